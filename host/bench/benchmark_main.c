@@ -0,0 +1,23 @@
+/**
+ *  @file
+ *
+ *  Runs the on-watch daily update benchmark (Benchmark.c) on the host, at
+ *  the default location, timed by the real clock.  Results are JSON lines
+ *  on stdout, as from "pebble logs", so the same scripts compare them.
+ */
+
+#include  "host.h"
+
+#include  "Benchmark.h"
+#include  "ConfigData.h"
+
+
+int  main(void)
+{
+   host_clock_use_real_ms(true);
+   config_data_init();
+
+   benchmark_run();
+
+   return 0;
+}
@@ -0,0 +1,26 @@
+/**
+ *  @file
+ *
+ *  Runs the on-watch my_math sweep (MathSweep.c) on the host, at the
+ *  default location (London), timed by the real clock.  Results are JSON
+ *  lines on stdout, as from "pebble logs".
+ *
+ *  The ns per call figures come out at or near zero here: the sweep times
+ *  with whole milliseconds, sized for the watch's speed.
+ */
+
+#include  "host.h"
+
+#include  "ConfigData.h"
+#include  "MathSweep.h"
+
+
+int  main(void)
+{
+   host_clock_use_real_ms(true);
+   config_data_init();
+
+   math_sweep_run();
+
+   return 0;
+}
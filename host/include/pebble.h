@@ -0,0 +1,427 @@
+/**
+ *  @file
+ *
+ *  Host stand-in for the Pebble SDK 3 (aplite) pebble.h: just the types,
+ *  constants and calls the portable sunclock modules use, so that they
+ *  build and run on a desktop machine.  Types follow the SDK's where the
+ *  difference could hide a bug (GColor is the SDK 3 GColor8 union, so
+ *  comparing colours with == fails to build here as on the watch).
+ *
+ *  The calls are implemented in host/stubs/; host/stubs/host.h has the
+ *  hooks tests use to drive them.
+ */
+
+#pragma once
+
+#include  <stdbool.h>
+#include  <stddef.h>
+#include  <stdint.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+
+
+// ------------------------------------------------
+//  Time
+
+#define  SECONDS_PER_MINUTE   60
+#define  SECONDS_PER_HOUR     3600
+#define  SECONDS_PER_DAY      86400
+
+typedef enum
+{
+   SECOND_UNIT = 1 << 0,
+   MINUTE_UNIT = 1 << 1,
+   HOUR_UNIT   = 1 << 2,
+   DAY_UNIT    = 1 << 3,
+   MONTH_UNIT  = 1 << 4,
+   YEAR_UNIT   = 1 << 5,
+} TimeUnits;
+
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+
+uint16_t  time_ms(time_t *tloc, uint16_t *out_ms);
+bool  clock_is_24h_style(void);
+bool  clock_is_timezone_set(void);
+
+void  tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void  tick_timer_service_unsubscribe(void);
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+
+AppTimer*  app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data);
+bool  app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms);
+void  app_timer_cancel(AppTimer *timer_handle);
+
+
+// ------------------------------------------------
+//  Logging
+
+typedef enum
+{
+   APP_LOG_LEVEL_ERROR         = 1,
+   APP_LOG_LEVEL_WARNING       = 50,
+   APP_LOG_LEVEL_INFO          = 100,
+   APP_LOG_LEVEL_DEBUG         = 200,
+   APP_LOG_LEVEL_DEBUG_VERBOSE = 255,
+} AppLogLevel;
+
+void  app_log(uint8_t log_level, const char *src_filename, int src_line_number,
+              const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+
+#define  APP_LOG(level, fmt, args...)  \
+   app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+
+// ------------------------------------------------
+//  Integer trig
+
+#define  TRIG_MAX_RATIO   0xffff
+#define  TRIG_MAX_ANGLE   0x10000
+
+int32_t  sin_lookup(int32_t angle);
+int32_t  cos_lookup(int32_t angle);
+int32_t  atan2_lookup(int16_t y, int16_t x);
+
+
+// ------------------------------------------------
+//  Persistent storage
+
+#define  PERSIST_DATA_MAX_LENGTH    256
+#define  PERSIST_STRING_MAX_LENGTH  PERSIST_DATA_MAX_LENGTH
+
+typedef enum
+{
+   S_SUCCESS          = 0,
+   S_TRUE             = 1,
+   S_FALSE            = 0,
+   E_ERROR            = -1,
+   E_UNKNOWN          = -2,
+   E_INTERNAL         = -3,
+   E_INVALID_ARGUMENT = -4,
+   E_OUT_OF_MEMORY    = -5,
+   E_OUT_OF_STORAGE   = -6,
+   E_OUT_OF_RESOURCES = -7,
+   E_RANGE            = -8,
+   E_DOES_NOT_EXIST   = -9,
+   E_INVALID_OPERATION = -10,
+   E_BUSY             = -11,
+} StatusCode;
+
+typedef int32_t status_t;
+
+bool  persist_exists(const uint32_t key);
+int  persist_get_size(const uint32_t key);
+int  persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size);
+int32_t  persist_read_int(const uint32_t key);
+status_t  persist_write_data(const uint32_t key, const void *data, const size_t size);
+status_t  persist_write_int(const uint32_t key, const int32_t value);
+status_t  persist_delete(const uint32_t key);
+
+
+// ------------------------------------------------
+//  Resources
+
+typedef void *ResHandle;
+
+///  The ids the resource build would generate, for the resources the
+///  portable modules load (see appinfo.json).
+enum
+{
+   RESOURCE_ID_SOLAR_EPHEMERIS = 1,
+   RESOURCE_ID_HOUR_HAND_ATLAS,
+};
+
+ResHandle  resource_get_handle(uint32_t resource_id);
+size_t  resource_size(ResHandle h);
+size_t  resource_load(ResHandle h, uint8_t *buffer, size_t max_length);
+size_t  resource_load_byte_range(ResHandle h, uint32_t start_offset,
+                                 uint8_t *buffer, size_t num_bytes);
+
+
+// ------------------------------------------------
+//  Graphics
+
+typedef struct GPoint
+{
+   int16_t x;
+   int16_t y;
+} GPoint;
+
+typedef struct GSize
+{
+   int16_t w;
+   int16_t h;
+} GSize;
+
+typedef struct GRect
+{
+   GPoint origin;
+   GSize  size;
+} GRect;
+
+#define  GPoint(x, y)        ((GPoint) { (x), (y) })
+#define  GPointZero          GPoint(0, 0)
+#define  GSize(w, h)         ((GSize) { (w), (h) })
+#define  GSizeZero           GSize(0, 0)
+#define  GRect(x, y, w, h)   ((GRect) { { (x), (y) }, { (w), (h) } })
+#define  GRectZero           GRect(0, 0, 0, 0)
+
+bool  gpoint_equal(const GPoint * const point_a, const GPoint * const point_b);
+bool  grect_equal(const GRect * const rect_a, const GRect * const rect_b);
+GPoint  grect_center_point(const GRect *rect);
+
+///  SDK 3 colour: 2 bits each of alpha, red, green and blue.
+typedef union GColor8
+{
+   uint8_t argb;
+   struct
+   {
+      uint8_t b : 2;
+      uint8_t g : 2;
+      uint8_t r : 2;
+      uint8_t a : 2;
+   };
+} GColor8;
+
+typedef GColor8 GColor;
+
+#define  GColorClear   ((GColor8) { .argb = 0x00 })
+#define  GColorBlack   ((GColor8) { .argb = 0xC0 })
+#define  GColorWhite   ((GColor8) { .argb = 0xFF })
+
+bool  gcolor_equal(GColor8 x, GColor8 y);
+
+typedef enum
+{
+   GCompOpAssign,
+   GCompOpAssignInverted,
+   GCompOpOr,
+   GCompOpAnd,
+   GCompOpClear,
+   GCompOpSet,
+} GCompOp;
+
+typedef enum
+{
+   GBitmapFormat1Bit = 0,
+   GBitmapFormat8Bit,
+   GBitmapFormat1BitPalette,
+   GBitmapFormat2BitPalette,
+   GBitmapFormat4BitPalette,
+} GBitmapFormat;
+
+typedef struct GBitmap GBitmap;
+typedef struct GContext GContext;
+
+GBitmap*  gbitmap_create_blank(GSize size, GBitmapFormat format);
+GBitmap*  gbitmap_create_with_resource(uint32_t resource_id);
+void  gbitmap_destroy(GBitmap *bitmap);
+uint8_t*  gbitmap_get_data(const GBitmap *bitmap);
+uint16_t  gbitmap_get_bytes_per_row(const GBitmap *bitmap);
+GRect  gbitmap_get_bounds(const GBitmap *bitmap);
+
+GBitmap*  graphics_capture_frame_buffer(GContext *ctx);
+bool  graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+void  graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+void  graphics_context_set_fill_color(GContext *ctx, GColor color);
+void  graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void  graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+typedef enum
+{
+   GCornerNone = 0,
+   GCornersAll = 0x0f
+} GCornerMask;
+
+void  graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+void  graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1);
+void  graphics_draw_pixel(GContext *ctx, GPoint point);
+
+typedef struct GPathInfo
+{
+   uint32_t num_points;
+   GPoint  *points;
+} GPathInfo;
+
+typedef struct GPath GPath;
+
+GPath*  gpath_create(const GPathInfo *init);
+void  gpath_destroy(GPath *gpath);
+void  gpath_move_to(GPath *path, GPoint point);
+void  gpath_draw_filled(GContext *ctx, GPath *path);
+
+
+// ------------------------------------------------
+//  Dictionaries and AppMessage
+
+typedef enum
+{
+   DICT_OK                = 0,
+   DICT_NOT_ENOUGH_STORAGE = 1 << 1,
+   DICT_INVALID_ARGS      = 1 << 2,
+   DICT_INTERNAL_INCONSISTENCY = 1 << 3,
+   DICT_MALLOC_FAILED     = 1 << 4,
+} DictionaryResult;
+
+typedef enum
+{
+   TUPLE_BYTE_ARRAY = 0,
+   TUPLE_CSTRING    = 1,
+   TUPLE_UINT       = 2,
+   TUPLE_INT        = 3,
+} TupleType;
+
+typedef struct __attribute__((__packed__))
+{
+   uint32_t  key;
+   TupleType type : 8;
+   uint16_t  length;
+   union
+   {
+      uint8_t  data[0];
+      char     cstring[0];
+      uint8_t  uint8;
+      uint16_t uint16;
+      uint32_t uint32;
+      int8_t   int8;
+      int16_t  int16;
+      int32_t  int32;
+   } value[];
+} Tuple;
+
+typedef struct Dictionary Dictionary;
+
+typedef struct
+{
+   Dictionary *dictionary;
+   const void *end;
+   Tuple      *cursor;
+} DictionaryIterator;
+
+typedef struct
+{
+   TupleType type;
+   uint32_t  key;
+   union
+   {
+      struct
+      {
+         const uint8_t *data;
+         const uint16_t length;
+      } bytes;
+      struct
+      {
+         const char *data;
+         const uint16_t length;
+      } cstring;
+      struct
+      {
+         uint32_t storage;
+         const uint16_t width;
+      } integer;
+   };
+} Tuplet;
+
+#define  TupletBytes(_key, _data, _length) \
+   ((const Tuplet) { .type = TUPLE_BYTE_ARRAY, .key = _key, .bytes = { .data = _data, .length = _length } })
+#define  TupletInteger(_key, _integer) \
+   ((const Tuplet) { .type = TUPLE_INT, .key = _key, .integer = { .storage = _integer, .width = sizeof(_integer) } })
+
+uint32_t  dict_calc_buffer_size(const uint8_t tuple_count, ...);
+DictionaryResult  dict_write_begin(DictionaryIterator *iter, uint8_t * const buffer, const uint16_t size);
+DictionaryResult  dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size);
+DictionaryResult  dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char * const cstring);
+DictionaryResult  dict_write_int(DictionaryIterator *iter, const uint32_t key, const void *integer, const uint8_t width_bytes, const bool is_signed);
+DictionaryResult  dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value);
+DictionaryResult  dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value);
+DictionaryResult  dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value);
+DictionaryResult  dict_write_int8(DictionaryIterator *iter, const uint32_t key, const int8_t value);
+DictionaryResult  dict_write_int16(DictionaryIterator *iter, const uint32_t key, const int16_t value);
+DictionaryResult  dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value);
+DictionaryResult  dict_write_tuplet(DictionaryIterator *iter, const Tuplet * const tuplet);
+uint32_t  dict_write_end(DictionaryIterator *iter);
+Tuple*  dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t * const buffer, const uint16_t size);
+Tuple*  dict_read_first(DictionaryIterator *iter);
+Tuple*  dict_read_next(DictionaryIterator *iter);
+Tuple*  dict_find(const DictionaryIterator *iter, const uint32_t key);
+
+typedef enum
+{
+   APP_MSG_OK                          = 0,
+   APP_MSG_SEND_TIMEOUT                = 1 << 1,
+   APP_MSG_SEND_REJECTED               = 1 << 2,
+   APP_MSG_NOT_CONNECTED               = 1 << 3,
+   APP_MSG_APP_NOT_RUNNING             = 1 << 4,
+   APP_MSG_INVALID_ARGS                = 1 << 5,
+   APP_MSG_BUSY                        = 1 << 6,
+   APP_MSG_BUFFER_OVERFLOW             = 1 << 7,
+   APP_MSG_ALREADY_RELEASED            = 1 << 9,
+   APP_MSG_CALLBACK_ALREADY_REGISTERED = 1 << 10,
+   APP_MSG_CALLBACK_NOT_REGISTERED     = 1 << 11,
+   APP_MSG_OUT_OF_MEMORY               = 1 << 12,
+   APP_MSG_CLOSED                      = 1 << 13,
+   APP_MSG_INTERNAL_ERROR              = 1 << 14,
+   APP_MSG_INVALID_STATE               = 1 << 15,
+} AppMessageResult;
+
+#define  APP_MESSAGE_INBOX_SIZE_MINIMUM   124
+#define  APP_MESSAGE_OUTBOX_SIZE_MINIMUM  636
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void *context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator *iterator, AppMessageResult reason,
+                                       void *context);
+
+AppMessageResult  app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+void  app_message_deregister_callbacks(void);
+AppMessageInboxReceived  app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+AppMessageInboxDropped  app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback);
+AppMessageOutboxSent  app_message_register_outbox_sent(AppMessageOutboxSent sent_callback);
+AppMessageOutboxFailed  app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback);
+AppMessageResult  app_message_outbox_begin(DictionaryIterator **iterator);
+AppMessageResult  app_message_outbox_send(void);
+
+typedef void (*ConnectionHandler)(bool connected);
+
+typedef struct
+{
+   ConnectionHandler pebble_app_connection_handler;
+   ConnectionHandler pebblekit_connection_handler;
+} ConnectionHandlers;
+
+void  connection_service_subscribe(ConnectionHandlers conn_handlers);
+void  connection_service_unsubscribe(void);
+bool  connection_service_peek_pebble_app_connection(void);
+
+
+// ------------------------------------------------
+//  Background worker
+
+typedef enum
+{
+   APP_WORKER_RESULT_SUCCESS            = 0,
+   APP_WORKER_RESULT_NO_WORKER          = 1,
+   APP_WORKER_RESULT_DIFFERENT_APP      = 2,
+   APP_WORKER_RESULT_NOT_RUNNING        = 3,
+   APP_WORKER_RESULT_ALREADY_RUNNING    = 4,
+   APP_WORKER_RESULT_ASKING_CONFIRMATION = 5,
+} AppWorkerResult;
+
+typedef struct
+{
+   uint16_t data0;
+   uint16_t data1;
+   uint16_t data2;
+} AppWorkerMessage;
+
+typedef void (*AppWorkerMessageHandler)(uint16_t type, AppWorkerMessage *data);
+
+bool  app_worker_is_running(void);
+AppWorkerResult  app_worker_launch(void);
+AppWorkerResult  app_worker_kill(void);
+bool  app_worker_message_subscribe(AppWorkerMessageHandler handler);
+bool  app_worker_message_unsubscribe(void);
+void  app_worker_send_message(uint8_t type, AppWorkerMessage *data);
@@ -0,0 +1,157 @@
+/**
+ *  @file
+ *
+ *  Hooks for host tests to drive the stand-in Pebble calls: a virtual
+ *  clock and timer queue, in-memory persistent storage, a fake screen,
+ *  and a scriptable phone on the far side of app_message.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+// ------------------------------------------------
+//  Clock and timers (host_clock.c)
+
+/**
+ *  Set the virtual clock.  time(), time_ms() and app_timer_* all run from
+ *  it, so tests don't wait on the real one.  It starts at
+ *  HOST_CLOCK_DEFAULT_TIME.
+ *
+ *  @param seconds Seconds since 1970, UTC.
+ */
+void  host_clock_set(time_t seconds);
+
+///  Where the virtual clock starts: 2016-03-01 12:00:00 UTC.
+#define  HOST_CLOCK_DEFAULT_TIME   1456833600
+
+///  Move the virtual clock on, without firing timers.
+void  host_clock_advance_ms(uint32_t ms);
+
+///  Virtual clock, in ms since 1970.
+uint64_t  host_clock_now_ms(void);
+
+/**
+ *  Have time_ms() read the real clock rather than the virtual one, for
+ *  timing code.  time() and timers stay virtual.
+ */
+void  host_clock_use_real_ms(bool fReal);
+
+/**
+ *  Run the virtual clock limitMs on, firing timers as they fall due (and
+ *  any they register in turn), in due order.
+ *
+ *  @return Timers fired.
+ */
+int  host_timers_run(uint32_t limitMs);
+
+///  Timers registered and not yet fired or cancelled.
+int  host_timers_pending(void);
+
+///  Drop all timers, unfired.
+void  host_timers_reset(void);
+
+///  Local time is UTC plus this many seconds (for localtime() et al).
+void  host_clock_set_local_offset(int32_t seconds);
+
+
+// ------------------------------------------------
+//  Persistent storage (host_persist.c)
+
+///  Forget everything stored.
+void  host_persist_reset(void);
+
+///  persist_write_data() calls since the last reset.
+int  host_persist_writes(void);
+
+
+// ------------------------------------------------
+//  Graphics (host_graphics.c)
+
+/**
+ *  A graphics context over a 1-bit framebuffer of the given size, with
+ *  the same row padding as aplite's.  It can refuse framebuffer captures,
+ *  for the paths that fall back when they can't have it.
+ */
+GContext*  host_gcontext_create(GSize size);
+void  host_gcontext_destroy(GContext *ctx);
+
+///  The context's framebuffer.
+GBitmap*  host_gcontext_get_frame_buffer(GContext *ctx);
+
+///  Have graphics_capture_frame_buffer() fail (return NULL), or not.
+void  host_gcontext_refuse_capture(GContext *ctx, bool fRefuse);
+
+///  gpath_draw_filled() and graphics_draw_bitmap_in_rect() calls on the
+///  context.
+int  host_gcontext_path_fills(GContext *ctx);
+int  host_gcontext_bitmap_draws(GContext *ctx);
+
+///  Value (0 or 1) of one pixel of a 1-bit bitmap.
+int  host_gbitmap_get_pixel(const GBitmap *pBitmap, int x, int y);
+
+
+// ------------------------------------------------
+//  Phone link (host_app_message.c)
+
+/**
+ *  Called for each message the watch sends, once app_message_outbox_send()
+ *  has accepted it.  The phone must finish the send with
+ *  host_app_message_outbox_done(), now or from a timer, and may answer with
+ *  host_app_message_deliver().
+ *
+ *  @return What app_message_outbox_send() returns.  Anything but
+ *          APP_MSG_OK also fails the send at once.
+ */
+typedef AppMessageResult (*HostPhoneHandler)(DictionaryIterator *pSent);
+
+///  Use handler as the phone.  NULL for none, when sends stay in flight.
+void  host_app_message_set_phone(HostPhoneHandler handler);
+
+///  Finish the send in flight: the outbox sent or failed callback is called.
+void  host_app_message_outbox_done(AppMessageResult result);
+
+///  Is a send in flight?
+bool  host_app_message_outbox_busy(void);
+
+///  Hand a message from the phone to the inbox received callback.
+void  host_app_message_deliver(const uint8_t *pBuffer, uint16_t size);
+
+///  Messages sent since the last reset.
+int  host_app_message_sends(void);
+
+///  The last message sent, as a buffer dict_read_begin_from_buffer() takes.
+const uint8_t*  host_app_message_last_sent(uint16_t *pSize);
+
+///  Connect or disconnect the phone, telling any subscribed handler.
+void  host_connection_set(bool fConnected);
+
+///  Drop the callbacks, any send in flight, the phone, and the counts.
+void  host_app_message_reset(void);
+
+
+// ------------------------------------------------
+//  Background worker (host_worker.c)
+
+///  Whether app_worker_is_running() says a worker is running.
+void  host_worker_set_running(bool fRunning);
+
+///  Messages the app sent the worker since the last reset.
+int  host_worker_messages(void);
+
+///  Type and data of the last message the app sent the worker.
+uint8_t  host_worker_last_message(AppWorkerMessage *pData);
+
+///  Hand a message from the worker to the app's subscribed handler.
+void  host_worker_send_to_app(uint16_t type, uint16_t data0, uint16_t data1, uint16_t data2);
+
+void  host_worker_reset(void);
+
+
+// ------------------------------------------------
+//  Logging (host_misc.c)
+
+///  Print APP_LOG output at this level or more urgent.  APP_LOG_LEVEL_INFO
+///  by default, or set by HOST_LOG_LEVEL in the environment.
+void  host_log_set_level(AppLogLevel level);
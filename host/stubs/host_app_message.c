@@ -0,0 +1,247 @@
+/**
+ *  @file
+ *
+ *  app_message and connection_service, with a scriptable phone behind them
+ *  (see HostPhoneHandler).
+ */
+
+#include  "host.h"
+
+
+///  Room for any message either way.
+#define  HOST_MESSAGE_BYTES   256
+
+static AppMessageInboxReceived inboxReceived = NULL;
+static AppMessageInboxDropped  inboxDropped  = NULL;
+static AppMessageOutboxSent    outboxSent    = NULL;
+static AppMessageOutboxFailed  outboxFailed  = NULL;
+static ConnectionHandler       connectionHandler = NULL;
+
+static HostPhoneHandler phoneHandler = NULL;
+
+static uint8_t  aOutbox[HOST_MESSAGE_BYTES];
+static uint16_t outboxBytes = 0;
+static DictionaryIterator outboxIter;
+static bool fOutboxOpen = false;
+static bool fOutboxInFlight = false;
+
+static bool fConnected = true;
+
+static int sends = 0;
+
+
+void  host_app_message_set_phone(HostPhoneHandler handler)
+{
+   phoneHandler = handler;
+}
+
+bool  host_app_message_outbox_busy(void)
+{
+   return fOutboxInFlight;
+}
+
+int  host_app_message_sends(void)
+{
+   return sends;
+}
+
+const uint8_t*  host_app_message_last_sent(uint16_t *pSize)
+{
+   if (pSize != NULL)
+   {
+      *pSize = outboxBytes;
+   }
+   return aOutbox;
+}
+
+
+void  host_app_message_reset(void)
+{
+   app_message_deregister_callbacks();
+   connectionHandler = NULL;
+   phoneHandler = NULL;
+   fOutboxOpen = false;
+   fOutboxInFlight = false;
+   fConnected = true;
+   outboxBytes = 0;
+   sends = 0;
+}
+
+
+void  host_app_message_outbox_done(AppMessageResult result)
+{
+
+   if (!fOutboxInFlight)
+   {
+      return;
+   }
+   fOutboxInFlight = false;
+
+   DictionaryIterator iter;
+   dict_read_begin_from_buffer(&iter, aOutbox, outboxBytes);
+
+   if (result == APP_MSG_OK)
+   {
+      if (outboxSent != NULL)
+      {
+         (*outboxSent)(&iter, NULL);
+      }
+   }
+   else if (outboxFailed != NULL)
+   {
+      (*outboxFailed)(&iter, result, NULL);
+   }
+
+}  /* end of host_app_message_outbox_done */
+
+
+void  host_app_message_deliver(const uint8_t *pBuffer, uint16_t size)
+{
+
+   if (!fConnected)
+   {
+      return;
+   }
+
+   if (inboxReceived == NULL)
+   {
+      if (inboxDropped != NULL)
+      {
+         (*inboxDropped)(APP_MSG_CALLBACK_NOT_REGISTERED, NULL);
+      }
+      return;
+   }
+
+   DictionaryIterator iter;
+   dict_read_begin_from_buffer(&iter, pBuffer, size);
+   (*inboxReceived)(&iter, NULL);
+
+}  /* end of host_app_message_deliver */
+
+
+void  host_connection_set(bool fNowConnected)
+{
+
+   bool fChanged = (fConnected != fNowConnected);
+   fConnected = fNowConnected;
+
+   if (fChanged && (connectionHandler != NULL))
+   {
+      (*connectionHandler)(fConnected);
+   }
+
+}  /* end of host_connection_set */
+
+
+AppMessageResult  app_message_open(const uint32_t size_inbound, const uint32_t size_outbound)
+{
+   return ((size_inbound <= HOST_MESSAGE_BYTES) && (size_outbound <= HOST_MESSAGE_BYTES)) ?
+             APP_MSG_OK : APP_MSG_OUT_OF_MEMORY;
+}
+
+
+void  app_message_deregister_callbacks(void)
+{
+   inboxReceived = NULL;
+   inboxDropped  = NULL;
+   outboxSent    = NULL;
+   outboxFailed  = NULL;
+}
+
+
+AppMessageInboxReceived  app_message_register_inbox_received(AppMessageInboxReceived received_callback)
+{
+   AppMessageInboxReceived old = inboxReceived;
+   inboxReceived = received_callback;
+   return old;
+}
+
+AppMessageInboxDropped  app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback)
+{
+   AppMessageInboxDropped old = inboxDropped;
+   inboxDropped = dropped_callback;
+   return old;
+}
+
+AppMessageOutboxSent  app_message_register_outbox_sent(AppMessageOutboxSent sent_callback)
+{
+   AppMessageOutboxSent old = outboxSent;
+   outboxSent = sent_callback;
+   return old;
+}
+
+AppMessageOutboxFailed  app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback)
+{
+   AppMessageOutboxFailed old = outboxFailed;
+   outboxFailed = failed_callback;
+   return old;
+}
+
+
+AppMessageResult  app_message_outbox_begin(DictionaryIterator **iterator)
+{
+
+   if (fOutboxInFlight)
+   {
+      return APP_MSG_BUSY;
+   }
+
+   dict_write_begin(&outboxIter, aOutbox, sizeof(aOutbox));
+   fOutboxOpen = true;
+   *iterator = &outboxIter;
+
+   return APP_MSG_OK;
+
+}  /* end of app_message_outbox_begin */
+
+
+AppMessageResult  app_message_outbox_send(void)
+{
+
+   if (!fOutboxOpen)
+   {
+      return APP_MSG_INVALID_STATE;
+   }
+   fOutboxOpen = false;
+
+   if (!fConnected)
+   {
+      return APP_MSG_NOT_CONNECTED;
+   }
+
+   outboxBytes = (uint16_t) dict_write_end(&outboxIter);
+   fOutboxInFlight = true;
+   sends++;
+
+   if (phoneHandler == NULL)
+   {
+      return APP_MSG_OK;
+   }
+
+   DictionaryIterator iter;
+   dict_read_begin_from_buffer(&iter, aOutbox, outboxBytes);
+   AppMessageResult result = (*phoneHandler)(&iter);
+   if (result != APP_MSG_OK)
+   {
+      fOutboxInFlight = false;
+   }
+
+   return result;
+
+}  /* end of app_message_outbox_send */
+
+
+void  connection_service_subscribe(ConnectionHandlers conn_handlers)
+{
+   connectionHandler = conn_handlers.pebble_app_connection_handler;
+}
+
+void  connection_service_unsubscribe(void)
+{
+   connectionHandler = NULL;
+}
+
+bool  connection_service_peek_pebble_app_connection(void)
+{
+   return fConnected;
+}
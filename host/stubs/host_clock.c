@@ -0,0 +1,221 @@
+/**
+ *  @file
+ *
+ *  Virtual clock and app_timer queue.  time() is taken over from the C
+ *  library, so that the modules under test and the tests share one clock.
+ */
+
+#include  "host.h"
+
+#include  <sys/time.h>
+
+
+///  Most timers registered at once.
+#define  HOST_MAX_TIMERS   256
+
+struct AppTimer
+{
+   uint64_t          dueMs;
+   uint32_t          serial;
+   AppTimerCallback  callback;
+   void             *pData;
+   bool              fLive;
+};
+
+static AppTimer aTimers[HOST_MAX_TIMERS];
+
+///  Registration order, so timers due at the same ms fire in it.
+static uint32_t nextSerial = 0;
+
+static uint64_t nowMs = (uint64_t) HOST_CLOCK_DEFAULT_TIME * 1000;
+
+static bool fRealMs = false;
+
+static int32_t localOffset = 0;
+
+
+void  host_clock_set(time_t seconds)
+{
+   nowMs = (uint64_t) seconds * 1000;
+}
+
+void  host_clock_advance_ms(uint32_t ms)
+{
+   nowMs += ms;
+}
+
+uint64_t  host_clock_now_ms(void)
+{
+   return nowMs;
+}
+
+void  host_clock_use_real_ms(bool fReal)
+{
+   fRealMs = fReal;
+}
+
+void  host_clock_set_local_offset(int32_t seconds)
+{
+   localOffset = seconds;
+}
+
+
+time_t  time(time_t *tloc)
+{
+   time_t now = (time_t) (nowMs / 1000);
+   if (tloc != NULL)
+   {
+      *tloc = now;
+   }
+   return now;
+}
+
+
+uint16_t  time_ms(time_t *tloc, uint16_t *out_ms)
+{
+
+   time_t   secs = (time_t) (nowMs / 1000);
+   uint16_t ms   = (uint16_t) (nowMs % 1000);
+
+   if (fRealMs)
+   {
+      struct timeval tv;
+      gettimeofday(&tv, NULL);
+      secs = tv.tv_sec;
+      ms   = (uint16_t) (tv.tv_usec / 1000);
+   }
+
+   if (tloc != NULL)
+   {
+      *tloc = secs;
+   }
+   if (out_ms != NULL)
+   {
+      *out_ms = ms;
+   }
+
+   return ms;
+
+}  /* end of time_ms */
+
+
+///  localtime() with the offset set by host_clock_set_local_offset(), not TZ.
+struct tm*  localtime(const time_t *timep)
+{
+   static struct tm tmLocal;
+
+   time_t local = *timep + localOffset;
+   gmtime_r(&local, &tmLocal);
+   tmLocal.tm_gmtoff = localOffset;
+   return &tmLocal;
+}
+
+
+bool  clock_is_24h_style(void)
+{
+   return true;
+}
+
+bool  clock_is_timezone_set(void)
+{
+   return true;
+}
+
+
+AppTimer*  app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data)
+{
+
+   for (int i = 0; i < HOST_MAX_TIMERS; i++)
+   {
+      if (!aTimers[i].fLive)
+      {
+         aTimers[i].dueMs    = nowMs + timeout_ms;
+         aTimers[i].serial   = nextSerial++;
+         aTimers[i].callback = callback;
+         aTimers[i].pData    = callback_data;
+         aTimers[i].fLive    = true;
+         return &aTimers[i];
+      }
+   }
+
+   return NULL;
+
+}  /* end of app_timer_register */
+
+
+bool  app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms)
+{
+   if ((timer_handle == NULL) || !timer_handle->fLive)
+   {
+      return false;
+   }
+
+   timer_handle->dueMs = nowMs + new_timeout_ms;
+   return true;
+}
+
+
+void  app_timer_cancel(AppTimer *timer_handle)
+{
+   if (timer_handle != NULL)
+   {
+      timer_handle->fLive = false;
+   }
+}
+
+
+int  host_timers_run(uint32_t limitMs)
+{
+
+   uint64_t endMs = nowMs + limitMs;
+   int fired = 0;
+
+   for (;;)
+   {
+      AppTimer *pNext = NULL;
+      for (int i = 0; i < HOST_MAX_TIMERS; i++)
+      {
+         AppTimer *p = &aTimers[i];
+         if (p->fLive &&
+             ((pNext == NULL) || (p->dueMs < pNext->dueMs) ||
+              ((p->dueMs == pNext->dueMs) && (p->serial < pNext->serial))))
+         {
+            pNext = p;
+         }
+      }
+
+      if ((pNext == NULL) || (pNext->dueMs > endMs))
+      {
+         break;
+      }
+
+      if (pNext->dueMs > nowMs)
+      {
+         nowMs = pNext->dueMs;
+      }
+      pNext->fLive = false;
+      (*pNext->callback)(pNext->pData);
+      fired++;
+   }
+
+   nowMs = endMs;
+   return fired;
+
+}  /* end of host_timers_run */
+
+
+int  host_timers_pending(void)
+{
+   int pending = 0;
+   for (int i = 0; i < HOST_MAX_TIMERS; i++)
+   {
+      pending += aTimers[i].fLive ? 1 : 0;
+   }
+   return pending;
+}
+
+
+void  host_timers_reset(void)
+{
+   memset(aTimers, 0, sizeof(aTimers));
+}
@@ -0,0 +1,225 @@
+/**
+ *  @file
+ *
+ *  Dictionaries, laid out as PebbleOS does: a count byte, then each tuple's
+ *  header (Tuple) followed by its value.
+ */
+
+#include  "host.h"
+
+#include  <stdarg.h>
+
+
+uint32_t  dict_calc_buffer_size(const uint8_t tuple_count, ...)
+{
+
+   uint32_t size = 1 + (tuple_count * sizeof(Tuple));
+
+   va_list args;
+   va_start(args, tuple_count);
+   for (int i = 0; i < tuple_count; i++)
+   {
+      size += va_arg(args, uint32_t);
+   }
+   va_end(args);
+
+   return size;
+
+}  /* end of dict_calc_buffer_size */
+
+
+DictionaryResult  dict_write_begin(DictionaryIterator *iter, uint8_t * const buffer,
+                                   const uint16_t size)
+{
+
+   if ((iter == NULL) || (buffer == NULL) || (size < 1))
+   {
+      return DICT_INVALID_ARGS;
+   }
+
+   iter->dictionary = (Dictionary *) buffer;
+   iter->end        = buffer + size;
+   iter->cursor     = (Tuple *) (buffer + 1);
+   buffer[0] = 0;
+
+   return DICT_OK;
+
+}  /* end of dict_write_begin */
+
+
+static DictionaryResult  host_dict_write(DictionaryIterator *iter, uint32_t key, TupleType type,
+                                         const void *pValue, uint16_t length)
+{
+
+   uint8_t *pTuple = (uint8_t *) iter->cursor;
+   if (pTuple + sizeof(Tuple) + length > (const uint8_t *) iter->end)
+   {
+      return DICT_NOT_ENOUGH_STORAGE;
+   }
+
+   iter->cursor->key    = key;
+   iter->cursor->type   = type;
+   iter->cursor->length = length;
+   memcpy(pTuple + sizeof(Tuple), pValue, length);
+
+   iter->cursor = (Tuple *) (pTuple + sizeof(Tuple) + length);
+   ((uint8_t *) iter->dictionary)[0]++;
+
+   return DICT_OK;
+
+}  /* end of host_dict_write */
+
+
+DictionaryResult  dict_write_data(DictionaryIterator *iter, const uint32_t key,
+                                  const uint8_t * const data, const uint16_t size)
+{
+   return host_dict_write(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult  dict_write_cstring(DictionaryIterator *iter, const uint32_t key,
+                                     const char * const cstring)
+{
+   return host_dict_write(iter, key, TUPLE_CSTRING, cstring, (uint16_t) (strlen(cstring) + 1));
+}
+
+DictionaryResult  dict_write_int(DictionaryIterator *iter, const uint32_t key,
+                                 const void *integer, const uint8_t width_bytes,
+                                 const bool is_signed)
+{
+   return host_dict_write(iter, key, is_signed ? TUPLE_INT : TUPLE_UINT, integer, width_bytes);
+}
+
+DictionaryResult  dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value)
+{
+   return host_dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult  dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value)
+{
+   return host_dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult  dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value)
+{
+   return host_dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult  dict_write_int8(DictionaryIterator *iter, const uint32_t key, const int8_t value)
+{
+   return host_dict_write(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+DictionaryResult  dict_write_int16(DictionaryIterator *iter, const uint32_t key, const int16_t value)
+{
+   return host_dict_write(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+DictionaryResult  dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value)
+{
+   return host_dict_write(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+
+DictionaryResult  dict_write_tuplet(DictionaryIterator *iter, const Tuplet * const tuplet)
+{
+
+   switch (tuplet->type)
+   {
+   case TUPLE_BYTE_ARRAY:
+      return host_dict_write(iter, tuplet->key, tuplet->type, tuplet->bytes.data,
+                             tuplet->bytes.length);
+
+   case TUPLE_CSTRING:
+      return host_dict_write(iter, tuplet->key, tuplet->type, tuplet->cstring.data,
+                             tuplet->cstring.length);
+
+   default:
+      //  little endian, so the low bytes of the storage are the value.
+      return host_dict_write(iter, tuplet->key, tuplet->type, &tuplet->integer.storage,
+                             tuplet->integer.width);
+   }
+
+}  /* end of dict_write_tuplet */
+
+
+uint32_t  dict_write_end(DictionaryIterator *iter)
+{
+   iter->end = iter->cursor;
+   return (uint32_t) ((uint8_t *) iter->cursor - (uint8_t *) iter->dictionary);
+}
+
+
+Tuple*  dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t * const buffer,
+                                    const uint16_t size)
+{
+   iter->dictionary = (Dictionary *) buffer;
+   iter->end        = buffer + size;
+   return dict_read_first(iter);
+}
+
+
+///  Is pTuple a whole tuple within the dictionary?
+static bool  host_dict_tuple_ok(const DictionaryIterator *iter, const Tuple *pTuple)
+{
+   const uint8_t *p = (const uint8_t *) pTuple;
+   return (p + sizeof(Tuple) <= (const uint8_t *) iter->end) &&
+          (p + sizeof(Tuple) + pTuple->length <= (const uint8_t *) iter->end);
+}
+
+
+Tuple*  dict_read_first(DictionaryIterator *iter)
+{
+
+   uint8_t *pBuffer = (uint8_t *) iter->dictionary;
+   iter->cursor = (Tuple *) (pBuffer + 1);
+
+   if ((pBuffer[0] == 0) || !host_dict_tuple_ok(iter, iter->cursor))
+   {
+      return NULL;
+   }
+
+   return iter->cursor;
+
+}  /* end of dict_read_first */
+
+
+Tuple*  dict_read_next(DictionaryIterator *iter)
+{
+
+   //  Count the tuples up to the cursor, to know when to stop.
+   uint8_t *pBuffer = (uint8_t *) iter->dictionary;
+   Tuple *pTuple = (Tuple *) (pBuffer + 1);
+   int index = 0;
+   while (pTuple != iter->cursor)
+   {
+      pTuple = (Tuple *) ((uint8_t *) pTuple + sizeof(Tuple) + pTuple->length);
+      index++;
+   }
+
+   if (index + 1 >= pBuffer[0])
+   {
+      return NULL;
+   }
+
+   iter->cursor = (Tuple *) ((uint8_t *) iter->cursor + sizeof(Tuple) + iter->cursor->length);
+
+   return host_dict_tuple_ok(iter, iter->cursor) ? iter->cursor : NULL;
+
+}  /* end of dict_read_next */
+
+
+Tuple*  dict_find(const DictionaryIterator *iter, const uint32_t key)
+{
+
+   DictionaryIterator scan = *iter;
+   for (Tuple *pTuple = dict_read_first(&scan); pTuple != NULL; pTuple = dict_read_next(&scan))
+   {
+      if (pTuple->key == key)
+      {
+         return pTuple;
+      }
+   }
+
+   return NULL;
+
+}  /* end of dict_find */
@@ -0,0 +1,474 @@
+/**
+ *  @file
+ *
+ *  Just enough of the graphics calls to run the dial code against a real
+ *  1-bit framebuffer: bitmaps, blits, filled paths and rectangles.  Fills
+ *  take pixel centres inside the outline, which is close to, though not
+ *  exactly, what PebbleOS draws.
+ */
+
+#include  "host.h"
+
+
+struct GBitmap
+{
+   uint8_t  *pData;
+   uint16_t  rowBytes;
+   GRect     bounds;
+   bool      fOwnsData;
+};
+
+struct GContext
+{
+   GBitmap  frameBuffer;
+   bool     fRefuseCapture;
+   bool     fCaptured;
+   GColor   fillColor;
+   GColor   strokeColor;
+   GCompOp  compOp;
+   int      pathFills;
+   int      bitmapDraws;
+};
+
+struct GPath
+{
+   uint32_t numPoints;
+   GPoint  *pPoints;
+   GPoint   offset;
+};
+
+
+///  aplite pads 1-bit rows to whole 32 bit words.
+static uint16_t  host_row_bytes(int16_t width)
+{
+   return (uint16_t) (((width + 31) / 32) * 4);
+}
+
+
+// ------------------------------------------------
+//  Bitmaps
+
+
+GBitmap*  gbitmap_create_blank(GSize size, GBitmapFormat format)
+{
+
+   if ((format != GBitmapFormat1Bit) || (size.w <= 0) || (size.h <= 0))
+   {
+      return NULL;
+   }
+
+   GBitmap *pBitmap = calloc(1, sizeof(*pBitmap));
+   if (pBitmap == NULL)
+   {
+      return NULL;
+   }
+
+   pBitmap->rowBytes  = host_row_bytes(size.w);
+   pBitmap->bounds    = GRect(0, 0, size.w, size.h);
+   pBitmap->pData     = calloc(size.h, pBitmap->rowBytes);
+   pBitmap->fOwnsData = true;
+   if (pBitmap->pData == NULL)
+   {
+      free(pBitmap);
+      return NULL;
+   }
+
+   return pBitmap;
+
+}  /* end of gbitmap_create_blank */
+
+
+GBitmap*  gbitmap_create_with_resource(uint32_t resource_id)
+{
+   (void) resource_id;
+
+   //  No image resources on the host.
+   return NULL;
+}
+
+
+void  gbitmap_destroy(GBitmap *bitmap)
+{
+   if (bitmap != NULL)
+   {
+      if (bitmap->fOwnsData)
+      {
+         free(bitmap->pData);
+      }
+      free(bitmap);
+   }
+}
+
+
+uint8_t*  gbitmap_get_data(const GBitmap *bitmap)
+{
+   return bitmap->pData;
+}
+
+uint16_t  gbitmap_get_bytes_per_row(const GBitmap *bitmap)
+{
+   return bitmap->rowBytes;
+}
+
+GRect  gbitmap_get_bounds(const GBitmap *bitmap)
+{
+   return bitmap->bounds;
+}
+
+
+int  host_gbitmap_get_pixel(const GBitmap *pBitmap, int x, int y)
+{
+   return (pBitmap->pData[(y * pBitmap->rowBytes) + (x / 8)] >> (x % 8)) & 1;
+}
+
+
+static void  host_gbitmap_set_pixel(GBitmap *pBitmap, int x, int y, int value)
+{
+
+   GRect *pBounds = &pBitmap->bounds;
+   if ((x < pBounds->origin.x) || (x >= pBounds->origin.x + pBounds->size.w) ||
+       (y < pBounds->origin.y) || (y >= pBounds->origin.y + pBounds->size.h))
+   {
+      return;
+   }
+
+   uint8_t *pByte = &pBitmap->pData[(y * pBitmap->rowBytes) + (x / 8)];
+   uint8_t mask = (uint8_t) (1 << (x % 8));
+   *pByte = value ? (*pByte | mask) : (*pByte & ~mask);
+
+}  /* end of host_gbitmap_set_pixel */
+
+
+// ------------------------------------------------
+//  Contexts
+
+
+GContext*  host_gcontext_create(GSize size)
+{
+
+   GContext *ctx = calloc(1, sizeof(*ctx));
+
+   ctx->frameBuffer.rowBytes  = host_row_bytes(size.w);
+   ctx->frameBuffer.bounds    = GRect(0, 0, size.w, size.h);
+   ctx->frameBuffer.pData     = calloc(size.h, ctx->frameBuffer.rowBytes);
+   ctx->frameBuffer.fOwnsData = true;
+   ctx->fillColor   = GColorBlack;
+   ctx->strokeColor = GColorBlack;
+   ctx->compOp      = GCompOpAssign;
+
+   return ctx;
+
+}  /* end of host_gcontext_create */
+
+
+void  host_gcontext_destroy(GContext *ctx)
+{
+   if (ctx != NULL)
+   {
+      free(ctx->frameBuffer.pData);
+      free(ctx);
+   }
+}
+
+GBitmap*  host_gcontext_get_frame_buffer(GContext *ctx)
+{
+   return &ctx->frameBuffer;
+}
+
+void  host_gcontext_refuse_capture(GContext *ctx, bool fRefuse)
+{
+   ctx->fRefuseCapture = fRefuse;
+}
+
+int  host_gcontext_path_fills(GContext *ctx)
+{
+   return ctx->pathFills;
+}
+
+int  host_gcontext_bitmap_draws(GContext *ctx)
+{
+   return ctx->bitmapDraws;
+}
+
+
+GBitmap*  graphics_capture_frame_buffer(GContext *ctx)
+{
+
+   if (ctx->fRefuseCapture || ctx->fCaptured)
+   {
+      return NULL;
+   }
+
+   ctx->fCaptured = true;
+   return &ctx->frameBuffer;
+
+}  /* end of graphics_capture_frame_buffer */
+
+
+bool  graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer)
+{
+   if (!ctx->fCaptured || (buffer != &ctx->frameBuffer))
+   {
+      return false;
+   }
+
+   ctx->fCaptured = false;
+   return true;
+}
+
+
+void  graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode)
+{
+   ctx->compOp = mode;
+}
+
+void  graphics_context_set_fill_color(GContext *ctx, GColor color)
+{
+   ctx->fillColor = color;
+}
+
+void  graphics_context_set_stroke_color(GContext *ctx, GColor color)
+{
+   ctx->strokeColor = color;
+}
+
+
+///  1 for white, 0 for anything else, as 1-bit drawing takes colours.
+static int  host_color_bit(GColor color)
+{
+   return gcolor_equal(color, GColorWhite) ? 1 : 0;
+}
+
+
+bool  gcolor_equal(GColor8 x, GColor8 y)
+{
+   //  All clear colours are the same colour.
+   return (x.argb == y.argb) || ((x.a == 0) && (y.a == 0));
+}
+
+
+// ------------------------------------------------
+//  Drawing
+
+
+void  graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect)
+{
+
+   ctx->bitmapDraws++;
+
+   if (bitmap == NULL)
+   {
+      return;
+   }
+
+   //  The bitmap is tiled across rect.
+   GRect src = bitmap->bounds;
+   for (int y = 0; y < rect.size.h; y++)
+   {
+      for (int x = 0; x < rect.size.w; x++)
+      {
+         int dstX = rect.origin.x + x;
+         int dstY = rect.origin.y + y;
+         if ((dstX < 0) || (dstX >= ctx->frameBuffer.bounds.size.w) ||
+             (dstY < 0) || (dstY >= ctx->frameBuffer.bounds.size.h))
+         {
+            continue;
+         }
+
+         int s = host_gbitmap_get_pixel(bitmap, src.origin.x + (x % src.size.w),
+                                        src.origin.y + (y % src.size.h));
+         int d = host_gbitmap_get_pixel(&ctx->frameBuffer, dstX, dstY);
+
+         switch (ctx->compOp)
+         {
+         case GCompOpAssign:          d = s;       break;
+         case GCompOpAssignInverted:  d = !s;      break;
+         case GCompOpOr:              d = d | s;   break;
+         case GCompOpAnd:             d = d & s;   break;
+         case GCompOpClear:           d = d & !s;  break;
+         case GCompOpSet:             d = d | s;   break;
+         }
+
+         host_gbitmap_set_pixel(&ctx->frameBuffer, dstX, dstY, d);
+      }
+   }
+
+}  /* end of graphics_draw_bitmap_in_rect */
+
+
+void  graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask)
+{
+   (void) corner_radius;
+   (void) corner_mask;
+
+   int value = host_color_bit(ctx->fillColor);
+   for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++)
+   {
+      for (int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++)
+      {
+         host_gbitmap_set_pixel(&ctx->frameBuffer, x, y, value);
+      }
+   }
+}
+
+
+void  graphics_draw_pixel(GContext *ctx, GPoint point)
+{
+   host_gbitmap_set_pixel(&ctx->frameBuffer, point.x, point.y, host_color_bit(ctx->strokeColor));
+}
+
+
+void  graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1)
+{
+
+   //  Bresenham.
+   int dx = abs(p1.x - p0.x);
+   int dy = -abs(p1.y - p0.y);
+   int sx = (p0.x < p1.x) ? 1 : -1;
+   int sy = (p0.y < p1.y) ? 1 : -1;
+   int err = dx + dy;
+   int x = p0.x;
+   int y = p0.y;
+
+   for (;;)
+   {
+      graphics_draw_pixel(ctx, GPoint(x, y));
+      if ((x == p1.x) && (y == p1.y))
+      {
+         break;
+      }
+      int e2 = 2 * err;
+      if (e2 >= dy)
+      {
+         err += dy;
+         x += sx;
+      }
+      if (e2 <= dx)
+      {
+         err += dx;
+         y += sy;
+      }
+   }
+
+}  /* end of graphics_draw_line */
+
+
+// ------------------------------------------------
+//  Paths
+
+
+GPath*  gpath_create(const GPathInfo *init)
+{
+
+   GPath *pPath = calloc(1, sizeof(*pPath));
+   if (pPath == NULL)
+   {
+      return NULL;
+   }
+
+   //  Like PebbleOS, keep using the caller's points.
+   pPath->numPoints = init->num_points;
+   pPath->pPoints   = init->points;
+
+   return pPath;
+
+}  /* end of gpath_create */
+
+
+void  gpath_destroy(GPath *gpath)
+{
+   free(gpath);
+}
+
+
+void  gpath_move_to(GPath *path, GPoint point)
+{
+   path->offset = point;
+}
+
+
+void  gpath_draw_filled(GContext *ctx, GPath *path)
+{
+
+   ctx->pathFills++;
+
+   if (path->numPoints < 3)
+   {
+      return;
+   }
+
+   int value = host_color_bit(ctx->fillColor);
+   int height = ctx->frameBuffer.bounds.size.h;
+   int width  = ctx->frameBuffer.bounds.size.w;
+
+   //  Even-odd rule, sampled at pixel centres, one row at a time.
+   for (int y = 0; y < height; y++)
+   {
+      float yc = y + 0.5f;
+      float aCrossings[64];
+      int crossings = 0;
+
+      for (uint32_t i = 0; i < path->numPoints; i++)
+      {
+         GPoint a = path->pPoints[i];
+         GPoint b = path->pPoints[(i + 1) % path->numPoints];
+         float ay = a.y + path->offset.y;
+         float by = b.y + path->offset.y;
+         if (((ay <= yc) && (by > yc)) || ((by <= yc) && (ay > yc)))
+         {
+            float ax = a.x + path->offset.x;
+            float bx = b.x + path->offset.x;
+            if (crossings < (int) (sizeof(aCrossings) / sizeof(aCrossings[0])))
+            {
+               aCrossings[crossings++] = ax + ((yc - ay) * (bx - ax) / (by - ay));
+            }
+         }
+      }
+
+      //  (few enough for an insertion sort)
+      for (int i = 1; i < crossings; i++)
+      {
+         float f = aCrossings[i];
+         int j = i;
+         for ( ; (j > 0) && (aCrossings[j - 1] > f); j--)
+         {
+            aCrossings[j] = aCrossings[j - 1];
+         }
+         aCrossings[j] = f;
+      }
+
+      for (int i = 0; i + 1 < crossings; i += 2)
+      {
+         for (int x = 0; x < width; x++)
+         {
+            float xc = x + 0.5f;
+            if ((xc >= aCrossings[i]) && (xc < aCrossings[i + 1]))
+            {
+               host_gbitmap_set_pixel(&ctx->frameBuffer, x, y, value);
+            }
+         }
+      }
+   }
+
+}  /* end of gpath_draw_filled */
+
+
+// ------------------------------------------------
+//  Geometry
+
+
+bool  gpoint_equal(const GPoint * const point_a, const GPoint * const point_b)
+{
+   return (point_a->x == point_b->x) && (point_a->y == point_b->y);
+}
+
+bool  grect_equal(const GRect * const rect_a, const GRect * const rect_b)
+{
+   return gpoint_equal(&rect_a->origin, &rect_b->origin) &&
+          (rect_a->size.w == rect_b->size.w) && (rect_a->size.h == rect_b->size.h);
+}
+
+GPoint  grect_center_point(const GRect *rect)
+{
+   return GPoint(rect->origin.x + (rect->size.w / 2), rect->origin.y + (rect->size.h / 2));
+}
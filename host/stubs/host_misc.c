@@ -0,0 +1,173 @@
+/**
+ *  @file
+ *
+ *  Integer trig, resources, logging and tick service stand-ins.
+ */
+
+#include  "host.h"
+
+#include  <math.h>
+#include  <stdarg.h>
+
+
+// ------------------------------------------------
+//  Integer trig: from libm, rounded as PebbleOS' tables are.
+
+static const double HOST_PI = 3.14159265358979323846;
+
+int32_t  sin_lookup(int32_t angle)
+{
+   return (int32_t) lround(sin(angle * (2 * HOST_PI / TRIG_MAX_ANGLE)) * TRIG_MAX_RATIO);
+}
+
+int32_t  cos_lookup(int32_t angle)
+{
+   return (int32_t) lround(cos(angle * (2 * HOST_PI / TRIG_MAX_ANGLE)) * TRIG_MAX_RATIO);
+}
+
+int32_t  atan2_lookup(int16_t y, int16_t x)
+{
+   double angle = atan2(y, x);
+   if (angle < 0)
+   {
+      angle += 2 * HOST_PI;
+   }
+   return ((int32_t) lround(angle * (TRIG_MAX_ANGLE / (2 * HOST_PI)))) % TRIG_MAX_ANGLE;
+}
+
+
+// ------------------------------------------------
+//  Resources: read from the files appinfo.json names.
+
+#ifndef  HOST_RESOURCES_DIR
+#define  HOST_RESOURCES_DIR  "resources"
+#endif
+
+static const char * const apszResourceFiles[] =
+{
+   [RESOURCE_ID_SOLAR_EPHEMERIS] = HOST_RESOURCES_DIR "/data/solar_ephemeris.bin",
+   [RESOURCE_ID_HOUR_HAND_ATLAS] = HOST_RESOURCES_DIR "/data/hour_atlas.bin",
+};
+
+#define  HOST_NUM_RESOURCES  (sizeof(apszResourceFiles) / sizeof(apszResourceFiles[0]))
+
+
+ResHandle  resource_get_handle(uint32_t resource_id)
+{
+   return ((resource_id > 0) && (resource_id < HOST_NUM_RESOURCES)) ?
+             (ResHandle) (uintptr_t) resource_id : NULL;
+}
+
+
+size_t  resource_load_byte_range(ResHandle h, uint32_t start_offset,
+                                 uint8_t *buffer, size_t num_bytes)
+{
+
+   uintptr_t id = (uintptr_t) h;
+   if ((id == 0) || (id >= HOST_NUM_RESOURCES))
+   {
+      return 0;
+   }
+
+   FILE *pFile = fopen(apszResourceFiles[id], "rb");
+   if (pFile == NULL)
+   {
+      return 0;
+   }
+
+   size_t bytes = 0;
+   if (fseek(pFile, (long) start_offset, SEEK_SET) == 0)
+   {
+      bytes = fread(buffer, 1, num_bytes, pFile);
+   }
+   fclose(pFile);
+
+   return bytes;
+
+}  /* end of resource_load_byte_range */
+
+
+size_t  resource_load(ResHandle h, uint8_t *buffer, size_t max_length)
+{
+   return resource_load_byte_range(h, 0, buffer, max_length);
+}
+
+
+size_t  resource_size(ResHandle h)
+{
+
+   uintptr_t id = (uintptr_t) h;
+   if ((id == 0) || (id >= HOST_NUM_RESOURCES))
+   {
+      return 0;
+   }
+
+   FILE *pFile = fopen(apszResourceFiles[id], "rb");
+   if (pFile == NULL)
+   {
+      return 0;
+   }
+
+   fseek(pFile, 0, SEEK_END);
+   long size = ftell(pFile);
+   fclose(pFile);
+
+   return (size > 0) ? (size_t) size : 0;
+
+}  /* end of resource_size */
+
+
+// ------------------------------------------------
+//  Logging
+
+static int logLevel = -1;
+
+void  host_log_set_level(AppLogLevel level)
+{
+   logLevel = level;
+}
+
+
+void  app_log(uint8_t log_level, const char *src_filename, int src_line_number,
+              const char *fmt, ...)
+{
+
+   if (logLevel < 0)
+   {
+      const char *pszLevel = getenv("HOST_LOG_LEVEL");
+      logLevel = (pszLevel != NULL) ? atoi(pszLevel) : APP_LOG_LEVEL_INFO;
+   }
+
+   if (log_level > logLevel)
+   {
+      return;
+   }
+
+   //  Info lines are the JSON results some test aids log: keep them bare.
+   if (log_level != APP_LOG_LEVEL_INFO)
+   {
+      const char *pszBase = strrchr(src_filename, '/');
+      printf("[%s:%d] ", (pszBase != NULL) ? pszBase + 1 : src_filename, src_line_number);
+   }
+
+   va_list args;
+   va_start(args, fmt);
+   vprintf(fmt, args);
+   va_end(args);
+   putchar('\n');
+
+}  /* end of app_log */
+
+
+// ------------------------------------------------
+//  Ticks: tests call the handlers themselves.
+
+void  tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler)
+{
+   (void) tick_units;
+   (void) handler;
+}
+
+void  tick_timer_service_unsubscribe(void)
+{
+}
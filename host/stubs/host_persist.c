@@ -0,0 +1,140 @@
+/**
+ *  @file
+ *
+ *  In-memory persistent storage, keeping to the watch's limits of
+ *  PERSIST_DATA_MAX_LENGTH bytes per key and HOST_PERSIST_TOTAL_BYTES in
+ *  all.
+ */
+
+#include  "host.h"
+
+
+///  Keys 0 - (this - 1) may be used: enough for all the app's.
+#define  HOST_PERSIST_KEYS   64
+
+///  Most bytes held over all keys, as aplite allows an app.
+#define  HOST_PERSIST_TOTAL_BYTES   4096
+
+static uint8_t aaStore[HOST_PERSIST_KEYS][PERSIST_DATA_MAX_LENGTH];
+
+///  Bytes held per key, or -1 for none.
+static int aLengths[HOST_PERSIST_KEYS];
+
+static bool fInitialized = false;
+
+static int writes = 0;
+
+
+static void  host_persist_check_init(void)
+{
+   if (!fInitialized)
+   {
+      host_persist_reset();
+   }
+}
+
+
+void  host_persist_reset(void)
+{
+   for (int i = 0; i < HOST_PERSIST_KEYS; i++)
+   {
+      aLengths[i] = -1;
+   }
+   fInitialized = true;
+   writes = 0;
+}
+
+
+int  host_persist_writes(void)
+{
+   return writes;
+}
+
+
+bool  persist_exists(const uint32_t key)
+{
+   host_persist_check_init();
+   return (key < HOST_PERSIST_KEYS) && (aLengths[key] >= 0);
+}
+
+
+int  persist_get_size(const uint32_t key)
+{
+   return persist_exists(key) ? aLengths[key] : E_DOES_NOT_EXIST;
+}
+
+
+int  persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size)
+{
+
+   if (!persist_exists(key))
+   {
+      return E_DOES_NOT_EXIST;
+   }
+
+   size_t bytes = ((size_t) aLengths[key] < buffer_size) ? (size_t) aLengths[key] : buffer_size;
+   memcpy(buffer, aaStore[key], bytes);
+
+   return (int) bytes;
+
+}  /* end of persist_read_data */
+
+
+int32_t  persist_read_int(const uint32_t key)
+{
+   int32_t value = 0;
+   persist_read_data(key, &value, sizeof(value));
+   return value;
+}
+
+
+status_t  persist_write_data(const uint32_t key, const void *data, const size_t size)
+{
+
+   host_persist_check_init();
+
+   if ((key >= HOST_PERSIST_KEYS) || (data == NULL))
+   {
+      return E_INVALID_ARGUMENT;
+   }
+
+   //  As PebbleOS does, write what fits and say how much that was.
+   size_t bytes = (size < PERSIST_DATA_MAX_LENGTH) ? size : PERSIST_DATA_MAX_LENGTH;
+
+   int total = (int) bytes;
+   for (int i = 0; i < HOST_PERSIST_KEYS; i++)
+   {
+      total += ((i != (int) key) && (aLengths[i] > 0)) ? aLengths[i] : 0;
+   }
+   if (total > HOST_PERSIST_TOTAL_BYTES)
+   {
+      return E_OUT_OF_STORAGE;
+   }
+
+   memcpy(aaStore[key], data, bytes);
+   aLengths[key] = (int) bytes;
+   writes++;
+
+   return (status_t) bytes;
+
+}  /* end of persist_write_data */
+
+
+status_t  persist_write_int(const uint32_t key, const int32_t value)
+{
+   return persist_write_data(key, &value, sizeof(value));
+}
+
+
+status_t  persist_delete(const uint32_t key)
+{
+
+   if (!persist_exists(key))
+   {
+      return E_DOES_NOT_EXIST;
+   }
+
+   aLengths[key] = -1;
+   return S_TRUE;
+
+}  /* end of persist_delete */
@@ -0,0 +1,105 @@
+/**
+ *  @file
+ *
+ *  The app side of app_worker: a worker that is or isn't running, and
+ *  records what the app sends it.  Tests answer for it with
+ *  host_worker_send_to_app().
+ */
+
+#include  "host.h"
+
+
+static bool fRunning = false;
+
+static AppWorkerMessageHandler appHandler = NULL;
+
+static int messages = 0;
+static uint8_t lastType = 0;
+static AppWorkerMessage lastMessage;
+
+
+void  host_worker_set_running(bool fNowRunning)
+{
+   fRunning = fNowRunning;
+}
+
+int  host_worker_messages(void)
+{
+   return messages;
+}
+
+uint8_t  host_worker_last_message(AppWorkerMessage *pData)
+{
+   if (pData != NULL)
+   {
+      *pData = lastMessage;
+   }
+   return lastType;
+}
+
+
+void  host_worker_send_to_app(uint16_t type, uint16_t data0, uint16_t data1, uint16_t data2)
+{
+   AppWorkerMessage message = { data0, data1, data2 };
+   if (appHandler != NULL)
+   {
+      (*appHandler)(type, &message);
+   }
+}
+
+
+void  host_worker_reset(void)
+{
+   fRunning = false;
+   appHandler = NULL;
+   messages = 0;
+   lastType = 0;
+   memset(&lastMessage, 0, sizeof(lastMessage));
+}
+
+
+bool  app_worker_is_running(void)
+{
+   return fRunning;
+}
+
+AppWorkerResult  app_worker_launch(void)
+{
+   if (fRunning)
+   {
+      return APP_WORKER_RESULT_ALREADY_RUNNING;
+   }
+
+   fRunning = true;
+   return APP_WORKER_RESULT_SUCCESS;
+}
+
+AppWorkerResult  app_worker_kill(void)
+{
+   if (!fRunning)
+   {
+      return APP_WORKER_RESULT_NOT_RUNNING;
+   }
+
+   fRunning = false;
+   return APP_WORKER_RESULT_SUCCESS;
+}
+
+bool  app_worker_message_subscribe(AppWorkerMessageHandler handler)
+{
+   appHandler = handler;
+   return true;
+}
+
+bool  app_worker_message_unsubscribe(void)
+{
+   appHandler = NULL;
+   return true;
+}
+
+void  app_worker_send_message(uint8_t type, AppWorkerMessage *data)
+{
+   messages++;
+   lastType = type;
+   lastMessage = *data;
+}
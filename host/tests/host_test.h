@@ -0,0 +1,147 @@
+/**
+ *  @file
+ *
+ *  Minimal checks for the host tests: each test program runs its cases,
+ *  prints any failed check with its location, and exits non-zero if there
+ *  were any.
+ */
+
+#pragma once
+
+#include  "host.h"
+
+#include  "messaging.h"
+
+
+extern int hostTestFailures;
+
+///  What messaging has told the host_test_location_* callbacks since
+///  host_test_messaging_init().
+typedef struct
+{
+   ///  Locations received.
+   int      fixes;
+
+   ///  Requests failed in messaging itself (FAIL_SRC_APP_MSG).
+   int      failures;
+
+   ///  Code of the last failure, from any source.
+   int32_t  lastErrCode;
+
+   ///  Also told of each failure, or NULL.
+   void   (*onFailed)(FailureSource eErrSrc, int32_t errCode);
+
+} HostTestLocations;
+
+extern HostTestLocations hostTestLocations;
+
+///  Define hostTestFailures and hostTestLocations, once per test program.
+#define  HOST_TEST_MAIN_DECLS                                               \
+   int hostTestFailures = 0;                                                \
+   HostTestLocations hostTestLocations = { 0 }
+
+///  Fail (and carry on) unless cond holds.
+#define  CHECK(cond)                                                        \
+   do                                                                       \
+   {                                                                        \
+      if (!(cond))                                                          \
+      {                                                                     \
+         printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+         hostTestFailures++;                                                \
+      }                                                                     \
+   } while (0)
+
+///  Fail unless two integers are equal, printing both.
+#define  CHECK_EQ(a, b)                                                     \
+   do                                                                       \
+   {                                                                        \
+      long long a_ = (long long) (a);                                       \
+      long long b_ = (long long) (b);                                       \
+      if (a_ != b_)                                                         \
+      {                                                                     \
+         printf("%s:%d: check failed: %s == %s (%lld vs %lld)\n",           \
+                __FILE__, __LINE__, #a, #b, a_, b_);                        \
+         hostTestFailures++;                                                \
+      }                                                                     \
+   } while (0)
+
+///  Fail unless |a - b| <= tolerance, printing both.
+#define  CHECK_NEAR(a, b, tolerance)                                        \
+   do                                                                       \
+   {                                                                        \
+      double a_ = (double) (a);                                             \
+      double b_ = (double) (b);                                             \
+      if (!((a_ - b_ <= (tolerance)) && (b_ - a_ <= (tolerance))))          \
+      {                                                                     \
+         printf("%s:%d: check failed: %s ~ %s (%g vs %g, tolerance %g)\n",  \
+                __FILE__, __LINE__, #a, #b, a_, b_, (double) (tolerance));  \
+         hostTestFailures++;                                                \
+      }                                                                     \
+   } while (0)
+
+/**
+ *  Run one case, with fresh storage and link, a day after the last.  The
+ *  clock only goes forward, as the modules under test keep times in
+ *  static state; the day lets any timers left by the last case run out
+ *  before storage is wiped.
+ */
+#define  RUN_TEST(func)                                                     \
+   do                                                                       \
+   {                                                                        \
+      host_timers_run(SECONDS_PER_DAY * 1000);                              \
+      host_persist_reset();                                                 \
+      host_app_message_reset();                                             \
+      host_worker_reset();                                                  \
+      host_clock_set_local_offset(0);                                       \
+      int before_ = hostTestFailures;                                       \
+      func();                                                               \
+      printf("%s %s\n", (hostTestFailures == before_) ? "ok  " : "FAIL", #func); \
+   } while (0)
+
+static inline void  host_test_location_received(const AppMsgLocation *pLocation)
+{
+   (void) pLocation;
+   hostTestLocations.fixes++;
+}
+
+static inline void  host_test_location_failed(FailureSource eErrSrc, int32_t errCode,
+                                              const char *pszErrMsg)
+{
+   (void) pszErrMsg;
+   hostTestLocations.failures += (eErrSrc == FAIL_SRC_APP_MSG);
+   hostTestLocations.lastErrCode = errCode;
+   if (hostTestLocations.onFailed != NULL)
+   {
+      (*hostTestLocations.onFailed)(eErrSrc, errCode);
+   }
+}
+
+///  A phone that takes every message, and answers none.
+static inline AppMessageResult  host_test_phone_takes(DictionaryIterator *pSent)
+{
+   (void) pSent;
+   host_app_message_outbox_done(APP_MSG_OK);
+   return APP_MSG_OK;
+}
+
+/**
+ *  Start messaging, with the host_test_location_* callbacks and a fresh
+ *  hostTestLocations.
+ *
+ *  @param phone Phone behind the link, or NULL to have the test finish
+ *             each send itself with host_app_message_outbox_done().
+ *  @param onFailed Also told of each failure, or NULL.
+ */
+static inline void  host_test_messaging_init(HostPhoneHandler phone,
+                                             void (*onFailed)(FailureSource eErrSrc,
+                                                              int32_t errCode))
+{
+   memset(&hostTestLocations, 0, sizeof(hostTestLocations));
+   hostTestLocations.onFailed = onFailed;
+   host_app_message_set_phone(phone);
+   app_msg_init(host_test_location_received, host_test_location_failed);
+}
+
+
+///  Exit status for main().
+#define  HOST_TEST_RESULT()   ((hostTestFailures == 0) ? 0 : 1)
@@ -0,0 +1,288 @@
+/**
+ *  @file
+ *
+ *  ConfigData: older flash layouts are taken up, bad ones are not, writes
+ *  are rate limited without being lost, and UTC offset changes apply on
+ *  time.
+ */
+
+#include  <math.h>
+
+#include  "host_test.h"
+
+#include  "ConfigData.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+#define  CONFIG_KEY   1
+
+///  The version 1 and 2 layouts (ConfigData.c), as this host lays them out.
+typedef struct
+{
+   uint16_t usVersion;
+   uint16_t usReserved;
+   float    fLatitude;
+   float    fLongitude;
+   int32_t  iUtcOffset;
+   time_t   timeLastUpdate;
+} __attribute__((__packed__))  ConfigV1;
+
+typedef struct
+{
+   uint16_t usVersion;
+   uint16_t usReserved;
+   int32_t  iLatitude;
+   int32_t  iLongitude;
+   int32_t  iUtcOffset;
+   time_t   timeLastUpdate;
+} __attribute__((__packed__))  ConfigV2;
+
+
+static void  test_none(void)
+{
+   config_data_init();
+   CHECK(!config_data_location_avail());
+   CHECK(!config_data_location_get(NULL, NULL, NULL, NULL));
+   CHECK(config_data_is_different(0, 0, 0));
+}
+
+
+static void  test_migrate_v1(void)
+{
+
+   ConfigV1 v1 = { 1, 0, 51.4769f, -0.0005f, -3600, 12345 };
+   persist_write_data(CONFIG_KEY, &v1, sizeof(v1));
+
+   config_data_init();
+   CHECK(config_data_location_avail());
+
+   float latitude, longitude;
+   int32_t utcOffset;
+   time_t timeLastUpdate;
+   CHECK(config_data_location_get(&latitude, &longitude, &utcOffset, &timeLastUpdate));
+   CHECK_NEAR(latitude, 51.4769, 1e-5);
+   CHECK_NEAR(longitude, -0.0005, 1e-6);
+   CHECK_EQ(utcOffset, -3600);
+   CHECK_EQ(timeLastUpdate, 12345);
+   CHECK_NEAR(config_data_get_tz_in_hours(), 1, 1e-6);
+
+   //  Converted rounded to the nearest micro-degree: the same fix again
+   //  is no change.
+   CHECK(!config_data_is_different(51476900, -500, -3600));
+
+   //  Flash keeps version 1 until the location changes.
+   ConfigV1 stored;
+   CHECK_EQ(persist_read_data(CONFIG_KEY, &stored, sizeof(stored)), sizeof(stored));
+   CHECK_EQ(stored.usVersion, 1);
+
+}  /* end of test_migrate_v1 */
+
+
+///  Version 1's float degrees go to the nearest micro-degree, or one off it
+///  where the product is too near half way for float to tell.
+static void  test_migrate_v1_rounding(void)
+{
+
+   int off = 0;
+   int worst = 0;
+   for (int i = 0; i < 2000; i++)
+   {
+      //  Over the whole range, ends included, off whole micro-degrees.
+      float latitude = -90.0f + (180.0f * i) / 1999;
+      float longitude = -180.0f + (360.0f * i) / 1999 + 0.0000123f * (i % 7);
+      ConfigV1 v1 = { 1, 0, latitude, longitude, 0, 12345 };
+      persist_write_data(CONFIG_KEY, &v1, sizeof(v1));
+      config_data_init();
+
+      int32_t iLatitude, iLongitude;
+      CHECK(config_data_location_get_scaled(&iLatitude, &iLongitude, NULL));
+      int aDiffs[2] =
+      {
+         abs(iLatitude - (int32_t) llround((double) latitude * CONFIG_DATA_DEGREE_SCALE)),
+         abs(iLongitude - (int32_t) llround((double) longitude * CONFIG_DATA_DEGREE_SCALE))
+      };
+      for (int j = 0; j < 2; j++)
+      {
+         off += (aDiffs[j] != 0);
+         worst = (aDiffs[j] > worst) ? aDiffs[j] : worst;
+      }
+   }
+   printf("%d of 4000 off the nearest micro-degree, worst by %d\n", off, worst);
+   CHECK(worst <= 1);
+   CHECK(off < 4000 / 20);
+
+}  /* end of test_migrate_v1_rounding */
+
+
+static void  test_migrate_v2(void)
+{
+
+   ConfigV2 v2 = { 2, 7, -33868800, 151209300, -36000, 54321 };
+   persist_write_data(CONFIG_KEY, &v2, sizeof(v2));
+
+   config_data_init();
+
+   float latitude, longitude;
+   int32_t utcOffset;
+   CHECK(config_data_location_get(&latitude, &longitude, &utcOffset, NULL));
+   CHECK_NEAR(latitude, -33.8688, 1e-5);
+   CHECK_NEAR(longitude, 151.2093, 1e-4);
+   CHECK_EQ(utcOffset, -36000);
+
+   //  The field that became usUtcOffsetChanges held junk in version 2.
+   CHECK(!config_data_apply_utc_offset_changes());
+   CHECK_EQ(utcOffset, -36000);
+
+}  /* end of test_migrate_v2 */
+
+
+static void  test_reject_bad(void)
+{
+
+   //  Unknown version.
+   ConfigV2 v9 = { 9, 0, 1, 2, 3, 4 };
+   persist_write_data(CONFIG_KEY, &v9, sizeof(v9));
+   config_data_init();
+   CHECK(!config_data_location_avail());
+
+   //  Cut short.
+   ConfigV2 v2 = { 2, 0, 1, 2, 3, 4 };
+   persist_write_data(CONFIG_KEY, &v2, sizeof(v2) - 2);
+   config_data_init();
+   CHECK(!config_data_location_avail());
+
+   //  Version 3 claiming more offset changes than it holds.
+   uint8_t aBytes[sizeof(ConfigV2)];
+   v2.usVersion = 3;
+   v2.usReserved = 2;
+   memcpy(aBytes, &v2, sizeof(v2));
+   persist_write_data(CONFIG_KEY, aBytes, sizeof(aBytes));
+   config_data_init();
+   CHECK(!config_data_location_avail());
+
+}  /* end of test_reject_bad */
+
+
+static void  test_round_trip_v3(void)
+{
+
+   config_data_init();
+   config_data_location_set(48856600, 2352200, -7200);
+
+   //  Change times are UTC, as time() is on the watch.
+   time_t nowUtc = time(NULL);
+   ConfigDataUtcOffsetChange aChanges[] = { { nowUtc + 3600, -3600 } };
+   config_data_set_utc_offset_changes(aChanges, 1);
+   host_timers_run(1000);
+   config_data_deinit();
+
+   //  As at the next launch.
+   config_data_init();
+   float latitude, longitude;
+   int32_t utcOffset;
+   CHECK(config_data_location_get(&latitude, &longitude, &utcOffset, NULL));
+   CHECK_NEAR(latitude, 48.8566, 1e-5);
+   CHECK_NEAR(longitude, 2.3522, 1e-5);
+   CHECK_EQ(utcOffset, -7200);
+
+   //  The change came back too, and applies when due.
+   CHECK(!config_data_apply_utc_offset_changes());
+   host_clock_advance_ms(3600 * 1000);
+   CHECK(config_data_apply_utc_offset_changes());
+   config_data_location_get(NULL, NULL, &utcOffset, NULL);
+   CHECK_EQ(utcOffset, -3600);
+   CHECK(!config_data_apply_utc_offset_changes());
+
+}  /* end of test_round_trip_v3 */
+
+
+///  West of UTC, a change is neither applied early nor dropped as past.
+static void  test_change_west_of_utc(void)
+{
+
+   config_data_init();
+   config_data_location_set(40712800, -74006000, 4 * 3600);
+
+   time_t nowUtc = time(NULL);
+   ConfigDataUtcOffsetChange aChanges[] = { { nowUtc + 3600, 5 * 3600 } };
+   config_data_set_utc_offset_changes(aChanges, 1);
+
+   host_clock_advance_ms(3599 * 1000);
+   CHECK(!config_data_apply_utc_offset_changes());
+   host_clock_advance_ms(1000);
+   CHECK(config_data_apply_utc_offset_changes());
+
+   int32_t utcOffset;
+   config_data_location_get(NULL, NULL, &utcOffset, NULL);
+   CHECK_EQ(utcOffset, 5 * 3600);
+
+}  /* end of test_change_west_of_utc */
+
+
+static void  test_rate_limited_writes(void)
+{
+
+   config_data_init();
+   ConfigDataStats before;
+   config_data_get_stats(&before);
+
+   //  The first change is written at once (from a task).
+   config_data_location_set(51500000, -130000, 0);
+   host_timers_run(1000);
+   ConfigDataStats stats;
+   config_data_get_stats(&stats);
+   CHECK_EQ(stats.usFlashWrites - before.usFlashWrites, 1);
+
+   //  Changes soon after are held back, and coalesced.
+   config_data_location_set(51600000, -130000, 0);
+   config_data_location_set(51700000, -130000, 0);
+   host_timers_run(1000);
+   config_data_get_stats(&stats);
+   CHECK_EQ(stats.usFlashWrites - before.usFlashWrites, 1);
+   CHECK(stats.usCoalesced - before.usCoalesced >= 2);
+
+   //  Until the interval is up.
+   host_timers_run((CONFIG_DATA_MIN_WRITE_INTERVAL_SECS + 1) * 1000);
+   config_data_get_stats(&stats);
+   CHECK_EQ(stats.usFlashWrites - before.usFlashWrites, 2);
+
+   //  A change held back at exit is written then.
+   config_data_location_set(51800000, -130000, 0);
+   config_data_deinit();
+   config_data_init();
+   float latitude;
+   config_data_location_get(&latitude, NULL, NULL, NULL);
+   CHECK_NEAR(latitude, 51.8, 1e-5);
+
+}  /* end of test_rate_limited_writes */
+
+
+static void  test_jitter_ignored(void)
+{
+
+   config_data_init();
+   config_data_location_set(51476900, -500, 0);
+
+   //  Tens of metres: ignored.  Tens of km: taken.  A new offset: taken.
+   CHECK(!config_data_is_different(51477200, -300, 0));
+   CHECK(config_data_is_different(51700000, -500, 0));
+   CHECK(config_data_is_different(51476900, -500, -3600));
+
+}  /* end of test_jitter_ignored */
+
+
+int  main(void)
+{
+   RUN_TEST(test_none);
+   RUN_TEST(test_migrate_v1);
+   RUN_TEST(test_migrate_v1_rounding);
+   RUN_TEST(test_migrate_v2);
+   RUN_TEST(test_reject_bad);
+   RUN_TEST(test_round_trip_v3);
+   RUN_TEST(test_change_west_of_utc);
+   RUN_TEST(test_rate_limited_writes);
+   RUN_TEST(test_jitter_ignored);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,159 @@
+/**
+ *  @file
+ *
+ *  DayRecord: a saved day's results are loaded back for the same day and
+ *  place, and not for another date or location.
+ */
+
+#include  "host_test.h"
+
+#include  "ConfigData.h"
+#include  "DayRecord.h"
+#include  "helpers.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+///  Local date the record is for.
+static struct tm  local_date(int year, int month, int day)
+{
+   struct tm tmDate;
+   memset(&tmDate, 0, sizeof(tmDate));
+   tmDate.tm_year = year - 1900;
+   tmDate.tm_mon = month - 1;
+   tmDate.tm_mday = day;
+   tmDate.tm_hour = 12;
+   time_t when = timegm(&tmDate);
+   gmtime_r(&when, &tmDate);
+   return tmDate;
+}
+
+
+///  A record for the date, tagged and saved as sunclock.c does.
+static DayRecord  save_record(const struct tm *pDate)
+{
+   DayRecord record;
+   memset(&record, 0, sizeof(record));
+   record.moonPhase = 5;
+   record.aDawnMinutes[0] = 356;
+   record.aDuskMinutes[0] = 1164;
+   strcpy(record.achSunrise, "8:05");
+   strcpy(record.achSunset, "15:55");
+
+   day_record_tag(&record, pDate);
+   CHECK(day_record_save(&record));
+   return record;
+}
+
+
+static void  test_fnv1a32(void)
+{
+   //  Published FNV-1a test vectors.
+   CHECK_EQ(fnv1a32("", 0), 0x811c9dc5UL);
+   CHECK_EQ(fnv1a32("a", 1), 0xe40c292cUL);
+   CHECK_EQ(fnv1a32("foobar", 6), 0xbf9cf968UL);
+}
+
+
+static void  test_hit(void)
+{
+
+   config_data_init();
+   config_data_location_set(51500000, -130000, 0);
+   struct tm tmDate = local_date(2016, 12, 21);
+   DayRecord saved = save_record(&tmDate);
+
+   uint16_t hitsBefore, missesBefore;
+   day_record_get_stats(&hitsBefore, &missesBefore);
+
+   DayRecord loaded;
+   CHECK(day_record_load(&loaded, &tmDate));
+   CHECK(memcmp(&loaded, &saved, sizeof(loaded)) == 0);
+
+   //  Any time that day.
+   tmDate.tm_hour = 23;
+   CHECK(day_record_load(&loaded, &tmDate));
+
+   uint16_t hits, misses;
+   day_record_get_stats(&hits, &misses);
+   CHECK_EQ(hits - hitsBefore, 2);
+   CHECK_EQ(misses - missesBefore, 0);
+
+}  /* end of test_hit */
+
+
+static void  test_date_misses(void)
+{
+
+   config_data_init();
+   config_data_location_set(51500000, -130000, 0);
+   struct tm tmDate = local_date(2016, 12, 21);
+   save_record(&tmDate);
+
+   DayRecord loaded;
+   struct tm tmNext = local_date(2016, 12, 22);
+   CHECK(!day_record_load(&loaded, &tmNext));
+
+   //  The same day of the year, another year.
+   struct tm tmYearOn = local_date(2017, 12, 21);
+   tmYearOn.tm_yday = tmDate.tm_yday;
+   CHECK(!day_record_load(&loaded, &tmYearOn));
+
+   CHECK(day_record_load(&loaded, &tmDate));
+
+}  /* end of test_date_misses */
+
+
+static void  test_location_misses(void)
+{
+
+   config_data_init();
+   config_data_location_set(51500000, -130000, 0);
+   struct tm tmDate = local_date(2016, 12, 21);
+   save_record(&tmDate);
+
+   DayRecord loaded;
+
+   //  Moved.
+   config_data_location_set(48856600, 2352200, 0);
+   CHECK(!day_record_load(&loaded, &tmDate));
+
+   //  Back, but in another time zone.
+   config_data_location_set(51500000, -130000, -3600);
+   CHECK(!day_record_load(&loaded, &tmDate));
+
+   //  Back as it was.
+   config_data_location_set(51500000, -130000, 0);
+   CHECK(day_record_load(&loaded, &tmDate));
+
+}  /* end of test_location_misses */
+
+
+static void  test_nothing_saved(void)
+{
+
+   config_data_init();
+   config_data_location_set(51500000, -130000, 0);
+   struct tm tmDate = local_date(2016, 12, 21);
+
+   DayRecord loaded;
+   CHECK(!day_record_load(&loaded, &tmDate));
+
+   //  Nor a record cut short.
+   DayRecord saved = save_record(&tmDate);
+   persist_write_data(2, &saved, sizeof(saved) - 1);
+   CHECK(!day_record_load(&loaded, &tmDate));
+
+}  /* end of test_nothing_saved */
+
+
+int  main(void)
+{
+   RUN_TEST(test_fnv1a32);
+   RUN_TEST(test_hit);
+   RUN_TEST(test_date_misses);
+   RUN_TEST(test_location_misses);
+   RUN_TEST(test_nothing_saved);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,296 @@
+/**
+ *  @file
+ *
+ *  DialCache: the PackBits flash copy of the dial round-trips bit for bit,
+ *  and is only taken back for the fingerprint it was saved with.
+ */
+
+#include  "host_test.h"
+
+#include  "DialCache.h"
+#include  "PersistBudget.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+#define  SCREEN_SIZE   GSize(144, 168)
+
+///  Persist keys the cache uses: header, then chunks.
+#define  DIAL_KEY_HEADER        PERSIST_KEY_DIAL_HEADER
+#define  DIAL_KEY_FIRST_CHUNK   PERSIST_KEY_DIAL_FIRST
+#define  DIAL_MAX_CHUNKS        PERSIST_DIAL_MAX_CHUNKS
+
+
+///  Rows of black, white, dither and a scatter of literal bytes: the kinds
+///  of run a dial has.
+static void  draw_test_dial(GContext *ctx, uint32_t seed)
+{
+
+   GBitmap *pFrameBuf = host_gcontext_get_frame_buffer(ctx);
+   uint8_t *pData = gbitmap_get_data(pFrameBuf);
+   uint16_t stride = gbitmap_get_bytes_per_row(pFrameBuf);
+
+   for (int y = 0; y < SCREEN_SIZE.h; y++)
+   {
+      for (int x = 0; x < stride; x++)
+      {
+         uint8_t b;
+         if (y < 40)
+         {
+            b = 0x00;
+         }
+         else if (y < 80)
+         {
+            b = (y & 1) ? 0x55 : 0xAA;
+         }
+         else if (y < 120)
+         {
+            b = 0xFF;
+         }
+         else
+         {
+            seed = (seed * 1103515245UL) + 12345;
+            b = (uint8_t) (seed >> 16);
+            if ((x > 6) && (x < 12))
+            {
+               b = 0x00;
+            }
+         }
+         pData[(y * stride) + x] = b;
+      }
+   }
+
+}  /* end of draw_test_dial */
+
+
+///  Are the dial's pixels (not the row padding) the same in both?
+static bool  same_pixels(const GBitmap *pA, const GBitmap *pB)
+{
+   for (int y = 0; y < SCREEN_SIZE.h; y++)
+   {
+      for (int x = 0; x < SCREEN_SIZE.w; x++)
+      {
+         if (host_gbitmap_get_pixel(pA, x, y) != host_gbitmap_get_pixel(pB, x, y))
+         {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+
+static void  test_round_trip(void)
+{
+
+   GContext *ctx = host_gcontext_create(SCREEN_SIZE);
+   draw_test_dial(ctx, 1);
+
+   DialCache *pSaved = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pSaved, 0x12345678);
+   CHECK(dial_cache_capture(pSaved, ctx));
+   CHECK(dial_cache_is_valid(pSaved));
+   CHECK(dial_cache_save(pSaved));
+
+   //  Compressed: fewer chunks than the raw 168 rows of 18 bytes would need.
+   int chunks = 0;
+   while ((chunks < DIAL_MAX_CHUNKS) && persist_exists(DIAL_KEY_FIRST_CHUNK + chunks))
+   {
+      chunks++;
+   }
+   CHECK(chunks > 0);
+   CHECK(chunks * PERSIST_DATA_MAX_LENGTH < 168 * 18);
+
+   DialCache *pRestored = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pRestored, 0x12345678);
+   CHECK(!dial_cache_is_valid(pRestored));
+   CHECK(dial_cache_restore(pRestored));
+   CHECK(dial_cache_is_valid(pRestored));
+   CHECK(same_pixels(pRestored->pBmpDial, pSaved->pBmpDial));
+   CHECK(same_pixels(pRestored->pBmpDial, host_gcontext_get_frame_buffer(ctx)));
+
+   //  And back out to a screen.
+   GContext *ctxRestored = host_gcontext_create(SCREEN_SIZE);
+   dial_cache_draw(pRestored, ctxRestored, GRect(0, 0, SCREEN_SIZE.w, SCREEN_SIZE.h));
+   CHECK(same_pixels(host_gcontext_get_frame_buffer(ctxRestored),
+                     host_gcontext_get_frame_buffer(ctx)));
+
+   dial_cache_destroy(pSaved);
+   dial_cache_destroy(pRestored);
+   host_gcontext_destroy(ctx);
+   host_gcontext_destroy(ctxRestored);
+
+}  /* end of test_round_trip */
+
+
+static void  test_edge_patterns(void)
+{
+
+   //  All one byte (longest repeats), and a run of distinct bytes longer
+   //  than one literal code.
+   static const uint8_t aFills[] = { 0x00, 0xFF };
+
+   for (unsigned f = 0; f <= sizeof(aFills); f++)
+   {
+      GContext *ctx = host_gcontext_create(SCREEN_SIZE);
+      GBitmap *pFrameBuf = host_gcontext_get_frame_buffer(ctx);
+      uint8_t *pData = gbitmap_get_data(pFrameBuf);
+      uint16_t stride = gbitmap_get_bytes_per_row(pFrameBuf);
+
+      for (int i = 0; i < SCREEN_SIZE.h * stride; i++)
+      {
+         pData[i] = (f < sizeof(aFills)) ? aFills[f] : ((i < 300) ? (uint8_t) i : 0);
+      }
+
+      DialCache *pSaved = dial_cache_create(SCREEN_SIZE);
+      dial_cache_set_fingerprint(pSaved, f);
+      CHECK(dial_cache_capture(pSaved, ctx));
+      CHECK(dial_cache_save(pSaved));
+
+      DialCache *pRestored = dial_cache_create(SCREEN_SIZE);
+      dial_cache_set_fingerprint(pRestored, f);
+      CHECK(dial_cache_restore(pRestored));
+      CHECK(same_pixels(pRestored->pBmpDial, pFrameBuf));
+
+      dial_cache_destroy(pSaved);
+      dial_cache_destroy(pRestored);
+      host_gcontext_destroy(ctx);
+   }
+
+}  /* end of test_edge_patterns */
+
+
+static void  test_fingerprint_mismatch(void)
+{
+
+   GContext *ctx = host_gcontext_create(SCREEN_SIZE);
+   draw_test_dial(ctx, 2);
+
+   DialCache *pSaved = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pSaved, 1);
+   dial_cache_capture(pSaved, ctx);
+   CHECK(dial_cache_save(pSaved));
+
+   DialCache *pOther = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pOther, 2);
+   CHECK(!dial_cache_restore(pOther));
+   CHECK(!dial_cache_is_valid(pOther));
+
+   //  A different screen size isn't taken either.
+   DialCache *pSmaller = dial_cache_create(GSize(144, 160));
+   dial_cache_set_fingerprint(pSmaller, 1);
+   CHECK(!dial_cache_restore(pSmaller));
+
+   dial_cache_destroy(pSaved);
+   dial_cache_destroy(pOther);
+   dial_cache_destroy(pSmaller);
+   host_gcontext_destroy(ctx);
+
+}  /* end of test_fingerprint_mismatch */
+
+
+static void  test_incompressible(void)
+{
+
+   //  Noise doesn't fit in the chunks allowed: the save fails, and leaves
+   //  nothing a restore would take.
+   GContext *ctx = host_gcontext_create(SCREEN_SIZE);
+   GBitmap *pFrameBuf = host_gcontext_get_frame_buffer(ctx);
+   uint8_t *pData = gbitmap_get_data(pFrameBuf);
+   uint32_t seed = 7;
+   for (int i = 0; i < SCREEN_SIZE.h * gbitmap_get_bytes_per_row(pFrameBuf); i++)
+   {
+      seed = (seed * 1103515245UL) + 12345;
+      pData[i] = (uint8_t) (seed >> 16);
+   }
+
+   DialCache *pSaved = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pSaved, 3);
+   dial_cache_capture(pSaved, ctx);
+   CHECK(!dial_cache_save(pSaved));
+   CHECK(!persist_exists(DIAL_KEY_HEADER));
+
+   DialCache *pRestored = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pRestored, 3);
+   CHECK(!dial_cache_restore(pRestored));
+
+   dial_cache_destroy(pSaved);
+   dial_cache_destroy(pRestored);
+   host_gcontext_destroy(ctx);
+
+}  /* end of test_incompressible */
+
+
+static void  test_corrupt_chunk(void)
+{
+
+   GContext *ctx = host_gcontext_create(SCREEN_SIZE);
+   draw_test_dial(ctx, 4);
+
+   DialCache *pSaved = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pSaved, 4);
+   dial_cache_capture(pSaved, ctx);
+   CHECK(dial_cache_save(pSaved));
+
+   //  Lose a chunk, as a save cut short by a crash might.
+   persist_delete(DIAL_KEY_FIRST_CHUNK + 1);
+
+   DialCache *pRestored = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pRestored, 4);
+   CHECK(!dial_cache_restore(pRestored));
+   CHECK(!dial_cache_is_valid(pRestored));
+
+   dial_cache_destroy(pSaved);
+   dial_cache_destroy(pRestored);
+   host_gcontext_destroy(ctx);
+
+}  /* end of test_corrupt_chunk */
+
+
+static void  test_old_chunks_removed(void)
+{
+
+   //  Every chunk key full, as an older version that allowed more left them.
+   uint8_t aOld[PERSIST_DATA_MAX_LENGTH];
+   memset(aOld, 0x55, sizeof(aOld));
+   for (int key = DIAL_KEY_FIRST_CHUNK; key <= PERSIST_KEY_DIAL_LAST; key++)
+   {
+      CHECK_EQ(persist_write_data(key, aOld, sizeof(aOld)), sizeof(aOld));
+   }
+
+   GContext *ctx = host_gcontext_create(SCREEN_SIZE);
+   draw_test_dial(ctx, 1);
+   DialCache *pSaved = dial_cache_create(SCREEN_SIZE);
+   dial_cache_set_fingerprint(pSaved, 5);
+   CHECK(dial_cache_capture(pSaved, ctx));
+   CHECK(dial_cache_save(pSaved));
+
+   //  None left past the new dial's.
+   int chunks = 0;
+   while (persist_exists(DIAL_KEY_FIRST_CHUNK + chunks))
+   {
+      chunks++;
+   }
+   CHECK(chunks <= DIAL_MAX_CHUNKS);
+   for (int key = DIAL_KEY_FIRST_CHUNK + chunks; key <= PERSIST_KEY_DIAL_LAST; key++)
+   {
+      CHECK(!persist_exists(key));
+   }
+
+   dial_cache_destroy(pSaved);
+   host_gcontext_destroy(ctx);
+
+}  /* end of test_old_chunks_removed */
+
+
+int  main(void)
+{
+   RUN_TEST(test_round_trip);
+   RUN_TEST(test_edge_patterns);
+   RUN_TEST(test_fingerprint_mismatch);
+   RUN_TEST(test_incompressible);
+   RUN_TEST(test_corrupt_chunk);
+   RUN_TEST(test_old_chunks_removed);
+
+   return HOST_TEST_RESULT();
+}
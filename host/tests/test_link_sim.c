@@ -0,0 +1,481 @@
+/**
+ *  @file
+ *
+ *  messaging over a slow, lossy phone link: latency, dropped and
+ *  duplicated messages, busy outboxes, disconnects and a phone app slow to
+ *  start, from a seeded random number generator so every run is the same.
+ *  A scripted phone answers location requests as the JS does, tagging each
+ *  answer with its run so that stale fixes can be spotted.
+ *
+ *  LINK_SIM_RUNS requests are made one after another.  Every one must end
+ *  in a fix, or a failure after APP_MSG_RETRY_MAX_ATTEMPTS sends: a run
+ *  that does neither within LINK_SIM_RUN_MAX_MS is hung, and fails the
+ *  test.  So does an earlier run's answer taken for a later run's, or a
+ *  send after a run has its fix.  Time-to-fix, retries
+ *  and radio use are printed as JSON lines, as the benchmark's are.
+ */
+
+#include  "host_test.h"
+
+#include  "messaging.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+///  Location requests made, one after another.
+#define  LINK_SIM_RUNS                 40
+
+///  Seed for the simulation's own random numbers, so that runs can be
+///  compared from build to build.
+#define  LINK_SIM_SEED                 12345
+
+///  One way latency of a message, range in ms.
+#define  LINK_SIM_LATENCY_MIN_MS       20
+#define  LINK_SIM_LATENCY_MAX_MS       400
+
+///  Chance in 100 of each message being lost, either way.
+#define  LINK_SIM_DROP_PERCENT         20
+
+///  Chance in 100 of the phone sending its answer twice ("stacked up").
+#define  LINK_SIM_DUPLICATE_PERCENT    25
+
+///  Chance in 100 of a send failing with APP_MSG_BUSY.
+#define  LINK_SIM_BUSY_PERCENT         10
+
+///  Chance in 100 of the phone being disconnected at the start of a run,
+///  and for how long, range in ms.
+#define  LINK_SIM_DISCONNECT_PERCENT   15
+#define  LINK_SIM_DISCONNECT_MAX_MS    6000
+
+///  Time the phone app takes to start, at launch and on reconnecting, range
+///  in ms.  Requests before then go unanswered.
+#define  LINK_SIM_PHONE_START_MAX_MS   3000
+
+///  Time the phone takes to get a fix, range in ms.
+#define  LINK_SIM_FIX_MIN_MS           100
+#define  LINK_SIM_FIX_MAX_MS           1500
+
+///  Time before an unacknowledged send fails with APP_MSG_SEND_TIMEOUT.
+#define  LINK_SIM_SEND_TIMEOUT_MS      2000
+
+///  Time left after each fix or failure for strays (duplicates, late
+///  retries) to turn up before the next run.
+#define  LINK_SIM_SETTLE_MS            3000
+
+///  A run with no fix or failure by now is hung: longer than messaging
+///  takes to wait out every send's answer, the backoffs between them, a
+///  busy outbox and a disconnect.
+#define  LINK_SIM_RUN_MAX_MS           ((APP_MSG_RETRY_MAX_ATTEMPTS *                    \
+                                         ((APP_MSG_ANSWER_TIMEOUT_SECS * 1000) +        \
+                                          APP_MSG_RETRY_MAX_MS)) +                       \
+                                        (APP_MSG_BUSY_MAX_RETRIES * APP_MSG_BUSY_RETRY_MS) + \
+                                        LINK_SIM_DISCONNECT_MAX_MS + LINK_SIM_PHONE_START_MAX_MS)
+
+///  Seconds since 1970 given as the phone's fix time.
+#define  LINK_SIM_FIX_TIME             1420070400
+
+
+// ------------------------------------------------
+//  Random numbers
+
+
+static uint32_t seed = LINK_SIM_SEED;
+
+///  0 - (range - 1), from a plain LCG: good enough, and the same every build.
+static uint32_t  link_sim_random(uint32_t range)
+{
+   seed = (seed * 1103515245UL) + 12345;
+   return (range == 0) ? 0 : ((seed >> 8) % range);
+}
+
+///  minimum - maximum inclusive.
+static uint32_t  link_sim_between(uint32_t minimum, uint32_t maximum)
+{
+   return minimum + link_sim_random(maximum - minimum + 1);
+}
+
+///  true percent times in 100.
+static bool  link_sim_chance(uint32_t percent)
+{
+   return link_sim_random(100) < percent;
+}
+
+
+// ------------------------------------------------
+//  The phone
+
+
+///  Virtual time that the phone app is up: it (re)starts at launch and
+///  with each reconnect.
+static uint64_t phoneReadyMs = 0;
+
+///  Run the phone is answering, to tell its answers apart.
+static int runIndex = 0;
+
+///  Phone answers sent twice.
+static int duplicatesSent = 0;
+
+
+///  How a send from the watch turned out: the phone's ack, or a timeout.
+static void  link_sim_outbox_done(void *pData)
+{
+   host_app_message_outbox_done((AppMessageResult) (uintptr_t) pData);
+}
+
+
+///  A phone answer arrives at the watch (host_app_message_deliver() drops
+///  it if the link is down).
+static void  link_sim_deliver_answer(void *pData)
+{
+
+   int run = (int) (uintptr_t) pData;
+
+   //  As the JS packs it, with the run in the latitude to tell it apart.
+   uint8_t aLocation[APP_MSG_LOCATION_FIXED_BYTES];
+   memset(aLocation, 0, sizeof(aLocation));
+   aLocation[0] = APP_MSG_LOCATION_VERSION;
+   int32_t latitude = run * 1000;
+   for (int i = 0; i < 4; i++)
+   {
+      aLocation[2 + i] = (uint8_t) (latitude >> (8 * i));
+      aLocation[14 + i] = (uint8_t) (LINK_SIM_FIX_TIME >> (8 * i));
+   }
+   aLocation[18] = 10;    // metres
+
+   uint8_t aInbox[64];
+   DictionaryIterator iter;
+   dict_write_begin(&iter, aInbox, sizeof(aInbox));
+   dict_write_data(&iter, MSG_KEY_LOCATION, aLocation, sizeof(aLocation));
+   uint32_t size = dict_write_end(&iter);
+
+   host_app_message_deliver(aInbox, (uint16_t) size);
+
+}  /* end of link_sim_deliver_answer */
+
+
+///  Send an answer from the phone, which may be lost on the way.
+static void  link_sim_send_answer(int run)
+{
+   if (!link_sim_chance(LINK_SIM_DROP_PERCENT))
+   {
+      app_timer_register(link_sim_between(LINK_SIM_LATENCY_MIN_MS, LINK_SIM_LATENCY_MAX_MS),
+                         link_sim_deliver_answer, (void *) (uintptr_t) run);
+   }
+}
+
+
+///  The phone has its fix: answer, maybe twice.
+static void  link_sim_phone_fix(void *pData)
+{
+
+   int run = (int) (uintptr_t) pData;
+
+   link_sim_send_answer(run);
+
+   if (link_sim_chance(LINK_SIM_DUPLICATE_PERCENT))
+   {
+      duplicatesSent++;
+      link_sim_send_answer(run);
+   }
+
+}  /* end of link_sim_phone_fix */
+
+
+///  HostPhoneHandler: a message from the watch, over the lossy link.
+static AppMessageResult  link_sim_phone(DictionaryIterator *pSent)
+{
+
+   if (link_sim_chance(LINK_SIM_BUSY_PERCENT))
+   {
+      return APP_MSG_BUSY;
+   }
+
+   AppMessageResult result = APP_MSG_OK;
+   uint32_t delayMs = link_sim_between(LINK_SIM_LATENCY_MIN_MS, LINK_SIM_LATENCY_MAX_MS);
+
+   if (link_sim_chance(LINK_SIM_DROP_PERCENT) || (host_clock_now_ms() < phoneReadyMs))
+   {
+      //  lost, or nothing on the phone to ack it.
+      result = APP_MSG_SEND_TIMEOUT;
+      delayMs = LINK_SIM_SEND_TIMEOUT_MS;
+   }
+   else if (dict_find(pSent, MSG_KEY_GET_LAT_LONG) != NULL)
+   {
+      app_timer_register(delayMs + link_sim_between(LINK_SIM_FIX_MIN_MS, LINK_SIM_FIX_MAX_MS),
+                         link_sim_phone_fix, (void *) (uintptr_t) runIndex);
+   }
+
+   app_timer_register(delayMs, link_sim_outbox_done, (void *) (uintptr_t) result);
+
+   return APP_MSG_OK;
+
+}  /* end of link_sim_phone */
+
+
+///  End of a simulated disconnect.
+static void  link_sim_reconnect(void *pData)
+{
+   (void) pData;
+
+   phoneReadyMs = host_clock_now_ms() + link_sim_random(LINK_SIM_PHONE_START_MAX_MS);
+   host_connection_set(true);
+}
+
+
+// ------------------------------------------------
+//  The runs
+
+
+///  Is a run waiting for its fix?
+static bool fRunActive = false;
+
+///  When the run started.
+static uint64_t runStartMs;
+
+///  Hung run timeout, or the settling time after a run.
+static AppTimer *pRunTimer = NULL;
+
+///  messaging's counts at the start and end of the run.
+static AppMsgStats statsRunStart;
+static AppMsgStats statsRunEnd;
+
+///  Results.
+static uint32_t aTimeToFixMs[LINK_SIM_RUNS];
+static int fixes = 0;
+static int failed = 0;
+static int failedAtRetryLimit = 0;
+static int hung = 0;
+static int aRetries[4];    // 0, 1, 2, 3 or more
+static int lateCallbacks = 0;
+static int staleFixes = 0;
+static int sendsAfterFix = 0;
+static bool fDone = false;
+
+
+static void  link_sim_coords_recvd(const AppMsgLocation *pLocation);
+static void  link_sim_coords_failed(FailureSource eErrSrc, int32_t errCode,
+                                    const char *pszErrMsg);
+static void  link_sim_start_run(void);
+
+
+///  Print the results, as JSON lines.
+static void  link_sim_report(void)
+{
+
+   //  (few enough for an insertion sort)
+   for (int i = 1; i < fixes; i++)
+   {
+      uint32_t ms = aTimeToFixMs[i];
+      int j = i;
+      for ( ; (j > 0) && (aTimeToFixMs[j - 1] > ms); j--)
+      {
+         aTimeToFixMs[j] = aTimeToFixMs[j - 1];
+      }
+      aTimeToFixMs[j] = ms;
+   }
+
+   uint64_t totalMs = 0;
+   for (int i = 0; i < fixes; i++)
+   {
+      totalMs += aTimeToFixMs[i];
+   }
+
+   AppMsgStats stats;
+   app_msg_get_stats(&stats);
+   int perFix = (fixes > 0) ? fixes : 1;
+
+   printf("{\"linksim_config\":{\"runs\":%d,\"drop_pct\":%d,\"dup_pct\":%d,"
+          "\"busy_pct\":%d,\"disconnect_pct\":%d}}\n",
+          LINK_SIM_RUNS, LINK_SIM_DROP_PERCENT, LINK_SIM_DUPLICATE_PERCENT,
+          LINK_SIM_BUSY_PERCENT, LINK_SIM_DISCONNECT_PERCENT);
+
+   printf("{\"linksim\":{\"fixes\":%d,\"failed\":%d,\"hung\":%d,"
+          "\"ttf_ms\":{\"min\":%u,\"p50\":%u,\"p90\":%u,\"max\":%u,\"mean\":%u}}}\n",
+          fixes, failed, hung,
+          (fixes > 0) ? aTimeToFixMs[0] : 0,
+          (fixes > 0) ? aTimeToFixMs[fixes / 2] : 0,
+          (fixes > 0) ? aTimeToFixMs[(fixes * 9) / 10] : 0,
+          (fixes > 0) ? aTimeToFixMs[fixes - 1] : 0,
+          (unsigned) (totalMs / perFix));
+
+   printf("{\"linksim_retries\":{\"0\":%d,\"1\":%d,\"2\":%d,\"3+\":%d},"
+          "\"wakeups_per_fix_x10\":%d,\"failures_per_fix_x10\":%d}\n",
+          aRetries[0], aRetries[1], aRetries[2], aRetries[3],
+          (stats.usRadioWakeups * 10) / perFix, (stats.usOutboxFailures * 10) / perFix);
+
+   printf("{\"linksim_duplicates\":{\"sent\":%d,\"late_callbacks\":%d,"
+          "\"stale_fixes\":%d,\"sends_after_fix\":%d}}\n",
+          duplicatesSent, lateCallbacks, staleFixes, sendsAfterFix);
+
+}  /* end of link_sim_report */
+
+
+///  Settling time is over: check for strays, and on to the next run.
+static void  link_sim_settled(void *pData)
+{
+   (void) pData;
+
+   pRunTimer = NULL;
+
+   //  Once a run has its answer, nothing more should go out for it.
+   AppMsgStats stats;
+   app_msg_get_stats(&stats);
+   sendsAfterFix += stats.usRadioWakeups - statsRunEnd.usRadioWakeups;
+
+   if (runIndex < LINK_SIM_RUNS)
+   {
+      link_sim_start_run();
+   }
+   else
+   {
+      fDone = true;
+   }
+
+}  /* end of link_sim_settled */
+
+
+///  The run has its answer: give strays time to show up.
+static void  link_sim_end_run(void)
+{
+
+   fRunActive = false;
+   app_msg_get_stats(&statsRunEnd);
+
+   if (pRunTimer != NULL)
+   {
+      app_timer_cancel(pRunTimer);
+   }
+   pRunTimer = app_timer_register(LINK_SIM_SETTLE_MS, link_sim_settled, NULL);
+
+}  /* end of link_sim_end_run */
+
+
+///  No answer at all: start messaging afresh, so the next run can ask.
+static void  link_sim_run_hung(void *pData)
+{
+   (void) pData;
+
+   pRunTimer = NULL;
+   hung++;
+   printf("run %d hung\n", runIndex);
+
+   app_msg_deinit();
+   app_msg_init(link_sim_coords_recvd, link_sim_coords_failed);
+
+   link_sim_end_run();
+
+}  /* end of link_sim_run_hung */
+
+
+static void  link_sim_coords_recvd(const AppMsgLocation *pLocation)
+{
+
+   int run = pLocation->latitude / 1000;
+
+   if (!fRunActive)
+   {
+      //  a duplicate after the run had its answer: passed on, harmlessly.
+      lateCallbacks++;
+      return;
+   }
+
+   if (run != runIndex)
+   {
+      //  an earlier run's answer, taken for this run's.
+      staleFixes++;
+   }
+
+   aTimeToFixMs[fixes++] = (uint32_t) (host_clock_now_ms() - runStartMs);
+
+   AppMsgStats stats;
+   app_msg_get_stats(&stats);
+   int retries = stats.usRetries - statsRunStart.usRetries;
+   aRetries[(retries < 3) ? retries : 3]++;
+
+   link_sim_end_run();
+
+}  /* end of link_sim_coords_recvd */
+
+
+static void  link_sim_coords_failed(FailureSource eErrSrc, int32_t errCode,
+                                    const char *pszErrMsg)
+{
+
+   if ((eErrSrc == FAIL_SRC_APP_MSG) && (errCode == APP_MSG_NOT_CONNECTED))
+   {
+      //  messaging waits for the connection to come back.
+      return;
+   }
+
+   if (fRunActive)
+   {
+      printf("run %d failed: %d, \"%s\"\n", runIndex, (int) errCode, pszErrMsg);
+      failed++;
+      failedAtRetryLimit += (eErrSrc == FAIL_SRC_APP_MSG) &&
+                            (errCode == APP_MSG_FAIL_RETRY_LIMIT);
+      link_sim_end_run();
+   }
+
+}  /* end of link_sim_coords_failed */
+
+
+///  Next location request, under new conditions.
+static void  link_sim_start_run(void)
+{
+
+   runIndex++;
+   runStartMs = host_clock_now_ms();
+
+   if (runIndex == 1)
+   {
+      //  launched with the face, as the JS is.
+      phoneReadyMs = runStartMs + link_sim_random(LINK_SIM_PHONE_START_MAX_MS);
+   }
+
+   if (link_sim_chance(LINK_SIM_DISCONNECT_PERCENT))
+   {
+      host_connection_set(false);
+      app_timer_register(link_sim_random(LINK_SIM_DISCONNECT_MAX_MS), link_sim_reconnect, NULL);
+   }
+
+   app_msg_get_stats(&statsRunStart);
+   fRunActive = true;
+   pRunTimer = app_timer_register(LINK_SIM_RUN_MAX_MS, link_sim_run_hung, NULL);
+
+   app_msg_RequestLatLong();
+
+}  /* end of link_sim_start_run */
+
+
+static void  test_lossy_link(void)
+{
+
+   host_app_message_set_phone(link_sim_phone);
+   app_msg_init(link_sim_coords_recvd, link_sim_coords_failed);
+
+   link_sim_start_run();
+   host_timers_run(LINK_SIM_RUNS * (LINK_SIM_RUN_MAX_MS + LINK_SIM_SETTLE_MS));
+
+   link_sim_report();
+
+   CHECK(fDone);
+   CHECK_EQ(fixes + failed + hung, LINK_SIM_RUNS);
+   CHECK_EQ(hung, 0);
+   CHECK_EQ(staleFixes, 0);
+   CHECK_EQ(sendsAfterFix, 0);
+
+   //  Every run gets there, lossy as the link is, or gives up only once
+   //  it has sent as often as it may.
+   CHECK_EQ(fixes + failedAtRetryLimit, LINK_SIM_RUNS);
+
+   app_msg_deinit();
+
+}  /* end of test_lossy_link */
+
+
+int  main(void)
+{
+   RUN_TEST(test_lossy_link);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,201 @@
+/**
+ *  @file
+ *
+ *  MathSweep.c against libm.  On the watch the sweep grades the my_math
+ *  approximations against its own double-precision references, there
+ *  being no libm: here those references are checked against libm, and
+ *  the approximations' errors and what they do to sunrise at London are
+ *  held to what the sweep reports.
+ *
+ *  MathSweep.c is included, not linked, for its static references.
+ */
+
+#include  <math.h>
+
+#include  "host_test.h"
+
+//  (my_math.h has its own.)
+#undef  M_PI
+#include  "../../src/MathSweep.c"
+
+HOST_TEST_MAIN_DECLS;
+
+
+///  Points per function, as the sweep takes.
+#define  POINTS   SWEEP_POINTS
+
+
+typedef struct
+{
+   const char *pszName;
+   double (*pfnRef)(double);
+   double (*pfnLibm)(double);
+   float (*pfnFloat)(float);
+   double lo;
+   double hi;
+   ///  Most my_math may be from libm.
+   double maxAbs;
+} LibmFunction;
+
+static double  libm_tan(double x)  { return tan(x); }
+
+///  As math_sweep_run() sweeps them, with the worst errors it finds, rounded up.
+static const LibmFunction aFunctions[] =
+{
+   { "sin",  ref_sin,  sin,      my_sin,  -4 * M_PI, 4 * M_PI, 4e-7   },
+   { "cos",  ref_cos,  cos,      my_cos,  -4 * M_PI, 4 * M_PI, 4e-7   },
+   { "tan",  ref_tan,  libm_tan, my_tan,  -1.5,      1.5,      1.5e-6 },
+   { "atan", ref_atan, atan,     my_atan, -20,       20,       3e-3   },
+   { "asin", ref_asin, asin,     my_asin, -1,        1,        1.6e-3 },
+   { "acos", ref_acos, acos,     my_acos, -1,        1,        1.6e-3 },
+   { "sqrt", ref_sqrt, sqrt,     my_sqrt,  0,        4,        3.5e-3 },
+};
+#define  NUM_FUNCTIONS   ((int) (sizeof(aFunctions) / sizeof(aFunctions[0])))
+
+
+///  The sweep's references are good to far better than float.
+static void  test_references_match_libm(void)
+{
+
+   for (int f = 0; f < NUM_FUNCTIONS; f++)
+   {
+      const LibmFunction *pFunc = &aFunctions[f];
+      double worst = 0;
+
+      for (int i = 0; i < POINTS; i++)
+      {
+         double x = pFunc->lo + ((pFunc->hi - pFunc->lo) * i) / (POINTS - 1);
+         double err = fabs(pFunc->pfnRef(x) - pFunc->pfnLibm(x));
+         //  (relative for tan, which runs up to 14.)
+         if (fabs(pFunc->pfnLibm(x)) > 1)
+         {
+            err /= fabs(pFunc->pfnLibm(x));
+         }
+         if (err > worst)
+         {
+            worst = err;
+         }
+      }
+
+      printf("ref_%-4s worst %.1e off libm\n", pFunc->pszName, worst);
+      CHECK(worst < 1e-12);
+   }
+
+}  /* end of test_references_match_libm */
+
+
+///  my_math is as far from libm as the sweep says, and no further.
+static void  test_my_math_against_libm(void)
+{
+
+   for (int f = 0; f < NUM_FUNCTIONS; f++)
+   {
+      const LibmFunction *pFunc = &aFunctions[f];
+      double worst = 0;
+      double xWorst = 0;
+
+      for (int i = 0; i < POINTS; i++)
+      {
+         float x = pFunc->lo + ((pFunc->hi - pFunc->lo) * i) / (POINTS - 1);
+         double err = fabs(pFunc->pfnFloat(x) - pFunc->pfnLibm(x));
+         if (err > worst)
+         {
+            worst = err;
+            xWorst = x;
+         }
+      }
+
+      printf("my_%-4s worst %.2e off libm, at %g\n", pFunc->pszName, worst, xWorst);
+      CHECK(worst <= pFunc->maxAbs);
+   }
+
+}  /* end of test_my_math_against_libm */
+
+
+///  Worst and mean sunrise / sunset error over a year at London, in seconds,
+///  against the double almanac with libm trig.
+static void  sun_error(const AlmanacFunc aMath[], double *pWorst, double *pMean)
+{
+
+   static const AlmanacFunc aLibm[NUM_ALMANAC_KERNELS] =
+   {
+      sin, cos, libm_tan, atan, asin, acos
+   };
+
+   double worst = 0;
+   double sum = 0;
+   int count = 0;
+
+   for (int day = 1; day <= 365; day++)
+   {
+      for (int sunset = 0; sunset <= 1; sunset++)
+      {
+         double ref = ref_sun_event(aLibm, day, SWEEP_DEFAULT_LATITUDE,
+                                    SWEEP_DEFAULT_LONGITUDE, ZENITH_OFFICIAL, sunset);
+         double test = (aMath == NULL) ?
+                          (sunset ? calcSunSet(2015, 1, day, SWEEP_DEFAULT_LATITUDE,
+                                               SWEEP_DEFAULT_LONGITUDE, ZENITH_OFFICIAL) :
+                                    calcSunRise(2015, 1, day, SWEEP_DEFAULT_LATITUDE,
+                                                SWEEP_DEFAULT_LONGITUDE, ZENITH_OFFICIAL)) :
+                          ref_sun_event(aMath, day, SWEEP_DEFAULT_LATITUDE,
+                                        SWEEP_DEFAULT_LONGITUDE, ZENITH_OFFICIAL, sunset);
+
+         double err = fabs(event_diff_secs(test, ref));
+         worst = (err > worst) ? err : worst;
+         sum += err;
+         count++;
+      }
+   }
+
+   *pWorst = worst;
+   *pMean = sum / count;
+
+}  /* end of sun_error */
+
+
+///  What each kernel costs sunrise at London, as the sweep reports it.
+static void  test_sunrise_error_at_london(void)
+{
+
+   double worst, mean;
+
+   //  calcSun() itself: the ephemeris table leaves out my_atan.
+   sun_error(NULL, &worst, &mean);
+   printf("calcSun  worst %.3f s, mean %.3f s\n", worst, mean);
+   CHECK(worst < 3);
+
+   for (int i = 0; i < NUM_ALMANAC_KERNELS; i++)
+   {
+      AlmanacFunc aMath[NUM_ALMANAC_KERNELS];
+      memcpy(aMath, aRefKernels, sizeof(aMath));
+      aMath[i] = aFloatKernels[i];
+      sun_error(aMath, &worst, &mean);
+      printf("%-8s worst %.3f s, mean %.3f s\n", apszKernelNames[i], worst, mean);
+
+      switch (i)
+      {
+         case ALMANAC_ATAN:
+            //  The one that matters: tens of seconds.
+            CHECK((worst > 30) && (worst < 45));
+            CHECK((mean > 20) && (mean < 30));
+            break;
+         case ALMANAC_ACOS:
+            CHECK(worst < 3);
+            break;
+         default:
+            CHECK(worst < 0.01);
+            break;
+      }
+   }
+
+}  /* end of test_sunrise_error_at_london */
+
+
+int  main(void)
+{
+   RUN_TEST(test_references_match_libm);
+   RUN_TEST(test_my_math_against_libm);
+   RUN_TEST(test_sunrise_error_at_london);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,127 @@
+/**
+ *  @file
+ *
+ *  messaging: a location request the phone took, but whose answer never
+ *  came back, is sent again after APP_MSG_ANSWER_TIMEOUT_SECS, and given
+ *  up after APP_MSG_RETRY_MAX_ATTEMPTS sends, so that the next request is
+ *  sent rather than taken as a repeat of it.
+ */
+
+#include  "host_test.h"
+
+#include  "messaging.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+///  The phone's answer: a MSG_KEY_LOCATION for London.
+static void  deliver_location(void)
+{
+
+   uint8_t aBytes[APP_MSG_LOCATION_FIXED_BYTES];
+   memset(aBytes, 0, sizeof(aBytes));
+   aBytes[0] = APP_MSG_LOCATION_VERSION;
+   int32_t latitude = 51500000;
+   memcpy(&aBytes[2], &latitude, sizeof(latitude));
+
+   uint8_t aBuffer[64];
+   DictionaryIterator iter;
+   dict_write_begin(&iter, aBuffer, sizeof(aBuffer));
+   Tuplet location = TupletBytes(MSG_KEY_LOCATION, aBytes, sizeof(aBytes));
+   dict_write_tuplet(&iter, &location);
+   uint32_t size = dict_write_end(&iter);
+
+   host_app_message_deliver(aBuffer, (uint16_t) size);
+
+}  /* end of deliver_location */
+
+
+static void  test_lost_answer(void)
+{
+
+   host_test_messaging_init(host_test_phone_takes, NULL);
+   CHECK(app_msg_RequestLatLong());
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   //  Asking again while the answer may still come is a repeat.
+   host_timers_run((APP_MSG_ANSWER_TIMEOUT_SECS - 1) * 1000);
+   CHECK(app_msg_RequestLatLong());
+   CHECK_EQ(host_app_message_sends(), 1);
+   CHECK_EQ(hostTestLocations.failures, 0);
+
+   //  Once it can't, the request is sent again, after the first backoff.
+   host_timers_run(1000 + APP_MSG_RETRY_FIRST_MS);
+   CHECK_EQ(host_app_message_sends(), 2);
+   CHECK_EQ(hostTestLocations.failures, 0);
+
+   //  And so on, until the last send goes unanswered too; then the request
+   //  has failed, with no more sends of its own.
+   host_timers_run(APP_MSG_RETRY_MAX_ATTEMPTS *
+                   ((APP_MSG_ANSWER_TIMEOUT_SECS * 1000) + APP_MSG_RETRY_MAX_MS));
+   CHECK_EQ(host_app_message_sends(), APP_MSG_RETRY_MAX_ATTEMPTS);
+   CHECK_EQ(hostTestLocations.failures, 1);
+   CHECK_EQ(hostTestLocations.lastErrCode, APP_MSG_FAIL_RETRY_LIMIT);
+   host_timers_run(SECONDS_PER_HOUR * 1000);
+   CHECK_EQ(host_app_message_sends(), APP_MSG_RETRY_MAX_ATTEMPTS);
+   CHECK_EQ(hostTestLocations.failures, 1);
+
+   //  And the next is sent afresh.
+   CHECK(app_msg_RequestLatLong());
+   CHECK_EQ(host_app_message_sends(), APP_MSG_RETRY_MAX_ATTEMPTS + 1);
+
+   app_msg_deinit();
+
+}  /* end of test_lost_answer */
+
+
+static void  test_answer_in_time(void)
+{
+
+   host_test_messaging_init(host_test_phone_takes, NULL);
+   CHECK(app_msg_RequestLatLong());
+   host_timers_run(5 * 1000);
+   deliver_location();
+   CHECK_EQ(hostTestLocations.fixes, 1);
+
+   //  Nothing more comes of that request.
+   host_timers_run(2 * APP_MSG_ANSWER_TIMEOUT_SECS * 1000);
+   CHECK_EQ(hostTestLocations.failures, 0);
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   app_msg_deinit();
+
+}  /* end of test_answer_in_time */
+
+
+static void  test_answer_to_resend(void)
+{
+
+   host_test_messaging_init(host_test_phone_takes, NULL);
+   CHECK(app_msg_RequestLatLong());
+
+   //  The first answer is lost; the second send's isn't.
+   host_timers_run((APP_MSG_ANSWER_TIMEOUT_SECS * 1000) + APP_MSG_RETRY_FIRST_MS);
+   CHECK_EQ(host_app_message_sends(), 2);
+   host_timers_run(5 * 1000);
+   deliver_location();
+   CHECK_EQ(hostTestLocations.fixes, 1);
+
+   //  Which ends the request.
+   host_timers_run(APP_MSG_RETRY_MAX_ATTEMPTS *
+                   ((APP_MSG_ANSWER_TIMEOUT_SECS * 1000) + APP_MSG_RETRY_MAX_MS));
+   CHECK_EQ(host_app_message_sends(), 2);
+   CHECK_EQ(hostTestLocations.failures, 0);
+
+   app_msg_deinit();
+
+}  /* end of test_answer_to_resend */
+
+
+int  main(void)
+{
+   RUN_TEST(test_lost_answer);
+   RUN_TEST(test_answer_in_time);
+   RUN_TEST(test_answer_to_resend);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,363 @@
+/**
+ *  @file
+ *
+ *  RefreshPolicy: the first location query, made with no location at all,
+ *  writes nothing to flash; a change of the watch's UTC offset, which
+ *  doesn't move time(), asks for a fix once; routine refreshes back off
+ *  from REFRESH_POLICY_MIN_AGE_SECS to REFRESH_POLICY_MAX_AGE_SECS, in the
+ *  hours of REFRESH_POLICY_HOURS only; a clock jump asks at once; no more
+ *  than REFRESH_POLICY_MAX_PER_DAY queries are made a day; and the state
+ *  is written once for a burst of changes.
+ */
+
+#include  "host_test.h"
+
+#include  "ConfigData.h"
+#include  "messaging.h"
+#include  "RefreshPolicy.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+///  Location requests messaging had made before this test's start().
+static int requestsAtStart = 0;
+
+///  Location requests made of messaging since start() (each of which it may
+///  send more than once).
+static int  location_requests(void)
+{
+   AppMsgStats stats;
+   app_msg_get_stats(&stats);
+   return stats.usRequests - requestsAtStart;
+}
+
+
+static void  start(void)
+{
+   config_data_init();
+   refresh_policy_init();
+   host_test_messaging_init(host_test_phone_takes, refresh_policy_query_failed);
+   requestsAtStart = 0;
+   requestsAtStart = location_requests();
+}
+
+
+///  The next minute tick, as sunclock.c makes it.
+static void  minute_tick(void)
+{
+   host_timers_run(60 * 1000);
+   time_t now = time(NULL);
+   refresh_policy_minute_tick(localtime(&now));
+}
+
+
+///  Run the clock on, without ticks, to the next start of a local hour.
+static void  run_to_hour(int hour)
+{
+   time_t now = time(NULL);
+   struct tm local = *localtime(&now);
+   int secs = (((hour - local.tm_hour + 24) % 24) * SECONDS_PER_HOUR) -
+              (local.tm_min * 60) - local.tm_sec;
+   host_timers_run(((secs <= 0) ? secs + SECONDS_PER_DAY : secs) * 1000);
+}
+
+
+///  Local hour now.
+static int  local_hour(void)
+{
+   time_t now = time(NULL);
+   return localtime(&now)->tm_hour;
+}
+
+
+static void  test_no_location_not_persisted(void)
+{
+
+   start();
+   CHECK(!config_data_location_avail());
+   int writesBefore = host_persist_writes();
+
+   CHECK(refresh_policy_request(REFRESH_POLICY_NO_LOCATION));
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   //  Asked again, as from each redraw: the one query is outstanding.
+   CHECK(refresh_policy_request(REFRESH_POLICY_NO_LOCATION));
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   CHECK_EQ(host_persist_writes(), writesBefore);
+   CHECK(!persist_exists(REFRESH_POLICY_KEY));
+
+   RefreshPolicyStats stats;
+   refresh_policy_get_stats(&stats);
+   CHECK_EQ(stats.usQueriesToday, 0);
+
+   app_msg_deinit();
+
+}  /* end of test_no_location_not_persisted */
+
+
+static void  test_utc_offset_change(void)
+{
+
+   start();
+   CHECK(config_data_location_set(51500000, -130000, 0));
+
+   //  The first tick only primes; then a tick with the offset unchanged.
+   minute_tick();
+   minute_tick();
+   CHECK_EQ(host_app_message_sends(), 0);
+
+   //  The phone moves to UTC+1.  time() runs on as before.
+   host_clock_set_local_offset(60 * 60);
+   minute_tick();
+   CHECK_EQ(host_app_message_sends(), 1);
+   int requestsBefore = location_requests();
+
+   RefreshPolicyStats stats;
+   refresh_policy_get_stats(&stats);
+   CHECK_EQ(stats.usQueriesToday, 1);
+
+   //  Once, not every minute while the answer is awaited or lost.
+   for (int i = 0; i < 10; i++)
+   {
+      minute_tick();
+   }
+   CHECK_EQ(location_requests(), requestsBefore);
+
+   //  Once the fix brings our offset into line, nothing more.
+   CHECK(config_data_location_set(51500000, -130000, -60 * 60));
+   refresh_policy_fix_received(false);
+   for (int i = 0; i < 2 * REFRESH_POLICY_RETRY_SECS / 60; i++)
+   {
+      minute_tick();
+   }
+   CHECK_EQ(location_requests(), requestsBefore);
+
+   app_msg_deinit();
+
+}  /* end of test_utc_offset_change */
+
+
+/**
+ *  Tick until the policy makes a routine query, checking it is made in
+ *  the hours allowed.
+ *
+ *  @return Seconds from now until the query, or -1 if none came within
+ *          twice REFRESH_POLICY_MAX_AGE_SECS.
+ */
+static int32_t  secs_to_next_query(void)
+{
+
+   time_t start = time(NULL);
+   int requestsBefore = location_requests();
+
+   while (time(NULL) - start < 2 * REFRESH_POLICY_MAX_AGE_SECS)
+   {
+      minute_tick();
+      if (location_requests() != requestsBefore)
+      {
+         CHECK(REFRESH_POLICY_HOURS & REFRESH_POLICY_HOUR(local_hour()));
+         return (int32_t) (time(NULL) - start);
+      }
+   }
+
+   return -1;
+
+}  /* end of secs_to_next_query */
+
+
+static void  test_backoff(void)
+{
+
+   start();
+   CHECK(config_data_location_set(51500000, -130000, 0));
+   minute_tick();
+
+   //  A new location is refreshed once it is REFRESH_POLICY_MIN_AGE_SECS
+   //  old, in the next allowed hour.  (The longest wait for one is from
+   //  20:00 to 06:00.)
+   int32_t secs = secs_to_next_query();
+   CHECK(secs >= REFRESH_POLICY_MIN_AGE_SECS - 60);
+   CHECK(secs <= REFRESH_POLICY_MIN_AGE_SECS + 10 * SECONDS_PER_HOUR);
+
+   //  Each answer that didn't move us doubles that, up to the cap.
+   int32_t dueAge = REFRESH_POLICY_MIN_AGE_SECS;
+   for (int fixes = 1; fixes <= 6; fixes++)
+   {
+      refresh_policy_fix_received(false);
+      dueAge = (2 * dueAge > REFRESH_POLICY_MAX_AGE_SECS) ? REFRESH_POLICY_MAX_AGE_SECS :
+                                                              2 * dueAge;
+
+      secs = secs_to_next_query();
+      CHECK(secs >= dueAge);
+      CHECK(secs <= dueAge + 10 * SECONDS_PER_HOUR);
+   }
+
+   RefreshPolicyStats stats;
+   refresh_policy_get_stats(&stats);
+   CHECK_EQ(stats.usSameFixes, 6);
+
+   //  One that did starts over.
+   refresh_policy_fix_received(true);
+   secs = secs_to_next_query();
+   CHECK(secs >= REFRESH_POLICY_MIN_AGE_SECS);
+   CHECK(secs <= REFRESH_POLICY_MIN_AGE_SECS + 10 * SECONDS_PER_HOUR);
+
+   app_msg_deinit();
+
+}  /* end of test_backoff */
+
+
+static void  test_hour_window(void)
+{
+
+   //  Local time five hours behind UTC, as our location has it.
+   host_clock_set_local_offset(-5 * SECONDS_PER_HOUR);
+   start();
+   run_to_hour(20);
+   CHECK(config_data_location_set(40700000, -74000000, 5 * SECONDS_PER_HOUR));
+   minute_tick();
+
+   //  Due at 02:00 local, but it waits for 06:00, local not UTC.
+   int32_t secs = secs_to_next_query();
+   CHECK(secs >= 10 * SECONDS_PER_HOUR - 60);
+   CHECK(secs <= 10 * SECONDS_PER_HOUR + 60);
+   CHECK_EQ(local_hour(), 6);
+
+   app_msg_deinit();
+
+}  /* end of test_hour_window */
+
+
+///  The clock set on by more than REFRESH_POLICY_CLOCK_JUMP_SECS, then a tick.
+static void  clock_jump(void)
+{
+   host_timers_run(REFRESH_POLICY_CLOCK_JUMP_SECS * 1000);
+   minute_tick();
+}
+
+
+static void  test_clock_jump(void)
+{
+
+   start();
+   run_to_hour(3);
+   CHECK(config_data_location_set(51500000, -130000, 0));
+   minute_tick();
+   minute_tick();
+   CHECK_EQ(location_requests(), 0);
+
+   //  Set on: asked at once, outside the hours for routine refreshes.
+   clock_jump();
+   CHECK_EQ(location_requests(), 1);
+   CHECK((REFRESH_POLICY_HOURS & REFRESH_POLICY_HOUR(local_hour())) == 0);
+   refresh_policy_fix_received(false);
+
+   //  Set back, once messaging has given up on the first's answer.
+   for (int i = 0; i < 5; i++)
+   {
+      minute_tick();
+   }
+   host_clock_set(time(NULL) - SECONDS_PER_HOUR);
+   minute_tick();
+   CHECK_EQ(location_requests(), 2);
+   refresh_policy_fix_received(false);
+
+   //  Ordinary ticks, a little early or late, don't.
+   host_timers_run(30 * 1000);
+   minute_tick();
+   minute_tick();
+   CHECK_EQ(location_requests(), 2);
+
+   app_msg_deinit();
+
+}  /* end of test_clock_jump */
+
+
+static void  test_daily_cap(void)
+{
+
+   start();
+   run_to_hour(1);
+   CHECK(config_data_location_set(51500000, -130000, 0));
+   minute_tick();
+
+   //  Every jump would ask, but only so many a day are made.
+   for (int i = 0; i < 2 * REFRESH_POLICY_MAX_PER_DAY; i++)
+   {
+      clock_jump();
+      refresh_policy_fix_received(false);
+   }
+   CHECK_EQ(location_requests(), REFRESH_POLICY_MAX_PER_DAY);
+
+   RefreshPolicyStats stats;
+   refresh_policy_get_stats(&stats);
+   CHECK_EQ(stats.usQueriesToday, REFRESH_POLICY_MAX_PER_DAY);
+
+   //  Nor on the next launch that day.
+   refresh_policy_deinit();
+   refresh_policy_init();
+   minute_tick();
+   clock_jump();
+   CHECK_EQ(location_requests(), REFRESH_POLICY_MAX_PER_DAY);
+
+   //  The next day starts a new count.
+   run_to_hour(1);
+   minute_tick();
+   CHECK_EQ(location_requests(), REFRESH_POLICY_MAX_PER_DAY + 1);
+   refresh_policy_get_stats(&stats);
+   CHECK_EQ(stats.usQueriesToday, 1);
+   CHECK_EQ(stats.usQueriesYesterday, REFRESH_POLICY_MAX_PER_DAY);
+
+   app_msg_deinit();
+
+}  /* end of test_daily_cap */
+
+
+static void  test_writes_coalesced(void)
+{
+
+   start();
+   CHECK(config_data_location_set(51500000, -130000, 0));
+   minute_tick();
+
+   //  A query and its answer are one write, when the delay is up.
+   clock_jump();
+   refresh_policy_fix_received(false);
+   CHECK(!persist_exists(REFRESH_POLICY_KEY));
+   host_timers_run(REFRESH_POLICY_WRITE_DELAY_SECS * 1000);
+   CHECK(persist_exists(REFRESH_POLICY_KEY));
+
+   RefreshPolicyStats stats;
+   refresh_policy_get_stats(&stats);
+   CHECK_EQ(stats.usFlashWrites, 1);
+
+   //  Held back ones are written at exit, and read at the next launch.
+   clock_jump();
+   refresh_policy_fix_received(false);
+   refresh_policy_deinit();
+   refresh_policy_get_stats(&stats);
+   CHECK_EQ(stats.usFlashWrites, 2);
+
+   refresh_policy_init();
+   refresh_policy_get_stats(&stats);
+   CHECK_EQ(stats.usSameFixes, 2);
+   CHECK_EQ(stats.usQueriesToday + stats.usQueriesYesterday, 2);
+
+   app_msg_deinit();
+
+}  /* end of test_writes_coalesced */
+
+
+int  main(void)
+{
+   RUN_TEST(test_no_location_not_persisted);
+   RUN_TEST(test_utc_offset_change);
+   RUN_TEST(test_backoff);
+   RUN_TEST(test_hour_window);
+   RUN_TEST(test_clock_jump);
+   RUN_TEST(test_daily_cap);
+   RUN_TEST(test_writes_coalesced);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,230 @@
+/**
+ *  @file
+ *
+ *  ScheduleStream: the worker writes the same schedule keys, so a stream
+ *  from the phone holds it off and writes nothing, nor asks the phone for
+ *  anything, until the worker confirms.  If it never does, the refresh is
+ *  left to the worker.
+ */
+
+#include  "host_test.h"
+
+#include  "ConfigData.h"
+#include  "messaging.h"
+#include  "ScheduleStream.h"
+#include  "SolarWorker.h"
+#include  "suncalc.h"
+#include  "TwilightSchedule.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+static const float aZeniths[] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                  ZENITH_CIVIL, ZENITH_OFFICIAL };
+#define  NUM_BANDS   ((int) (sizeof(aZeniths) / sizeof(aZeniths[0])))
+
+///  Stands in for an old schedule header, as the worker might be writing.
+static const uint32_t oldHeader = 0x5EED5EED;
+
+
+///  A face with a location, the phone there, and an old schedule in flash.
+static void  start_face(bool fWorkerRunning)
+{
+
+   config_data_init();
+   config_data_location_set(51500000, -130000, 0);
+   host_timers_run(1000);
+
+   host_worker_set_running(fWorkerRunning);
+   solar_worker_init();
+   host_test_messaging_init(NULL, NULL);
+   schedule_stream_init();
+
+   persist_write_data(TWILIGHT_SCHEDULE_KEY_HEADER, &oldHeader, sizeof(oldHeader));
+
+}  /* end of start_face */
+
+
+static void  stop_face(void)
+{
+   schedule_stream_deinit();
+   app_msg_deinit();
+   solar_worker_deinit();
+}
+
+
+///  Is the old schedule header still there, untouched?
+static bool  old_schedule_intact(void)
+{
+   uint32_t header = 0;
+   return (persist_read_data(TWILIGHT_SCHEDULE_KEY_HEADER, &header, sizeof(header)) ==
+              (int) sizeof(header)) &&
+          (header == oldHeader);
+}
+
+
+static void  refresh_today(void)
+{
+   time_t now = time(NULL);
+   schedule_stream_refresh(aZeniths, NUM_BANDS, localtime(&now));
+}
+
+
+static void  test_waits_for_worker(void)
+{
+
+   start_face(true);
+   refresh_today();
+
+   //  The hold is sent, and nothing else done yet.
+   AppWorkerMessage message;
+   CHECK_EQ(host_worker_last_message(&message), SOLAR_WORKER_MSG_HOLD);
+   CHECK_EQ(message.data0, 1);
+   CHECK(old_schedule_intact());
+   CHECK_EQ(host_app_message_sends(), 0);
+
+   //  Still nothing a moment later.
+   host_timers_run(500);
+   CHECK(old_schedule_intact());
+   CHECK_EQ(host_app_message_sends(), 0);
+
+   //  Once the worker confirms, the schedule is the face's.
+   host_worker_send_to_app(SOLAR_WORKER_MSG_HELD, 0, 0, 0);
+   CHECK(!old_schedule_intact());
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   //  (A late or repeated confirmation changes nothing.)
+   host_worker_send_to_app(SOLAR_WORKER_MSG_HELD, 0, 0, 0);
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   stop_face();
+
+}  /* end of test_waits_for_worker */
+
+
+static void  test_worker_never_confirms(void)
+{
+
+   start_face(true);
+   refresh_today();
+
+   host_timers_run(SCHEDULE_STREAM_STALL_MS + 1000);
+
+   //  Let go, and left to the worker, with the phone never asked.
+   CHECK_EQ(host_worker_last_message(NULL), SOLAR_WORKER_MSG_REFRESH);
+   CHECK(old_schedule_intact());
+   CHECK_EQ(host_app_message_sends(), 0);
+
+   //  A confirmation after all is too late.
+   host_worker_send_to_app(SOLAR_WORKER_MSG_HELD, 0, 0, 0);
+   CHECK(old_schedule_intact());
+   CHECK_EQ(host_app_message_sends(), 0);
+
+   stop_face();
+
+}  /* end of test_worker_never_confirms */
+
+
+static void  test_no_worker(void)
+{
+
+   start_face(false);
+   refresh_today();
+
+   //  Nothing to wait for.
+   CHECK_EQ(host_worker_messages(), 0);
+   CHECK(!old_schedule_intact());
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   stop_face();
+
+}  /* end of test_no_worker */
+
+
+///  A chunk of numDays days from firstDay, as the phone sends it.
+static void  deliver_chunk(int firstDay, int numDays)
+{
+
+   uint8_t aBytes[APP_MSG_SCHEDULE_CHUNK_MAX_BYTES];
+   aBytes[0] = APP_MSG_SCHEDULE_VERSION;
+   aBytes[1] = NUM_BANDS;
+   aBytes[2] = (uint8_t) firstDay;
+   aBytes[3] = (uint8_t) (firstDay >> 8);
+   aBytes[4] = (uint8_t) TWILIGHT_SCHEDULE_DAYS;
+   aBytes[5] = (uint8_t) (TWILIGHT_SCHEDULE_DAYS >> 8);
+   aBytes[6] = (uint8_t) numDays;
+
+   //  Dawns at 5:00 - 5:03, dusks at 19:00 - 19:03, every day.
+   uint8_t *p = &aBytes[APP_MSG_SCHEDULE_CHUNK_FIXED_BYTES];
+   for (int day = 0; day < numDays; day++)
+   {
+      for (int i = 0; i < 2 * NUM_BANDS; i++)
+      {
+         int minute = ((i < NUM_BANDS) ? (5 * 60) : (19 * 60)) + (i % NUM_BANDS);
+         *p++ = (uint8_t) minute;
+         *p++ = (uint8_t) (minute >> 8);
+      }
+   }
+
+   uint8_t aBuffer[128];
+   DictionaryIterator iter;
+   dict_write_begin(&iter, aBuffer, sizeof(aBuffer));
+   dict_write_data(&iter, MSG_KEY_SCHEDULE_CHUNK, aBytes, p - aBytes);
+   uint32_t size = dict_write_end(&iter);
+
+   host_app_message_deliver(aBuffer, (uint16_t) size);
+
+}  /* end of deliver_chunk */
+
+
+///  Day asked for by the last message sent, if it was an ack; else -1.
+static int  last_ack_day(void)
+{
+   uint16_t size;
+   const uint8_t *pBuffer = host_app_message_last_sent(&size);
+
+   DictionaryIterator iter;
+   dict_read_begin_from_buffer(&iter, pBuffer, size);
+   Tuple *pAck = dict_find(&iter, MSG_KEY_SCHEDULE_ACK);
+
+   return (pAck == NULL) ? -1 : pAck->value->uint16;
+}
+
+
+static void  test_ack_retried(void)
+{
+
+   start_face(false);
+   refresh_today();
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   //  The first chunk comes while the request is still in the outbox, so
+   //  its ack can't go yet.
+   deliver_chunk(0, 3);
+   CHECK_EQ(host_app_message_sends(), 1);
+
+   //  Once the outbox is free, it does.
+   host_app_message_outbox_done(APP_MSG_OK);
+   host_timers_run(SCHEDULE_STREAM_ACK_RETRY_MS);
+   CHECK_EQ(host_app_message_sends(), 2);
+   CHECK_EQ(last_ack_day(), 3);
+
+   //  And only the once.
+   host_app_message_outbox_done(APP_MSG_OK);
+   host_timers_run(SCHEDULE_STREAM_ACK_MAX_RETRIES * SCHEDULE_STREAM_ACK_RETRY_MS);
+   CHECK_EQ(host_app_message_sends(), 2);
+
+   stop_face();
+
+}  /* end of test_ack_retried */
+
+
+int  main(void)
+{
+   RUN_TEST(test_no_worker);
+   RUN_TEST(test_waits_for_worker);
+   RUN_TEST(test_worker_never_confirms);
+   RUN_TEST(test_ack_retried);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,116 @@
+/**
+ *  @file
+ *
+ *  SolarWorker: the worker reads the location from ConfigData's flash copy,
+ *  so a change ConfigData is holding back is written before the face has
+ *  the worker build, or lets it carry on.  And the worker's built-in copy
+ *  of the ephemeris table is the face's resource, so both work out the same
+ *  times.
+ */
+
+#include  "host_test.h"
+
+#include  "ConfigData.h"
+#include  "SolarWorker.h"
+#include  "SolarEphemeris.h"
+#include  "suncalc.h"
+
+#include  "../../worker_src/WorkerEphemerisTable.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+static const float aZeniths[] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                  ZENITH_CIVIL, ZENITH_OFFICIAL };
+#define  NUM_BANDS   ((int) (sizeof(aZeniths) / sizeof(aZeniths[0])))
+
+
+///  A location written, and a move since held back in RAM.
+static void  move_held_back(void)
+{
+
+   config_data_init();
+   config_data_location_set(51500000, -130000, 0);
+   host_timers_run(1000);
+
+   ConfigDataStats before, after;
+   config_data_get_stats(&before);
+   config_data_location_set(48856600, 2352200, 0);
+   host_timers_run(1000);
+   config_data_get_stats(&after);
+   CHECK_EQ(after.usFlashWrites, before.usFlashWrites);
+
+}  /* end of move_held_back */
+
+
+///  Latitude as the worker would read it, from flash.
+static float  flash_latitude(void)
+{
+   config_data_init();
+   return config_data_get_latitude();
+}
+
+
+static void  test_refresh_flushes(void)
+{
+
+   solar_worker_init();
+   host_worker_set_running(true);
+   move_held_back();
+
+   time_t now = time(NULL);
+   solar_worker_refresh(aZeniths, NUM_BANDS, localtime(&now));
+   CHECK_EQ(host_worker_last_message(NULL), SOLAR_WORKER_MSG_REFRESH);
+   CHECK_NEAR(flash_latitude(), 48.8566, 1e-5);
+
+   solar_worker_deinit();
+
+}  /* end of test_refresh_flushes */
+
+
+static void  test_release_flushes(void)
+{
+
+   solar_worker_init();
+   host_worker_set_running(true);
+
+   solar_worker_hold(true);
+   move_held_back();
+
+   //  (a hold needs nothing in flash.)
+   CHECK_NEAR(flash_latitude(), 51.5, 1e-5);
+   config_data_location_set(48856600, 2352200, 0);
+
+   solar_worker_hold(false);
+   AppWorkerMessage message;
+   CHECK_EQ(host_worker_last_message(&message), SOLAR_WORKER_MSG_HOLD);
+   CHECK_EQ(message.data0, 0);
+   CHECK_NEAR(flash_latitude(), 48.8566, 1e-5);
+
+   solar_worker_deinit();
+
+}  /* end of test_release_flushes */
+
+
+static void  test_worker_table_matches(void)
+{
+
+   for (int day = 0; day + 1 < SOLAR_EPHEMERIS_NUM_DAYS; day++)
+   {
+      SolarEphemerisRecord aRecs[2];
+      CHECK(solar_ephemeris_read(day, aRecs));
+      CHECK(memcmp(&aRecs[0], &aWorkerEphemeris[day], sizeof(aRecs[0])) == 0);
+      CHECK(memcmp(&aRecs[1], &aWorkerEphemeris[day + 1], sizeof(aRecs[1])) == 0);
+   }
+
+}  /* end of test_worker_table_matches */
+
+
+int  main(void)
+{
+   RUN_TEST(test_refresh_flushes);
+   RUN_TEST(test_release_flushes);
+   RUN_TEST(test_worker_table_matches);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,170 @@
+/**
+ *  @file
+ *
+ *  suncalc: almanac results against published times, and the batched
+ *  solvers against the one-at-a-time ones.
+ */
+
+#include  "host_test.h"
+
+#include  "suncalc.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+static const float aZeniths[] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                  ZENITH_CIVIL, ZENITH_OFFICIAL };
+#define  NUM_ZENITHS   ((int) (sizeof(aZeniths) / sizeof(aZeniths[0])))
+
+///  One minute, in hours.
+#define  MINUTE   (1.0f / 60)
+
+
+static void  test_day_of_year(void)
+{
+   CHECK_EQ(calcDayOfYear(2016, 1, 1), 1);
+   CHECK_EQ(calcDayOfYear(2016, 3, 1), 61);      // leap year
+   CHECK_EQ(calcDayOfYear(2015, 3, 1), 60);
+   CHECK_EQ(calcDayOfYear(2016, 12, 31), 366);
+   CHECK_EQ(calcDayOfYear(2017, 12, 31), 365);
+}
+
+
+///  Published (NOAA) rise and set times, in UTC hours.
+static void  test_known_times(void)
+{
+
+   //  London, 2016-06-21: 03:43 and 20:21.
+   CHECK_NEAR(calcSunRise(2016, 6, 21, 51.5074f, -0.1278f, ZENITH_OFFICIAL), 3 + 43 * MINUTE, 2 * MINUTE);
+   CHECK_NEAR(calcSunSet(2016, 6, 21, 51.5074f, -0.1278f, ZENITH_OFFICIAL), 20 + 21 * MINUTE, 2 * MINUTE);
+
+   //  London, 2016-12-21: 08:04 and 15:53.
+   CHECK_NEAR(calcSunRise(2016, 12, 21, 51.5074f, -0.1278f, ZENITH_OFFICIAL), 8 + 4 * MINUTE, 2 * MINUTE);
+   CHECK_NEAR(calcSunSet(2016, 12, 21, 51.5074f, -0.1278f, ZENITH_OFFICIAL), 15 + 53 * MINUTE, 2 * MINUTE);
+
+   //  Sydney, 2016-01-01: 18:47 (Dec 31) and 09:09 UTC.
+   CHECK_NEAR(calcSunRise(2016, 1, 1, -33.8688f, 151.2093f, ZENITH_OFFICIAL), 18 + 47 * MINUTE, 2 * MINUTE);
+   CHECK_NEAR(calcSunSet(2016, 1, 1, -33.8688f, 151.2093f, ZENITH_OFFICIAL), 9 + 9 * MINUTE, 2 * MINUTE);
+
+   //  Null Island at the March equinox: a little over 12 hours of day.
+   float rise = calcSunRise(2016, 3, 20, 0, 0, ZENITH_OFFICIAL);
+   float set  = calcSunSet(2016, 3, 20, 0, 0, ZENITH_OFFICIAL);
+   CHECK_NEAR(rise, 6 + 4 * MINUTE, 2 * MINUTE);
+   CHECK_NEAR(set - rise, 12 + 7 * MINUTE, 2 * MINUTE);
+
+}  /* end of test_known_times */
+
+
+static void  test_polar(void)
+{
+
+   //  Longyearbyen: polar night in December, midnight sun in June.
+   CHECK(calcSunRise(2016, 12, 21, 78.22f, 15.65f, ZENITH_OFFICIAL) == NO_RISE_SET_TIME);
+   CHECK(calcSunSet(2016, 6, 21, 78.22f, 15.65f, ZENITH_OFFICIAL) == NO_RISE_SET_TIME);
+
+   //  London in June: no astronomical night, but nautical twilight ends.
+   float aRise[NUM_ZENITHS], aSet[NUM_ZENITHS];
+   calcSunRiseSetMulti(2016, 6, 21, 51.5f, -0.13f, aZeniths, NUM_ZENITHS, aRise, aSet);
+   CHECK(aRise[0] == NO_RISE_SET_TIME);
+   CHECK(aSet[0] == NO_RISE_SET_TIME);
+   CHECK(aRise[1] != NO_RISE_SET_TIME);
+   CHECK(aSet[1] != NO_RISE_SET_TIME);
+
+}  /* end of test_polar */
+
+
+static void  test_multi_matches_single(void)
+{
+
+   static const float aSites[][2] = { { 0, 0 }, { 51.5f, -0.13f }, { -33.87f, 151.21f },
+                                      { 64.84f, -147.72f }, { 37.77f, -122.42f } };
+
+   for (unsigned site = 0; site < sizeof(aSites) / sizeof(aSites[0]); site++)
+   {
+      for (int month = 1; month <= 12; month++)
+      {
+         float aRise[NUM_ZENITHS], aSet[NUM_ZENITHS];
+         calcSunRiseSetMulti(2016, month, 15, aSites[site][0], aSites[site][1],
+                             aZeniths, NUM_ZENITHS, aRise, aSet);
+
+         for (int z = 0; z < NUM_ZENITHS; z++)
+         {
+            float rise = calcSunRise(2016, month, 15, aSites[site][0], aSites[site][1], aZeniths[z]);
+            float set  = calcSunSet(2016, month, 15, aSites[site][0], aSites[site][1], aZeniths[z]);
+            CHECK_NEAR(aRise[z], rise, 0.1f * MINUTE);
+            CHECK_NEAR(aSet[z], set, 0.1f * MINUTE);
+         }
+      }
+   }
+
+}  /* end of test_multi_matches_single */
+
+
+static void  test_days_matches_multi(void)
+{
+
+   //  A run across the end of a leap year.
+   #define  RUN_DAYS   40
+   float aRise[RUN_DAYS * NUM_ZENITHS], aSet[RUN_DAYS * NUM_ZENITHS];
+   CHECK(calcSunRiseSetDays(2016, calcDayOfYear(2016, 12, 1), RUN_DAYS, 51.5f, -0.13f,
+                            aZeniths, NUM_ZENITHS, aRise, aSet));
+
+   for (int day = 0; day < RUN_DAYS; day++)
+   {
+      //  Dec 1 + day, as the almanac takes it.
+      int year = (day < 31) ? 2016 : 2017;
+      int month = (day < 31) ? 12 : 1;
+      int dayOfMonth = (day < 31) ? 1 + day : day - 30;
+
+      float aDayRise[NUM_ZENITHS], aDaySet[NUM_ZENITHS];
+      calcSunRiseSetMulti(year, month, dayOfMonth, 51.5f, -0.13f, aZeniths, NUM_ZENITHS,
+                          aDayRise, aDaySet);
+
+      for (int z = 0; z < NUM_ZENITHS; z++)
+      {
+         CHECK_NEAR(aRise[(day * NUM_ZENITHS) + z], aDayRise[z], 0.1f * MINUTE);
+         CHECK_NEAR(aSet[(day * NUM_ZENITHS) + z], aDaySet[z], 0.1f * MINUTE);
+      }
+   }
+
+}  /* end of test_days_matches_multi */
+
+
+static void  test_days_too_many_zeniths(void)
+{
+
+   //  One more zenith than it takes: an error, and nothing written.
+   const float aMore[SUNCALC_MAX_MULTI + 1] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                                ZENITH_CIVIL, ZENITH_OFFICIAL, 90 };
+   float aRise[SUNCALC_MAX_MULTI + 1], aSet[SUNCALC_MAX_MULTI + 1];
+   for (int i = 0; i <= SUNCALC_MAX_MULTI; i++)
+   {
+      aRise[i] = aSet[i] = -7;
+   }
+
+   CHECK(!calcSunRiseSetDays(2016, 1, 1, 51.5f, -0.13f, aMore, SUNCALC_MAX_MULTI + 1,
+                             aRise, aSet));
+   CHECK(!calcSunRiseSetDays(2016, 1, 1, 51.5f, -0.13f, aMore, 0, aRise, aSet));
+   for (int i = 0; i <= SUNCALC_MAX_MULTI; i++)
+   {
+      CHECK(aRise[i] == -7);
+      CHECK(aSet[i] == -7);
+   }
+
+   CHECK(calcSunRiseSetDays(2016, 1, 1, 51.5f, -0.13f, aMore, SUNCALC_MAX_MULTI,
+                            aRise, aSet));
+
+}  /* end of test_days_too_many_zeniths */
+
+
+int  main(void)
+{
+   RUN_TEST(test_day_of_year);
+   RUN_TEST(test_known_times);
+   RUN_TEST(test_polar);
+   RUN_TEST(test_multi_matches_single);
+   RUN_TEST(test_days_matches_multi);
+   RUN_TEST(test_days_too_many_zeniths);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,233 @@
+/**
+ *  @file
+ *
+ *  The fixed-point engine (suncalc_fixed.c) and the float one (suncalc.c)
+ *  against the same almanac algorithm worked in double precision, every
+ *  day of a year at eight sites; and degrees rounded to the nearest
+ *  fixed-point angle.
+ *
+ *  Here sin_lookup() and friends are libm rather than the watch's tables,
+ *  so the fixed-point engine's rounding to trig units is tested but not the
+ *  tables' own.
+ */
+
+#include  <math.h>
+
+#include  "host_test.h"
+
+#include  "suncalc.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+///  Most either engine may be from the double-precision answer, in minutes.
+#define  MAX_MINUTES_OFF       1.2
+
+/**
+ *  Within this of cos(H) = +/-1, the edge of polar day or night, time is
+ *  so sensitive to cos(H) that a rounding of it moves an event minutes, and
+ *  the engines may even disagree on whether there is one.  There they are
+ *  held to MAX_EDGE_MINUTES_OFF instead.
+ */
+#define  POLAR_EDGE            0.01
+#define  MAX_EDGE_MINUTES_OFF  5.0
+
+
+typedef struct
+{
+   const char *pName;
+   double      latitude;
+   double      longitude;
+} Site;
+
+static const Site aSites[] =
+{
+   { "London",        51.4769,   -0.0005 },
+   { "Quito",         -0.1807,  -78.4678 },
+   { "Sydney",       -33.8688,  151.2093 },
+   { "New York",      40.7128,  -74.0060 },
+   { "Reykjavik",     64.1466,  -21.9426 },
+   { "Singapore",      1.3521,  103.8198 },
+   { "Cape Town",    -33.9249,   18.4241 },
+   { "Anchorage",     61.2181, -149.9003 },
+};
+#define  NUM_SITES   ((int) (sizeof(aSites) / sizeof(aSites[0])))
+
+static const float aZeniths[] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                  ZENITH_CIVIL, ZENITH_OFFICIAL };
+#define  NUM_ZENITHS   ((int) (sizeof(aZeniths) / sizeof(aZeniths[0])))
+
+
+#define  RAD   (M_PI / 180)
+
+/**
+ *  The almanac algorithm as suncalc.c's calcSun() has it, in double.
+ *
+ *  @param pCosH Receives cos of the hour angle: no event if beyond +/-1.
+ *
+ *  @return UTC hours, or NO_RISE_SET_TIME.
+ */
+static double  reference_time(int N, double latitude, double longitude,
+                              bool fSet, double zenith, double *pCosH)
+{
+
+   double lngHour = longitude / 15;
+   double t = N + (((fSet ? 18 : 6) - lngHour) / 24);
+
+   double M = (0.9856 * t) - 3.289;
+   double L = fmod(M + (1.916 * sin(M * RAD)) + (0.020 * sin(2 * M * RAD)) + 282.634 + 720, 360);
+
+   double RA = fmod((atan(0.91764 * tan(L * RAD)) / RAD) + 360, 360);
+   RA += (floor(L / 90) * 90) - (floor(RA / 90) * 90);
+   RA /= 15;
+
+   double sinDec = 0.39782 * sin(L * RAD);
+   double cosDec = cos(asin(sinDec));
+
+   double cosH = (cos(zenith * RAD) - (sinDec * sin(latitude * RAD))) /
+                 (cosDec * cos(latitude * RAD));
+   *pCosH = cosH;
+   if ((cosH > 1) || (cosH < -1))
+   {
+      return NO_RISE_SET_TIME;
+   }
+
+   double H = (fSet ? (acos(cosH) / RAD) : (360 - (acos(cosH) / RAD))) / 15;
+   double T = H + RA - (0.06571 * t) - 6.622;
+
+   return fmod(T - lngHour + 48, 24);
+
+}  /* end of reference_time */
+
+
+///  Minutes between two times of day, the short way round midnight.
+static double  minutes_apart(double hoursA, double hoursB)
+{
+   double diff = fabs(hoursA - hoursB);
+   if (diff > 12)
+   {
+      diff = 24 - diff;
+   }
+   return diff * 60;
+}
+
+
+typedef struct
+{
+   double worst;
+   double worstAtEdge;
+   int    compared;
+   int    mismatches;
+} Tally;
+
+///  Score one engine's time against the reference's.
+static void  tally(Tally *pTally, double reference, double cosH, bool fNone, double hours)
+{
+   if ((reference == NO_RISE_SET_TIME) || fNone)
+   {
+      if ((reference == NO_RISE_SET_TIME) != fNone)
+      {
+         pTally->mismatches += (fabs(fabs(cosH) - 1) > POLAR_EDGE);
+      }
+      return;
+   }
+
+   double diff = minutes_apart(reference, hours);
+   double *pWorst = (fabs(cosH) > 1 - POLAR_EDGE) ? &pTally->worstAtEdge : &pTally->worst;
+   if (diff > *pWorst)
+   {
+      *pWorst = diff;
+   }
+   pTally->compared++;
+}
+
+
+static void  test_eight_sites(void)
+{
+
+   int32_t aZenithsFixed[NUM_ZENITHS];
+   for (int i = 0; i < NUM_ZENITHS; i++)
+   {
+      aZenithsFixed[i] = SUNCALC_DEGREES_TO_FIXED(aZeniths[i]);
+   }
+
+   for (int s = 0; s < NUM_SITES; s++)
+   {
+      const Site *pSite = &aSites[s];
+      Tally floatTally = { 0 };
+      Tally fixedTally = { 0 };
+
+      //  As suncalc_fixed_compare() does: Jan 1 + (day - 1) of a leap year.
+      for (int day = 1; day <= 366; day++)
+      {
+         float aRise[NUM_ZENITHS], aSet[NUM_ZENITHS];
+         calcSunRiseSetMultiFloat(2016, 1, day, pSite->latitude, pSite->longitude,
+                                  aZeniths, NUM_ZENITHS, aRise, aSet);
+
+         int32_t aRiseFixed[NUM_ZENITHS], aSetFixed[NUM_ZENITHS];
+         calcSunRiseSetMultiFixed(day, SUNCALC_DEGREES_TO_FIXED(pSite->latitude),
+                                  SUNCALC_DEGREES_TO_FIXED(pSite->longitude),
+                                  aZenithsFixed, NUM_ZENITHS, aRiseFixed, aSetFixed);
+
+         for (int i = 0; i < NUM_ZENITHS; i++)
+         {
+            for (int j = 0; j < 2; j++)
+            {
+               bool fSet = (j == 1);
+               double cosH;
+               double reference = reference_time(day, pSite->latitude, pSite->longitude,
+                                                 fSet, aZeniths[i], &cosH);
+
+               float fFloat = fSet ? aSet[i] : aRise[i];
+               tally(&floatTally, reference, cosH, fFloat == NO_RISE_SET_TIME, fFloat);
+
+               int32_t fixed = fSet ? aSetFixed[i] : aRiseFixed[i];
+               tally(&fixedTally, reference, cosH, fixed == SUNCALC_FIXED_NO_RISE_SET,
+                     SUNCALC_FIXED_TO_HOURS(fixed));
+            }
+         }
+      }
+
+      printf("%-10s float worst %.2f min (%.2f at polar edge), fixed %.2f min (%.2f), %d times\n",
+             pSite->pName, floatTally.worst, floatTally.worstAtEdge,
+             fixedTally.worst, fixedTally.worstAtEdge, floatTally.compared);
+
+      CHECK(floatTally.compared > 0);
+      CHECK(floatTally.worst <= MAX_MINUTES_OFF);
+      CHECK(fixedTally.worst <= MAX_MINUTES_OFF);
+      CHECK(floatTally.worstAtEdge <= MAX_EDGE_MINUTES_OFF);
+      CHECK(fixedTally.worstAtEdge <= MAX_EDGE_MINUTES_OFF);
+      CHECK_EQ(floatTally.mismatches, 0);
+      CHECK_EQ(fixedTally.mismatches, 0);
+   }
+
+}  /* end of test_eight_sites */
+
+
+static void  test_degrees_to_fixed(void)
+{
+
+   //  Nearest, not toward zero, on both sides of it.
+   CHECK_EQ(SUNCALC_DEGREES_TO_FIXED(0.01f), 2);
+   CHECK_EQ(SUNCALC_DEGREES_TO_FIXED(-0.01f), -2);
+   CHECK_EQ(SUNCALC_DEGREES_TO_FIXED(ZENITH_OFFICIAL), 16536);
+   CHECK_EQ(SUNCALC_DEGREES_TO_FIXED(-180.0f), -SUNCALC_FIXED_CIRCLE / 2);
+
+   //  Across the whole range of scaled latitude and longitude.
+   for (int32_t scaled = -180 * SUNCALC_FIXED_DEGREE_SCALE;
+        scaled <= 180 * SUNCALC_FIXED_DEGREE_SCALE; scaled += 997)
+   {
+      double exact = (double) scaled * SUNCALC_FIXED_CIRCLE / (360.0 * SUNCALC_FIXED_DEGREE_SCALE);
+      CHECK_EQ(SUNCALC_SCALED_DEGREES_TO_FIXED(scaled), lround(exact));
+   }
+
+}  /* end of test_degrees_to_fixed */
+
+
+int  main(void)
+{
+   RUN_TEST(test_degrees_to_fixed);
+   RUN_TEST(test_eight_sites);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,249 @@
+/**
+ *  @file
+ *
+ *  TwilightPath: times of day go to the same places on the dial as the
+ *  float mapping they replaced, and the single pass straight to the
+ *  framebuffer draws the same dial as rendering one band at a time, and
+ *  says so when it can't run, so that sunclock.c falls back to the slow way.
+ */
+
+#include  "host_test.h"
+
+#include  "my_math.h"
+#include  "suncalc.h"
+#include  "TwilightPath.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+#define  NUM_BANDS   4
+
+///  The dial's bands, as sunclock.c sets them up.
+static TwilightPath *apPaths[NUM_BANDS];
+static const GColor aColors[NUM_BANDS] = { GColorBlack, GColorWhite, GColorWhite, GColorWhite };
+
+///  A winter's day at London: every band present, in local minutes.
+static const int16_t aDawn[NUM_BANDS] = { 356, 397, 440, 483 };
+static const int16_t aDusk[NUM_BANDS] = { 1164, 1123, 1080, 1037 };
+
+
+static void  create_paths(void)
+{
+   apPaths[0] = twilight_path_create(ZENITH_ASTRONOMICAL, ENCLOSE_SCREEN_BOTTOM,
+                                     TWILIGHT_SHADE_NONE);
+   apPaths[1] = twilight_path_create(ZENITH_NAUTICAL, ENCLOSE_SCREEN_TOP,
+                                     TWILIGHT_SHADE_DARK_GREY);
+   apPaths[2] = twilight_path_create(ZENITH_CIVIL, ENCLOSE_SCREEN_TOP,
+                                     TWILIGHT_SHADE_GREY);
+   apPaths[3] = twilight_path_create(ZENITH_OFFICIAL, ENCLOSE_SCREEN_TOP,
+                                     TWILIGHT_SHADE_LIGHT_GREY);
+
+   for (int i = 0; i < NUM_BANDS; i++)
+   {
+      twilight_path_set_minutes(apPaths[i], aDawn[i], aDusk[i]);
+   }
+}
+
+static void  destroy_paths(void)
+{
+   for (int i = 0; i < NUM_BANDS; i++)
+   {
+      twilight_path_destroy(apPaths[i]);
+   }
+}
+
+
+///  The hour hand's angle as it was worked out in float, before whole
+///  minutes and twilight_path_dial_angle().
+static int32_t  float_hand_angle(int hours, int minutes)
+{
+   float fraction = (12.0f + hours + (minutes / 60.0f)) / 24.0f;
+   return ((int32_t) (TRIG_MAX_ANGLE * fraction)) & (TRIG_MAX_ANGLE - 1);
+}
+
+
+///  A band endpoint as it was worked out in float, from a local time.
+static GPoint  float_edge_point(float time)
+{
+   float fSin, fCos;
+   my_sincos((time + 12.0f) / 24 * M_PI * 2, &fSin, &fCos);
+   return GPoint((int16_t) (fSin * 120), 9 - (int16_t) (fCos * 120));
+}
+
+
+static void  test_hand_angle_matches_float(void)
+{
+
+   int differing = 0;
+   for (int minute = 0; minute < TWILIGHT_MINUTES_PER_DAY; minute++)
+   {
+      int32_t angle = twilight_path_dial_angle(minute);
+      int32_t floatAngle = float_hand_angle(minute / 60, minute % 60);
+      if (angle != floatAngle)
+      {
+         if (differing++ < 4)
+         {
+            printf("minute %d: %d vs float %d\n", minute, (int) angle, (int) floatAngle);
+         }
+      }
+   }
+   CHECK_EQ(differing, 0);
+
+}  /* end of test_hand_angle_matches_float */
+
+
+static void  test_edges_match_float(void)
+{
+
+   TwilightPath *pPath = twilight_path_create(ZENITH_OFFICIAL, ENCLOSE_SCREEN_TOP,
+                                              TWILIGHT_SHADE_NONE);
+   int worst = 0;
+
+   //  Dawn at every minute, with dusk opposite: both endpoints each time.
+   for (int minute = 0; minute < TWILIGHT_MINUTES_PER_DAY; minute++)
+   {
+      int16_t dusk = (minute + (TWILIGHT_MINUTES_PER_DAY / 2)) % TWILIGHT_MINUTES_PER_DAY;
+      twilight_path_set_minutes(pPath, minute, dusk);
+
+      GPoint aPoints[2] = { pPath->aPathPoints[1], pPath->aPathPoints[4] };
+      GPoint aFloat[2] = { float_edge_point(minute / 60.0f), float_edge_point(dusk / 60.0f) };
+      for (int i = 0; i < 2; i++)
+      {
+         int dx = abs(aPoints[i].x - aFloat[i].x);
+         int dy = abs(aPoints[i].y - aFloat[i].y);
+         worst = (dx > worst) ? dx : worst;
+         worst = (dy > worst) ? dy : worst;
+      }
+   }
+
+   printf("band endpoints: worst %d px from float\n", worst);
+   CHECK(worst <= 1);
+
+   twilight_path_destroy(pPath);
+
+}  /* end of test_edges_match_float */
+
+
+///  A screen of the given size, all white, as the dial layer starts.
+static GContext*  white_screen(GSize size)
+{
+   GContext *ctx = host_gcontext_create(size);
+   graphics_context_set_fill_color(ctx, GColorWhite);
+   graphics_fill_rect(ctx, GRect(0, 0, size.w, size.h), 0, GCornerNone);
+   return ctx;
+}
+
+
+///  The slow way, as sunclock.c falls back to.
+static void  render_one_at_a_time(GContext *ctx, GRect frame)
+{
+   for (int i = 0; i < NUM_BANDS; i++)
+   {
+      twilight_path_render(apPaths[i], ctx, aColors[i], frame);
+   }
+}
+
+
+///  Pixels that differ between two screens of the same size.
+static int  pixels_differing(GContext *ctxA, GContext *ctxB, GSize size)
+{
+   int differing = 0;
+   for (int y = 0; y < size.h; y++)
+   {
+      for (int x = 0; x < size.w; x++)
+      {
+         differing += (host_gbitmap_get_pixel(host_gcontext_get_frame_buffer(ctxA), x, y) !=
+                       host_gbitmap_get_pixel(host_gcontext_get_frame_buffer(ctxB), x, y));
+      }
+   }
+   return differing;
+}
+
+
+static void  test_multi_matches_one_at_a_time(void)
+{
+
+   create_paths();
+   GSize size = GSize(144, 168);
+   GRect frame = GRect(0, 0, 144, 168);
+
+   GContext *ctxMulti = white_screen(size);
+   CHECK(twilight_path_render_multi(apPaths, aColors, NUM_BANDS, ctxMulti, frame));
+   CHECK_EQ(host_gcontext_path_fills(ctxMulti), 0);
+
+   GContext *ctxSlow = white_screen(size);
+   render_one_at_a_time(ctxSlow, frame);
+   CHECK_EQ(host_gcontext_path_fills(ctxSlow), NUM_BANDS);
+
+   //  The two fill polygons by different rules only along band edges.
+   CHECK(pixels_differing(ctxMulti, ctxSlow, size) < (size.w * size.h) / 100);
+
+   host_gcontext_destroy(ctxMulti);
+   host_gcontext_destroy(ctxSlow);
+   destroy_paths();
+
+}  /* end of test_multi_matches_one_at_a_time */
+
+
+static void  test_no_framebuffer(void)
+{
+
+   create_paths();
+   GSize size = GSize(144, 168);
+   GRect frame = GRect(0, 0, 144, 168);
+
+   //  The framebuffer is already taken: nothing drawn, and false back.
+   GContext *ctx = white_screen(size);
+   host_gcontext_refuse_capture(ctx, true);
+   GContext *ctxBlank = white_screen(size);
+   CHECK(!twilight_path_render_multi(apPaths, aColors, NUM_BANDS, ctx, frame));
+   CHECK_EQ(pixels_differing(ctx, ctxBlank, size), 0);
+
+   //  So the fallback draws the dial.
+   render_one_at_a_time(ctx, frame);
+   CHECK_EQ(host_gcontext_path_fills(ctx), NUM_BANDS);
+   CHECK(pixels_differing(ctx, ctxBlank, size) > 0);
+
+   host_gcontext_destroy(ctx);
+   host_gcontext_destroy(ctxBlank);
+   destroy_paths();
+
+}  /* end of test_no_framebuffer */
+
+
+static void  test_wide_rows(void)
+{
+
+   create_paths();
+
+   //  Rows of more words than the single pass buffers.
+   GSize size = GSize(300, 168);
+   GRect frame = GRect(0, 0, 300, 168);
+
+   GContext *ctx = white_screen(size);
+   GContext *ctxBlank = white_screen(size);
+   CHECK(!twilight_path_render_multi(apPaths, aColors, NUM_BANDS, ctx, frame));
+   CHECK_EQ(pixels_differing(ctx, ctxBlank, size), 0);
+
+   //  The framebuffer was given back: it can be captured again.
+   GBitmap *pFrameBuf = graphics_capture_frame_buffer(ctx);
+   CHECK(pFrameBuf != NULL);
+   graphics_release_frame_buffer(ctx, pFrameBuf);
+
+   host_gcontext_destroy(ctx);
+   host_gcontext_destroy(ctxBlank);
+   destroy_paths();
+
+}  /* end of test_wide_rows */
+
+
+int  main(void)
+{
+   RUN_TEST(test_hand_angle_matches_float);
+   RUN_TEST(test_edges_match_float);
+   RUN_TEST(test_multi_matches_one_at_a_time);
+   RUN_TEST(test_no_framebuffer);
+   RUN_TEST(test_wide_rows);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,292 @@
+/**
+ *  @file
+ *
+ *  TwilightSchedule: the delta-encoded days in flash decode to the same
+ *  minutes as working them out live, and the schedule is only used where
+ *  and when it was built for.
+ */
+
+#include  "host_test.h"
+
+#include  "ConfigData.h"
+#include  "PersistBudget.h"
+#include  "suncalc.h"
+#include  "TwilightPath.h"
+#include  "TwilightSchedule.h"
+
+HOST_TEST_MAIN_DECLS;
+
+
+static const float aZeniths[] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                  ZENITH_CIVIL, ZENITH_OFFICIAL };
+#define  NUM_BANDS   ((int) (sizeof(aZeniths) / sizeof(aZeniths[0])))
+
+///  2016-12-01 00:00 UTC: the schedule runs across a new year.
+#define  FIRST_DAY   1480550400
+
+
+///  Fresh ConfigData and schedule, at the given place.
+static void  set_location(float latitude, float longitude, int32_t utcOffset)
+{
+   config_data_init();
+   config_data_location_set((int32_t) (latitude * CONFIG_DATA_DEGREE_SCALE),
+                            (int32_t) (longitude * CONFIG_DATA_DEGREE_SCALE), utcOffset);
+   twilight_schedule_reload();
+}
+
+
+///  Local date of the given day after FIRST_DAY (local time is UTC here).
+static struct tm  day_tm(int day)
+{
+   time_t when = FIRST_DAY + (day * SECONDS_PER_DAY);
+   struct tm tmDay;
+   gmtime_r(&when, &tmDay);
+   return tmDay;
+}
+
+
+static void  build_schedule(void)
+{
+   struct tm tmFirst = day_tm(0);
+   twilight_schedule_refresh(aZeniths, NUM_BANDS, &tmFirst);
+   host_timers_run(60 * 1000);
+   CHECK(twilight_schedule_is_current(NUM_BANDS, &tmFirst));
+}
+
+
+///  Every day of the schedule looks up what working it out live gives.
+static void  check_matches_live(float latitude)
+{
+
+   set_location(latitude, -0.13f, 0);
+   build_schedule();
+
+   TwilightPath *apPaths[NUM_BANDS];
+   for (int i = 0; i < NUM_BANDS; i++)
+   {
+      apPaths[i] = twilight_path_create(aZeniths[i], ENCLOSE_SCREEN_TOP, TWILIGHT_SHADE_NONE);
+   }
+
+   int mismatches = 0;
+   for (int day = 0; day < TWILIGHT_SCHEDULE_DAYS; day++)
+   {
+      struct tm tmDay = day_tm(day);
+      int16_t aDawn[NUM_BANDS], aDusk[NUM_BANDS];
+      bool fFound = twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS);
+      CHECK(fFound);
+
+      twilight_path_compute_current_multi(apPaths, NUM_BANDS, &tmDay);
+      for (int i = 0; fFound && (i < NUM_BANDS); i++)
+      {
+         if ((aDawn[i] != apPaths[i]->dawnMinute) || (aDusk[i] != apPaths[i]->duskMinute))
+         {
+            if (mismatches++ < 4)
+            {
+               printf("lat %g day %d band %d: %d/%d vs live %d/%d\n", latitude, day, i,
+                      aDawn[i], aDusk[i], apPaths[i]->dawnMinute, apPaths[i]->duskMinute);
+            }
+         }
+      }
+   }
+   CHECK_EQ(mismatches, 0);
+
+   //  Not before its first day, nor after its last.
+   struct tm tmBefore = day_tm(-1);
+   struct tm tmAfter = day_tm(TWILIGHT_SCHEDULE_DAYS);
+   int16_t aDawn[NUM_BANDS], aDusk[NUM_BANDS];
+   CHECK(!twilight_schedule_lookup(&tmBefore, aDawn, aDusk, NUM_BANDS));
+   CHECK(!twilight_schedule_lookup(&tmAfter, aDawn, aDusk, NUM_BANDS));
+
+   for (int i = 0; i < NUM_BANDS; i++)
+   {
+      twilight_path_destroy(apPaths[i]);
+   }
+
+}  /* end of check_matches_live */
+
+
+static void  test_equator(void)
+{
+   check_matches_live(0);
+}
+
+static void  test_london(void)
+{
+   check_matches_live(51.5f);
+}
+
+static void  test_arctic(void)
+{
+   //  Bands appear and vanish through the winter: escaped values.
+   check_matches_live(68);
+}
+
+
+static void  test_drift(void)
+{
+
+   set_location(51.5f, -0.13f, 0);
+   build_schedule();
+
+   struct tm tmDay = day_tm(10);
+   int16_t aDawn[NUM_BANDS], aDusk[NUM_BANDS];
+   CHECK(twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS));
+
+   //  0.05 degrees of longitude at 51.5 N is about 3.5 km: still used.
+   config_data_location_set(51500000, -80000, 0);
+   CHECK(twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS));
+
+   //  0.25 degrees is about 17 km: not.
+   config_data_location_set(51500000, 120000, 0);
+   CHECK(!twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS));
+   CHECK(!twilight_schedule_is_current(NUM_BANDS, &tmDay));
+
+   //  Nor with another UTC offset.
+   config_data_location_set(51500000, -130000, -3600);
+   CHECK(!twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS));
+
+   //  Another band count isn't what was built.
+   config_data_location_set(51500000, -130000, 0);
+   CHECK(twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS));
+   CHECK(!twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS - 1));
+
+}  /* end of test_drift */
+
+
+static void  test_survives_reload(void)
+{
+
+   set_location(51.5f, -0.13f, 0);
+   build_schedule();
+
+   struct tm tmDay = day_tm(45);
+   int16_t aDawn[NUM_BANDS], aDusk[NUM_BANDS];
+   CHECK(twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS));
+
+   //  As after a relaunch: read back from flash.
+   twilight_schedule_reload();
+   int16_t aDawn2[NUM_BANDS], aDusk2[NUM_BANDS];
+   CHECK(twilight_schedule_lookup(&tmDay, aDawn2, aDusk2, NUM_BANDS));
+   CHECK(memcmp(aDawn, aDawn2, sizeof(aDawn)) == 0);
+   CHECK(memcmp(aDusk, aDusk2, sizeof(aDusk)) == 0);
+
+}  /* end of test_survives_reload */
+
+
+static void  test_old_version_dropped(void)
+{
+
+   set_location(51.5f, -0.13f, 0);
+   build_schedule();
+
+   //  A header from before the location was kept in micro-degrees.
+   uint8_t aHeader[PERSIST_DATA_MAX_LENGTH];
+   int size = persist_read_data(TWILIGHT_SCHEDULE_KEY_HEADER, aHeader, sizeof(aHeader));
+   CHECK(size > 2);
+   aHeader[0] = 1;
+   aHeader[1] = 0;
+   persist_write_data(TWILIGHT_SCHEDULE_KEY_HEADER, aHeader, size);
+
+   twilight_schedule_reload();
+   struct tm tmDay = day_tm(10);
+   int16_t aDawn[NUM_BANDS], aDusk[NUM_BANDS];
+   CHECK(!twilight_schedule_lookup(&tmDay, aDawn, aDusk, NUM_BANDS));
+
+}  /* end of test_old_version_dropped */
+
+
+static void  test_old_blocks_removed(void)
+{
+
+   //  Every block key full, as an older version that allowed more left them.
+   uint8_t aOld[PERSIST_DATA_MAX_LENGTH];
+   memset(aOld, 0x55, sizeof(aOld));
+   for (int key = PERSIST_KEY_SCHEDULE_FIRST; key <= PERSIST_KEY_SCHEDULE_LAST; key++)
+   {
+      CHECK_EQ(persist_write_data(key, aOld, sizeof(aOld)), sizeof(aOld));
+   }
+
+   set_location(51.5f, -0.13f, 0);
+   build_schedule();
+
+   //  None left past the new schedule's.
+   int blocks = 0;
+   while (persist_exists(PERSIST_KEY_SCHEDULE_FIRST + blocks))
+   {
+      blocks++;
+   }
+   CHECK(blocks <= PERSIST_SCHEDULE_MAX_BLOCKS);
+   for (int key = PERSIST_KEY_SCHEDULE_FIRST + blocks; key <= PERSIST_KEY_SCHEDULE_LAST; key++)
+   {
+      CHECK(!persist_exists(key));
+   }
+
+}  /* end of test_old_blocks_removed */
+
+
+static void  test_stream(void)
+{
+
+   //  Local time is UTC + 1 hour.
+   set_location(51.5f, -0.13f, -3600);
+
+   struct tm tmFirst = day_tm(0);
+   CHECK(twilight_schedule_stream_begin(2, &tmFirst));
+
+   //  Big jumps and gaps, to take the escape path too.
+   static const int16_t aUtcDawn[][2] = { { 300, 400 }, { 301, 402 }, { TWILIGHT_NO_MINUTE, 403 },
+                                          { 302, 404 }, { 1430, 10 } };
+   static const int16_t aUtcDusk[][2] = { { 1000, 900 }, { 999, 899 }, { TWILIGHT_NO_MINUTE, 898 },
+                                          { 998, 897 }, { 20, 1420 } };
+   #define  STREAM_DAYS   ((int) (sizeof(aUtcDawn) / sizeof(aUtcDawn[0])))
+
+   for (int day = 0; day < STREAM_DAYS; day++)
+   {
+      CHECK(twilight_schedule_stream_add_day(aUtcDawn[day], aUtcDusk[day]));
+   }
+   CHECK_EQ(twilight_schedule_stream_days(), STREAM_DAYS);
+   twilight_schedule_stream_end(true);
+   CHECK_EQ(twilight_schedule_stream_days(), -1);
+
+   for (int day = 0; day < STREAM_DAYS; day++)
+   {
+      struct tm tmDay = day_tm(day);
+      int16_t aDawn[2], aDusk[2];
+      CHECK(twilight_schedule_lookup(&tmDay, aDawn, aDusk, 2));
+      for (int i = 0; i < 2; i++)
+      {
+         int16_t dawn = (aUtcDawn[day][i] == TWILIGHT_NO_MINUTE) ?
+                           TWILIGHT_NO_MINUTE : ((aUtcDawn[day][i] + 60) % 1440);
+         int16_t dusk = (aUtcDusk[day][i] == TWILIGHT_NO_MINUTE) ?
+                           TWILIGHT_NO_MINUTE : ((aUtcDusk[day][i] + 60) % 1440);
+         CHECK_EQ(aDawn[i], dawn);
+         CHECK_EQ(aDusk[i], dusk);
+      }
+   }
+
+   struct tm tmAfter = day_tm(STREAM_DAYS);
+   int16_t aDawn[2], aDusk[2];
+   CHECK(!twilight_schedule_lookup(&tmAfter, aDawn, aDusk, 2));
+
+   //  A stream ended without keeping leaves no schedule.
+   CHECK(twilight_schedule_stream_begin(2, &tmFirst));
+   CHECK(twilight_schedule_stream_add_day(aUtcDawn[0], aUtcDusk[0]));
+   twilight_schedule_stream_end(false);
+   CHECK(!twilight_schedule_lookup(&tmFirst, aDawn, aDusk, 2));
+
+}  /* end of test_stream */
+
+
+int  main(void)
+{
+   RUN_TEST(test_equator);
+   RUN_TEST(test_london);
+   RUN_TEST(test_arctic);
+   RUN_TEST(test_drift);
+   RUN_TEST(test_survives_reload);
+   RUN_TEST(test_old_version_dropped);
+   RUN_TEST(test_old_blocks_removed);
+   RUN_TEST(test_stream);
+
+   return HOST_TEST_RESULT();
+}
@@ -0,0 +1,252 @@
+/**
+ *  @file
+ *
+ *  Picks the kernel build the CPU runs, and shares batches out over a pool
+ *  of threads.
+ */
+
+#include  <pthread.h>
+#include  <stdlib.h>
+
+#include  "batch_engine.h"
+
+
+typedef void (*BatchKernel)(const BatchSoA *pBatch, int first, int count);
+
+void  batch_kernel_scalar(const BatchSoA *pBatch, int first, int count);
+#if BATCH_HAVE_X86
+void  batch_kernel_sse2(const BatchSoA *pBatch, int first, int count);
+void  batch_kernel_avx2(const BatchSoA *pBatch, int first, int count);
+#endif
+
+typedef struct
+{
+   const char  *pszName;
+   int          width;
+   BatchKernel  kernel;
+} BatchIsaInfo;
+
+static const BatchIsaInfo aIsas[BATCH_NUM_ISAS] =
+{
+   { "scalar", 1, batch_kernel_scalar },
+#if BATCH_HAVE_X86
+   { "sse2",   4, batch_kernel_sse2 },
+   { "avx2",   8, batch_kernel_avx2 },
+#else
+   { "sse2",   4, NULL },
+   { "avx2",   8, NULL },
+#endif
+};
+
+
+bool  batch_isa_available(BatchIsa isa)
+{
+
+   if ((isa < 0) || (isa >= BATCH_NUM_ISAS) || (aIsas[isa].kernel == NULL))
+   {
+      return false;
+   }
+
+#if BATCH_HAVE_X86
+   __builtin_cpu_init();
+   switch (isa)
+   {
+   case BATCH_ISA_SSE2:  return __builtin_cpu_supports("sse2");
+   case BATCH_ISA_AVX2:  return __builtin_cpu_supports("avx2");
+   default:              break;
+   }
+#endif
+
+   return true;
+
+}  /* end of batch_isa_available */
+
+
+BatchIsa  batch_isa_best(void)
+{
+   BatchIsa best = BATCH_ISA_SCALAR;
+   for (int isa = BATCH_ISA_SCALAR; isa < BATCH_NUM_ISAS; isa++)
+   {
+      if (batch_isa_available(isa))
+      {
+         best = isa;
+      }
+   }
+   return best;
+}
+
+
+const char*  batch_isa_name(BatchIsa isa)
+{
+   return ((isa < 0) || (isa >= BATCH_NUM_ISAS)) ? NULL : aIsas[isa].pszName;
+}
+
+
+int  batch_isa_width(BatchIsa isa)
+{
+   return ((isa < 0) || (isa >= BATCH_NUM_ISAS)) ? 0 : aIsas[isa].width;
+}
+
+
+void  batch_solve(const BatchSoA *pBatch, int first, int count, BatchIsa isa)
+{
+   aIsas[isa].kernel(pBatch, first, count);
+}
+
+
+struct BatchPool
+{
+   pthread_mutex_t  mutex;
+
+   ///  Signalled when there is a batch, or the pool is stopping.
+   pthread_cond_t   condWork;
+
+   ///  Signalled when the last thread finishes its part of a batch.
+   pthread_cond_t   condDone;
+
+   int              numThreads;
+   pthread_t       *aThreads;
+
+   ///  The batch being worked on, or NULL.
+   const BatchSoA  *pBatch;
+   BatchKernel      kernel;
+
+   ///  Counts batches, so that a thread takes each one once.
+   uint32_t         generation;
+
+   ///  Next entry not yet taken.
+   int              next;
+
+   ///  Threads still working on the batch.
+   int              busy;
+
+   bool             fStop;
+};
+
+
+///  Next chunk of the batch, or false if there are none left.
+static bool  batch_pool_take(BatchPool *pPool, int *pFirst, int *pCount)
+{
+
+   int first = __atomic_fetch_add(&pPool->next, BATCH_CHUNK, __ATOMIC_RELAXED);
+   if (first >= pPool->pBatch->count)
+   {
+      return false;
+   }
+
+   int count = pPool->pBatch->count - first;
+   *pFirst = first;
+   *pCount = (count > BATCH_CHUNK) ? BATCH_CHUNK : count;
+   return true;
+
+}  /* end of batch_pool_take */
+
+
+static void*  batch_pool_thread(void *pContext)
+{
+
+   BatchPool *pPool = pContext;
+   uint32_t generationDone = 0;
+
+   pthread_mutex_lock(&pPool->mutex);
+   for (;;)
+   {
+      while (!pPool->fStop && (pPool->generation == generationDone))
+      {
+         pthread_cond_wait(&pPool->condWork, &pPool->mutex);
+      }
+      if (pPool->fStop)
+      {
+         break;
+      }
+      generationDone = pPool->generation;
+      pthread_mutex_unlock(&pPool->mutex);
+
+      int first, count;
+      while (batch_pool_take(pPool, &first, &count))
+      {
+         pPool->kernel(pPool->pBatch, first, count);
+      }
+
+      pthread_mutex_lock(&pPool->mutex);
+      if (--pPool->busy == 0)
+      {
+         pthread_cond_signal(&pPool->condDone);
+      }
+   }
+   pthread_mutex_unlock(&pPool->mutex);
+
+   return NULL;
+
+}  /* end of batch_pool_thread */
+
+
+BatchPool*  batch_pool_create(int numThreads)
+{
+
+   BatchPool *pPool = calloc(1, sizeof(BatchPool));
+   pPool->numThreads = (numThreads < 1) ? 1 : numThreads;
+   pPool->aThreads = calloc(pPool->numThreads, sizeof(pthread_t));
+   pthread_mutex_init(&pPool->mutex, NULL);
+   pthread_cond_init(&pPool->condWork, NULL);
+   pthread_cond_init(&pPool->condDone, NULL);
+
+   for (int i = 0; i < pPool->numThreads; i++)
+   {
+      pthread_create(&pPool->aThreads[i], NULL, batch_pool_thread, pPool);
+   }
+
+   return pPool;
+
+}  /* end of batch_pool_create */
+
+
+int  batch_pool_threads(const BatchPool *pPool)
+{
+   return pPool->numThreads;
+}
+
+
+void  batch_pool_solve(BatchPool *pPool, const BatchSoA *pBatch, BatchIsa isa)
+{
+
+   pthread_mutex_lock(&pPool->mutex);
+
+   pPool->pBatch = pBatch;
+   pPool->kernel = aIsas[isa].kernel;
+   pPool->next = 0;
+   pPool->busy = pPool->numThreads;
+   pPool->generation++;
+   pthread_cond_broadcast(&pPool->condWork);
+
+   while (pPool->busy > 0)
+   {
+      pthread_cond_wait(&pPool->condDone, &pPool->mutex);
+   }
+   pPool->pBatch = NULL;
+
+   pthread_mutex_unlock(&pPool->mutex);
+
+}  /* end of batch_pool_solve */
+
+
+void  batch_pool_destroy(BatchPool *pPool)
+{
+
+   pthread_mutex_lock(&pPool->mutex);
+   pPool->fStop = true;
+   pthread_cond_broadcast(&pPool->condWork);
+   pthread_mutex_unlock(&pPool->mutex);
+
+   for (int i = 0; i < pPool->numThreads; i++)
+   {
+      pthread_join(pPool->aThreads[i], NULL);
+   }
+
+   pthread_cond_destroy(&pPool->condWork);
+   pthread_cond_destroy(&pPool->condDone);
+   pthread_mutex_destroy(&pPool->mutex);
+   free(pPool->aThreads);
+   free(pPool);
+
+}  /* end of batch_pool_destroy */
@@ -0,0 +1,98 @@
+/**
+ *  @file
+ *
+ *  Host batch engine: suncalc.c's rise and set times for many (date,
+ *  latitude, longitude, zenith) at once, laid out as a structure of
+ *  arrays so that the kernel can take several in each vector register.
+ *
+ *  The kernel is built for each instruction set the host may have, and
+ *  batch_isa_best() picks the widest the CPU runs.  A BatchPool spreads a
+ *  batch over threads a chunk at a time.
+ *
+ *  Results match calcSunRise() / calcSunSet() built without the ephemeris
+ *  table (TESTING_DISABLE_EPHEMERIS_TABLE) to the bit: the kernel does the
+ *  same float operations, only side by side.
+ */
+
+#pragma once
+
+#include  <stdbool.h>
+#include  <stdint.h>
+
+
+///  A batch: count entries in each array.
+typedef struct
+{
+   int       count;
+
+   ///  Inputs.  Day of year as from calcDayOfYear(), and degrees.
+   int32_t  *aDayOfYear;
+   float    *aLatitude;
+   float    *aLongitude;
+   float    *aZenith;
+
+   ///  Outputs: UTC hours, or NO_RISE_SET_TIME.
+   float    *aRise;
+   float    *aSet;
+
+} BatchSoA;
+
+
+///  Builds of the kernel, narrowest first.
+typedef enum
+{
+   ///  One lane at a time, in the host's plain float code.
+   BATCH_ISA_SCALAR,
+
+   ///  4 lanes in SSE2 registers.
+   BATCH_ISA_SSE2,
+
+   ///  8 lanes in AVX2 registers.
+   BATCH_ISA_AVX2,
+
+   BATCH_NUM_ISAS
+
+} BatchIsa;
+
+
+///  Entries a pool thread takes at a time.
+#define  BATCH_CHUNK   4096
+
+
+///  Is this build of the kernel here, and does this CPU run it?
+bool  batch_isa_available(BatchIsa isa);
+
+///  Widest build available.
+BatchIsa  batch_isa_best(void);
+
+///  "scalar", "sse2" or "avx2"; or NULL.
+const char*  batch_isa_name(BatchIsa isa);
+
+///  Lanes per step of the build.
+int  batch_isa_width(BatchIsa isa);
+
+/**
+ *  Work out entries first - first + count of the batch, on this thread.
+ *
+ *  @param isa Build to use.  Must be batch_isa_available().
+ */
+void  batch_solve(const BatchSoA *pBatch, int first, int count, BatchIsa isa);
+
+
+///  Threads for batch_pool_solve().
+typedef struct BatchPool BatchPool;
+
+///  Start numThreads threads (at least one), idle until given a batch.
+BatchPool*  batch_pool_create(int numThreads);
+
+///  Threads in the pool.
+int  batch_pool_threads(const BatchPool *pPool);
+
+/**
+ *  Work out the whole batch, BATCH_CHUNK entries at a time on whichever
+ *  thread is free, and return when all are done.
+ */
+void  batch_pool_solve(BatchPool *pPool, const BatchSoA *pBatch, BatchIsa isa);
+
+///  Stop the threads and free the pool.
+void  batch_pool_destroy(BatchPool *pPool);
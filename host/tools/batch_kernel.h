@@ -0,0 +1,255 @@
+/**
+ *  @file
+ *
+ *  The batch engine's kernel: suncalc.c's computed path (calcSunPosition()
+ *  without the ephemeris table, then calcSunEventTime()) and the my_math.c
+ *  functions it calls, written once over BATCH_WIDTH lanes with GCC's
+ *  vector extensions.
+ *
+ *  Each batch_kernel_*.c defines BATCH_WIDTH and BATCH_KERNEL, and
+ *  includes this.  CMakeLists.txt builds each for its own instruction set,
+ *  and without contracting multiplies and adds into FMAs, so that every
+ *  lane does the same float operations in the same order as the watch's
+ *  code, and gets the same answer to the bit.
+ */
+
+#include  <string.h>
+
+#include  "batch_engine.h"
+#include  "my_math.h"
+#include  "suncalc.h"
+
+
+typedef float   VFloat __attribute__((vector_size(BATCH_WIDTH * sizeof(float))));
+typedef int32_t VInt   __attribute__((vector_size(BATCH_WIDTH * sizeof(int32_t))));
+
+
+///  Lanes of a where mask is set, else of b.
+static inline VFloat  vsel(VInt mask, VFloat a, VFloat b)
+{
+   return (VFloat) ((mask & (VInt) a) | (~mask & (VInt) b));
+}
+
+static inline VFloat  vfloor(VFloat x)
+{
+   //  (my_floor(): truncates, as the cast does.)
+   return __builtin_convertvector(__builtin_convertvector(x, VInt), VFloat);
+}
+
+static inline VFloat  vfabs(VFloat x)
+{
+   return vsel(x < 0, -x, x);
+}
+
+static inline VFloat  vrint(VFloat x)
+{
+   VFloat t = vfloor(vfabs(x) + 0.5f);
+   return vsel(x < 0.0f, -t, t);
+}
+
+static inline VFloat  vsqrt(VFloat x)
+{
+   const VFloat xhalf = 0.5f * x;
+   VFloat y = (VFloat) (0x5f3759df - ((VInt) x >> 1));
+   return x * y * (1.5f - xhalf * y * y);
+}
+
+static inline VFloat  vatan(VFloat x)
+{
+   //  (my_atan() recurses for x < 0: atan(-x) = -atan(x).)
+   VFloat xa = vfabs(x);
+   VFloat r = (M_PI / 2) * (0.596227f * xa + xa * xa) / (1 + 2 * 0.596227f * xa + xa * xa);
+   return vsel(x >= 0, r, -r);
+}
+
+static inline VFloat  vcos_core(VFloat x)
+{
+   VFloat x8, x4, x2;
+   x2 = x * x;
+   x4 = x2 * x2;
+   x8 = x4 * x4;
+   return (-2.7236370439787708e-7f * x2 + 2.4799852696610628e-5f) * x8 +
+          (-1.3888885054799695e-3f * x2 + 4.1666666636943683e-2f) * x4 +
+          (-4.9999999999963024e-1f * x2 + 1.0000000000000000e+0f);
+}
+
+static inline VFloat  vsin_core(VFloat x)
+{
+   VFloat x4, x2;
+   x2 = x * x;
+   x4 = x2 * x2;
+   return ((2.7181216275479732e-6f * x2 - 1.9839312269456257e-4f) * x4 +
+           (8.3333293048425631e-3f * x2 - 1.6666666640797048e-1f)) * x2 * x + x;
+}
+
+static inline VFloat  vasin_core(VFloat x)
+{
+   VFloat x8, x4, x2;
+   x2 = x * x;
+   x4 = x2 * x2;
+   x8 = x4 * x4;
+   return (((4.5334220547132049e-2f * x2 - 1.1226216762576600e-2f) * x4 +
+            (2.6334281471361822e-2f * x2 + 2.0596336163223834e-2f)) * x8 +
+           (3.0582043602875735e-2f * x2 + 4.4630538556294605e-2f) * x4 +
+           (7.5000364034134126e-2f * x2 + 1.6666666300567365e-1f)) * x2 * x + x;
+}
+
+///  my_sincos(), whose cosine is also my_cos()'s.
+static inline void  vsincos(VFloat x, VFloat *pSin, VFloat *pCos)
+{
+
+   VFloat q = vrint(x * 6.3661977236758138e-1f);
+   VInt quadrant = __builtin_convertvector(q, VInt);
+   VFloat t = x - q * 1.5707963705062866e+00f;
+   t = t - q * -4.3711388286737929e-08f;
+
+   VFloat s = vsin_core(t);
+   VFloat c = vcos_core(t);
+
+   VInt odd = (quadrant & 1) != 0;
+   VFloat s1 = vsel(odd, c, s);
+   VFloat c1 = vsel(odd, -s, c);
+
+   VInt neg = (quadrant & 2) != 0;
+   *pSin = vsel(neg, -s1, s1);
+   *pCos = vsel(neg, -c1, c1);
+
+}  /* end of vsincos */
+
+static inline VFloat  vacos(VFloat x)
+{
+   VFloat xa = vfabs(x);
+   VFloat tFar = 2.0f * vasin_core(vsqrt(0.5f * (1.0f - xa)));
+   VFloat tNear = 1.5707963267948966f - vasin_core(xa);
+   VFloat t = vsel(xa > 0.5625f, tFar, tNear);
+   return vsel(x < 0.0f, 3.1415926535897932f - t, t);
+}
+
+static inline VFloat  vasin(VFloat x)
+{
+   return (M_PI / 2) - vacos(x);
+}
+
+
+/**
+ *  One rise or set for each lane: calcSun() by the computed path.
+ *
+ *  @param N Day of year.
+ *  @param sunset 6 for rise, 18 for set: the hour step 2 starts from.
+ */
+static VFloat  batch_event(VFloat N, VFloat lngHour, VFloat sinLat, VFloat cosLat,
+                           VFloat cosZenith, float startHour, bool fSunset)
+{
+
+   // 2. - 6., as calcSunPosition()
+   VFloat t = N + ((startHour - lngHour) / 24);
+
+   VFloat M = (0.9856f * t) - 3.289f;
+
+   VFloat sinM, cosM;
+   vsincos((M_PI / 180.0f) * M, &sinM, &cosM);
+   VFloat L = M + (1.916f * sinM) + (0.020f * 2 * sinM * cosM) + 282.634f;
+   L = vsel(L < 0, L + 360.0f, L);
+   L = vsel(L > 360, L - 360.0f, L);
+
+   VFloat sinL, cosL;
+   vsincos((M_PI / 180.0f) * L, &sinL, &cosL);
+
+   VFloat RA = (180.0f / M_PI) * vatan(0.91764f * (sinL / cosL));
+   RA = vsel(RA < 0, RA + 360, RA);
+   RA = vsel(RA > 360, RA - 360, RA);
+
+   VFloat Lquadrant  = (vfloor(L / 90)) * 90;
+   VFloat RAquadrant = (vfloor(RA / 90)) * 90;
+   RA = RA + (Lquadrant - RAquadrant);
+   RA = RA / 15;
+
+   VFloat sinDec = 0.39782f * sinL;
+   VFloat unused, cosDec;
+   vsincos(vasin(sinDec), &unused, &cosDec);
+
+   VFloat eqnTime = RA - (0.06571f * t) - 6.622f;
+
+   // 7. - 9., as calcSunEventTime()
+   VFloat cosH = (cosZenith - (sinDec * sinLat)) / (cosDec * cosLat);
+   VInt none = (cosH > 1) | (cosH < -1);
+
+   VFloat H = fSunset ? ((180.0f / M_PI) * vacos(cosH)) :
+                        (360 - (180.0f / M_PI) * vacos(cosH));
+   H = H / 15;
+
+   VFloat T = H + eqnTime;
+
+   VFloat UT = T - lngHour;
+   UT = vsel(UT < 0, UT + 24, UT);
+   UT = vsel(UT > 24, UT - 24, UT);
+
+   return vsel(none, (VFloat) { 0 } + NO_RISE_SET_TIME, UT);
+
+}  /* end of batch_event */
+
+
+///  Lanes first - first + BATCH_WIDTH of the batch, all there.
+static void  batch_lanes(const BatchSoA *pBatch, int first)
+{
+
+   VFloat N, latitude, longitude, zenith;
+   VInt dayOfYear;
+   memcpy(&dayOfYear, &pBatch->aDayOfYear[first], sizeof(dayOfYear));
+   memcpy(&latitude,  &pBatch->aLatitude[first],  sizeof(latitude));
+   memcpy(&longitude, &pBatch->aLongitude[first], sizeof(longitude));
+   memcpy(&zenith,    &pBatch->aZenith[first],    sizeof(zenith));
+   N = __builtin_convertvector(dayOfYear, VFloat);
+
+   VFloat lngHour = longitude / 15;
+
+   VFloat sinLat, cosLat;
+   vsincos((M_PI / 180.0f) * latitude, &sinLat, &cosLat);
+
+   VFloat unused, cosZenith;
+   vsincos((M_PI / 180.0f) * zenith, &unused, &cosZenith);
+
+   VFloat rise = batch_event(N, lngHour, sinLat, cosLat, cosZenith, 6, false);
+   VFloat set = batch_event(N, lngHour, sinLat, cosLat, cosZenith, 18, true);
+
+   memcpy(&pBatch->aRise[first], &rise, sizeof(rise));
+   memcpy(&pBatch->aSet[first],  &set,  sizeof(set));
+
+}  /* end of batch_lanes */
+
+
+void  BATCH_KERNEL(const BatchSoA *pBatch, int first, int count)
+{
+
+   int end = first + count;
+   int i = first;
+   for ( ; i + BATCH_WIDTH <= end; i += BATCH_WIDTH)
+   {
+      batch_lanes(pBatch, i);
+   }
+
+   if (i == end)
+   {
+      return;
+   }
+
+   //  The last few, padded out with copies of the last.
+   int32_t aDayOfYear[BATCH_WIDTH];
+   float aLatitude[BATCH_WIDTH], aLongitude[BATCH_WIDTH], aZenith[BATCH_WIDTH];
+   float aRise[BATCH_WIDTH], aSet[BATCH_WIDTH];
+   for (int lane = 0; lane < BATCH_WIDTH; lane++)
+   {
+      int j = (i + lane < end) ? (i + lane) : (end - 1);
+      aDayOfYear[lane] = pBatch->aDayOfYear[j];
+      aLatitude[lane]  = pBatch->aLatitude[j];
+      aLongitude[lane] = pBatch->aLongitude[j];
+      aZenith[lane]    = pBatch->aZenith[j];
+   }
+
+   BatchSoA tail = { BATCH_WIDTH, aDayOfYear, aLatitude, aLongitude, aZenith, aRise, aSet };
+   batch_lanes(&tail, 0);
+
+   memcpy(&pBatch->aRise[i], aRise, (end - i) * sizeof(float));
+   memcpy(&pBatch->aSet[i],  aSet,  (end - i) * sizeof(float));
+
+}  /* end of BATCH_KERNEL */
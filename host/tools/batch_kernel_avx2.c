@@ -0,0 +1,11 @@
+/**
+ *  @file
+ *
+ *  The batch kernel eight lanes at a time.  Built with -mavx2, and only
+ *  run where batch_isa_available() finds the CPU has it.
+ */
+
+#define  BATCH_WIDTH    8
+#define  BATCH_KERNEL   batch_kernel_avx2
+
+#include  "batch_kernel.h"
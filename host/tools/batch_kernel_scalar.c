@@ -0,0 +1,11 @@
+/**
+ *  @file
+ *
+ *  The batch kernel one lane at a time, for comparison, and for hosts
+ *  without the vector builds.
+ */
+
+#define  BATCH_WIDTH    1
+#define  BATCH_KERNEL   batch_kernel_scalar
+
+#include  "batch_kernel.h"
@@ -0,0 +1,10 @@
+/**
+ *  @file
+ *
+ *  The batch kernel four lanes at a time.  Built with -msse2.
+ */
+
+#define  BATCH_WIDTH    4
+#define  BATCH_KERNEL   batch_kernel_sse2
+
+#include  "batch_kernel.h"
@@ -0,0 +1,603 @@
+/**
+ *  @file
+ *
+ *  Works out a run of days of rise and set times for many sites at once,
+ *  through the batch engine (batch_engine.h), for checking the solar math
+ *  over a whole map or pre-generating schedules.
+ *
+ *      suncalc_batch [-y year] [-s first-day-of-year] [-d days]
+ *                    [-g sites | sites.csv] [-f csv|bin] [-o out]
+ *                    [-j threads] [-i scalar|sse2|avx2] [-S]
+ *
+ *  Sites are "latitude,longitude" lines (blank lines and # comments
+ *  skipped) from the file, or stdin if it is "-".  Or with -g, a grid of
+ *  that many sites over the globe.  Every site gets the four dial zeniths.
+ *
+ *  The engine runs on -j threads (by default one per online CPU), with the
+ *  widest kernel build the CPU runs, or -i's.
+ *
+ *  Output (to stdout, or -o) is CSV with a header line:
+ *
+ *      site,latitude,longitude,year,day_of_year,zenith,rise,set
+ *
+ *  rise and set being UTC hours, empty when there is none that day.  Or
+ *  with -f bin, BatchRecord (below) per line of the CSV, little-endian,
+ *  with NO_RISE_SET_TIME for none.
+ *
+ *  On stderr it reports throughput, and the same days again one event at
+ *  a time through calcSunRise() / calcSunSet() (the scalar path, without
+ *  the ephemeris table, as the engine is), with the worst difference
+ *  between the two.  Exits 1 if any time is out of range or the two differ
+ *  by more than a second.
+ *
+ *  With -S it also times the first block of the run with each kernel build
+ *  on 1, 2, 4 ... -j threads, and reports events/s, the speed-up on the
+ *  scalar path, and the speed-up per thread on that build's one thread.
+ */
+
+#include  <errno.h>
+#include  <math.h>
+#include  <stdlib.h>
+#include  <sys/time.h>
+#include  <unistd.h>
+
+#include  "host.h"
+
+#include  "batch_engine.h"
+#include  "suncalc.h"
+
+
+///  Most days per run.
+#define  BATCH_MAX_DAYS      732
+
+///  Most the scalar path may differ from the batch, in hours.
+#define  BATCH_MAX_DIFF      (1.0 / 3600)
+
+///  Entries (site, day and zenith) worked out and written at a time.
+#define  BATCH_BLOCK_ENTRIES (1 << 18)
+
+///  Least time -S spends on each measurement, in seconds.
+#define  BATCH_SCALING_SECS  0.2
+
+typedef struct
+{
+   uint32_t site;
+   uint16_t year;
+   uint16_t dayOfYear;
+   float    zenith;
+   float    rise;
+   float    set;
+} __attribute__((__packed__))  BatchRecord;
+
+typedef struct
+{
+   float latitude;
+   float longitude;
+} BatchSite;
+
+///  One day of the run.
+typedef struct
+{
+   int year;
+   int dayOfYear;
+   int month;
+   int day;
+} BatchDay;
+
+static const float aZeniths[] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                  ZENITH_CIVIL, ZENITH_OFFICIAL };
+#define  NUM_ZENITHS   ((int) (sizeof(aZeniths) / sizeof(aZeniths[0])))
+
+
+static double  now_seconds(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + (tv.tv_usec / 1e6);
+}
+
+
+static int  usage(void)
+{
+   fprintf(stderr, "usage: suncalc_batch [-y year] [-s first-day-of-year] [-d days]\n"
+                   "                     [-g sites | sites.csv] [-f csv|bin] [-o out]\n"
+                   "                     [-j threads] [-i scalar|sse2|avx2] [-S]\n");
+   return 2;
+}
+
+
+/**
+ *  Read "latitude,longitude" lines.
+ *
+ *  @return Sites read (in a malloc'd array at *ppSites), or -1.
+ */
+static int  read_sites(FILE *pFile, BatchSite **ppSites)
+{
+
+   int numSites = 0;
+   int maxSites = 1024;
+   BatchSite *pSites = malloc(maxSites * sizeof(BatchSite));
+   char line[256];
+   int lineNumber = 0;
+
+   while (fgets(line, sizeof(line), pFile) != NULL)
+   {
+      lineNumber++;
+
+      char *p = line;
+      while ((*p == ' ') || (*p == '\t'))
+      {
+         p++;
+      }
+      if ((*p == '#') || (*p == '\n') || (*p == '\r') || (*p == '\0'))
+      {
+         continue;
+      }
+
+      float latitude, longitude;
+      if ((sscanf(p, "%f , %f", &latitude, &longitude) != 2) ||
+          (latitude < -90) || (latitude > 90) || (longitude < -180) || (longitude > 180))
+      {
+         fprintf(stderr, "line %d: expected latitude,longitude\n", lineNumber);
+         free(pSites);
+         return -1;
+      }
+
+      if (numSites == maxSites)
+      {
+         maxSites *= 2;
+         pSites = realloc(pSites, maxSites * sizeof(BatchSite));
+      }
+      pSites[numSites].latitude = latitude;
+      pSites[numSites].longitude = longitude;
+      numSites++;
+   }
+
+   *ppSites = pSites;
+   return numSites;
+
+}  /* end of read_sites */
+
+
+///  About numSites sites, evenly over latitude (short of the poles) and longitude.
+static int  grid_sites(int numSites, BatchSite **ppSites)
+{
+
+   int rows = 1;
+   while (2 * rows * rows < numSites)
+   {
+      rows++;
+   }
+   int columns = (numSites + rows - 1) / rows;
+
+   BatchSite *pSites = malloc(rows * columns * sizeof(BatchSite));
+   int n = 0;
+   for (int r = 0; (r < rows) && (n < numSites); r++)
+   {
+      for (int c = 0; (c < columns) && (n < numSites); c++)
+      {
+         pSites[n].latitude = -89.5f + (179.0f * (r + 0.5f) / rows);
+         pSites[n].longitude = -180.0f + (360.0f * (c + 0.5f) / columns);
+         n++;
+      }
+   }
+
+   *ppSites = pSites;
+   return n;
+
+}  /* end of grid_sites */
+
+
+///  The run's days, from firstDay of year on, with their month and day.
+static void  run_days(int year, int firstDay, int numDays, BatchDay *pDays)
+{
+
+   int dayYear = year;
+   int dayOfYear = firstDay;
+   for (int d = 0; d < numDays; d++)
+   {
+      int month = 1;
+      while ((month < 12) && (calcDayOfYear(dayYear, month + 1, 1) <= dayOfYear))
+      {
+         month++;
+      }
+      pDays[d].year = dayYear;
+      pDays[d].dayOfYear = dayOfYear;
+      pDays[d].month = month;
+      pDays[d].day = dayOfYear - calcDayOfYear(dayYear, month, 1) + 1;
+
+      if (++dayOfYear > calcDayOfYear(dayYear, 12, 31))
+      {
+         dayOfYear = 1;
+         dayYear++;
+      }
+   }
+
+}  /* end of run_days */
+
+
+///  Arrays for up to maxCount entries.
+static void  batch_alloc(BatchSoA *pBatch, int maxCount)
+{
+   pBatch->count = 0;
+   pBatch->aDayOfYear = malloc(maxCount * sizeof(int32_t));
+   pBatch->aLatitude  = malloc(maxCount * sizeof(float));
+   pBatch->aLongitude = malloc(maxCount * sizeof(float));
+   pBatch->aZenith    = malloc(maxCount * sizeof(float));
+   pBatch->aRise      = malloc(maxCount * sizeof(float));
+   pBatch->aSet       = malloc(maxCount * sizeof(float));
+}
+
+
+static void  batch_free(BatchSoA *pBatch)
+{
+   free(pBatch->aDayOfYear);
+   free(pBatch->aLatitude);
+   free(pBatch->aLongitude);
+   free(pBatch->aZenith);
+   free(pBatch->aRise);
+   free(pBatch->aSet);
+}
+
+
+///  Fill the batch with sites first - first + numSites, each for every day and zenith.
+static void  batch_fill(BatchSoA *pBatch, const BatchSite *pSites, int first, int numSites,
+                        const BatchDay *pDays, int numDays)
+{
+
+   int n = 0;
+   for (int s = first; s < first + numSites; s++)
+   {
+      for (int d = 0; d < numDays; d++)
+      {
+         for (int z = 0; z < NUM_ZENITHS; z++)
+         {
+            pBatch->aDayOfYear[n] = pDays[d].dayOfYear;
+            pBatch->aLatitude[n]  = pSites[s].latitude;
+            pBatch->aLongitude[n] = pSites[s].longitude;
+            pBatch->aZenith[n]    = aZeniths[z];
+            n++;
+         }
+      }
+   }
+   pBatch->count = n;
+
+}  /* end of batch_fill */
+
+
+///  Scalar path over the batch, into pRise and pSet.
+static void  scalar_solve(const BatchSoA *pBatch, const BatchDay *pDays, int numDays,
+                          float *pRise, float *pSet)
+{
+
+   for (int n = 0; n < pBatch->count; n++)
+   {
+      const BatchDay *pDay = &pDays[(n / NUM_ZENITHS) % numDays];
+      pRise[n] = calcSunRise(pDay->year, pDay->month, pDay->day,
+                             pBatch->aLatitude[n], pBatch->aLongitude[n], pBatch->aZenith[n]);
+      pSet[n] = calcSunSet(pDay->year, pDay->month, pDay->day,
+                           pBatch->aLatitude[n], pBatch->aLongitude[n], pBatch->aZenith[n]);
+   }
+
+}  /* end of scalar_solve */
+
+
+static void  write_csv_time(FILE *pOut, float hours)
+{
+   if (hours == NO_RISE_SET_TIME)
+   {
+      return;
+   }
+   fprintf(pOut, "%.4f", hours);
+}
+
+
+///  The batch's entries, for sites firstSite on.
+static void  write_batch(FILE *pOut, bool fBinary, const BatchSoA *pBatch, int firstSite,
+                         const BatchDay *pDays, int numDays)
+{
+
+   for (int n = 0; n < pBatch->count; n++)
+   {
+      int site = firstSite + (n / (NUM_ZENITHS * numDays));
+      const BatchDay *pDay = &pDays[(n / NUM_ZENITHS) % numDays];
+
+      if (fBinary)
+      {
+         BatchRecord record = { site, pDay->year, pDay->dayOfYear, pBatch->aZenith[n],
+                                pBatch->aRise[n], pBatch->aSet[n] };
+         fwrite(&record, sizeof(record), 1, pOut);
+      }
+      else
+      {
+         fprintf(pOut, "%d,%.4f,%.4f,%d,%d,%.4f,", site, pBatch->aLatitude[n],
+                 pBatch->aLongitude[n], pDay->year, pDay->dayOfYear, pBatch->aZenith[n]);
+         write_csv_time(pOut, pBatch->aRise[n]);
+         fputc(',', pOut);
+         write_csv_time(pOut, pBatch->aSet[n]);
+         fputc('\n', pOut);
+      }
+   }
+
+}  /* end of write_batch */
+
+
+///  Seconds per batch_pool_solve() of the batch, timed over a few.
+static double  time_pool(BatchPool *pPool, const BatchSoA *pBatch, BatchIsa isa)
+{
+
+   int runs = 0;
+   double start = now_seconds();
+   double secs;
+   do
+   {
+      batch_pool_solve(pPool, pBatch, isa);
+      runs++;
+      secs = now_seconds() - start;
+   } while (secs < BATCH_SCALING_SECS);
+
+   return secs / runs;
+
+}  /* end of time_pool */
+
+
+/**
+ *  -S: events/s of each kernel build on 1, 2, 4 ... maxThreads threads.
+ *
+ *  @param scalarSecs Time the scalar path took over the batch.
+ */
+static void  scaling_report(const BatchSoA *pBatch, int maxThreads, double scalarSecs)
+{
+
+   double events = 2.0 * pBatch->count;
+   fprintf(stderr, "scaling over %d events (scalar path %.0f events/s):\n",
+           pBatch->count * 2, events / scalarSecs);
+   fprintf(stderr, "  %-6s %7s %12s %9s %9s\n",
+           "build", "threads", "events/s", "speed-up", "per core");
+
+   for (int isa = BATCH_ISA_SCALAR; isa < BATCH_NUM_ISAS; isa++)
+   {
+      if (!batch_isa_available(isa))
+      {
+         fprintf(stderr, "  %-6s not available\n", batch_isa_name(isa));
+         continue;
+      }
+
+      double oneThreadSecs = 0;
+      for (int threads = 1; ; threads = (threads * 2 < maxThreads) ? threads * 2 : maxThreads)
+      {
+         BatchPool *pPool = batch_pool_create(threads);
+         double secs = time_pool(pPool, pBatch, isa);
+         batch_pool_destroy(pPool);
+
+         if (threads == 1)
+         {
+            oneThreadSecs = secs;
+         }
+         fprintf(stderr, "  %-6s %7d %12.0f %8.1fx %8.0f%%\n", batch_isa_name(isa), threads,
+                 events / secs, scalarSecs / secs, 100 * oneThreadSecs / (secs * threads));
+
+         if (threads >= maxThreads)
+         {
+            break;
+         }
+      }
+   }
+
+}  /* end of scaling_report */
+
+
+int  main(int argc, char *argv[])
+{
+
+   int year = 2016;
+   int firstDay = 1;
+   int numDays = 366;
+   int gridSites = 0;
+   bool fBinary = false;
+   bool fScaling = false;
+   int numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+   BatchIsa isa = batch_isa_best();
+   const char *pSitesPath = NULL;
+   const char *pOutPath = NULL;
+
+   for (int i = 1; i < argc; i++)
+   {
+      const char *pArg = argv[i];
+      const char *pValue = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+      if (((pArg[0] != '-') || (pArg[1] == '\0')) && (pSitesPath == NULL))
+      {
+         pSitesPath = pArg;
+         continue;
+      }
+      if (strcmp(pArg, "-S") == 0)
+      {
+         fScaling = true;
+         continue;
+      }
+      if ((pValue == NULL) || (pArg[0] != '-') || (pArg[2] != '\0'))
+      {
+         return usage();
+      }
+
+      switch (pArg[1])
+      {
+      case 'y':  year = atoi(pValue);  break;
+      case 's':  firstDay = atoi(pValue);  break;
+      case 'd':  numDays = atoi(pValue);  break;
+      case 'g':  gridSites = atoi(pValue);  break;
+      case 'o':  pOutPath = pValue;  break;
+      case 'j':  numThreads = atoi(pValue);  break;
+      case 'f':
+         if (strcmp(pValue, "bin") == 0)
+            fBinary = true;
+         else if (strcmp(pValue, "csv") != 0)
+            return usage();
+         break;
+      case 'i':
+         for (isa = BATCH_ISA_SCALAR; isa < BATCH_NUM_ISAS; isa++)
+         {
+            if (strcmp(pValue, batch_isa_name(isa)) == 0)
+               break;
+         }
+         if (isa == BATCH_NUM_ISAS)
+            return usage();
+         break;
+      default:
+         return usage();
+      }
+      i++;
+   }
+
+   if ((numDays < 1) || (numDays > BATCH_MAX_DAYS) || (firstDay < 1) ||
+       (firstDay > calcDayOfYear(year, 12, 31)) || ((gridSites > 0) == (pSitesPath != NULL)) ||
+       (numThreads < 1))
+   {
+      return usage();
+   }
+   if (!batch_isa_available(isa))
+   {
+      fprintf(stderr, "this CPU does not run the %s build\n", batch_isa_name(isa));
+      return 2;
+   }
+
+   BatchSite *pSites = NULL;
+   int numSites;
+   if (gridSites > 0)
+   {
+      numSites = grid_sites(gridSites, &pSites);
+   }
+   else
+   {
+      FILE *pIn = (strcmp(pSitesPath, "-") == 0) ? stdin : fopen(pSitesPath, "r");
+      if (pIn == NULL)
+      {
+         fprintf(stderr, "%s: %s\n", pSitesPath, strerror(errno));
+         return 2;
+      }
+      numSites = read_sites(pIn, &pSites);
+      if (pIn != stdin)
+      {
+         fclose(pIn);
+      }
+      if (numSites <= 0)
+      {
+         return 2;
+      }
+   }
+
+   FILE *pOut = (pOutPath == NULL) ? stdout : fopen(pOutPath, fBinary ? "wb" : "w");
+   if (pOut == NULL)
+   {
+      fprintf(stderr, "%s: %s\n", pOutPath, strerror(errno));
+      return 2;
+   }
+   if (!fBinary)
+   {
+      fprintf(pOut, "site,latitude,longitude,year,day_of_year,zenith,rise,set\n");
+   }
+
+   static BatchDay aDays[BATCH_MAX_DAYS];
+   run_days(year, firstDay, numDays, aDays);
+
+   //  Whole sites to a block, at least one.
+   int blockSites = BATCH_BLOCK_ENTRIES / (numDays * NUM_ZENITHS);
+   if (blockSites < 1)
+   {
+      blockSites = 1;
+   }
+   int maxEntries = blockSites * numDays * NUM_ZENITHS;
+
+   BatchSoA batch;
+   batch_alloc(&batch, maxEntries);
+   float *pScalarRise = malloc(maxEntries * sizeof(float));
+   float *pScalarSet = malloc(maxEntries * sizeof(float));
+
+   BatchPool *pPool = batch_pool_create(numThreads);
+
+   double batchSecs = 0;
+   double scalarSecs = 0;
+   double worstDiff = 0;
+   long events = 0;
+   long eventsNone = 0;
+   long eventsInexact = 0;
+   long outOfRange = 0;
+   long mismatches = 0;
+
+   for (int first = 0; first < numSites; first += blockSites)
+   {
+      int numBlockSites = (numSites - first < blockSites) ? (numSites - first) : blockSites;
+      batch_fill(&batch, pSites, first, numBlockSites, aDays, numDays);
+
+      double start = now_seconds();
+      batch_pool_solve(pPool, &batch, isa);
+      batchSecs += now_seconds() - start;
+
+      //  The same again, one event at a time.
+      start = now_seconds();
+      scalar_solve(&batch, aDays, numDays, pScalarRise, pScalarSet);
+      double blockScalarSecs = now_seconds() - start;
+      scalarSecs += blockScalarSecs;
+
+      if (fScaling && (first == 0))
+      {
+         scaling_report(&batch, numThreads, blockScalarSecs);
+      }
+
+      for (int n = 0; n < batch.count; n++)
+      {
+         float aBatch[2] = { batch.aRise[n], batch.aSet[n] };
+         float aScalar[2] = { pScalarRise[n], pScalarSet[n] };
+
+         for (int j = 0; j < 2; j++)
+         {
+            events++;
+            eventsInexact += (aBatch[j] != aScalar[j]);
+            if ((aBatch[j] == NO_RISE_SET_TIME) || (aScalar[j] == NO_RISE_SET_TIME))
+            {
+               eventsNone += (aBatch[j] == NO_RISE_SET_TIME);
+               mismatches += (aBatch[j] != aScalar[j]);
+               continue;
+            }
+
+            outOfRange += (aBatch[j] < 0) || (aBatch[j] > 24);
+            double diff = fabs(aBatch[j] - aScalar[j]);
+            if (diff > 12)
+            {
+               diff = 24 - diff;
+            }
+            if (diff > worstDiff)
+            {
+               worstDiff = diff;
+            }
+         }
+      }
+
+      //  (written out after the timing, so as not to time the output.)
+      write_batch(pOut, fBinary, &batch, first, aDays, numDays);
+   }
+
+   batch_pool_destroy(pPool);
+   batch_free(&batch);
+   free(pScalarRise);
+   free(pScalarSet);
+   if (pOut != stdout)
+   {
+      fclose(pOut);
+   }
+   free(pSites);
+
+   fprintf(stderr, "%d sites x %d days x %d zeniths: %ld events, %ld with no rise or set\n",
+           numSites, numDays, NUM_ZENITHS, events, eventsNone);
+   fprintf(stderr, "batch:  %.3f s, %.0f events/s (%s, %d threads)\n", batchSecs,
+           events / batchSecs, batch_isa_name(isa), numThreads);
+   fprintf(stderr, "scalar: %.3f s, %.0f events/s (batch is %.1fx)\n",
+           scalarSecs, events / scalarSecs, scalarSecs / batchSecs);
+   fprintf(stderr, "worst batch vs scalar difference %.3f s, %ld not to the bit, "
+                   "%ld rise/set mismatches, %ld out of range\n",
+           worstDiff * 3600, eventsInexact, mismatches, outOfRange);
+
+   return ((worstDiff > BATCH_MAX_DIFF) || (mismatches > 0) || (outOfRange > 0)) ? 1 : 0;
+
+}  /* end of main */
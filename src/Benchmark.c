@@ -0,0 +1,154 @@
+/**
+ *  @file
+ *  
+ */
+
+#include  "Benchmark.h"
+
+#include  "testing.h"
+
+#if TESTING_BENCHMARK_DAILY_UPDATE
+
+#include  "config.h"
+#include  "ConfigData.h"
+#include  "suncalc.h"
+#include  "TwilightPath.h"
+
+
+///  Calls timed per benchmark.  time_ms() only counts whole milliseconds,
+///  so this needs to be large enough for a total of several hundred.
+#define  BENCHMARK_ITERATIONS   200
+
+///  Where to compute for if no location has been received yet (London).
+#define  BENCHMARK_DEFAULT_LATITUDE    51.5f
+#define  BENCHMARK_DEFAULT_LONGITUDE   (-0.13f)
+
+
+///  Milliseconds since a time_ms() reading.
+static int32_t elapsed_ms(time_t startSecs, uint16_t startMs)
+{
+   time_t nowSecs;
+   uint16_t nowMs;
+   time_ms(&nowSecs, &nowMs);
+   return ((nowSecs - startSecs) * 1000) + nowMs - startMs;
+}
+
+
+///  Log one benchmark's result.
+static void log_result(const char *pszName, int iterations, int32_t ms)
+{
+   APP_LOG(APP_LOG_LEVEL_INFO,
+           "{\"bench\":\"%s\",\"n\":%d,\"ms\":%d,\"us_per_call\":%d}",
+           pszName, iterations, (int) ms, (int) ((ms * 1000) / iterations));
+}
+
+
+void  benchmark_run(void)
+{
+
+   float latitude = BENCHMARK_DEFAULT_LATITUDE;
+   float longitude = BENCHMARK_DEFAULT_LONGITUDE;
+   config_data_location_get(&latitude, &longitude, NULL, NULL);
+
+   APP_LOG(APP_LOG_LEVEL_INFO,
+           "{\"bench_config\":{\"fixed_point\":%d,\"ephemeris_table\":%d,\"lat_x100\":%d}}",
+           SUNCALC_USE_FIXED_POINT, !TESTING_DISABLE_EPHEMERIS_TABLE,
+           (int) (latitude * 100));
+
+   time_t startSecs;
+   uint16_t startMs;
+
+   //  Vary the day, so that every call does the full work (the ephemeris
+   //  table reads in particular).  Jan 1 + (day - 1) is a valid date for
+   //  the almanac's day-of-year formula even past the end of January.
+   //  A result is kept so the calls can't be optimized away.
+   volatile float fSink = 0;
+
+   // ------------------------------------------------
+
+   time_ms(&startSecs, &startMs);
+   for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+   {
+      fSink += calcSunRise(2016, 1, 1 + i, latitude, longitude, ZENITH_OFFICIAL);
+   }
+   log_result("calcSunRise", BENCHMARK_ITERATIONS, elapsed_ms(startSecs, startMs));
+
+   // ------------------------------------------------
+
+   static const float aZeniths[] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                     ZENITH_CIVIL, ZENITH_OFFICIAL };
+   #define NUM_BENCH_ZENITHS  (sizeof(aZeniths) / sizeof(aZeniths[0]))
+   float aRise[NUM_BENCH_ZENITHS];
+   float aSet[NUM_BENCH_ZENITHS];
+
+   time_ms(&startSecs, &startMs);
+   for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+   {
+      calcSunRiseSetMulti(2016, 1, 1 + i, latitude, longitude,
+                          aZeniths, NUM_BENCH_ZENITHS, aRise, aSet);
+      fSink += aRise[0];
+   }
+   log_result("calcSunRiseSetMulti_4", BENCHMARK_ITERATIONS, elapsed_ms(startSecs, startMs));
+
+   // ------------------------------------------------
+
+   //  Same set of paths as the watchface uses.
+   TwilightPath *apPaths[] =
+   {
+      twilight_path_create(ZENITH_ASTRONOMICAL, ENCLOSE_SCREEN_BOTTOM, TWILIGHT_SHADE_NONE),
+      twilight_path_create(ZENITH_NAUTICAL,     ENCLOSE_SCREEN_TOP,    TWILIGHT_SHADE_DARK_GREY),
+      twilight_path_create(ZENITH_CIVIL,        ENCLOSE_SCREEN_TOP,    TWILIGHT_SHADE_GREY),
+      twilight_path_create(ZENITH_OFFICIAL,     ENCLOSE_SCREEN_TOP,    TWILIGHT_SHADE_LIGHT_GREY)
+   };
+   #define NUM_BENCH_PATHS  (sizeof(apPaths) / sizeof(apPaths[0]))
+
+   bool fPathsOk = true;
+   for (unsigned i = 0; i < NUM_BENCH_PATHS; i++)
+   {
+      fPathsOk = fPathsOk && (apPaths[i] != NULL);
+   }
+
+   if (fPathsOk)
+   {
+      struct tm tmDay = { .tm_year = 116, .tm_mon = 0, .tm_mday = 1 };
+
+      time_ms(&startSecs, &startMs);
+      for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+      {
+         tmDay.tm_mday = 1 + i;
+         twilight_path_compute_current(apPaths[3], &tmDay);
+      }
+      log_result("twilight_path_compute_current", BENCHMARK_ITERATIONS,
+                 elapsed_ms(startSecs, startMs));
+
+      //  The work updateDayAndNightInfo() does, short of touching the UI:
+      //  all four bands, then sunrise / sunset text.
+      char achText[sizeof("00:00")];
+
+      time_ms(&startSecs, &startMs);
+      for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+      {
+         tmDay.tm_mday = 1 + i;
+         twilight_path_compute_current_multi(apPaths, NUM_BENCH_PATHS, &tmDay);
+
+         struct tm tmText = tmDay;
+         tmText.tm_hour = apPaths[3]->dawnMinute / 60;
+         tmText.tm_min = apPaths[3]->dawnMinute % 60;
+         strftime(achText, sizeof(achText), "%R", &tmText);
+         tmText.tm_hour = apPaths[3]->duskMinute / 60;
+         tmText.tm_min = apPaths[3]->duskMinute % 60;
+         strftime(achText, sizeof(achText), "%R", &tmText);
+      }
+      log_result("daily_update", BENCHMARK_ITERATIONS, elapsed_ms(startSecs, startMs));
+   }
+
+   for (unsigned i = 0; i < NUM_BENCH_PATHS; i++)
+   {
+      twilight_path_destroy(apPaths[i]);
+   }
+
+   (void) fSink;
+
+}  /* end of benchmark_run */
+
+#endif  // TESTING_BENCHMARK_DAILY_UPDATE
@@ -0,0 +1,20 @@
+/**
+ *  @file
+ *  
+ *  Test aid: time the daily solar update and its parts on the watch, and
+ *  log the results as JSON lines (one per benchmark) which can be pulled
+ *  from "pebble logs" and compared from build to build.
+ *  
+ *  Only built when TESTING_BENCHMARK_DAILY_UPDATE is set in testing.h.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+/**
+ *  Run all benchmarks and log their results.  Takes several seconds, so
+ *  call it before the main window is up.
+ */
+void  benchmark_run(void);
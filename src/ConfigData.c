@@ -5,11 +5,21 @@
 
 #include  "ConfigData.h"
 
+#include  "my_math.h"
+#include  "PersistBudget.h"
+#include  "suncalc.h"
+#include  "TaskScheduler.h"
 #include  "testing.h"
 
 
 ///  Version of code's current ConfigDataCurLocation structure layout.
-#define CONFIG_DATA_CUR_VERSION 1
+#define CONFIG_DATA_CUR_VERSION 3
+
+///  Version 1 kept latitude / longitude as floats, in the same places.
+#define CONFIG_DATA_FLOAT_VERSION 1
+
+///  Version 2 ended at timeLastUpdate, and usUtcOffsetChanges was zero.
+#define CONFIG_DATA_V2_BYTES  offsetof(ConfigDataCurLocation, aUtcOffsetChanges)
 
 /**
  *  All data we persist to flash for current location.
@@ -19,20 +29,22 @@ typedef struct
    ///  Version of this struct.  Always CONFIG_DATA_CUR_VERSION now.
    uint16_t usVersion;
 
-   ///  Set to zero.
-   uint16_t usReserved;
+   ///  Entries used in aUtcOffsetChanges.
+   uint16_t usUtcOffsetChanges;
 
-   ///  Degrees from equator: positive for North, negative for South.
-   float    fLatitude;
+   ///  Degrees from equator, times CONFIG_DATA_DEGREE_SCALE: positive for
+   ///  North, negative for South.
+   int32_t  iLatitude;
 
-   ///  Degrees from Greenwich: positive for Each, negative for West.
-   float    fLongitude;
+   ///  Degrees from Greenwich, times CONFIG_DATA_DEGREE_SCALE: positive for
+   ///  East, negative for West.
+   int32_t  iLongitude;
 
    ///  Time offset from UTC to local time.
    int32_t  iUtcOffset;
 
    /**
-    *  Time this struct's values were last changed in flash.
+    *  Time this struct's values were last changed.
     *  NB: this comes from PebbleOS' time() call, so may be local time
     *      instead of the customary UTC.
     *  
@@ -40,30 +52,75 @@ typedef struct
     */
    time_t   timeLastUpdate;
 
+   ///  Coming changes of iUtcOffset, soonest first.
+   ConfigDataUtcOffsetChange aUtcOffsetChanges[CONFIG_DATA_MAX_UTC_OFFSET_CHANGES];
+
 } __attribute__((__packed__))  ConfigDataCurLocation;
 
 
-///  PebbleOS persist_* config item key for ConfigDataCurLocation.
-#define  CONFIG_DATA_KEY_CUR_LOCATION  1
+///  PebbleOS persist_* config item key for ConfigDataCurLocation (see
+///  PersistBudget.h).
+#define  CONFIG_DATA_KEY_CUR_LOCATION  PERSIST_KEY_CONFIG_DATA
+
+_Static_assert(sizeof(ConfigDataCurLocation) <= PERSIST_BYTES_CONFIG_DATA,
+               "ConfigDataCurLocation is over its PersistBudget.h line");
 
-///  Cached copy of watch flash.  Valid after config_data_init() is called.
+///  Cached copy of watch flash, plus any change not yet written.  Valid
+///  after config_data_init() is called.
 static ConfigDataCurLocation  curLocationCache;
 
+///  Cached float copies of curLocationCache fields.
+static float curLatitude = 0;
+static float curLongitude = 0;
+
 ///  Cached copy of timezone-in-hours.  Valid after config_data_init() is called.
 static float curTimezoneInHours = 0;
 
+///  When curLocationCache was last written to flash, or 0 if not since launch.
+static time_t timeLastWrite = 0;
+
+///  Held back write of curLocationCache to flash, or NULL.
+static AppTimer *pWriteTimer = NULL;
+
+///  Queued write of curLocationCache to flash, or TASK_HANDLE_NONE.
+static TaskHandle writeTask = TASK_HANDLE_NONE;
+
+static ConfigDataStats stats;
+
+
+///  Persisted units to degrees.
+static float  config_data_unscale_degrees(int32_t scaled)
+{
+   return (float) scaled * (1.0f / CONFIG_DATA_DEGREE_SCALE);
+}
 
 /**
  *  Silly little helper because we persist a "UTC offset" (from local) in seconds,
  *  but the app wants local offset from UTC (tradition tz info) expressed in hours
  *  and fractions of an hour.
  *  
- *  Since this is floating point, we calculate it at config updates rather
- *  than on the fly.
+ *  Since this is floating point, we calculate it (and the float coords) at
+ *  config updates rather than on the fly.
  */
 static void  compute_tz_in_hours()
 {
-   curTimezoneInHours = -(curLocationCache.iUtcOffset / 3600.0);
+   curTimezoneInHours = -(curLocationCache.iUtcOffset / 3600.0f);
+
+   curLatitude  = config_data_unscale_degrees(curLocationCache.iLatitude);
+   curLongitude = config_data_unscale_degrees(curLocationCache.iLongitude);
+}
+
+///  Degrees to persisted units, rounded.
+static int32_t  config_data_scale_degrees(float degrees)
+{
+   //  Whole degrees and fraction apart, all in float: the fraction is exact,
+   //  and its millionths are well within float precision, where the whole
+   //  product (up to 1.8 * 10^8) isn't.
+   int32_t whole = (int32_t) degrees;
+   float fraction = degrees - whole;
+
+   return (whole * CONFIG_DATA_DEGREE_SCALE) +
+          (int32_t) my_rint(fraction * CONFIG_DATA_DEGREE_SCALE);
 }
 
 void  config_data_init()
@@ -71,22 +128,156 @@ void  config_data_init()
 
    int iRet;
 
+   memset(&curLocationCache, 0, sizeof(curLocationCache));
    iRet = persist_read_data(CONFIG_DATA_KEY_CUR_LOCATION,
                             &curLocationCache, sizeof(curLocationCache));
 #if TESTING_DISABLE_CACHE_READ
    iRet = 0;
 #endif
-   if ((iRet < (int) sizeof(curLocationCache)) ||
-       (curLocationCache.usVersion != CONFIG_DATA_CUR_VERSION))
+   if ((iRet >= (int) CONFIG_DATA_V2_BYTES) &&
+       (curLocationCache.usVersion == CONFIG_DATA_FLOAT_VERSION))
+   {
+      //  Same layout, but float coords.  Converted in RAM only: flash
+      //  keeps version 1 until the location next changes.
+      float fLatitude, fLongitude;
+      memcpy(&fLatitude, &curLocationCache.iLatitude, sizeof(fLatitude));
+      memcpy(&fLongitude, &curLocationCache.iLongitude, sizeof(fLongitude));
+
+      curLocationCache.usVersion  = CONFIG_DATA_CUR_VERSION;
+      curLocationCache.iLatitude  = config_data_scale_degrees(fLatitude);
+      curLocationCache.iLongitude = config_data_scale_degrees(fLongitude);
+   }
+
+   if ((iRet >= (int) CONFIG_DATA_V2_BYTES) && (curLocationCache.usVersion == 2))
+   {
+      //  Version 3 with no UTC offset changes.
+      curLocationCache.usVersion = CONFIG_DATA_CUR_VERSION;
+      curLocationCache.usUtcOffsetChanges = 0;
+   }
+
+   if ((iRet < (int) CONFIG_DATA_V2_BYTES) ||
+       (curLocationCache.usVersion != CONFIG_DATA_CUR_VERSION) ||
+       (curLocationCache.usUtcOffsetChanges > CONFIG_DATA_MAX_UTC_OFFSET_CHANGES) ||
+       (iRet < (int) (CONFIG_DATA_V2_BYTES + (curLocationCache.usUtcOffsetChanges *
+                                              sizeof(ConfigDataUtcOffsetChange)))))
    {
       //  no (usable) persisted data.
       memset(&curLocationCache, 0, sizeof(curLocationCache));
       // (Zeroing the timeLastUpdate field marks cache as invalid.)
    }
-   else
+
+   compute_tz_in_hours();
+}
+
+
+/**
+ *  Write curLocationCache to flash now.
+ *  
+ *  @return \c true if write went ok, \c false if it failed.
+ */
+static bool  config_data_write_now(void)
+{
+
+   int iRet;
+
+   //  Started seeing E_INTERNAL from persist_write_data, so make a best effort
+   //  to remove the old value, if any, first.
+   iRet = persist_delete(CONFIG_DATA_KEY_CUR_LOCATION);
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "persist_delete ret =  %d", iRet); 
+
+   iRet = persist_write_data(CONFIG_DATA_KEY_CUR_LOCATION, 
+                             &curLocationCache, sizeof(curLocationCache));
+
+   timeLastWrite = time(NULL);
+   stats.usFlashWrites++;
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "location flash writes %d, coalesced %d, ignored %d",
+           stats.usFlashWrites, stats.usCoalesced, stats.usIgnored);
+
+   if (iRet == sizeof(curLocationCache))
    {
-      compute_tz_in_hours();
+      return true;
+   }
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "persist_write_data failed, ret =  %d", iRet);
+
+   //BUGBUG - should we flag cached copy as invalid to match?
+   return false;
+
+}  /* end of config_data_write_now */
+
+
+///  TaskScheduler step: write curLocationCache as it is by now.
+static bool  config_data_write_step(void *pContext)
+{
+   (void) pContext;
+
+   writeTask = TASK_HANDLE_NONE;
+   config_data_write_now();
+
+   return true;
+}
+
+
+///  Have config_data_write_step() run soon, after any more urgent work.
+static void  config_data_queue_write(void)
+{
+   if (writeTask != TASK_HANDLE_NONE)
+   {
+      return;
+   }
+
+   writeTask = task_scheduler_submit(config_data_write_step, NULL, NULL,
+                                     TASK_PRIORITY_LOW);
+   if (writeTask == TASK_HANDLE_NONE)
+   {
+      config_data_write_now();
+   }
+}
+
+
+///  app_timer callback for a held back write.
+static void  config_data_write_timer_callback(void *pData)
+{
+   (void) pData;
+
+   pWriteTimer = NULL;
+   config_data_queue_write();
+}
+
+
+///  Drop any write held back or queued.  Returns \c true if there was one.
+static bool  config_data_cancel_write(void)
+{
+
+   bool fPending = (pWriteTimer != NULL) || (writeTask != TASK_HANDLE_NONE);
+
+   if (pWriteTimer != NULL)
+   {
+      app_timer_cancel(pWriteTimer);
+      pWriteTimer = NULL;
    }
+
+   task_scheduler_cancel(writeTask);
+   writeTask = TASK_HANDLE_NONE;
+
+   return fPending;
+
+}  /* end of config_data_cancel_write */
+
+
+void  config_data_flush(void)
+{
+   if (config_data_cancel_write())
+   {
+      config_data_write_now();
+   }
+}
+
+
+void  config_data_deinit(void)
+{
+   config_data_flush();
 }
 
 
@@ -108,10 +299,10 @@ bool  config_data_location_get(float* pLat, float *pLong, int32_t *pUtcOffset,
    }
 
    if (pLat != 0)
-      *pLat = curLocationCache.fLatitude; 
+      *pLat = curLatitude; 
 
    if (pLong != 0)
-      *pLong = curLocationCache.fLongitude; 
+      *pLong = curLongitude; 
 
    if (pUtcOffset != 0)
       *pUtcOffset = curLocationCache.iUtcOffset; 
@@ -123,14 +314,36 @@ bool  config_data_location_get(float* pLat, float *pLong, int32_t *pUtcOffset,
 
 }  /* end of config_data_location_get */
 
+
+bool  config_data_location_get_scaled(int32_t *pLat, int32_t *pLong, int32_t *pUtcOffset)
+{
+
+   if (curLocationCache.timeLastUpdate == 0)
+   {
+      return false;
+   }
+
+   if (pLat != NULL)
+      *pLat = curLocationCache.iLatitude;
+
+   if (pLong != NULL)
+      *pLong = curLocationCache.iLongitude;
+
+   if (pUtcOffset != NULL)
+      *pUtcOffset = curLocationCache.iUtcOffset;
+
+   return true;
+
+}  /* end of config_data_location_get_scaled */
+
 float  config_data_get_latitude()
 {
-   return curLocationCache.fLatitude;
+   return curLatitude;
 }
 
 float  config_data_get_longitude()
 {
-   return curLocationCache.fLongitude;
+   return curLongitude;
 }
 
 float  config_data_get_tz_in_hours()
@@ -139,13 +352,121 @@ float  config_data_get_tz_in_hours()
 }
 
 
-bool  config_data_is_different(float latitude, float longitude, int32_t utcOffset)
+/**
+ *  Most seconds today's official sunrise or sunset moves between the
+ *  configured location and the one given.
+ */
+static int32_t  config_data_sun_shift_secs(float latitude, float longitude)
+{
+
+   static const float aZenith[1] = { ZENITH_OFFICIAL };
+
+   time_t now = time(NULL);
+   struct tm *pLocalTime = localtime(&now);
+
+   float aRise[2], aSet[2];
+
+   //BUGBUG - date should be UTC!  (As in TwilightPath.c.)
+   calcSunRiseSetMulti(pLocalTime->tm_year, pLocalTime->tm_mon + 1, pLocalTime->tm_mday,
+                       curLatitude, curLongitude, aZenith, 1, &aRise[0], &aSet[0]);
+   calcSunRiseSetMulti(pLocalTime->tm_year, pLocalTime->tm_mon + 1, pLocalTime->tm_mday,
+                       latitude, longitude, aZenith, 1, &aRise[1], &aSet[1]);
+
+   int32_t maxShift = 0;
+   const float *apTimes[2] = { aRise, aSet };
+
+   for (int i = 0; i < 2; i++)
+   {
+      const float *pTimes = apTimes[i];
+      if ((pTimes[0] == NO_RISE_SET_TIME) != (pTimes[1] == NO_RISE_SET_TIME))
+      {
+         //  sun rises at one place and not at the other.
+         return INT32_MAX;
+      }
+      if (pTimes[0] == NO_RISE_SET_TIME)
+      {
+         continue;
+      }
+
+      //  (UTC hours, so a shift across midnight looks like nearly 24 hours.)
+      float hours = pTimes[1] - pTimes[0];
+      if (hours > 12)
+         hours -= 24;
+      else if (hours < -12)
+         hours += 24;
+
+      int32_t shift = (int32_t) (((hours < 0) ? -hours : hours) * 3600);
+      if (shift > maxShift)
+         maxShift = shift;
+   }
+
+   return maxShift;
+
+}  /* end of config_data_sun_shift_secs */
+
+
+///  Distance in km between the configured location and the one given.
+static int32_t  config_data_distance_km(float latitude, float longitude)
 {
-   float tmpLat, tmpLong;
-   int32_t tmp_utcOffset;
 
-   return ! (config_data_location_get(&tmpLat, &tmpLong, &tmp_utcOffset, NULL) &&
-             (latitude == tmpLat) && (longitude == tmpLong) && (utcOffset == tmp_utcOffset));
+   //  Equirectangular approximation: plenty at the distances that matter here.
+   float dLong = longitude - curLongitude;
+   if (dLong > 180)
+      dLong -= 360;
+   else if (dLong < -180)
+      dLong += 360;
+
+   int32_t meanLatAngle = (int32_t) ((latitude + curLatitude) / 2 * TRIG_MAX_ANGLE / 360);
+   float x = dLong * cos_lookup(meanLatAngle) / TRIG_MAX_RATIO;
+   float y = latitude - curLatitude;
+
+   //  111.2 km per degree.
+   return (int32_t) (my_sqrt(x * x + y * y) * 111.2f);
+
+}  /* end of config_data_distance_km */
+
+
+bool  config_data_is_different(int32_t iLatitude, int32_t iLongitude, int32_t utcOffset)
+{
+
+   if (!config_data_location_avail() || (utcOffset != curLocationCache.iUtcOffset))
+   {
+      return true;
+   }
+
+   if ((iLatitude == curLocationCache.iLatitude) &&
+       (iLongitude == curLocationCache.iLongitude))
+   {
+      return false;
+   }
+
+   float latitude = config_data_unscale_degrees(iLatitude);
+   float longitude = config_data_unscale_degrees(iLongitude);
+
+   bool fSignificant = false;
+   int32_t shiftSecs = -1, km = -1;
+
+   if (CONFIG_DATA_SIGNIFICANT_SHIFT_SECS > 0)
+   {
+      shiftSecs = config_data_sun_shift_secs(latitude, longitude);
+      fSignificant |= (shiftSecs > CONFIG_DATA_SIGNIFICANT_SHIFT_SECS);
+   }
+
+   if (CONFIG_DATA_SIGNIFICANT_KM > 0)
+   {
+      km = config_data_distance_km(latitude, longitude);
+      fSignificant |= (km > CONFIG_DATA_SIGNIFICANT_KM);
+   }
+
+   if (!fSignificant)
+   {
+      stats.usIgnored++;
+   }
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "location moved %d km, sun shift %d s: %s",
+           (int) km, (int) shiftSecs, fSignificant ? "taken" : "ignored");
+
+   return fSignificant;
 
 }  /* end of config_data_is_different */
 
@@ -153,61 +474,167 @@ bool  config_data_is_different(float latitude, float longitude, int32_t utcOffse
 ///  Do the geolocation parts of two location structs match?
 static bool locations_equiv(ConfigDataCurLocation* pLoc1, ConfigDataCurLocation* pLoc2)
 {
-   return (pLoc1->fLatitude == pLoc2->fLatitude) &&
-          (pLoc1->fLongitude == pLoc2->fLongitude) &&
+   return (pLoc1->iLatitude == pLoc2->iLatitude) &&
+          (pLoc1->iLongitude == pLoc2->iLongitude) &&
           (pLoc1->iUtcOffset == pLoc2->iUtcOffset);
 }
 
 
-bool  config_data_location_set(float fLat, float fLong, int32_t iUtcOffset)
+/**
+ *  Have curLocationCache, just changed, written to flash: soon if there
+ *  has been no write for CONFIG_DATA_MIN_WRITE_INTERVAL_SECS, else then.
+ */
+static void  config_data_schedule_write(void)
+{
+
+   if ((pWriteTimer != NULL) || (writeTask != TASK_HANDLE_NONE))
+   {
+      //  the write already pending will pick this up.
+      stats.usCoalesced++;
+      return;
+   }
+
+   time_t now = time(NULL);
+   time_t nextWrite = timeLastWrite + CONFIG_DATA_MIN_WRITE_INTERVAL_SECS;
+   if ((timeLastWrite == 0) || (now >= nextWrite))
+   {
+      config_data_queue_write();
+      return;
+   }
+
+   stats.usCoalesced++;
+   pWriteTimer = app_timer_register((nextWrite - now) * 1000,
+                                    config_data_write_timer_callback, NULL);
+   if (pWriteTimer == NULL)
+   {
+      config_data_queue_write();
+   }
+
+}  /* end of config_data_schedule_write */
+
+
+bool  config_data_location_set(int32_t iLatitude, int32_t iLongitude, int32_t iUtcOffset)
 {
 
 ConfigDataCurLocation   newLocation;
 
 
+   //  (keeps any UTC offset changes.)
+   newLocation = curLocationCache;
+
    newLocation.usVersion      = CONFIG_DATA_CUR_VERSION;
-   newLocation.usReserved     = 0;
-   newLocation.fLatitude      = fLat;
-   newLocation.fLongitude     = fLong;
+   newLocation.iLatitude      = iLatitude;
+   newLocation.iLongitude     = iLongitude;
    newLocation.iUtcOffset     = iUtcOffset;
    newLocation.timeLastUpdate = time(NULL);
 
-   int iRet;
-
    if (locations_equiv(&newLocation, &curLocationCache))
    {
       //  we want to leave curLocationCache.timeLastUpdate undisturbed.
       return true;
    }
 
-   //  Started seeing E_INTERNAL from persist_write_data, so make a best effort
-   //  to remove the old value, if any, first.
-   iRet = persist_delete(CONFIG_DATA_KEY_CUR_LOCATION);
-   APP_LOG(APP_LOG_LEVEL_DEBUG, "persist_delete ret =  %d", iRet); 
+   curLocationCache = newLocation;
+   compute_tz_in_hours();
 
-   iRet = persist_write_data(CONFIG_DATA_KEY_CUR_LOCATION, 
-                             &newLocation, sizeof(newLocation));
-   if (iRet == sizeof(newLocation))
+   config_data_schedule_write();
+
+   return true;
+
+}  /* end of config_data_location_set */
+
+
+void  config_data_set_utc_offset_changes(const ConfigDataUtcOffsetChange aChanges[],
+                                         int numChanges)
+{
+
+   if (!config_data_location_avail())
    {
-      curLocationCache = newLocation;
-      compute_tz_in_hours();
+      return;
+   }
 
-      return true;
+   ConfigDataUtcOffsetChange aKept[CONFIG_DATA_MAX_UTC_OFFSET_CHANGES];
+   memset(aKept, 0, sizeof(aKept));
+
+   //  (time() is UTC on SDK3, as the change times are.)
+   time_t nowUtc = time(NULL);
+   int numKept = 0;
+   for (int i = 0; (i < numChanges) && (numKept < CONFIG_DATA_MAX_UTC_OFFSET_CHANGES); i++)
+   {
+      if (aChanges[i].timeChange > nowUtc)
+      {
+         aKept[numKept++] = aChanges[i];
+      }
    }
 
-   APP_LOG(APP_LOG_LEVEL_DEBUG, "persist_write_data failed, ret =  %d", iRet);
+   if ((numKept == curLocationCache.usUtcOffsetChanges) &&
+       (memcmp(aKept, curLocationCache.aUtcOffsetChanges, sizeof(aKept)) == 0))
+   {
+      return;
+   }
 
-   //BUGBUG - should we flag cached copy as invalid to match?
-   return false;
+   curLocationCache.usUtcOffsetChanges = numKept;
+   memcpy(curLocationCache.aUtcOffsetChanges, aKept, sizeof(aKept));
 
-}  /* end of config_data_location_set */
+   config_data_schedule_write();
+
+}  /* end of config_data_set_utc_offset_changes */
+
+
+bool  config_data_apply_utc_offset_changes(void)
+{
+
+   bool fChanged = false;
+
+   //  (time() is UTC on SDK3, as the change times are.)
+   time_t nowUtc = time(NULL);
+
+   while (curLocationCache.usUtcOffsetChanges > 0)
+   {
+      ConfigDataUtcOffsetChange *pNext = &curLocationCache.aUtcOffsetChanges[0];
+
+      if (nowUtc < pNext->timeChange)
+      {
+         break;
+      }
+
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "UTC offset now %d, was %d",
+              (int) pNext->utcOffset, (int) curLocationCache.iUtcOffset);
+
+      curLocationCache.iUtcOffset = pNext->utcOffset;
+      curLocationCache.usUtcOffsetChanges--;
+      memmove(&curLocationCache.aUtcOffsetChanges[0], &curLocationCache.aUtcOffsetChanges[1],
+              curLocationCache.usUtcOffsetChanges * sizeof(ConfigDataUtcOffsetChange));
+      memset(&curLocationCache.aUtcOffsetChanges[curLocationCache.usUtcOffsetChanges], 0,
+             sizeof(ConfigDataUtcOffsetChange));
+      fChanged = true;
+   }
+
+   if (fChanged)
+   {
+      curLocationCache.timeLastUpdate = time(NULL);
+      compute_tz_in_hours();
+      config_data_schedule_write();
+   }
+
+   return fChanged;
+
+}  /* end of config_data_apply_utc_offset_changes */
 
 
 void  config_data_location_erase(void)
 {
+   config_data_cancel_write();
+
    persist_delete(CONFIG_DATA_KEY_CUR_LOCATION);
 
    //  clear cache to match:
    memset(&curLocationCache, 0, sizeof(curLocationCache));
+   compute_tz_in_hours();
 }
 
+
+void  config_data_get_stats(ConfigDataStats *pStats)
+{
+   *pStats = stats;
+}
@@ -9,12 +9,77 @@
 #include  "pebble.h"
 
 
+/**
+ *  A new location fix is only taken up if it moves sunrise or sunset by
+ *  more than this many seconds, or moves us more than
+ *  CONFIG_DATA_SIGNIFICANT_KM.  Set either to 0 to not use it.  Phone fixes
+ *  jitter by tens of metres even when the user hasn't moved, and each fix
+ *  taken up costs a flash write and a full recompute of the day.
+ */
+#define  CONFIG_DATA_SIGNIFICANT_SHIFT_SECS  30
+
+///  See CONFIG_DATA_SIGNIFICANT_SHIFT_SECS.
+#define  CONFIG_DATA_SIGNIFICANT_KM          2
+
+/**
+ *  Least time between flash writes of the location.  A change taken up
+ *  sooner than this after the last write is held in RAM, and written (with
+ *  any later changes) once the time is up, or at exit.
+ */
+#define  CONFIG_DATA_MIN_WRITE_INTERVAL_SECS  (10*60)
+
+///  Units per degree of the scaled integer latitude / longitude we take.
+#define  CONFIG_DATA_DEGREE_SCALE  1000000
+
+///  Most upcoming UTC offset changes kept.
+#define  CONFIG_DATA_MAX_UTC_OFFSET_CHANGES  2
+
+
+///  A coming change of UTC offset, as when DST starts or ends.
+typedef struct
+{
+   ///  When it happens: UTC seconds since 1970.
+   time_t   timeChange;
+
+   ///  UTC offset from then on, in seconds.
+   int32_t  utcOffset;
+
+} __attribute__((__packed__))  ConfigDataUtcOffsetChange;
+
+
+///  Counts since launch, from config_data_get_stats().
+typedef struct
+{
+   ///  Location writes to flash.
+   uint16_t usFlashWrites;
+
+   ///  Changes taken up while a write was held back.
+   uint16_t usCoalesced;
+
+   ///  Changed fixes config_data_is_different() judged too small to matter.
+   uint16_t usIgnored;
+
+} ConfigDataStats;
+
+
 /**
  *  Read what configuration data we have from watch flash into RAM cache.
  *  Best called from program init, as this might be a lengthy operation.
  */
 void  config_data_init();
 
+/**
+ *  Write any location change still held in RAM to flash.  Call at program
+ *  exit.
+ */
+void  config_data_deinit(void);
+
+/**
+ *  Write any location change still held in RAM to flash now.  Call before
+ *  the worker is to read the location from flash.
+ */
+void  config_data_flush(void);
+
 /**
  *  Convenience function to simply check whether location data is persisted,
  *  without returning the values.
@@ -37,8 +102,8 @@ bool  config_data_location_avail();
  *             from UTC, in seconds.  This is the reverse of the usual tz
  *             offset: *pUtcOffset is added to local time to obtain UTC.
  *  @param pLastUpdateTime Points to var to receive the time the returned values
- *             were last changed in flash.  This is relative to PebbleOS' time()
- *             value, so is local time rather than UTC.
+ *             were last changed in flash.  This is PebbleOS' time()
+ *             value, so UTC on SDK3.
  * 
  *  @return \c true if persisted location info is available, else \c false.
  *          In the latter case, all other returns are undefined.
@@ -46,42 +111,74 @@ bool  config_data_location_avail();
 bool  config_data_location_get(float* pLat, float *pLong, int32_t *pUtcOffset,
                                time_t* pLastUpdateTime);
 
+/**
+ *  As config_data_location_get(), but with the coords as they are kept:
+ *  degrees times CONFIG_DATA_DEGREE_SCALE.  For callers that store or send
+ *  them on, so they don't pass through float and back.
+ * 
+ *  @return \c true if location info is available, else \c false.
+ */
+bool  config_data_location_get_scaled(int32_t *pLat, int32_t *pLong, int32_t *pUtcOffset);
+
 float  config_data_get_latitude();
 float  config_data_get_longitude();
 float  config_data_get_tz_in_hours();
 
 /**
- *  Convenience to check if the caller-supplied values match our config values.
+ *  Check if the caller-supplied values differ enough from our config values
+ *  to be worth taking up: a different UTC offset, or a move past
+ *  CONFIG_DATA_SIGNIFICANT_SHIFT_SECS or CONFIG_DATA_SIGNIFICANT_KM.
  *  
- *  @param fLat Latitude coord: degrees from equator, positive for North,
- *             negative for South.
- *  @param fLong Longitutde coord: degrees from Greenwich, positive for East
- *             and negative for West.
- *  @param pUtcOffset Offset of local (watch) time from UTC, in seconds.
- *             This is the reverse of the usual tz offset: *pUtcOffset
+ *  @param latitude Latitude coord: degrees from equator times
+ *             CONFIG_DATA_DEGREE_SCALE, positive for North, negative for South.
+ *  @param longitude Longitude coord: degrees from Greenwich times
+ *             CONFIG_DATA_DEGREE_SCALE, positive for East and negative for West.
+ *  @param utcOffset Offset of local (watch) time from UTC, in seconds.
+ *             This is the reverse of the usual tz offset: utcOffset
  *             is added to local time to obtain UTC.
  *  
- *  @return \c true of parameters match our config, else \c false.
+ *  @return \c true if parameters differ significantly from our config (or
+ *          we have none), else \c false.
  */
-bool  config_data_is_different(float latitude, float longitude, int32_t utcOffset);
+bool  config_data_is_different(int32_t latitude, int32_t longitude, int32_t utcOffset);
 
 
 /**
- *  Save supplied location values in our cache and in watch flash.
- *  This is a blocking call and the flash write might take a noticable
- *  amount of time, so design accordingly.
+ *  Save supplied location values in our cache and in watch flash.  The
+ *  cache changes at once.  The flash write is queued as a low priority
+ *  TaskScheduler task if there has been none for
+ *  CONFIG_DATA_MIN_WRITE_INTERVAL_SECS, else held back until then.
  * 
- *  @param fLat Latitude coord: degrees from equator, positive for North,
- *             negative for South.
- *  @param fLong Longitutde coord: degrees from Greenwich, positive for East
- *             and negative for West.
- *  @param pUtcOffset Offset of local (watch) time from UTC, in seconds.
- *             This is the reverse of the usual tz offset: *pUtcOffset
+ *  @param latitude Latitude coord: degrees from equator times
+ *             CONFIG_DATA_DEGREE_SCALE, positive for North, negative for South.
+ *  @param longitude Longitude coord: degrees from Greenwich times
+ *             CONFIG_DATA_DEGREE_SCALE, positive for East and negative for West.
+ *  @param iUtcOffset Offset of local (watch) time from UTC, in seconds.
+ *             This is the reverse of the usual tz offset: iUtcOffset
  *             is added to local time to obtain UTC.
  *  
- *  @return \c true if write went ok, \c false if it failed.
+ *  @return \c true.  (Write failures are only logged.)
  */
-bool  config_data_location_set(float fLat, float fLong, int32_t iUtcOffset);
+bool  config_data_location_set(int32_t latitude, int32_t longitude, int32_t iUtcOffset);
+
+/**
+ *  Replace the upcoming UTC offset changes kept (with the location, so
+ *  saved as config_data_location_set() does).  Changes already past are
+ *  dropped, as are any over CONFIG_DATA_MAX_UTC_OFFSET_CHANGES.
+ *  
+ *  @param aChanges Changes, soonest first.
+ *  @param numChanges Entries in aChanges.
+ */
+void  config_data_set_utc_offset_changes(const ConfigDataUtcOffsetChange aChanges[],
+                                         int numChanges);
+
+/**
+ *  Switch to the UTC offset of any kept change now due.  Call once a
+ *  minute or so.
+ *  
+ *  @return \c true if the UTC offset changed.
+ */
+bool  config_data_apply_utc_offset_changes(void);
 
 
 /**
@@ -90,3 +187,6 @@ bool  config_data_location_set(float fLat, float fLong, int32_t iUtcOffset);
  */
 void  config_data_location_erase(void);
 
+///  Counts of flash writes et al since launch.
+void  config_data_get_stats(ConfigDataStats *pStats);
+
@@ -0,0 +1,129 @@
+/**
+ *  @file
+ *
+ */
+
+#include  "DayRecord.h"
+
+#include  "ConfigData.h"
+#include  "helpers.h"
+#include  "PersistBudget.h"
+#include  "testing.h"
+
+
+///  Version of code's current DayRecord structure layout.
+#define  DAY_RECORD_VERSION   1
+
+///  PebbleOS persist_* key for DayRecord (see PersistBudget.h).
+#define  DAY_RECORD_KEY       PERSIST_KEY_DAY_RECORD
+
+_Static_assert(sizeof(DayRecord) <= PERSIST_BYTES_DAY_RECORD,
+               "DayRecord is over its PersistBudget.h line");
+
+
+///  day_record_load() results since launch.
+static uint16_t usHits = 0;
+static uint16_t usMisses = 0;
+
+
+/**
+ *  Hash the present location config: everything other than the date that
+ *  the day's results depend on.
+ */
+static uint32_t day_record_location_hash(void)
+{
+
+   struct
+   {
+      float    latitude;
+      float    longitude;
+      int32_t  utcOffset;
+   } location;
+
+   memset(&location, 0, sizeof(location));
+   config_data_location_get(&location.latitude, &location.longitude,
+                            &location.utcOffset, NULL);
+
+   return fnv1a32(&location, sizeof(location));
+
+}  /* end of day_record_location_hash */
+
+
+void  day_record_tag(DayRecord *pRecord, const struct tm *pLocalTime)
+{
+   pRecord->usVersion    = DAY_RECORD_VERSION;
+   pRecord->year         = pLocalTime->tm_year;
+   pRecord->yday         = pLocalTime->tm_yday;
+   pRecord->locationHash = day_record_location_hash();
+   pRecord->f24h         = clock_is_24h_style();
+}
+
+
+bool  day_record_is_for(const DayRecord *pRecord, const struct tm *pLocalTime)
+{
+   return (pRecord->usVersion == DAY_RECORD_VERSION) &&
+          (pRecord->year == pLocalTime->tm_year) &&
+          (pRecord->yday == pLocalTime->tm_yday) &&
+          (pRecord->locationHash == day_record_location_hash()) &&
+          (pRecord->f24h == clock_is_24h_style());
+}
+
+
+bool  day_record_load(DayRecord *pRecord, const struct tm *pLocalTime)
+{
+
+   int iRet = persist_read_data(DAY_RECORD_KEY, pRecord, sizeof(*pRecord));
+#if TESTING_DISABLE_DAY_RECORD_READ
+   iRet = 0;
+#endif
+
+   bool fHit = (iRet == (int) sizeof(*pRecord)) &&
+               day_record_is_for(pRecord, pLocalTime);
+
+   if (fHit)
+   {
+      //  (in case of a corrupt record, don't let the texts run off the end.)
+      pRecord->achSunrise[DAY_RECORD_TEXT_BYTES - 1] = '\0';
+      pRecord->achSunset[DAY_RECORD_TEXT_BYTES - 1] = '\0';
+      usHits++;
+   }
+   else
+   {
+      usMisses++;
+   }
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "day record %s (hits %d, misses %d)",
+           fHit ? "hit" : "miss", usHits, usMisses);
+
+   return fHit;
+
+}  /* end of day_record_load */
+
+
+bool  day_record_save(const DayRecord *pRecord)
+{
+
+   //  As in config_data_location_set(), a best effort to remove the old
+   //  value first avoids E_INTERNAL from persist_write_data.
+   persist_delete(DAY_RECORD_KEY);
+
+   int iRet = persist_write_data(DAY_RECORD_KEY, pRecord, sizeof(*pRecord));
+   if (iRet != (int) sizeof(*pRecord))
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "day record write failed, ret = %d", iRet);
+      return false;
+   }
+
+   return true;
+
+}  /* end of day_record_save */
+
+
+void  day_record_get_stats(uint16_t *pHits, uint16_t *pMisses)
+{
+   if (pHits != NULL)
+      *pHits = usHits;
+
+   if (pMisses != NULL)
+      *pMisses = usMisses;
+}
@@ -0,0 +1,96 @@
+/**
+ *  @file
+ *
+ *  Everything the face shows which is worked out once a day: the twilight
+ *  band times, moon phase, and sunrise / sunset text.  Kept in watch flash
+ *  next to the location config, so that relaunching the face on the same
+ *  day at the same location needs no solar math at all.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+///  Most twilight bands a day record holds times for.
+#define  DAY_RECORD_MAX_BANDS   4
+
+///  Room for a formatted sunrise / sunset time, as "00:00" or "12:00".
+#define  DAY_RECORD_TEXT_BYTES  sizeof("00:00")
+
+
+/**
+ *  One day's results, as persisted.  Not valid for any day unless
+ *  day_record_load() says so.
+ */
+typedef struct
+{
+
+   ///  Version of this struct's layout.  Always DAY_RECORD_VERSION now.
+   uint16_t usVersion;
+
+   ///  Local date the record is for: years since 1900, and day of year (0 - 365).
+   int16_t  year;
+   int16_t  yday;
+
+   ///  Hash of the location config the record was computed for.
+   uint32_t locationHash;
+
+   ///  Were the texts formatted for 24 hour time?
+   uint8_t  f24h;
+
+   ///  Moon phase, 0 - 27, already corrected for hemisphere.
+   uint8_t  moonPhase;
+
+   /**
+    *  Dawn and dusk of each band, as minutes of the local day.  A band with
+    *  no dawn / dusk that day holds TWILIGHT_NO_MINUTE (as 0xFFFF).
+    */
+   uint16_t aDawnMinutes[DAY_RECORD_MAX_BANDS];
+   uint16_t aDuskMinutes[DAY_RECORD_MAX_BANDS];
+
+   ///  Sunrise and sunset time, as shown.
+   char     achSunrise[DAY_RECORD_TEXT_BYTES];
+   char     achSunset[DAY_RECORD_TEXT_BYTES];
+
+} __attribute__((__packed__))  DayRecord;
+
+
+/**
+ *  Read the persisted day record, if it is for the given day, the present
+ *  location config, and the present 12 / 24 hour setting.
+ *
+ *  @param pRecord Receives the record.  Undefined if we return \c false.
+ *  @param pLocalTime Local date wanted.
+ *
+ *  @return \c true if *pRecord is good for today, else \c false.
+ */
+bool  day_record_load(DayRecord *pRecord, const struct tm *pLocalTime);
+
+/**
+ *  Tag a freshly computed record with the given day, the present location
+ *  config and 12 / 24 hour setting.
+ *
+ *  @param pRecord Record to tag.
+ *  @param pLocalTime Local date the record was computed for.
+ */
+void  day_record_tag(DayRecord *pRecord, const struct tm *pLocalTime);
+
+/**
+ *  Is a record tagged for the given day, the present location config, and
+ *  the present 12 / 24 hour setting?
+ */
+bool  day_record_is_for(const DayRecord *pRecord, const struct tm *pLocalTime);
+
+/**
+ *  Write a tagged record to flash, in place of the last.  Blocking.
+ *
+ *  @return \c true if written, else \c false.
+ */
+bool  day_record_save(const DayRecord *pRecord);
+
+/**
+ *  Counts of day_record_load() results since launch, to confirm that
+ *  relaunches are served from flash.  Either pointer may be NULL.
+ */
+void  day_record_get_stats(uint16_t *pHits, uint16_t *pMisses);
@@ -0,0 +1,543 @@
+/**
+ *  @file
+ *  
+ */
+
+
+#include  "DialCache.h"
+
+#include  "helpers.h"
+#include  "PersistBudget.h"
+
+
+//  Flash copy of the dial.
+//  
+//  The dial is PackBits run-length encoded, a byte (8 pixels) at a time,
+//  reading the image rows end to end.  The twilight bands are mostly long
+//  runs of black, white, or a dither byte repeated across the row, and the
+//  watchface mask is mostly black, so a typical dial comes out under 2 KB
+//  against 3 KB raw.  That is more than one persist key can hold, so the
+//  compressed bytes are spread over consecutive keys, each filled to the
+//  limit, with a small header in a key of its own.
+
+///  Version of the flash layout, including how the dial itself is drawn.
+///  Bump this whenever a change would make a previously saved dial wrong.
+#define  DIAL_STORE_VERSION       1
+
+///  PebbleOS persist_* key for DialStoreHeader (see PersistBudget.h).
+#define  DIAL_STORE_KEY_HEADER    PERSIST_KEY_DIAL_HEADER
+
+///  Key of the first chunk of compressed dial; the rest follow on.
+#define  DIAL_STORE_KEY_FIRST     PERSIST_KEY_DIAL_FIRST
+
+///  Most chunks we'll spend on a dial, which caps its flash use.
+#define  DIAL_STORE_MAX_CHUNKS    PERSIST_DIAL_MAX_CHUNKS
+
+///  Bytes in each chunk but the last.
+#define  DIAL_STORE_CHUNK_BYTES   PERSIST_DATA_MAX_LENGTH
+
+///  Longest literal or repeat run in one PackBits code.
+#define  PACKBITS_MAX_RUN         128
+
+
+/**
+ *  Describes the compressed dial held in the chunk keys.
+ */
+typedef struct
+{
+   ///  Always DIAL_STORE_VERSION now.
+   uint16_t usVersion;
+
+   ///  Total compressed bytes, over all chunks.
+   uint16_t usBytes;
+
+   ///  Fingerprint the dial was saved with.
+   uint32_t fingerprint;
+
+   ///  Size of the dial in pixels.
+   uint16_t usWidth;
+   uint16_t usHeight;
+
+} __attribute__((__packed__))  DialStoreHeader;
+
+_Static_assert(sizeof(DialStoreHeader) <= PERSIST_BYTES_DIAL_HEADER,
+               "DialStoreHeader is over its PersistBudget.h line");
+
+
+/**
+ *  Where we are in the compressed byte stream, while reading or writing
+ *  it a byte at a time.
+ */
+typedef struct
+{
+   ///  Bytes of the current chunk.
+   uint8_t  aChunk[DIAL_STORE_CHUNK_BYTES];
+
+   ///  Next byte to read / write within aChunk.
+   uint16_t usPos;
+
+   ///  Bytes of aChunk in use: when reading, how much the chunk held.
+   uint16_t usLen;
+
+   ///  Chunks read / written so far.
+   uint16_t usChunks;
+
+   ///  Bytes read / written so far, over all chunks.
+   uint16_t usTotal;
+
+   ///  Cleared on any error, such as running out of chunks.
+   bool     fOk;
+
+} DialStoreStream;
+
+
+///  Read pixel byte i of the dial, counting along the rows end to end.
+static uint8_t dial_byte(const uint8_t *pData, uint16_t stride, uint16_t rowLen, int i)
+{
+   return pData[((i / rowLen) * stride) + (i % rowLen)];
+}
+
+
+///  Append one byte to the compressed stream, writing out chunks as they fill.
+static void dial_store_put(DialStoreStream *pStream, uint8_t b)
+{
+
+   if (pStream->usPos == DIAL_STORE_CHUNK_BYTES)
+   {
+      if ((pStream->usChunks == DIAL_STORE_MAX_CHUNKS) ||
+          (persist_write_data(DIAL_STORE_KEY_FIRST + pStream->usChunks,
+                              pStream->aChunk, DIAL_STORE_CHUNK_BYTES)
+                                 != DIAL_STORE_CHUNK_BYTES))
+      {
+         pStream->fOk = false;
+         return;
+      }
+      pStream->usChunks++;
+      pStream->usPos = 0;
+   }
+
+   pStream->aChunk[pStream->usPos++] = b;
+   pStream->usTotal++;
+
+}  /* end of dial_store_put */
+
+
+///  Fetch the next byte of the compressed stream, reading in chunks as needed.
+static uint8_t dial_store_get(DialStoreStream *pStream)
+{
+
+   if (pStream->usPos == pStream->usLen)
+   {
+      int iRet = 0;
+      if (pStream->usChunks < DIAL_STORE_MAX_CHUNKS)
+      {
+         iRet = persist_read_data(DIAL_STORE_KEY_FIRST + pStream->usChunks,
+                                  pStream->aChunk, DIAL_STORE_CHUNK_BYTES);
+      }
+      if (iRet <= 0)
+      {
+         pStream->fOk = false;
+         return 0;
+      }
+      pStream->usChunks++;
+      pStream->usLen = iRet;
+      pStream->usPos = 0;
+   }
+
+   pStream->usTotal++;
+   return pStream->aChunk[pStream->usPos++];
+
+}  /* end of dial_store_get */
+
+
+///  Remove chunk keys from first onward, so they don't hold on to flash.
+///  (Up to the end of the key range, which older versions used more of.)
+static void dial_store_delete_chunks(int first)
+{
+   for (int key = DIAL_STORE_KEY_FIRST + first; key <= PERSIST_KEY_DIAL_LAST; key++)
+   {
+      persist_delete(key);
+   }
+}
+
+
+DialCache* dial_cache_create(GSize size)
+{
+
+   DialCache * pMyRet = malloc(sizeof(DialCache));
+   if (pMyRet == 0)
+   {
+      return pMyRet;
+   }
+
+   pMyRet->pBmpDial = gbitmap_create_blank(size, GBitmapFormat1Bit);
+   if (pMyRet->pBmpDial == NULL)
+   {
+      free(pMyRet);
+      return NULL;
+   }
+
+   pMyRet->fValid = false;
+   pMyRet->fingerprint = 0;
+   pMyRet->fPersisted = false;
+
+   return pMyRet;
+
+}  /* end of dial_cache_create */
+
+
+void  dial_cache_destroy(DialCache *pDialCache)
+{
+
+   if (pDialCache != 0)
+   {
+      SAFE_DESTROY(gbitmap, pDialCache->pBmpDial);
+
+      free(pDialCache);
+   }
+
+}  /* end of dial_cache_destroy */
+
+
+void  dial_cache_invalidate(DialCache *pDialCache)
+{
+   if (pDialCache != 0)
+   {
+      pDialCache->fValid = false;
+   }
+}
+
+
+void  dial_cache_set_fingerprint(DialCache *pDialCache, uint32_t fingerprint)
+{
+   if ((pDialCache != 0) && (pDialCache->fingerprint != fingerprint))
+   {
+      pDialCache->fingerprint = fingerprint;
+      pDialCache->fValid = false;
+      pDialCache->fPersisted = false;
+   }
+}
+
+
+bool  dial_cache_is_valid(DialCache *pDialCache)
+{
+   return (pDialCache != 0) && pDialCache->fValid;
+}
+
+
+bool  dial_cache_capture(DialCache *pDialCache, GContext *ctx)
+{
+
+   if (pDialCache == 0)
+   {
+      return false;
+   }
+
+   GBitmap *pFrameBuf = graphics_capture_frame_buffer(ctx);
+   if (pFrameBuf == NULL)
+   {
+      return false;
+   }
+
+   //  Rows may be padded differently in the two bitmaps, so copy row by row.
+   uint8_t *pSrc = gbitmap_get_data(pFrameBuf);
+   uint8_t *pDst = gbitmap_get_data(pDialCache->pBmpDial);
+   uint16_t srcRowBytes = gbitmap_get_bytes_per_row(pFrameBuf);
+   uint16_t dstRowBytes = gbitmap_get_bytes_per_row(pDialCache->pBmpDial);
+   uint16_t copyBytes = (srcRowBytes < dstRowBytes) ? srcRowBytes : dstRowBytes;
+
+   GRect srcBounds = gbitmap_get_bounds(pFrameBuf);
+   GRect dstBounds = gbitmap_get_bounds(pDialCache->pBmpDial);
+   int16_t rows = (srcBounds.size.h < dstBounds.size.h) ?
+                     srcBounds.size.h : dstBounds.size.h;
+
+   for (int16_t y = 0; y < rows; y++)
+   {
+      memcpy(pDst + (y * dstRowBytes), pSrc + (y * srcRowBytes), copyBytes);
+   }
+
+   graphics_release_frame_buffer(ctx, pFrameBuf);
+
+   pDialCache->fValid = true;
+
+   return true;
+
+}  /* end of dial_cache_capture */
+
+
+void  dial_cache_draw(DialCache *pDialCache, GContext *ctx, GRect rect)
+{
+
+   if (pDialCache == 0)
+   {
+      return;
+   }
+
+   graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+   graphics_draw_bitmap_in_rect(ctx, pDialCache->pBmpDial, rect);
+
+}  /* end of dial_cache_draw */
+
+
+bool  dial_cache_draw_rect(DialCache *pDialCache, GContext *ctx, GRect rect)
+{
+
+   if (pDialCache == 0)
+   {
+      return false;
+   }
+
+   GBitmap *pFrameBuf = graphics_capture_frame_buffer(ctx);
+   if (pFrameBuf == NULL)
+   {
+      return false;
+   }
+
+   uint8_t *pDst = gbitmap_get_data(pFrameBuf);
+   const uint8_t *pSrc = gbitmap_get_data(pDialCache->pBmpDial);
+   uint16_t dstRowBytes = gbitmap_get_bytes_per_row(pFrameBuf);
+   uint16_t srcRowBytes = gbitmap_get_bytes_per_row(pDialCache->pBmpDial);
+
+   GRect dstBounds = gbitmap_get_bounds(pFrameBuf);
+   GRect srcBounds = gbitmap_get_bounds(pDialCache->pBmpDial);
+   int16_t width  = (srcBounds.size.w < dstBounds.size.w) ? srcBounds.size.w : dstBounds.size.w;
+   int16_t height = (srcBounds.size.h < dstBounds.size.h) ? srcBounds.size.h : dstBounds.size.h;
+
+   int16_t left   = (rect.origin.x < 0) ? 0 : rect.origin.x;
+   int16_t top    = (rect.origin.y < 0) ? 0 : rect.origin.y;
+   int16_t right  = rect.origin.x + rect.size.w;
+   int16_t bottom = rect.origin.y + rect.size.h;
+   if (right > width)
+      right = width;
+   if (bottom > height)
+      bottom = height;
+
+   if ((left < right) && (top < bottom))
+   {
+      int16_t firstByte = left / 8;
+      int16_t copyBytes = ((right + 7) / 8) - firstByte;
+
+      for (int16_t y = top; y < bottom; y++)
+      {
+         memcpy(pDst + (y * dstRowBytes) + firstByte,
+                pSrc + (y * srcRowBytes) + firstByte, copyBytes);
+      }
+   }
+
+   graphics_release_frame_buffer(ctx, pFrameBuf);
+
+   return true;
+
+}  /* end of dial_cache_draw_rect */
+
+
+bool  dial_cache_restore(DialCache *pDialCache)
+{
+
+   if (pDialCache == 0)
+   {
+      return false;
+   }
+
+   if (pDialCache->fValid)
+   {
+      return true;
+   }
+
+   GRect bounds = gbitmap_get_bounds(pDialCache->pBmpDial);
+
+   DialStoreHeader header;
+   int iRet = persist_read_data(DIAL_STORE_KEY_HEADER, &header, sizeof(header));
+   if ((iRet < (int) sizeof(header)) ||
+       (header.usVersion != DIAL_STORE_VERSION) ||
+       (header.fingerprint != pDialCache->fingerprint) ||
+       (header.usWidth != bounds.size.w) || (header.usHeight != bounds.size.h))
+   {
+      //  nothing saved, or not for today / here.
+      return false;
+   }
+
+   DialStoreStream *pStream = malloc(sizeof(DialStoreStream));
+   if (pStream == NULL)
+   {
+      return false;
+   }
+   pStream->usPos = 0;
+   pStream->usLen = 0;
+   pStream->usChunks = 0;
+   pStream->usTotal = 0;
+   pStream->fOk = true;
+
+   uint8_t *pData = gbitmap_get_data(pDialCache->pBmpDial);
+   uint16_t stride = gbitmap_get_bytes_per_row(pDialCache->pBmpDial);
+   uint16_t rowLen = (bounds.size.w + 7) / 8;
+   int total = rowLen * bounds.size.h;
+
+   int i = 0;
+   while ((i < total) && pStream->fOk && (pStream->usTotal < header.usBytes))
+   {
+      uint8_t code = dial_store_get(pStream);
+      int count;
+      bool fRepeat;
+
+      if (code < PACKBITS_MAX_RUN)
+      {
+         count = code + 1;
+         fRepeat = false;
+      }
+      else if (code > PACKBITS_MAX_RUN)
+      {
+         count = 257 - code;
+         fRepeat = true;
+      }
+      else
+      {
+         continue;      // no-op code
+      }
+
+      if (i + count > total)
+      {
+         pStream->fOk = false;
+         break;
+      }
+
+      uint8_t b = fRepeat ? dial_store_get(pStream) : 0;
+      for (int k = 0; k < count; k++, i++)
+      {
+         pData[((i / rowLen) * stride) + (i % rowLen)] = fRepeat ? b : dial_store_get(pStream);
+      }
+   }
+
+   bool fOk = pStream->fOk && (i == total) && (pStream->usTotal == header.usBytes);
+
+   free(pStream);
+
+   if (!fOk)
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "dial in flash unusable");
+      return false;
+   }
+
+   pDialCache->fValid = true;
+   pDialCache->fPersisted = true;
+
+   return true;
+
+}  /* end of dial_cache_restore */
+
+
+bool  dial_cache_save(DialCache *pDialCache)
+{
+
+   if ((pDialCache == 0) || !pDialCache->fValid)
+   {
+      return false;
+   }
+
+   if (pDialCache->fPersisted)
+   {
+      return true;
+   }
+
+   DialStoreStream *pStream = malloc(sizeof(DialStoreStream));
+   if (pStream == NULL)
+   {
+      return false;
+   }
+   pStream->usPos = 0;
+   pStream->usLen = 0;
+   pStream->usChunks = 0;
+   pStream->usTotal = 0;
+   pStream->fOk = true;
+
+   //  Old header goes first, so that a save cut short leaves nothing usable.
+   persist_delete(DIAL_STORE_KEY_HEADER);
+
+   GRect bounds = gbitmap_get_bounds(pDialCache->pBmpDial);
+   const uint8_t *pData = gbitmap_get_data(pDialCache->pBmpDial);
+   uint16_t stride = gbitmap_get_bytes_per_row(pDialCache->pBmpDial);
+   uint16_t rowLen = (bounds.size.w + 7) / 8;
+   int total = rowLen * bounds.size.h;
+
+   int i = 0;
+   while ((i < total) && pStream->fOk)
+   {
+      uint8_t b = dial_byte(pData, stride, rowLen, i);
+
+      int run = 1;
+      while ((i + run < total) && (run < PACKBITS_MAX_RUN) &&
+             (dial_byte(pData, stride, rowLen, i + run) == b))
+      {
+         run++;
+      }
+
+      if (run > 1)
+      {
+         dial_store_put(pStream, 257 - run);
+         dial_store_put(pStream, b);
+         i += run;
+         continue;
+      }
+
+      //  Literal bytes, up to where the next repeat starts.
+      int lit = 1;
+      while ((i + lit < total) && (lit < PACKBITS_MAX_RUN) &&
+             ! ((i + lit + 1 < total) &&
+                (dial_byte(pData, stride, rowLen, i + lit) ==
+                 dial_byte(pData, stride, rowLen, i + lit + 1))))
+      {
+         lit++;
+      }
+
+      dial_store_put(pStream, lit - 1);
+      for (int k = 0; k < lit; k++)
+      {
+         dial_store_put(pStream, dial_byte(pData, stride, rowLen, i + k));
+      }
+      i += lit;
+   }
+
+   //  last, partly filled chunk.
+   if (pStream->fOk && (pStream->usPos > 0))
+   {
+      if (persist_write_data(DIAL_STORE_KEY_FIRST + pStream->usChunks,
+                             pStream->aChunk, pStream->usPos) == pStream->usPos)
+      {
+         pStream->usChunks++;
+      }
+      else
+      {
+         pStream->fOk = false;
+      }
+   }
+
+   bool fOk = pStream->fOk;
+   uint16_t usBytes = pStream->usTotal;
+   int chunks = pStream->usChunks;
+
+   free(pStream);
+
+   if (fOk)
+   {
+      DialStoreHeader header;
+      header.usVersion   = DIAL_STORE_VERSION;
+      header.usBytes     = usBytes;
+      header.fingerprint = pDialCache->fingerprint;
+      header.usWidth     = bounds.size.w;
+      header.usHeight    = bounds.size.h;
+
+      fOk = (persist_write_data(DIAL_STORE_KEY_HEADER, &header, sizeof(header))
+                == (int) sizeof(header));
+   }
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "dial save %s: %d bytes in %d keys",
+           fOk ? "ok" : "failed", (int) usBytes, chunks);
+
+   //  drop chunks from any earlier, bigger dial (or all of them, on failure).
+   dial_store_delete_chunks(fOk ? chunks : 0);
+
+   pDialCache->fPersisted = fOk;
+
+   return fOk;
+
+}  /* end of dial_cache_save */
@@ -0,0 +1,116 @@
+/**
+ *  @file
+ *  
+ *  Retained copy of the fully composited watch "dial" (twilight bands plus
+ *  watchface mask).  The dial only changes when the day's twilight times
+ *  are recomputed, so everything in between can redraw it with one blit.
+ *  
+ *  The dial can also be kept in watch flash, compressed, so that when the
+ *  face is next launched on the same day and at the same location the
+ *  first frame needs no solar math and no band rendering.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+///  Carries the retained dial image and whether it is current.
+typedef struct
+{
+
+   ///  Offscreen copy of the dial, same format as the screen framebuffer.
+   GBitmap* pBmpDial;
+
+   ///  Does pBmpDial hold the dial for the current day / location?
+   bool fValid;
+
+   /**
+    *  Identifies the day / location the dial is for.  Set by the caller via
+    *  dial_cache_set_fingerprint(); the cache itself doesn't know what goes
+    *  into it.
+    */
+   uint32_t fingerprint;
+
+   ///  Does watch flash already hold this same dial?
+   bool fPersisted;
+
+} DialCache;
+
+
+/**
+ *  Allocate a dial cache for a screen of the given size.  The cache starts
+ *  out invalid.
+ *  
+ *  @return New instance, or NULL if there isn't enough heap for it.  All
+ *          other dial_cache_* routines accept a NULL instance, so a caller
+ *          may simply carry on without a cache.
+ */
+DialCache* dial_cache_create(GSize size);
+
+void  dial_cache_destroy(DialCache *pDialCache);
+
+///  Mark the cached dial as stale, so that the next redraw renders it afresh.
+void  dial_cache_invalidate(DialCache *pDialCache);
+
+/**
+ *  Say which day / location the dial should now show.  If that's not what
+ *  the cache holds, the cache is invalidated.
+ * 
+ *  @param fingerprint Caller's hash of everything the dial depends on.
+ */
+void  dial_cache_set_fingerprint(DialCache *pDialCache, uint32_t fingerprint);
+
+///  Does the cache hold a current dial image?
+bool  dial_cache_is_valid(DialCache *pDialCache);
+
+/**
+ *  Copy the dial just rendered into ctx into the cache, and mark it valid.
+ *  Must be called before anything other than the dial has been drawn.
+ * 
+ *  @return \c true if the dial was captured, else \c false.
+ */
+bool  dial_cache_capture(DialCache *pDialCache, GContext *ctx);
+
+/**
+ *  Blit the cached dial into the given context.
+ * 
+ *  @param ctx Graphics context to draw into.  We leave its compositing
+ *             mode set to GCompOpAssign.
+ *  @param rect Rectangle, within ctx, to draw the dial to.
+ */
+void  dial_cache_draw(DialCache *pDialCache, GContext *ctx, GRect rect);
+
+/**
+ *  Restore just part of the dial, from the cache straight into the
+ *  framebuffer.  The area actually restored is widened to whole bytes
+ *  (8 pixel columns).
+ * 
+ *  @param ctx Graphics context to draw into.  Its framebuffer must be
+ *             laid out as the dial was when captured.
+ *  @param rect Part of the dial to restore, in screen coordinates.
+ * 
+ *  @return \c true if restored, \c false if the framebuffer was not
+ *          available, in which case the caller should use
+ *          dial_cache_draw() instead.
+ */
+bool  dial_cache_draw_rect(DialCache *pDialCache, GContext *ctx, GRect rect);
+
+/**
+ *  Load the dial last saved by dial_cache_save(), if it was saved with
+ *  the fingerprint most recently given to dial_cache_set_fingerprint().
+ *  Best called before the first frame is drawn.
+ * 
+ *  @return \c true if the cache now holds a valid dial, else \c false.
+ */
+bool  dial_cache_restore(DialCache *pDialCache);
+
+/**
+ *  Compress the cached dial into watch flash, along with its fingerprint.
+ *  Does nothing if the cache is invalid or flash already holds this dial.
+ *  This is a blocking call which writes several persist keys, so it is
+ *  best left until the face is unloaded.
+ * 
+ *  @return \c true if flash now holds the cached dial, else \c false.
+ */
+bool  dial_cache_save(DialCache *pDialCache);
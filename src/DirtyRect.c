@@ -0,0 +1,66 @@
+/**
+ *  @file
+ *  
+ */
+
+
+#include  "DirtyRect.h"
+
+
+void  dirty_rect_add(DirtyRect *pDirty, GRect rect)
+{
+
+   if ((rect.size.w <= 0) || (rect.size.h <= 0))
+   {
+      return;
+   }
+
+   if (!pDirty->fAny)
+   {
+      pDirty->rect = rect;
+      pDirty->fAny = true;
+      return;
+   }
+
+   int16_t left   = pDirty->rect.origin.x;
+   int16_t top    = pDirty->rect.origin.y;
+   int16_t right  = left + pDirty->rect.size.w;
+   int16_t bottom = top + pDirty->rect.size.h;
+
+   if (rect.origin.x < left)
+      left = rect.origin.x;
+   if (rect.origin.y < top)
+      top = rect.origin.y;
+   if (rect.origin.x + rect.size.w > right)
+      right = rect.origin.x + rect.size.w;
+   if (rect.origin.y + rect.size.h > bottom)
+      bottom = rect.origin.y + rect.size.h;
+
+   pDirty->rect = GRect(left, top, right - left, bottom - top);
+
+}  /* end of dirty_rect_add */
+
+
+void  dirty_rect_add_all(DirtyRect *pDirty)
+{
+   pDirty->fAll = true;
+   pDirty->fAny = true;
+}
+
+
+bool  dirty_rect_take(DirtyRect *pDirty, GRect *pRect)
+{
+
+   bool fPartial = pDirty->fAny && !pDirty->fAll;
+
+   if (fPartial)
+   {
+      *pRect = pDirty->rect;
+   }
+
+   pDirty->fAny = false;
+   pDirty->fAll = false;
+
+   return fPartial;
+
+}  /* end of dirty_rect_take */
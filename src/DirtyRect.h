@@ -0,0 +1,46 @@
+/**
+ *  @file
+ *  
+ *  Tracks which part of the screen has changed since the last redraw, so
+ *  that the redraw can restore just that part of the retained dial.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+///  Area of the screen needing redraw.
+typedef struct
+{
+
+   ///  Union of all areas marked since the last dirty_rect_take().
+   GRect rect;
+
+   ///  Has anything been marked since the last dirty_rect_take()?
+   bool fAny;
+
+   ///  Has the whole screen been marked?
+   bool fAll;
+
+} DirtyRect;
+
+
+///  Mark an area as needing redraw.  Empty rectangles are ignored.
+void  dirty_rect_add(DirtyRect *pDirty, GRect rect);
+
+///  Mark the whole screen as needing redraw.
+void  dirty_rect_add_all(DirtyRect *pDirty);
+
+/**
+ *  Fetch the area needing redraw, and reset to nothing marked.
+ *  
+ *  A redraw with nothing marked wasn't asked for by us, so we can't know
+ *  what it's for: we treat that as the whole screen.
+ * 
+ *  @param pRect Receives the area to redraw, if only part of the screen.
+ * 
+ *  @return \c true if only *pRect need be redrawn, \c false if the whole
+ *          screen must be.
+ */
+bool  dirty_rect_take(DirtyRect *pDirty, GRect *pRect);
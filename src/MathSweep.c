@@ -0,0 +1,605 @@
+/**
+ *  @file
+ *
+ *  There is no libm on the watch, so the references here are our own
+ *  double-precision versions: Taylor series after exact-enough range
+ *  reduction, and Newton iteration for square root.  They are slow, but
+ *  good to far better than float precision over the domains swept, which
+ *  is all we need to grade the float approximations against.
+ */
+
+#include  "MathSweep.h"
+
+#include  "testing.h"
+
+#if TESTING_SWEEP_MY_MATH
+
+#include  "config.h"
+#include  "ConfigData.h"
+#include  "my_math.h"
+#include  "suncalc.h"
+
+
+///  Points per function sweep, evenly spaced over the function's domain.
+#define  SWEEP_POINTS         4001
+
+///  Calls timed per function.  time_ms() only counts whole milliseconds,
+///  so the ns per call figure has a resolution of 1000000 / this.
+#define  SWEEP_TIMING_CALLS   20000
+
+///  Where to compute sunrise for if no location has been received yet (London).
+#define  SWEEP_DEFAULT_LATITUDE    51.5f
+#define  SWEEP_DEFAULT_LONGITUDE   (-0.13f)
+
+///  ULP histogram buckets: [0,1) [1,2) [2,4) [4,16) [16,256) [256,65536) [65536,inf)
+#define  SWEEP_ULP_BUCKETS    7
+static const uint32_t aUlpBucketTops[SWEEP_ULP_BUCKETS - 1] = { 1, 2, 4, 16, 256, 65536 };
+
+///  Absolute error histogram buckets: below 1e-7, 1e-6, 1e-5, 1e-4, 1e-3, and above.
+#define  SWEEP_ABS_BUCKETS    6
+static const double aAbsBucketTops[SWEEP_ABS_BUCKETS - 1] = { 1e-7, 1e-6, 1e-5, 1e-4, 1e-3 };
+
+
+static const double REF_PI = 3.14159265358979323846;
+static const double REF_SQRT3 = 1.73205080756887729353;
+
+
+// ------------------------------------------------
+//  Double-precision reference functions.
+
+///  Round to nearest integer, halves away from zero.
+static double ref_round(double x)
+{
+   return (x < 0) ? -(double) (int32_t) (0.5 - x) : (double) (int32_t) (x + 0.5);
+}
+
+///  sin(x) for |x| <= pi/4: Taylor series, well past double precision.
+static double ref_sin_core(double x)
+{
+   double x2 = x * x;
+   double term = x;
+   double sum = x;
+   for (int n = 1; n <= 10; n++)
+   {
+      term *= -x2 / ((2 * n) * (2 * n + 1));
+      sum += term;
+   }
+   return sum;
+}
+
+///  cos(x) for |x| <= pi/4: Taylor series, well past double precision.
+static double ref_cos_core(double x)
+{
+   double x2 = x * x;
+   double term = 1;
+   double sum = 1;
+   for (int n = 1; n <= 10; n++)
+   {
+      term *= -x2 / ((2 * n - 1) * (2 * n));
+      sum += term;
+   }
+   return sum;
+}
+
+static double ref_sin(double x)
+{
+   double q = ref_round(x / (REF_PI / 2));
+   double t = x - (q * (REF_PI / 2));
+   int quadrant = ((int32_t) q) & 3;    // two's complement: right for negatives too
+
+   switch (quadrant)
+   {
+      case 1:  return ref_cos_core(t);
+      case 2:  return -ref_sin_core(t);
+      case 3:  return -ref_cos_core(t);
+      default: return ref_sin_core(t);
+   }
+}
+
+static double ref_cos(double x)
+{
+   double q = ref_round(x / (REF_PI / 2));
+   double t = x - (q * (REF_PI / 2));
+   int quadrant = ((int32_t) q) & 3;
+
+   switch (quadrant)
+   {
+      case 1:  return -ref_sin_core(t);
+      case 2:  return -ref_cos_core(t);
+      case 3:  return ref_sin_core(t);
+      default: return ref_cos_core(t);
+   }
+}
+
+static double ref_tan(double x)
+{
+   return ref_sin(x) / ref_cos(x);
+}
+
+static double ref_sqrt(double x)
+{
+   if (x <= 0)
+   {
+      return 0;
+   }
+   //  my_sqrt() is already good to a few parts in 10^3, so a handful of
+   //  Newton steps (each doubling the correct bits) reaches double precision.
+   double r = my_sqrt((float) x);
+   if (r <= 0)
+   {
+      r = x;
+   }
+   for (int i = 0; i < 5; i++)
+   {
+      r = 0.5 * (r + (x / r));
+   }
+   return r;
+}
+
+static double ref_atan(double x)
+{
+   bool fNegative = (x < 0);
+   if (fNegative)
+   {
+      x = -x;
+   }
+
+   //  atan(x) = pi/2 - atan(1/x), to get x <= 1...
+   bool fInverted = (x > 1);
+   if (fInverted)
+   {
+      x = 1 / x;
+   }
+
+   //  ...then atan(x) = pi/6 + atan((x*sqrt(3) - 1) / (x + sqrt(3))),
+   //  to get |x| <= tan(pi/12), where the series converges quickly.
+   double base = 0;
+   if (x > 0.26794919243112270)
+   {
+      base = REF_PI / 6;
+      x = ((x * REF_SQRT3) - 1) / (x + REF_SQRT3);
+   }
+
+   double x2 = x * x;
+   double power = x;
+   double sum = x;
+   for (int n = 1; n <= 14; n++)
+   {
+      power *= -x2;
+      sum += power / (2 * n + 1);
+   }
+
+   double r = base + sum;
+   if (fInverted)
+   {
+      r = (REF_PI / 2) - r;
+   }
+   return fNegative ? -r : r;
+}
+
+static double ref_asin(double x)
+{
+   if (x >= 1)
+   {
+      return REF_PI / 2;
+   }
+   if (x <= -1)
+   {
+      return -REF_PI / 2;
+   }
+   return ref_atan(x / ref_sqrt(1 - (x * x)));
+}
+
+static double ref_acos(double x)
+{
+   //  Near +-1, go via the half angle rather than lose bits in 1 - x*x.
+   if (x > 0.5)
+   {
+      return 2 * ref_asin(ref_sqrt((1 - x) / 2));
+   }
+   if (x < -0.5)
+   {
+      return REF_PI - (2 * ref_asin(ref_sqrt((1 + x) / 2)));
+   }
+   return (REF_PI / 2) - ref_asin(x);
+}
+
+
+// ------------------------------------------------
+//  The float approximations, called in double, so that either can be
+//  plugged in to ref_sun_event().
+
+static double flt_sin(double x)  { return my_sin((float) x); }
+static double flt_cos(double x)  { return my_cos((float) x); }
+static double flt_tan(double x)  { return my_tan((float) x); }
+static double flt_atan(double x) { return my_atan((float) x); }
+static double flt_asin(double x) { return my_asin((float) x); }
+static double flt_acos(double x) { return my_acos((float) x); }
+
+
+///  Trig used by the almanac algorithm, indexed so each can be swapped independently.
+typedef enum
+{
+   ALMANAC_SIN,
+   ALMANAC_COS,
+   ALMANAC_TAN,
+   ALMANAC_ATAN,
+   ALMANAC_ASIN,
+   ALMANAC_ACOS,
+   NUM_ALMANAC_KERNELS
+} AlmanacKernel;
+
+typedef double (*AlmanacFunc)(double);
+
+static const AlmanacFunc aRefKernels[NUM_ALMANAC_KERNELS] =
+{
+   ref_sin, ref_cos, ref_tan, ref_atan, ref_asin, ref_acos
+};
+
+static const AlmanacFunc aFloatKernels[NUM_ALMANAC_KERNELS] =
+{
+   flt_sin, flt_cos, flt_tan, flt_atan, flt_asin, flt_acos
+};
+
+static const char * const apszKernelNames[NUM_ALMANAC_KERNELS] =
+{
+   "my_sin", "my_cos", "my_tan", "my_atan", "my_asin", "my_acos"
+};
+
+
+/**
+ *  calcSun()'s almanac algorithm, steps 2 - 9, in double and without the
+ *  ephemeris table, using the supplied trig.
+ *
+ *  @return UTC hour and fraction, or NO_RISE_SET_TIME.
+ */
+static double ref_sun_event(const AlmanacFunc aMath[], int N, double latitude,
+                            double longitude, double zenith, int sunset)
+{
+
+   const double toRad = REF_PI / 180;
+   const double toDeg = 180 / REF_PI;
+
+   double lngHour = longitude / 15;
+   double t = N + (((sunset ? 18 : 6) - lngHour) / 24);
+
+   double M = (0.9856 * t) - 3.289;
+
+   double L = M + (1.916 * aMath[ALMANAC_SIN](toRad * M)) +
+              (0.020 * aMath[ALMANAC_SIN](toRad * 2 * M)) + 282.634;
+   if (L < 0) L += 360;
+   if (L > 360) L -= 360;
+
+   double RA = toDeg * aMath[ALMANAC_ATAN](0.91764 * aMath[ALMANAC_TAN](toRad * L));
+   if (RA < 0) RA += 360;
+   if (RA > 360) RA -= 360;
+
+   double Lquadrant  = ((int32_t) (L / 90)) * 90;
+   double RAquadrant = ((int32_t) (RA / 90)) * 90;
+   RA = (RA + (Lquadrant - RAquadrant)) / 15;
+
+   double sinDec = 0.39782 * aMath[ALMANAC_SIN](toRad * L);
+   double cosDec = aMath[ALMANAC_COS](aMath[ALMANAC_ASIN](sinDec));
+
+   double cosH = (aMath[ALMANAC_COS](toRad * zenith) - (sinDec * aMath[ALMANAC_SIN](toRad * latitude))) /
+                 (cosDec * aMath[ALMANAC_COS](toRad * latitude));
+   if ((cosH > 1) || (cosH < -1))
+   {
+      return NO_RISE_SET_TIME;
+   }
+
+   double H = toDeg * aMath[ALMANAC_ACOS](cosH);
+   if (!sunset)
+   {
+      H = 360 - H;
+   }
+   H = H / 15;
+
+   double T = H + RA - (0.06571 * t) - 6.622;
+
+   double UT = T - lngHour;
+   if (UT < 0) UT += 24;
+   if (UT > 24) UT -= 24;
+
+   return UT;
+
+}  /* end of ref_sun_event */
+
+
+// ------------------------------------------------
+
+
+///  Milliseconds since a time_ms() reading.
+static int32_t elapsed_ms(time_t startSecs, uint16_t startMs)
+{
+   time_t nowSecs;
+   uint16_t nowMs;
+   time_ms(&nowSecs, &nowMs);
+   return ((nowSecs - startSecs) * 1000) + nowMs - startMs;
+}
+
+
+///  Clamp a non-negative error figure into an int for logging.
+static int clamp_to_int(double x)
+{
+   return (x >= 0x7FFFFFFF) ? 0x7FFFFFFF : (int) x;
+}
+
+
+/**
+ *  Spacing of floats at the magnitude of a reference value: the unit in
+ *  the last place which a correctly rounded float result would have.
+ */
+static double float_ulp(double ref)
+{
+   union
+   {
+      float f;
+      uint32_t u;
+   } bits;
+
+   bits.f = (float) ((ref < 0) ? -ref : ref);
+   int32_t exponent = (bits.u >> 23) & 0xFF;
+
+   //  below here floats are denormal, with fixed spacing 2^-149.
+   if (exponent <= 23)
+   {
+      bits.u = 1;
+   }
+   else
+   {
+      bits.u = (uint32_t) (exponent - 23) << 23;
+   }
+
+   return bits.f;
+}
+
+
+///  Stand-in function for timing the loop itself.
+static float identity(float x)
+{
+   return x;
+}
+
+
+///  Nanoseconds per call of a float function over the sweep's points.
+static int32_t time_per_call_ns(float (*pfnFloat)(float), float lo, float hi)
+{
+   volatile float fSink = 0;
+   float step = (hi - lo) / SWEEP_POINTS;
+   float x = lo;
+
+   time_t startSecs;
+   uint16_t startMs;
+   time_ms(&startSecs, &startMs);
+
+   for (int i = 0; i < SWEEP_TIMING_CALLS; i++)
+   {
+      fSink += pfnFloat(x);
+      x += step;
+      if (x > hi)
+      {
+         x = lo;
+      }
+   }
+
+   (void) fSink;
+   return elapsed_ms(startSecs, startMs) * (1000000 / SWEEP_TIMING_CALLS);
+}
+
+
+///  One function to sweep, and the domain it is swept over.
+typedef struct
+{
+   const char *pszName;
+   float (*pfnFloat)(float);
+   double (*pfnRef)(double);
+   float lo;
+   float hi;
+} SweepFunction;
+
+
+/**
+ *  Sweep one function across its domain, and log error and speed.
+ *
+ *  @param overheadNs Loop overhead, from timing identity(), to take off
+ *             the ns per call figure.
+ */
+static void sweep_function(const SweepFunction *pFunc, int32_t overheadNs)
+{
+
+   uint16_t aUlpHist[SWEEP_ULP_BUCKETS] = { 0 };
+   uint16_t aAbsHist[SWEEP_ABS_BUCKETS] = { 0 };
+   double maxAbs = 0;
+   double maxUlp = 0;
+   double sumUlp = 0;
+   float xMaxUlp = pFunc->lo;
+
+   for (int i = 0; i < SWEEP_POINTS; i++)
+   {
+      float x = pFunc->lo + ((pFunc->hi - pFunc->lo) * i) / (SWEEP_POINTS - 1);
+      double ref = pFunc->pfnRef(x);
+      double err = (double) pFunc->pfnFloat(x) - ref;
+      if (err < 0)
+      {
+         err = -err;
+      }
+      double ulps = err / float_ulp(ref);
+
+      if (err > maxAbs)
+      {
+         maxAbs = err;
+      }
+      if (ulps > maxUlp)
+      {
+         maxUlp = ulps;
+         xMaxUlp = x;
+      }
+      sumUlp += ulps;
+
+      unsigned bucket = 0;
+      while ((bucket < SWEEP_ULP_BUCKETS - 1) && (ulps >= aUlpBucketTops[bucket]))
+      {
+         bucket++;
+      }
+      aUlpHist[bucket]++;
+
+      bucket = 0;
+      while ((bucket < SWEEP_ABS_BUCKETS - 1) && (err >= aAbsBucketTops[bucket]))
+      {
+         bucket++;
+      }
+      aAbsHist[bucket]++;
+   }
+
+   int32_t ns = time_per_call_ns(pFunc->pfnFloat, pFunc->lo, pFunc->hi) - overheadNs;
+   if (ns < 0)
+   {
+      ns = 0;    // within timing resolution of the bare loop
+   }
+
+   //  (Pebble's printf has no %f, so errors are logged scaled to integers.)
+   APP_LOG(APP_LOG_LEVEL_INFO,
+           "{\"fn\":\"%s\",\"max_abs_e9\":%d,\"max_ulp\":%d,\"mean_ulp_x100\":%d,"
+           "\"at_x_e6\":%d,\"ns_per_call\":%d}",
+           pFunc->pszName, clamp_to_int(maxAbs * 1e9), clamp_to_int(maxUlp),
+           clamp_to_int((sumUlp * 100) / SWEEP_POINTS), (int) (xMaxUlp * 1e6f), (int) ns);
+
+   APP_LOG(APP_LOG_LEVEL_INFO,
+           "{\"fn\":\"%s\",\"ulp_hist\":[%d,%d,%d,%d,%d,%d,%d],\"abs_hist\":[%d,%d,%d,%d,%d,%d]}",
+           pFunc->pszName,
+           aUlpHist[0], aUlpHist[1], aUlpHist[2], aUlpHist[3],
+           aUlpHist[4], aUlpHist[5], aUlpHist[6],
+           aAbsHist[0], aAbsHist[1], aAbsHist[2], aAbsHist[3], aAbsHist[4], aAbsHist[5]);
+
+}  /* end of sweep_function */
+
+
+///  Signed difference of two UTC times of day, in seconds, across midnight.
+static double event_diff_secs(double a, double b)
+{
+   double diff = a - b;
+   if (diff > 12) diff -= 24;
+   if (diff < -12) diff += 24;
+   return diff * 3600;
+}
+
+
+/**
+ *  Sunrise and sunset over a whole year, against the double almanac, with
+ *  the given trig swapped in.  Logs worst and mean error in milliseconds.
+ *
+ *  @param pszName Name of what is being compared, for the log.
+ *  @param aMath Trig to use, or NULL to use calcSunRise() / calcSunSet()
+ *             themselves (which is also affected by the ephemeris table).
+ */
+static void sweep_sun_events(const char *pszName, const AlmanacFunc aMath[],
+                             float latitude, float longitude)
+{
+
+   double maxErr = 0;
+   double sumErr = 0;
+   int    count = 0;
+   int    mismatched = 0;
+
+   for (int day = 1; day <= 365; day++)
+   {
+      for (int sunset = 0; sunset <= 1; sunset++)
+      {
+         double ref = ref_sun_event(aRefKernels, day, latitude, longitude,
+                                    ZENITH_OFFICIAL, sunset);
+         double test;
+         if (aMath == NULL)
+         {
+            //  Jan 1 + (day - 1) gives the right day of year even past January.
+            test = sunset ?
+                   calcSunSet(2015, 1, day, latitude, longitude, ZENITH_OFFICIAL) :
+                   calcSunRise(2015, 1, day, latitude, longitude, ZENITH_OFFICIAL);
+         }
+         else
+         {
+            test = ref_sun_event(aMath, day, latitude, longitude, ZENITH_OFFICIAL, sunset);
+         }
+
+         if ((ref == NO_RISE_SET_TIME) || (test == NO_RISE_SET_TIME))
+         {
+            if (ref != test)
+            {
+               mismatched++;
+            }
+            continue;
+         }
+
+         double err = event_diff_secs(test, ref);
+         if (err < 0)
+         {
+            err = -err;
+         }
+         if (err > maxErr)
+         {
+            maxErr = err;
+         }
+         sumErr += err;
+         count++;
+      }
+   }
+
+   APP_LOG(APP_LOG_LEVEL_INFO,
+           "{\"sun\":\"%s\",\"events\":%d,\"max_ms\":%d,\"mean_ms\":%d,\"no_rise_set_mismatch\":%d}",
+           pszName, count, clamp_to_int(maxErr * 1000),
+           (count > 0) ? clamp_to_int((sumErr * 1000) / count) : 0, mismatched);
+
+}  /* end of sweep_sun_events */
+
+
+void  math_sweep_run(void)
+{
+
+   float latitude = SWEEP_DEFAULT_LATITUDE;
+   float longitude = SWEEP_DEFAULT_LONGITUDE;
+   config_data_location_get(&latitude, &longitude, NULL, NULL);
+
+   APP_LOG(APP_LOG_LEVEL_INFO,
+           "{\"sweep_config\":{\"points\":%d,\"timing_calls\":%d,\"ephemeris_table\":%d,"
+           "\"lat_x100\":%d,\"lng_x100\":%d}}",
+           SWEEP_POINTS, SWEEP_TIMING_CALLS, !TESTING_DISABLE_EPHEMERIS_TABLE,
+           (int) (latitude * 100), (int) (longitude * 100));
+   APP_LOG(APP_LOG_LEVEL_INFO,
+           "{\"sweep_buckets\":{\"ulp\":[1,2,4,16,256,65536],"
+           "\"abs\":[\"1e-7\",\"1e-6\",\"1e-5\",\"1e-4\",\"1e-3\"]}}");
+
+   //  Domains cover what suncalc and TwilightPath pass in, with margin.
+   static const SweepFunction aFunctions[] =
+   {
+      { "my_sin",  my_sin,  ref_sin,  -4 * 3.14159265f, 4 * 3.14159265f },
+      { "my_cos",  my_cos,  ref_cos,  -4 * 3.14159265f, 4 * 3.14159265f },
+      { "my_tan",  my_tan,  ref_tan,  -1.5f,  1.5f  },
+      { "my_atan", my_atan, ref_atan, -20.0f, 20.0f },
+      { "my_asin", my_asin, ref_asin, -1.0f,  1.0f  },
+      { "my_acos", my_acos, ref_acos, -1.0f,  1.0f  },
+      { "my_sqrt", my_sqrt, ref_sqrt,  0.0f,  4.0f  }
+   };
+
+   int32_t overheadNs = time_per_call_ns(identity, 0, 1);
+
+   for (unsigned i = 0; i < sizeof(aFunctions) / sizeof(aFunctions[0]); i++)
+   {
+      sweep_function(&aFunctions[i], overheadNs);
+   }
+
+   //  Sunrise / sunset error of the real thing, then of the double almanac
+   //  with just one float kernel swapped in at a time, to show which
+   //  kernels the error comes from.
+   sweep_sun_events("calcSun", NULL, latitude, longitude);
+
+   for (int i = 0; i < NUM_ALMANAC_KERNELS; i++)
+   {
+      AlmanacFunc aMath[NUM_ALMANAC_KERNELS];
+      memcpy(aMath, aRefKernels, sizeof(aMath));
+      aMath[i] = aFloatKernels[i];
+      sweep_sun_events(apszKernelNames[i], aMath, latitude, longitude);
+   }
+
+}  /* end of math_sweep_run */
+
+#endif  // TESTING_SWEEP_MY_MATH
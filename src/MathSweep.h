@@ -0,0 +1,21 @@
+/**
+ *  @file
+ *
+ *  Test aid: sweep each of the my_math approximations across its domain,
+ *  compare against double-precision reference versions, and log error
+ *  histograms, speed, and the resulting sunrise error as JSON lines (one
+ *  per function) which can be pulled from "pebble logs".
+ *
+ *  Only built when TESTING_SWEEP_MY_MATH is set in testing.h.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+/**
+ *  Run all sweeps and log their results.  Takes several seconds, so call
+ *  it before the main window is up.
+ */
+void  math_sweep_run(void);
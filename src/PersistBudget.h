@@ -0,0 +1,73 @@
+/**
+ *  @file
+ *
+ *  Every persist_* key the face and the worker use, and the most bytes
+ *  each may hold.  PebbleOS gives an app (face and worker together)
+ *  PERSIST_BUDGET_TOTAL_BYTES, and on aplite a write past that fails, so
+ *  the sum of the maxima below is checked against it here, and each
+ *  module checks its own records against its line.
+ *
+ *  Keys are never reused for something else, as flash from an older
+ *  version may still hold them.  The schedule and dial ranges are wider
+ *  than their caps, as older versions used more of them.
+ */
+
+#pragma once
+
+
+///  Most bytes an app may keep in persist storage.
+#define  PERSIST_BUDGET_TOTAL_BYTES          4096
+
+///  Largest single value (PERSIST_DATA_MAX_LENGTH).
+#define  PERSIST_BUDGET_VALUE_BYTES          256
+
+
+///  ConfigData: the location, UTC offset and offset changes.
+#define  PERSIST_KEY_CONFIG_DATA             1
+#define  PERSIST_BYTES_CONFIG_DATA           48
+
+///  DayRecord: today's twilight times and texts.
+#define  PERSIST_KEY_DAY_RECORD              2
+#define  PERSIST_BYTES_DAY_RECORD            40
+
+///  TwilightSchedule: header, then up to PERSIST_SCHEDULE_MAX_BLOCKS full
+///  blocks in the keys after it (a 90 day, four band schedule takes 4).
+#define  PERSIST_KEY_SCHEDULE_HEADER         3
+#define  PERSIST_KEY_SCHEDULE_FIRST          4
+#define  PERSIST_KEY_SCHEDULE_LAST           15
+#define  PERSIST_SCHEDULE_MAX_BLOCKS         5
+#define  PERSIST_BYTES_SCHEDULE_HEADER       48
+
+///  DialCache: header, then up to PERSIST_DIAL_MAX_CHUNKS full chunks of
+///  compressed dial in the keys after it (a typical dial is under 2 KB).
+#define  PERSIST_KEY_DIAL_HEADER             16
+#define  PERSIST_KEY_DIAL_FIRST              17
+#define  PERSIST_KEY_DIAL_LAST               26
+#define  PERSIST_DIAL_MAX_CHUNKS             9
+#define  PERSIST_BYTES_DIAL_HEADER           16
+
+///  SolarWorker: the face's request to the worker.
+#define  PERSIST_KEY_SOLAR_WORKER_REQUEST    27
+#define  PERSIST_BYTES_SOLAR_WORKER_REQUEST  20
+
+///  RefreshPolicy: query counts and backoff.
+#define  PERSIST_KEY_REFRESH_POLICY          28
+#define  PERSIST_BYTES_REFRESH_POLICY        32
+
+
+#define  PERSIST_BUDGET_USED_BYTES                                            \
+   (PERSIST_BYTES_CONFIG_DATA + PERSIST_BYTES_DAY_RECORD +                    \
+    PERSIST_BYTES_SCHEDULE_HEADER +                                           \
+    (PERSIST_SCHEDULE_MAX_BLOCKS * PERSIST_BUDGET_VALUE_BYTES) +              \
+    PERSIST_BYTES_DIAL_HEADER +                                               \
+    (PERSIST_DIAL_MAX_CHUNKS * PERSIST_BUDGET_VALUE_BYTES) +                  \
+    PERSIST_BYTES_SOLAR_WORKER_REQUEST + PERSIST_BYTES_REFRESH_POLICY)
+
+#if  PERSIST_BUDGET_USED_BYTES > PERSIST_BUDGET_TOTAL_BYTES
+#error  "persist keys can hold more than PebbleOS gives an app"
+#endif
+
+#if  (PERSIST_KEY_SCHEDULE_FIRST + PERSIST_SCHEDULE_MAX_BLOCKS - 1 > PERSIST_KEY_SCHEDULE_LAST) || \
+     (PERSIST_KEY_DIAL_FIRST + PERSIST_DIAL_MAX_CHUNKS - 1 > PERSIST_KEY_DIAL_LAST)
+#error  "more blocks or chunks than keys for them"
+#endif
@@ -0,0 +1,380 @@
+/**
+ *  @file
+ *
+ */
+
+#include  "RefreshPolicy.h"
+
+#include  "ConfigData.h"
+
+
+///  Version of code's current RefreshPolicyState layout.
+#define  REFRESH_POLICY_VERSION  1
+
+
+/**
+ *  All the policy persists, so that backoff and the daily counts carry
+ *  over from launch to launch.  Times are from time(), so UTC.
+ */
+typedef struct
+{
+   ///  Version of this struct.  Always REFRESH_POLICY_VERSION now.
+   uint16_t usVersion;
+
+   ///  Fixes in a row which didn't move us.
+   uint16_t usSameFixes;
+
+   ///  Local day (days since 1970) usQueriesToday counts.
+   int32_t  iDay;
+
+   ///  Queries made on iDay, and on the day before it.
+   uint16_t usQueriesToday;
+   uint16_t usQueriesYesterday;
+
+   ///  Last query made, or 0 for none.
+   time_t   timeLastQuery;
+
+   ///  Last fix received, moved or not, or 0 for none.
+   time_t   timeLastFix;
+
+} __attribute__((__packed__))  RefreshPolicyState;
+
+_Static_assert(sizeof(RefreshPolicyState) <= PERSIST_BYTES_REFRESH_POLICY,
+               "RefreshPolicyState is over its PersistBudget.h line");
+
+
+static RefreshPolicyState state;
+
+///  Write of a change to state held back, or NULL if flash has it all.
+static AppTimer *pWriteTimer = NULL;
+
+static uint16_t usFlashWrites = 0;
+
+///  Has a query been made that hasn't been answered or failed yet?  (One
+///  unanswered for REFRESH_POLICY_RETRY_SECS is taken as lost.)
+static bool fQueryOutstanding = false;
+
+///  time() at the last minute tick, or 0 before the first.
+static time_t timeLastTick = 0;
+
+///  Watch UTC offset (UTC - local, as ConfigData keeps it) last asked about
+///  by refresh_policy_check_utc_offset(), and when.
+static int32_t utcOffsetAsked = 0;
+static time_t  timeUtcOffsetAsked = 0;
+
+
+static void  refresh_policy_write_now(void)
+{
+
+   //  As in config_data_write_now(), a best effort to remove the old value
+   //  first avoids E_INTERNAL from persist_write_data.
+   persist_delete(REFRESH_POLICY_KEY);
+
+   int iRet = persist_write_data(REFRESH_POLICY_KEY, &state, sizeof(state));
+   usFlashWrites++;
+   if (iRet != (int) sizeof(state))
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "refresh policy write failed, ret = %d", iRet);
+   }
+
+}  /* end of refresh_policy_write_now */
+
+
+///  app_timer callback for the held back write.
+static void  refresh_policy_write_timer_callback(void *pData)
+{
+   (void) pData;
+
+   pWriteTimer = NULL;
+   refresh_policy_write_now();
+}
+
+
+///  state has changed: have it written REFRESH_POLICY_WRITE_DELAY_SECS on,
+///  along with any more changes by then.
+static void  refresh_policy_schedule_write(void)
+{
+
+   if (pWriteTimer != NULL)
+   {
+      return;
+   }
+
+   pWriteTimer = app_timer_register(REFRESH_POLICY_WRITE_DELAY_SECS * 1000,
+                                    refresh_policy_write_timer_callback, NULL);
+   if (pWriteTimer == NULL)
+   {
+      refresh_policy_write_now();
+   }
+
+}  /* end of refresh_policy_schedule_write */
+
+
+/**
+ *  Start a new day's count if the local day has changed.
+ *
+ *  @return \c true if it had, and the state needs writing.
+ */
+static bool  refresh_policy_roll_day(time_t now)
+{
+
+   int32_t day = now / SECONDS_PER_DAY;
+   if (day == state.iDay)
+   {
+      return false;
+   }
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "refresh policy: %d queries on day %d",
+           state.usQueriesToday, (int) state.iDay);
+
+   state.usQueriesYesterday = (day == state.iDay + 1) ? state.usQueriesToday : 0;
+   state.usQueriesToday = 0;
+   state.iDay = day;
+
+   return true;
+
+}  /* end of refresh_policy_roll_day */
+
+
+///  Seconds old a location may get before a routine refresh.
+static time_t  refresh_policy_due_age(void)
+{
+   //  (shifted no further than the cap needs, to stay in range.)
+   time_t dueAge = REFRESH_POLICY_MIN_AGE_SECS;
+   for (int i = 0; (i < state.usSameFixes) && (dueAge < REFRESH_POLICY_MAX_AGE_SECS); i++)
+   {
+      dueAge <<= 1;
+   }
+
+   return (dueAge > REFRESH_POLICY_MAX_AGE_SECS) ? REFRESH_POLICY_MAX_AGE_SECS : dueAge;
+}
+
+
+bool  refresh_policy_request(RefreshPolicyReason eReason)
+{
+
+   time_t now = time(NULL);
+
+   if (fQueryOutstanding && (now - state.timeLastQuery < REFRESH_POLICY_RETRY_SECS))
+   {
+      return true;
+   }
+
+   if (eReason == REFRESH_POLICY_NO_LOCATION)
+   {
+      //  Not counted against the day's, so nothing to persist.  (Asked for
+      //  again by the face after a failure, or REFRESH_POLICY_RETRY_SECS.)
+      fQueryOutstanding = true;
+      state.timeLastQuery = now;
+      app_msg_RequestLatLong();
+      return true;
+   }
+
+   bool fWrite = refresh_policy_roll_day(now);
+
+   //  A new UTC offset or a clock jump may mean we've just flown somewhere,
+   //  so it needn't wait out a recent routine query; but it does count
+   //  towards the day's.
+   bool fAllowed = true;
+   if ((eReason == REFRESH_POLICY_AGE) && (state.timeLastQuery != 0) &&
+       (now - state.timeLastQuery < REFRESH_POLICY_RETRY_SECS))
+   {
+      fAllowed = false;
+   }
+   else if ((eReason != REFRESH_POLICY_NO_LOCATION) &&
+            (state.usQueriesToday >= REFRESH_POLICY_MAX_PER_DAY))
+   {
+      fAllowed = false;
+   }
+
+   if (!fAllowed)
+   {
+      if (fWrite)
+      {
+         refresh_policy_schedule_write();
+      }
+      return false;
+   }
+
+   fQueryOutstanding = true;
+   app_msg_RequestLatLong();
+
+   state.usQueriesToday++;
+   state.timeLastQuery = now;
+   refresh_policy_schedule_write();
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "refresh policy: query for reason %d, %d today",
+           (int) eReason, state.usQueriesToday);
+
+   return true;
+
+}  /* end of refresh_policy_request */
+
+
+/**
+ *  In SDK3 time() is UTC, so a change of time zone doesn't move it: it
+ *  shows only in the offset of local time.  Compare that with the offset
+ *  that came with our location.
+ *
+ *  @return \c true if they differ.
+ */
+static bool  refresh_policy_check_utc_offset(const struct tm *pLocalTime, time_t now)
+{
+
+   int32_t watchUtcOffset = -pLocalTime->tm_gmtoff;
+   int32_t ourUtcOffset = 0;
+   config_data_location_get(NULL, NULL, &ourUtcOffset, NULL);
+
+   if (watchUtcOffset == ourUtcOffset)
+   {
+      return false;
+   }
+
+   //  Once for each new offset, and again after REFRESH_POLICY_RETRY_SECS
+   //  should the answer not resolve it.
+   if ((timeUtcOffsetAsked == 0) || (watchUtcOffset != utcOffsetAsked) ||
+       (now - timeUtcOffsetAsked >= REFRESH_POLICY_RETRY_SECS))
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "refresh policy: UTC offset %d, ours %d",
+              (int) watchUtcOffset, (int) ourUtcOffset);
+      if (refresh_policy_request(REFRESH_POLICY_UTC_OFFSET))
+      {
+         utcOffsetAsked = watchUtcOffset;
+         timeUtcOffsetAsked = now;
+      }
+   }
+
+   return true;
+
+}  /* end of refresh_policy_check_utc_offset */
+
+
+void  refresh_policy_minute_tick(const struct tm *pLocalTime)
+{
+
+   time_t now = time(NULL);
+   time_t sinceLastTick = now - timeLastTick;
+   bool fFirstTick = (timeLastTick == 0);
+   timeLastTick = now;
+
+   if (fFirstTick || !config_data_location_avail())
+   {
+      //  The first tick comes from window load, before the event loop may
+      //  be running; and with no location, the face asks by itself.
+      return;
+   }
+
+   //  (A DST change the phone told us of in advance has been applied to
+   //  ConfigData by now, so matches.)
+   if (refresh_policy_check_utc_offset(pLocalTime, now))
+   {
+      return;
+   }
+
+   //  The clock itself being set, by hand or by a time sync from a phone
+   //  whose clock was wrong.
+   if ((sinceLastTick <= 60 - REFRESH_POLICY_CLOCK_JUMP_SECS) ||
+       (sinceLastTick >= 60 + REFRESH_POLICY_CLOCK_JUMP_SECS))
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "refresh policy: clock jumped %d s",
+              (int) (sinceLastTick - 60));
+      refresh_policy_request(REFRESH_POLICY_CLOCK_JUMP);
+      return;
+   }
+
+   if ((REFRESH_POLICY_HOURS & REFRESH_POLICY_HOUR(pLocalTime->tm_hour)) == 0)
+   {
+      return;
+   }
+
+   time_t timeLastUpdate = 0;
+   config_data_location_get(NULL, NULL, NULL, &timeLastUpdate);
+   time_t timeLatest = (state.timeLastFix > timeLastUpdate) ? state.timeLastFix :
+                                                                timeLastUpdate;
+
+   if (now - timeLatest >= refresh_policy_due_age())
+   {
+      refresh_policy_request(REFRESH_POLICY_AGE);
+   }
+
+}  /* end of refresh_policy_minute_tick */
+
+
+void  refresh_policy_fix_received(bool fMoved)
+{
+
+   fQueryOutstanding = false;
+
+   //  Where we keep being told the same thing, ask less often.
+   state.usSameFixes = fMoved ? 0 : (state.usSameFixes + 1);
+   state.timeLastFix = time(NULL);
+   refresh_policy_roll_day(state.timeLastFix);
+   refresh_policy_schedule_write();
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "refresh policy: fix %s, next due at %d s old",
+           fMoved ? "moved" : "same", (int) refresh_policy_due_age());
+
+}  /* end of refresh_policy_fix_received */
+
+
+void  refresh_policy_query_failed(FailureSource eErrSrc, int32_t errCode)
+{
+
+   if ((eErrSrc == FAIL_SRC_APP_MSG) && (errCode == APP_MSG_NOT_CONNECTED))
+   {
+      //  messaging holds the query until the phone is back.
+      return;
+   }
+
+   //  Tried again no sooner than REFRESH_POLICY_RETRY_SECS after it was made.
+   fQueryOutstanding = false;
+
+}  /* end of refresh_policy_query_failed */
+
+
+void  refresh_policy_init(void)
+{
+
+   pWriteTimer = NULL;
+   usFlashWrites = 0;
+   fQueryOutstanding = false;
+   timeLastTick = 0;
+   utcOffsetAsked = 0;
+   timeUtcOffsetAsked = 0;
+
+   memset(&state, 0, sizeof(state));
+   int iRet = persist_read_data(REFRESH_POLICY_KEY, &state, sizeof(state));
+
+   if ((iRet != (int) sizeof(state)) || (state.usVersion != REFRESH_POLICY_VERSION))
+   {
+      //  none yet, or an old layout: start afresh.
+      memset(&state, 0, sizeof(state));
+      state.usVersion = REFRESH_POLICY_VERSION;
+   }
+
+}  /* end of refresh_policy_init */
+
+
+void  refresh_policy_deinit(void)
+{
+
+   if (pWriteTimer != NULL)
+   {
+      app_timer_cancel(pWriteTimer);
+      pWriteTimer = NULL;
+      refresh_policy_write_now();
+   }
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "refresh policy: %d queries today, %d yesterday, %d same fixes, %d writes",
+           state.usQueriesToday, state.usQueriesYesterday, state.usSameFixes, usFlashWrites);
+
+}  /* end of refresh_policy_deinit */
+
+
+void  refresh_policy_get_stats(RefreshPolicyStats *pStats)
+{
+   pStats->usQueriesToday     = state.usQueriesToday;
+   pStats->usQueriesYesterday = state.usQueriesYesterday;
+   pStats->usSameFixes        = state.usSameFixes;
+   pStats->usFlashWrites      = usFlashWrites;
+}
@@ -0,0 +1,144 @@
+/**
+ *  @file
+ *
+ *  When to ask the phone for a fresh location fix.  Once a location is
+ *  persisted it still needs refreshing now and then, or after travel the
+ *  bands stay wrong.  But each query wakes the phone's radio and GPS, so
+ *  asking at every launch would be wasteful for a user who mostly stays put.
+ *
+ *  A routine refresh is due once the location is REFRESH_POLICY_MIN_AGE_SECS
+ *  old.  That doubles for each fix in a row which didn't move us, up to
+ *  REFRESH_POLICY_MAX_AGE_SECS.  Routine refreshes are only made in the
+ *  hours of REFRESH_POLICY_HOURS, when the user is likely about and the
+ *  phone awake.  A change of time zone, seen as the watch's UTC offset no
+ *  longer matching ConfigData's, or a jump of the watch clock, asks at once.
+ *  Either way, there are at most REFRESH_POLICY_MAX_PER_DAY queries a day,
+ *  and they are counted.  With no location at all, queries are neither
+ *  limited nor counted.
+ *
+ *  The counts and backoff are kept in RAM, and written to flash
+ *  REFRESH_POLICY_WRITE_DELAY_SECS after they first change (so one write
+ *  covers a query and its fix), or at refresh_policy_deinit().
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+#include  "messaging.h"
+#include  "PersistBudget.h"
+
+
+///  PebbleOS persist_* key for the policy's state (see PersistBudget.h).
+#define  REFRESH_POLICY_KEY               PERSIST_KEY_REFRESH_POLICY
+
+///  Age of the location at which a routine refresh is first due.
+#define  REFRESH_POLICY_MIN_AGE_SECS      (6 * 60 * 60)
+
+///  Longest the due age backs off to, after many fixes in a row that didn't
+///  move us.
+#define  REFRESH_POLICY_MAX_AGE_SECS      (4 * 24 * 60 * 60)
+
+///  Least time between routine queries, and how long after a failed (or
+///  unanswered) query we ask again.
+#define  REFRESH_POLICY_RETRY_SECS        (60 * 60)
+
+///  Most queries a (local) day, except with no location at all.
+#define  REFRESH_POLICY_MAX_PER_DAY       6
+
+///  Bit for hour (0 - 23) of the local day in REFRESH_POLICY_HOURS.
+#define  REFRESH_POLICY_HOUR(hour)        (1UL << (hour))
+
+///  Hours of the day in which routine refreshes may be made: morning,
+///  midday and evening.
+#define  REFRESH_POLICY_HOURS                                         \
+   (REFRESH_POLICY_HOUR(6)  | REFRESH_POLICY_HOUR(7)  | REFRESH_POLICY_HOUR(8)  | \
+    REFRESH_POLICY_HOUR(12) | REFRESH_POLICY_HOUR(13) |                            \
+    REFRESH_POLICY_HOUR(17) | REFRESH_POLICY_HOUR(18) | REFRESH_POLICY_HOUR(19))
+
+/**
+ *  A change of the watch clock between minute ticks of at least this much
+ *  is taken as it being set anew.  (The phone's ordinary time syncs are
+ *  seconds.)
+ */
+#define  REFRESH_POLICY_CLOCK_JUMP_SECS   (15 * 60)
+
+///  How long a change to the policy's state is held in RAM before it is
+///  written, so that later changes go in the same write.
+#define  REFRESH_POLICY_WRITE_DELAY_SECS  (10 * 60)
+
+
+///  Why a query is made.
+typedef enum
+{
+   ///  No location persisted: the face can't show anything without one.
+   REFRESH_POLICY_NO_LOCATION,
+
+   ///  The location is old enough for a routine refresh.
+   REFRESH_POLICY_AGE,
+
+   ///  The watch clock jumped, so we may have been somewhere else.
+   REFRESH_POLICY_CLOCK_JUMP,
+
+   ///  The watch's UTC offset no longer matches ours: the phone changed
+   ///  time zone.
+   REFRESH_POLICY_UTC_OFFSET,
+
+} RefreshPolicyReason;
+
+
+///  Query counts, from refresh_policy_get_stats().
+typedef struct
+{
+   ///  Queries made today and yesterday (local days).
+   uint16_t usQueriesToday;
+   uint16_t usQueriesYesterday;
+
+   ///  Fixes in a row which didn't move us.
+   uint16_t usSameFixes;
+
+   ///  Writes of the state to flash since refresh_policy_init().
+   uint16_t usFlashWrites;
+
+} RefreshPolicyStats;
+
+
+///  Read the policy's state from flash.  After config_data_init(), and
+///  before any refresh_policy_minute_tick().
+void  refresh_policy_init(void);
+
+///  Write any change held back, and log the query counts.  At program exit.
+void  refresh_policy_deinit(void);
+
+/**
+ *  Ask the phone for a fix now, if the policy allows it for this reason.
+ *
+ *  @param eReason Why.  REFRESH_POLICY_NO_LOCATION is always allowed, but
+ *             still only sends one query while one is outstanding.  It
+ *             isn't counted, so has nothing to write to flash.
+ *
+ *  @return \c true if a query was made (or is outstanding).
+ */
+bool  refresh_policy_request(RefreshPolicyReason eReason);
+
+/**
+ *  Check whether a refresh is due, and ask for one if so.  Call from each
+ *  minute tick.  Does nothing until there is a location to refresh.
+ *
+ *  @param pLocalTime Local time now.
+ */
+void  refresh_policy_minute_tick(const struct tm *pLocalTime);
+
+/**
+ *  A fix came from the phone.
+ *
+ *  @param fMoved \c true if it differed enough from the location we had to
+ *             be taken up (config_data_is_different()).
+ */
+void  refresh_policy_fix_received(bool fMoved);
+
+///  A query failed, as reported to the app_msg_coords_failed_callback.
+void  refresh_policy_query_failed(FailureSource eErrSrc, int32_t errCode);
+
+///  Query counts.
+void  refresh_policy_get_stats(RefreshPolicyStats *pStats);
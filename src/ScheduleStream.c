@@ -0,0 +1,493 @@
+/**
+ *  @file
+ *
+ */
+
+#include  "ScheduleStream.h"
+
+#include  "ConfigData.h"
+#include  "messaging.h"
+#include  "my_math.h"
+#include  "SolarWorker.h"
+#include  "suncalc.h"
+#include  "testing.h"
+#include  "TwilightSchedule.h"
+
+
+#if  APP_MSG_DEGREE_SCALE != CONFIG_DATA_DEGREE_SCALE
+#error  "schedule requests send ConfigData's scaled location as it is"
+#endif
+
+
+#if TESTING_LOG_SCHEDULE_STREAM_COST
+///  Days of local math timed at the end of a stream, to estimate what the
+///  whole schedule would have cost the watch.
+#define  SCHEDULE_STREAM_SAMPLE_DAYS  10
+#endif
+
+
+///  State of a stream under way.
+typedef struct
+{
+
+   ///  As sent, but for usFirstDay, which is set on each (re)send.
+   AppMsgScheduleRequest request;
+
+   ///  What schedule_stream_refresh() was given, for the fallback.
+   float    aZeniths[TWILIGHT_SCHEDULE_MAX_BANDS];
+   struct tm localTime;
+
+   ///  Has the schedule build begun?  Not until the worker has confirmed
+   ///  its hold, as it may be writing the same keys till then.
+   bool     fBegun;
+
+   ///  Fires if the chunks stop coming, or the worker doesn't confirm.
+   AppTimer *pStallTimer;
+
+   ///  Times we've asked again.
+   uint8_t  numResumes;
+
+   ///  Chunks taken, and chunks dropped as repeats or out of order.
+   uint16_t usChunks;
+   uint16_t usRepeats;
+
+   ///  When the stream started.
+   time_t   startSecs;
+   uint16_t startMs;
+
+   ///  Watch time spent storing chunks.
+   uint32_t ulWatchMs;
+
+} ScheduleStream;
+
+
+///  Stream under way, or NULL.
+static ScheduleStream *pStream = NULL;
+
+///  An ack the outbox didn't take, waiting to be sent again.  Kept apart
+///  from the stream, as the last ack may be after it has ended.
+static AppTimer *pAckTimer = NULL;
+static uint16_t usAckDay;
+static uint8_t  numAckRetries;
+
+
+///  Milliseconds since a time_ms() reading.
+static uint32_t schedule_stream_ms_since(time_t startSecs, uint16_t startMs)
+{
+   time_t   nowSecs;
+   uint16_t nowMs;
+   time_ms(&nowSecs, &nowMs);
+
+   return ((nowSecs - startSecs) * 1000) + nowMs - startMs;
+}
+
+
+///  Zenith angle in 1 / 1000 degrees, rounded.
+static int32_t schedule_stream_scale_zenith(float zenith)
+{
+   return (int32_t) my_rint(zenith * 1000);
+}
+
+
+#if TESTING_LOG_SCHEDULE_STREAM_COST
+/**
+ *  Time SCHEDULE_STREAM_SAMPLE_DAYS of local math, for the log.
+ *
+ *  @return Estimated ms to work out usDays days on the watch.
+ */
+static uint32_t schedule_stream_local_estimate_ms(uint16_t usDays)
+{
+
+   ScheduleStream *pS = pStream;
+   int numBands = pS->request.numBands;
+   float aRise[SCHEDULE_STREAM_SAMPLE_DAYS * TWILIGHT_SCHEDULE_MAX_BANDS];
+   float aSet[SCHEDULE_STREAM_SAMPLE_DAYS * TWILIGHT_SCHEDULE_MAX_BANDS];
+
+   time_t   startSecs;
+   uint16_t startMs;
+   time_ms(&startSecs, &startMs);
+
+   if (!calcSunRiseSetDays(pS->localTime.tm_year + 1900,
+                           calcDayOfYear(pS->localTime.tm_year + 1900,
+                                         pS->localTime.tm_mon + 1, pS->localTime.tm_mday),
+                           SCHEDULE_STREAM_SAMPLE_DAYS,
+                           config_data_get_latitude(), config_data_get_longitude(),
+                           pS->aZeniths, numBands, aRise, aSet))
+   {
+      //  (no estimate: more bands than the solver takes.)
+      return 0;
+   }
+
+   return (schedule_stream_ms_since(startSecs, startMs) * usDays) /
+          SCHEDULE_STREAM_SAMPLE_DAYS;
+
+}  /* end of schedule_stream_local_estimate_ms */
+#endif
+
+
+static void schedule_stream_ack_callback(void *pData);
+
+
+///  Ack the chunks so far, asking for usNextDay on.
+static void schedule_stream_ack(uint16_t usNextDay)
+{
+
+   if (pAckTimer != NULL)
+   {
+      //  (a newer ack replaces one still waiting.)
+      app_timer_cancel(pAckTimer);
+      pAckTimer = NULL;
+   }
+
+   usAckDay = usNextDay;
+   numAckRetries = 0;
+
+   if (!app_msg_ack_schedule(usAckDay))
+   {
+      //  most likely the outbox is still busy with the last one.
+      pAckTimer = app_timer_register(SCHEDULE_STREAM_ACK_RETRY_MS,
+                                     schedule_stream_ack_callback, NULL);
+   }
+
+}  /* end of schedule_stream_ack */
+
+
+///  Try an ack the outbox didn't take again.
+static void schedule_stream_ack_callback(void *pData)
+{
+   (void) pData;
+
+   pAckTimer = NULL;
+
+   if (app_msg_ack_schedule(usAckDay))
+   {
+      return;
+   }
+
+   if (++numAckRetries < SCHEDULE_STREAM_ACK_MAX_RETRIES)
+   {
+      pAckTimer = app_timer_register(SCHEDULE_STREAM_ACK_RETRY_MS,
+                                     schedule_stream_ack_callback, NULL);
+   }
+   else
+   {
+      //  (the phone stops sending, and the stall timer asks again.)
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "stream: ack of day %d not sent", usAckDay);
+   }
+
+}  /* end of schedule_stream_ack_callback */
+
+
+/**
+ *  End the stream under way.  The days received are kept either way.
+ *
+ *  @param fFallBack \c true to have the schedule topped up by other means
+ *             if the stream didn't cover it.
+ */
+static void schedule_stream_stop(bool fFallBack)
+{
+
+   ScheduleStream *pS = pStream;
+
+   if (pS->pStallTimer != NULL)
+   {
+      app_timer_cancel(pS->pStallTimer);
+      pS->pStallTimer = NULL;
+   }
+
+   int numDays = 0;
+
+   if (pS->fBegun)
+   {
+      numDays = twilight_schedule_stream_days();
+
+      uint32_t ulTransferMs = schedule_stream_ms_since(pS->startSecs, pS->startMs);
+
+      APP_LOG(APP_LOG_LEVEL_DEBUG,
+              "stream: %d of %d days, %d chunks (%d repeats, %d resumes), %d ms transfer, "
+              "%d ms watch time",
+              numDays, pS->request.usDays, pS->usChunks, pS->usRepeats, pS->numResumes,
+              (int) ulTransferMs, (int) pS->ulWatchMs);
+
+#if TESTING_LOG_SCHEDULE_STREAM_COST
+      if ((numDays > 0) && fFallBack)
+      {
+         APP_LOG(APP_LOG_LEVEL_DEBUG, "stream: local math would be about %d ms",
+                 (int) schedule_stream_local_estimate_ms(numDays));
+      }
+#endif
+
+      twilight_schedule_stream_end(true);
+   }
+
+   solar_worker_hold(false);
+
+   if (fFallBack && (numDays < pS->request.usDays))
+   {
+      //  (does nothing if the days that came are enough for now.)
+      solar_worker_refresh(pS->aZeniths, pS->request.numBands, &pS->localTime);
+   }
+
+   free(pS);
+   pStream = NULL;
+
+}  /* end of schedule_stream_stop */
+
+
+static void schedule_stream_stall_callback(void *pData);
+
+
+///  (Re)start the stall timer.
+static void schedule_stream_arm(void)
+{
+
+   if (pStream->pStallTimer != NULL)
+   {
+      app_timer_reschedule(pStream->pStallTimer, SCHEDULE_STREAM_STALL_MS);
+   }
+   else
+   {
+      pStream->pStallTimer = app_timer_register(SCHEDULE_STREAM_STALL_MS,
+                                                schedule_stream_stall_callback, NULL);
+   }
+
+}  /* end of schedule_stream_arm */
+
+
+///  Ask the phone for the days from the first we don't have yet.
+static void schedule_stream_ask(void)
+{
+
+   pStream->request.usFirstDay = twilight_schedule_stream_days();
+
+   if (!app_msg_request_schedule(&pStream->request))
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "stream: request from day %d not sent",
+              pStream->request.usFirstDay);
+   }
+
+   //  (if not sent, the stall timer has us try again.)
+   schedule_stream_arm();
+
+}  /* end of schedule_stream_ask */
+
+
+///  No chunk for a while.
+static void schedule_stream_stall_callback(void *pData)
+{
+   (void) pData;
+
+   pStream->pStallTimer = NULL;
+
+   if (!pStream->fBegun)
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "stream: worker didn't confirm its hold");
+      schedule_stream_stop(true);
+      return;
+   }
+
+   bool fConnected = connection_service_peek_pebble_app_connection();
+   if ((schedule_stream_ms_since(pStream->startSecs, pStream->startMs) / 1000 >=
+           SCHEDULE_STREAM_MAX_SECS) ||
+       (fConnected && (pStream->numResumes >= SCHEDULE_STREAM_MAX_RESUMES)))
+   {
+      schedule_stream_stop(true);
+   }
+   else if (fConnected)
+   {
+      pStream->numResumes++;
+      schedule_stream_ask();
+   }
+   else
+   {
+      //  wait for the phone to come back.
+      schedule_stream_arm();
+   }
+
+}  /* end of schedule_stream_stall_callback */
+
+
+///  A chunk from the phone.
+static void schedule_stream_chunk_callback(const AppMsgScheduleChunk *pChunk)
+{
+
+   if ((pStream == NULL) || !pStream->fBegun)
+   {
+      //  (a late repeat after we finished.)
+      return;
+   }
+
+   if ((pChunk->numBands != pStream->request.numBands) ||
+       (pChunk->usTotalDays != pStream->request.usDays))
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "stream: chunk for another request");
+      return;
+   }
+
+   time_t   startSecs;
+   uint16_t startMs;
+   time_ms(&startSecs, &startMs);
+
+   int nextDay = twilight_schedule_stream_days();
+   if (pChunk->usFirstDay != nextDay)
+   {
+      //  Repeat, or one after a lost chunk: either way the phone goes
+      //  back to nextDay when it sees this.
+      pStream->usRepeats++;
+      schedule_stream_ack(nextDay);
+      schedule_stream_arm();
+      return;
+   }
+
+   bool fOk = true;
+   for (int day = 0; fOk && (day < pChunk->numDays); day++)
+   {
+      int16_t aDawnMinutes[TWILIGHT_SCHEDULE_MAX_BANDS];
+      int16_t aDuskMinutes[TWILIGHT_SCHEDULE_MAX_BANDS];
+
+      for (int i = 0; i < pChunk->numBands; i++)
+      {
+         aDawnMinutes[i] = app_msg_schedule_chunk_minute(pChunk, day, i);
+         aDuskMinutes[i] = app_msg_schedule_chunk_minute(pChunk, day, pChunk->numBands + i);
+      }
+
+      //  (fails once the schedule is full, or on a flash write error.)
+      fOk = twilight_schedule_stream_add_day(aDawnMinutes, aDuskMinutes);
+   }
+
+   pStream->usChunks++;
+   nextDay = twilight_schedule_stream_days();
+   schedule_stream_ack(nextDay);
+
+   pStream->ulWatchMs += schedule_stream_ms_since(startSecs, startMs);
+
+   if (!fOk || (nextDay >= pStream->request.usDays))
+   {
+      schedule_stream_stop(true);
+   }
+   else
+   {
+      schedule_stream_arm();
+   }
+
+}  /* end of schedule_stream_chunk_callback */
+
+
+///  Begin the build, now the schedule keys are ours, and ask the phone.
+static void schedule_stream_begin(void)
+{
+
+   if (!twilight_schedule_stream_begin(pStream->request.numBands, &pStream->localTime))
+   {
+      schedule_stream_stop(true);
+      return;
+   }
+
+   pStream->fBegun = true;
+   schedule_stream_ask();
+
+}  /* end of schedule_stream_begin */
+
+
+///  SolarWorker callback: the worker has stopped, and holds off.
+static void schedule_stream_held_callback(void)
+{
+
+   if ((pStream == NULL) || pStream->fBegun)
+   {
+      return;
+   }
+
+   if (pStream->pStallTimer != NULL)
+   {
+      app_timer_cancel(pStream->pStallTimer);
+      pStream->pStallTimer = NULL;
+   }
+
+   schedule_stream_begin();
+
+}  /* end of schedule_stream_held_callback */
+
+
+void  schedule_stream_refresh(const float aZeniths[], int numBands,
+                              const struct tm *pLocalTime)
+{
+
+   if ((pStream != NULL) || (numBands > TWILIGHT_SCHEDULE_MAX_BANDS) ||
+       twilight_schedule_is_current(numBands, pLocalTime))
+   {
+      return;
+   }
+
+   bool fStream = connection_service_peek_pebble_app_connection();
+#if TESTING_DISABLE_SCHEDULE_STREAM
+   fStream = false;
+#endif
+
+   if (fStream)
+   {
+      pStream = malloc(sizeof(ScheduleStream));
+   }
+   if (pStream == NULL)
+   {
+      solar_worker_refresh(aZeniths, numBands, pLocalTime);
+      return;
+   }
+   memset(pStream, 0, sizeof(*pStream));
+
+   AppMsgScheduleRequest *pR = &pStream->request;
+   pR->numBands  = numBands;
+   pR->usDays    = TWILIGHT_SCHEDULE_DAYS;
+   pR->usYear    = pLocalTime->tm_year + 1900;
+   pR->month     = pLocalTime->tm_mon + 1;
+   pR->mday      = pLocalTime->tm_mday;
+   //  The location as ConfigData keeps it, in the same units as we send.
+   config_data_location_get_scaled(&pR->latitude, &pR->longitude, NULL);
+   for (int i = 0; i < numBands; i++)
+   {
+      pR->aZeniths[i] = schedule_stream_scale_zenith(aZeniths[i]);
+   }
+
+   memcpy(pStream->aZeniths, aZeniths, numBands * sizeof(aZeniths[0]));
+   pStream->localTime = *pLocalTime;
+   time_ms(&pStream->startSecs, &pStream->startMs);
+
+   //  The worker would otherwise build the schedule too, in the same keys,
+   //  so nothing is written until it confirms that it has stopped.  (The
+   //  stall timer gives up on it if it doesn't.)
+   if (solar_worker_hold(true))
+   {
+      schedule_stream_arm();
+      return;
+   }
+
+   schedule_stream_begin();
+
+}  /* end of schedule_stream_refresh */
+
+
+void  schedule_stream_init(void)
+{
+   app_msg_set_schedule_callback(schedule_stream_chunk_callback);
+   solar_worker_set_held_callback(schedule_stream_held_callback);
+}
+
+
+void  schedule_stream_deinit(void)
+{
+
+   app_msg_set_schedule_callback(NULL);
+   solar_worker_set_held_callback(NULL);
+
+   if (pAckTimer != NULL)
+   {
+      app_timer_cancel(pAckTimer);
+      pAckTimer = NULL;
+   }
+
+   if (pStream != NULL)
+   {
+      schedule_stream_stop(false);
+   }
+
+}  /* end of schedule_stream_deinit */
@@ -0,0 +1,58 @@
+/**
+ *  @file
+ *
+ *  Twilight schedule (TwilightSchedule.h) from the phone.  The phone has
+ *  a real FPU, so it works out the days ahead and streams them to us a
+ *  few at a time (see MSG_KEY_SCHEDULE_CHUNK in messaging.h), and the
+ *  watch just stores them.  The worker, which writes the same keys, is
+ *  held off first (solar_worker_hold()), and nothing is written until it
+ *  confirms; if it doesn't within SCHEDULE_STREAM_STALL_MS, the refresh is
+ *  left to it after all.
+ *
+ *  Each chunk is acked with the next day wanted; an ack the outbox won't
+ *  take is sent again every SCHEDULE_STREAM_ACK_RETRY_MS, up to
+ *  SCHEDULE_STREAM_ACK_MAX_RETRIES times.  If the chunks stop
+ *  coming, we ask again from there, up to SCHEDULE_STREAM_MAX_RESUMES
+ *  times, waiting out a dropped connection.  Failing all that, whatever
+ *  came is kept, and the rest is left to the worker or local math, as
+ *  solar_worker_refresh() does.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+///  Ask again if no chunk comes for this long.
+#define  SCHEDULE_STREAM_STALL_MS        (10 * 1000)
+
+///  Times we ask again from where we got to before giving up.
+#define  SCHEDULE_STREAM_MAX_RESUMES     3
+
+///  Wait before sending an ack again when the outbox won't take it, in
+///  ms, and the most times we do.
+#define  SCHEDULE_STREAM_ACK_RETRY_MS    250
+#define  SCHEDULE_STREAM_ACK_MAX_RETRIES 8
+
+///  Give up on a stream this long after it started, connected or not.
+///  Well within the worker's SOLAR_WORKER_HOLD_MAX_SECS.
+#define  SCHEDULE_STREAM_MAX_SECS        (2 * 60)
+
+
+///  Start listening for chunks.  After app_msg_init().
+void  schedule_stream_init(void);
+
+///  Stop listening.  A stream under way keeps the days it has.
+void  schedule_stream_deinit(void);
+
+/**
+ *  Have the schedule refreshed as twilight_schedule_refresh() would: from
+ *  the phone if it is there, else as solar_worker_refresh() does.  Returns
+ *  right away.  Does nothing while a stream is under way.
+ *
+ *  @param aZeniths Zenith angle of each band, in degrees.
+ *  @param numBands Entries in aZeniths.  At most TWILIGHT_SCHEDULE_MAX_BANDS.
+ *  @param pLocalTime Local date of the first day to schedule (today).
+ */
+void  schedule_stream_refresh(const float aZeniths[], int numBands,
+                              const struct tm *pLocalTime);
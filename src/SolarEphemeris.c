@@ -0,0 +1,47 @@
+/**
+ *  @file
+ *  
+ */
+
+#include  "SolarEphemeris.h"
+
+#include  "testing.h"
+
+
+bool  solar_ephemeris_lookup(int32_t t, int32_t *pSinDec, int32_t *pCosDec,
+                             int32_t *pEqnTime)
+{
+
+#if TESTING_DISABLE_EPHEMERIS_TABLE
+   return false;
+#endif
+
+   int32_t day = t >> 16;
+   int32_t frac = t & 0xFFFF;
+
+   if ((day < 0) || (day + 1 >= SOLAR_EPHEMERIS_NUM_DAYS))
+   {
+      //  outside the table, caller needs to do the math.
+      return false;
+   }
+
+   //  read just the two records we interpolate between.
+   SolarEphemerisRecord aRecs[2];
+   if (!solar_ephemeris_read(day, aRecs))
+   {
+      return false;
+   }
+
+   *pSinDec = aRecs[0].sSinDec +
+              (((aRecs[1].sSinDec - aRecs[0].sSinDec) * frac) >> 16);
+
+   *pCosDec = aRecs[0].usCosDec +
+              (((aRecs[1].usCosDec - aRecs[0].usCosDec) * frac) >> 16);
+
+   //  equation of time value wraps at midnight, so interpolate the short way around.
+   int32_t eqnDelta = (int16_t) (aRecs[1].usEqnTime - aRecs[0].usEqnTime);
+   *pEqnTime = (aRecs[0].usEqnTime + ((eqnDelta * frac) >> 16)) & (TRIG_MAX_ANGLE - 1);
+
+   return true;
+
+}  /* end of solar_ephemeris_lookup */
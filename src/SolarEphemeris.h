@@ -0,0 +1,60 @@
+/**
+ *  @file
+ *  
+ *  Precomputed per-day solar ephemeris, read on demand from a raw resource.
+ *  
+ *  The almanac algorithm in suncalc.c derives the sun's declination and
+ *  right ascension from the day of year alone, so tools/gen_ephemeris.py
+ *  tabulates them once per day and we interpolate between records.  This
+ *  leaves only the hour angle acos() to be computed on the watch.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+///  Number of records in the table: one per whole day-of-year time, 0 - 368.
+#define  SOLAR_EPHEMERIS_NUM_DAYS   369
+
+///  One table record.  See tools/gen_ephemeris.py.
+typedef struct
+{
+   int16_t  sSinDec;
+   uint16_t usCosDec;
+   uint16_t usEqnTime;
+
+} __attribute__((__packed__))  SolarEphemerisRecord;
+
+/**
+ *  Read two consecutive records of the table.  The face reads them from
+ *  its resource (SolarEphemerisResource.c), the worker from its own copy
+ *  (worker_src/WorkerEphemeris.c).
+ *  
+ *  @param day First record to read, 0 to SOLAR_EPHEMERIS_NUM_DAYS - 2.
+ *  @param aRecs Receives records day and day + 1.
+ *  
+ *  @return \c true if both were read.
+ */
+bool  solar_ephemeris_read(int32_t day, SolarEphemerisRecord aRecs[2]);
+
+/**
+ *  Look up the sun's position at the given time.
+ *  
+ *  Only the two records bracketing the requested time are read;
+ *  nothing is kept in the heap.
+ *  
+ *  @param t Day of year plus fraction, scaled by 0x10000.
+ *  @param pSinDec Receives sine of sun's declination, scaled by 0x10000.
+ *  @param pCosDec Receives cosine of sun's declination, scaled by 0x10000.
+ *  @param pEqnTime Receives the sun's right ascension less the almanac's
+ *             local mean time correction (RA - 0.06571 * t - 6.622 hours),
+ *             as a fraction of a day in PebbleOS trig units.  Adding the
+ *             hour angle to this gives local mean time of the event.
+ *  
+ *  @return \c true if the table covers t and was read ok, else \c false,
+ *          in which case the caller should fall back to computing the
+ *          values itself.
+ */
+bool  solar_ephemeris_lookup(int32_t t, int32_t *pSinDec, int32_t *pCosDec,
+                             int32_t *pEqnTime);
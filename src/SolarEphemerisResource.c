@@ -0,0 +1,22 @@
+/**
+ *  @file
+ *  
+ *  The face's solar ephemeris records, read from the SOLAR_EPHEMERIS
+ *  resource.
+ */
+
+#include  "SolarEphemeris.h"
+
+
+bool  solar_ephemeris_read(int32_t day, SolarEphemerisRecord aRecs[2])
+{
+
+   size_t bytesRead;
+
+   bytesRead = resource_load_byte_range(resource_get_handle(RESOURCE_ID_SOLAR_EPHEMERIS),
+                                        day * sizeof(SolarEphemerisRecord),
+                                        (uint8_t *) aRecs, 2 * sizeof(SolarEphemerisRecord));
+
+   return (bytesRead == 2 * sizeof(SolarEphemerisRecord));
+
+}  /* end of solar_ephemeris_read */
@@ -0,0 +1,166 @@
+/**
+ *  @file
+ *  
+ *  Face side of SolarWorker.h.  The worker side is in worker_src/.
+ */
+
+#include  "SolarWorker.h"
+
+#include  "ConfigData.h"
+
+
+///  Has app_worker_launch() been tried since launch?  Once is enough: when
+///  another app's worker is running it asks the user, and we'd rather not
+///  nag.
+static bool fLaunchTried = false;
+
+///  Did the worker start (or was it running)?
+static bool fWorkerUp = false;
+
+///  Told of SOLAR_WORKER_MSG_HELD, or NULL.
+static SolarWorkerHeldCallback heldCallback = NULL;
+
+
+///  Message from our worker.
+static void solar_worker_message_handler(uint16_t type, AppWorkerMessage *pData)
+{
+
+   if (type == SOLAR_WORKER_MSG_HELD)
+   {
+      if (heldCallback != NULL)
+      {
+         (*heldCallback)();
+      }
+      return;
+   }
+
+   if (type != SOLAR_WORKER_MSG_SCHEDULE_READY)
+   {
+      return;
+   }
+
+   twilight_schedule_reload();
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG,
+           "worker schedule: %d days, %d ms worker time, %d bytes shared state",
+           pData->data0, pData->data1,
+           (int) (pData->data2 + sizeof(SolarWorkerRequest)));
+
+}  /* end of solar_worker_message_handler */
+
+
+void  solar_worker_init(void)
+{
+   app_worker_message_subscribe(solar_worker_message_handler);
+}
+
+
+void  solar_worker_set_held_callback(SolarWorkerHeldCallback callback)
+{
+   heldCallback = callback;
+}
+
+
+void  solar_worker_deinit(void)
+{
+   app_worker_message_unsubscribe();
+}
+
+
+_Static_assert(sizeof(SolarWorkerRequest) <= PERSIST_BYTES_SOLAR_WORKER_REQUEST,
+               "SolarWorkerRequest is over its PersistBudget.h line");
+
+
+///  Persist the request for the worker, unless it is already there.
+static void solar_worker_write_request(const float aZeniths[], int numBands)
+{
+
+   SolarWorkerRequest request, current;
+
+   memset(&request, 0, sizeof(request));
+   request.usVersion = SOLAR_WORKER_REQUEST_VERSION;
+   request.usBands   = numBands;
+   memcpy(request.aZeniths, aZeniths, numBands * sizeof(aZeniths[0]));
+
+   if ((persist_read_data(SOLAR_WORKER_KEY_REQUEST, &current, sizeof(current))
+           == (int) sizeof(current)) &&
+       (memcmp(&current, &request, sizeof(request)) == 0))
+   {
+      return;
+   }
+
+   //  As in config_data_location_set(), a best effort to remove the old
+   //  value first avoids E_INTERNAL from persist_write_data.
+   persist_delete(SOLAR_WORKER_KEY_REQUEST);
+   persist_write_data(SOLAR_WORKER_KEY_REQUEST, &request, sizeof(request));
+
+}  /* end of solar_worker_write_request */
+
+
+void  solar_worker_refresh(const float aZeniths[], int numBands,
+                           const struct tm *pLocalTime)
+{
+
+   if (numBands > TWILIGHT_SCHEDULE_MAX_BANDS)
+   {
+      return;
+   }
+
+   solar_worker_write_request(aZeniths, numBands);
+
+   //  The worker reads the location from flash, where a change may be
+   //  held back for up to CONFIG_DATA_MIN_WRITE_INTERVAL_SECS.
+   config_data_flush();
+
+   if (!fLaunchTried)
+   {
+      fLaunchTried = true;
+
+      AppWorkerResult result = app_worker_launch();
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "worker launch result %d", (int) result);
+
+      //  (If the user is being asked, the worker reads the request when
+      //  it starts.  Building here as well would race it for the keys.)
+      fWorkerUp = (result == APP_WORKER_RESULT_SUCCESS) ||
+                  (result == APP_WORKER_RESULT_ALREADY_RUNNING) ||
+                  (result == APP_WORKER_RESULT_ASKING_CONFIRMATION);
+   }
+
+   if (fWorkerUp && app_worker_is_running())
+   {
+      AppWorkerMessage message;
+      memset(&message, 0, sizeof(message));
+      app_worker_send_message(SOLAR_WORKER_MSG_REFRESH, &message);
+      return;
+   }
+
+   if (!fWorkerUp)
+   {
+      twilight_schedule_refresh(aZeniths, numBands, pLocalTime);
+   }
+
+}  /* end of solar_worker_refresh */
+
+
+bool  solar_worker_hold(bool fHold)
+{
+
+   if (!app_worker_is_running())
+   {
+      return false;
+   }
+
+   if (!fHold)
+   {
+      //  It carries on with the location in flash: see solar_worker_refresh().
+      config_data_flush();
+   }
+
+   AppWorkerMessage message;
+   memset(&message, 0, sizeof(message));
+   message.data0 = fHold;
+   app_worker_send_message(SOLAR_WORKER_MSG_HOLD, &message);
+
+   return true;
+
+}  /* end of solar_worker_hold */
@@ -0,0 +1,107 @@
+/**
+ *  @file
+ *  
+ *  Hand-off between the watchface and its background worker (worker_src/),
+ *  which keeps the twilight schedule (TwilightSchedule.h) topped up in idle
+ *  time, so that the face finds each day's times ready in flash.
+ *  
+ *  The face leaves the band zeniths in SOLAR_WORKER_KEY_REQUEST and sends
+ *  SOLAR_WORKER_MSG_REFRESH.  The worker also checks by itself once a day,
+ *  face running or not.  The location comes from ConfigData's flash copy,
+ *  which the face flushes (config_data_flush()) before each message.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+#include  "PersistBudget.h"
+#include  "TwilightSchedule.h"
+
+
+///  PebbleOS persist_* key for SolarWorkerRequest (see PersistBudget.h).
+#define  SOLAR_WORKER_KEY_REQUEST         PERSIST_KEY_SOLAR_WORKER_REQUEST
+
+///  Version of code's current SolarWorkerRequest layout.
+#define  SOLAR_WORKER_REQUEST_VERSION     1
+
+///  Face to worker: check the schedule against SolarWorkerRequest now.
+#define  SOLAR_WORKER_MSG_REFRESH         1
+
+/**
+ *  Worker to face: a new schedule is in flash.  data0 is its days, data1
+ *  the worker's time spent building it in ms (at most 0xFFFF), and data2
+ *  its flash bytes.
+ */
+#define  SOLAR_WORKER_MSG_SCHEDULE_READY  2
+
+/**
+ *  Face to worker: data0 non-zero to leave the schedule alone (the face is
+ *  writing one from the phone), zero to carry on.  A hold lapses by itself
+ *  after SOLAR_WORKER_HOLD_MAX_SECS, in case the face goes away.
+ */
+#define  SOLAR_WORKER_MSG_HOLD            3
+
+/**
+ *  Worker to face: a SOLAR_WORKER_MSG_HOLD is in place, and any build of
+ *  the worker's own dropped, so the face may write the schedule keys.
+ */
+#define  SOLAR_WORKER_MSG_HELD            4
+
+///  Longest a SOLAR_WORKER_MSG_HOLD lasts.
+#define  SOLAR_WORKER_HOLD_MAX_SECS       (5 * 60)
+
+
+///  What the worker is to schedule, as persisted by the face.
+typedef struct
+{
+
+   ///  Always SOLAR_WORKER_REQUEST_VERSION now.
+   uint16_t usVersion;
+
+   ///  Entries used in aZeniths.
+   uint16_t usBands;
+
+   ///  Zenith angle of each band, in degrees.
+   float    aZeniths[TWILIGHT_SCHEDULE_MAX_BANDS];
+
+} __attribute__((__packed__))  SolarWorkerRequest;
+
+
+///  Called when the worker confirms a hold (SOLAR_WORKER_MSG_HELD).
+typedef void (*SolarWorkerHeldCallback)(void);
+
+
+/**
+ *  Start listening for the worker.  Face only.
+ */
+void  solar_worker_init(void);
+
+///  Have callback called when the worker confirms a hold.  NULL for none.
+void  solar_worker_set_held_callback(SolarWorkerHeldCallback callback);
+
+///  Stop listening for the worker.  The worker itself keeps running.
+void  solar_worker_deinit(void);
+
+/**
+ *  Have the schedule refreshed as twilight_schedule_refresh() would, by the
+ *  worker if it can be had, else by the face itself.  Face only.
+ *  
+ *  @param aZeniths Zenith angle of each band, in degrees.
+ *  @param numBands Entries in aZeniths.  At most TWILIGHT_SCHEDULE_MAX_BANDS.
+ *  @param pLocalTime Local date of the first day to schedule (today).
+ */
+void  solar_worker_refresh(const float aZeniths[], int numBands,
+                           const struct tm *pLocalTime);
+
+/**
+ *  Keep the worker away from the schedule while the face builds one
+ *  itself, or let it carry on.  Any build of its own under way is dropped.
+ *  The message is only sent here: the worker confirms a hold with
+ *  SOLAR_WORKER_MSG_HELD, and the schedule keys aren't the face's until
+ *  then.  Face only.
+ *
+ *  @return \c true if the worker is running, so a hold is to be confirmed,
+ *          else \c false (there's nothing to wait for).
+ */
+bool  solar_worker_hold(bool fHold);
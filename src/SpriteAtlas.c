@@ -0,0 +1,311 @@
+/**
+ *  @file
+ *
+ */
+
+
+#include  "SpriteAtlas.h"
+
+#include  "helpers.h"
+
+
+//  Resource layout: see tools/gen_hour_atlas.py.
+
+///  Bytes before the sprite offset table.
+#define  SPRITE_ATLAS_HEADER_BYTES   2
+
+///  Bytes before the first run code of a sprite: left, top, rows.
+#define  SPRITE_HEADER_BYTES         3
+
+///  Kinds of run, from the top two bits of each run code.
+#define  SPRITE_RUN_TRANSPARENT      0
+#define  SPRITE_RUN_BLACK            1
+#define  SPRITE_RUN_WHITE            2
+#define  SPRITE_RUN_END_ROW          3
+
+
+/**
+ *  Read one sprite from the resource, in place of any already loaded.
+ *  On failure pAtlas->pSprite is left NULL, and the image simply isn't
+ *  drawn.
+ * 
+ *  @param spriteIndex Which stored sprite, 0 to pAtlas->numSprites - 1.
+ */
+static void sprite_atlas_load(SpriteAtlas *pAtlas, int spriteIndex)
+{
+
+   if (pAtlas->pSprite != NULL)
+   {
+      free(pAtlas->pSprite);
+      pAtlas->pSprite = NULL;
+   }
+
+   uint16_t aOffsets[2];
+   if (resource_load_byte_range(pAtlas->hResource,
+                                SPRITE_ATLAS_HEADER_BYTES + (spriteIndex * sizeof(uint16_t)),
+                                (uint8_t *) aOffsets, sizeof(aOffsets)) != sizeof(aOffsets))
+   {
+      return;
+   }
+
+   uint16_t usBytes = aOffsets[1] - aOffsets[0];
+   if (usBytes < SPRITE_HEADER_BYTES)
+   {
+      return;
+   }
+
+   pAtlas->pSprite = malloc(usBytes);
+   if (pAtlas->pSprite == NULL)
+   {
+      return;
+   }
+
+   if (resource_load_byte_range(pAtlas->hResource, aOffsets[0],
+                                pAtlas->pSprite, usBytes) != usBytes)
+   {
+      free(pAtlas->pSprite);
+      pAtlas->pSprite = NULL;
+      return;
+   }
+
+   pAtlas->usSpriteBytes = usBytes;
+
+   //  Rows are only as long as their last opaque run, so find the widest.
+   const uint8_t *pRun = pAtlas->pSprite + SPRITE_HEADER_BYTES;
+   const uint8_t *pEnd = pAtlas->pSprite + usBytes;
+   int16_t width = 0;
+   int16_t x = 0;
+   while (pRun < pEnd)
+   {
+      uint8_t code = *pRun++;
+      if ((code >> 6) == SPRITE_RUN_END_ROW)
+      {
+         x = 0;
+         continue;
+      }
+      x += (code & 0x3F) + 1;
+      if (x > width)
+      {
+         width = x;
+      }
+   }
+
+   pAtlas->spriteRect = GRect((int8_t) pAtlas->pSprite[0], (int8_t) pAtlas->pSprite[1],
+                              width, pAtlas->pSprite[2]);
+
+}  /* end of sprite_atlas_load */
+
+
+/**
+ *  Screen position of a sprite pixel, turned clockwise by a number of
+ *  quarter turns about the pivot.
+ *
+ *  @param x Pixel column, relative to the pivot.
+ *  @param y Pixel row, relative to the pivot.
+ */
+static GPoint sprite_atlas_place(GPoint pivot, int quarterTurns, int16_t x, int16_t y)
+{
+   switch (quarterTurns)
+   {
+      case 1:
+         return GPoint(pivot.x - y - 1, pivot.y + x);
+      case 2:
+         return GPoint(pivot.x - x - 1, pivot.y - y - 1);
+      case 3:
+         return GPoint(pivot.x + y, pivot.y - x - 1);
+      default:
+         return GPoint(pivot.x + x, pivot.y + y);
+   }
+}
+
+
+/**
+ *  Layer update handler: draw the current sprite's black and white runs
+ *  as lines, leaving transparent runs untouched.
+ */
+static void sprite_atlas_update_proc(Layer *me, GContext *ctx)
+{
+
+   SpriteAtlas *pAtlas = *(SpriteAtlas **) layer_get_data(me);
+   if (pAtlas->pSprite == NULL)
+   {
+      return;
+   }
+
+   int quarterTurns = pAtlas->angleIndex / pAtlas->numSprites;
+
+   const uint8_t *pRun = pAtlas->pSprite;
+   const uint8_t *pEnd = pAtlas->pSprite + pAtlas->usSpriteBytes;
+
+   int16_t left = (int8_t) pRun[0];
+   int16_t y    = (int8_t) pRun[1];
+   int     rows = pRun[2];
+   pRun += SPRITE_HEADER_BYTES;
+
+   for (int row = 0; row < rows; row++, y++)
+   {
+      int16_t x = left;
+
+      while (pRun < pEnd)
+      {
+         uint8_t code = *pRun++;
+         int kind = code >> 6;
+         int16_t len = (code & 0x3F) + 1;
+
+         if (kind == SPRITE_RUN_END_ROW)
+         {
+            break;
+         }
+
+         if (kind != SPRITE_RUN_TRANSPARENT)
+         {
+            graphics_context_set_stroke_color(ctx, (kind == SPRITE_RUN_WHITE) ?
+                                                   GColorWhite : GColorBlack);
+            graphics_draw_line(ctx,
+                               sprite_atlas_place(pAtlas->pivot, quarterTurns, x, y),
+                               sprite_atlas_place(pAtlas->pivot, quarterTurns, x + len - 1, y));
+         }
+
+         x += len;
+      }
+   }
+
+}  /* end of sprite_atlas_update_proc */
+
+
+SpriteAtlas* sprite_atlas_create(uint32_t resourceId, GRect frame)
+{
+
+   SpriteAtlas * pMyRet = malloc(sizeof(SpriteAtlas));
+   if (pMyRet == 0)
+   {
+      return pMyRet;
+   }
+
+   pMyRet->hResource = resource_get_handle(resourceId);
+   pMyRet->pSprite = NULL;
+   pMyRet->usSpriteBytes = 0;
+   pMyRet->spriteRect = GRect(0, 0, 0, 0);
+   pMyRet->angleIndex = -1;      // nothing loaded yet
+   pMyRet->pivot = grect_center_point(&frame);
+   pMyRet->pLayer = NULL;
+
+   uint8_t aHeader[SPRITE_ATLAS_HEADER_BYTES];
+   if ((resource_load_byte_range(pMyRet->hResource, 0, aHeader, sizeof(aHeader))
+           != sizeof(aHeader)) ||
+       (aHeader[1] == 0) || (aHeader[0] != 4 * aHeader[1]))
+   {
+      sprite_atlas_destroy(pMyRet);
+      return 0;
+   }
+   pMyRet->numAngles = aHeader[0];
+   pMyRet->numSprites = aHeader[1];
+
+   pMyRet->pLayer = layer_create_with_data(frame, sizeof(SpriteAtlas *));
+   if (pMyRet->pLayer == NULL)
+   {
+      sprite_atlas_destroy(pMyRet);
+      return 0;
+   }
+   *(SpriteAtlas **) layer_get_data(pMyRet->pLayer) = pMyRet;
+   layer_set_update_proc(pMyRet->pLayer, sprite_atlas_update_proc);
+
+   return pMyRet;
+
+}  /* end of sprite_atlas_create */
+
+
+void  sprite_atlas_add_to_layer(SpriteAtlas *pAtlas, Layer *parent)
+{
+   layer_add_child(parent, pAtlas->pLayer);
+}
+
+
+void  sprite_atlas_set_pivot(SpriteAtlas *pAtlas, GPoint pivot)
+{
+   if (!gpoint_equal(&pAtlas->pivot, &pivot))
+   {
+      pAtlas->pivot = pivot;
+      layer_mark_dirty(pAtlas->pLayer);
+   }
+}
+
+
+bool  sprite_atlas_set_angle(SpriteAtlas *pAtlas, int32_t angle)
+{
+
+   angle &= (TRIG_MAX_ANGLE - 1);
+
+   int angleIndex = ((angle * pAtlas->numAngles) + (TRIG_MAX_ANGLE / 2)) / TRIG_MAX_ANGLE;
+   if (angleIndex >= pAtlas->numAngles)
+   {
+      angleIndex = 0;
+   }
+
+   if (angleIndex == pAtlas->angleIndex)
+   {
+      return false;
+   }
+
+   //  only the sprite index within the quarter turn matters for loading.
+   if ((pAtlas->angleIndex < 0) || (pAtlas->pSprite == NULL) ||
+       ((angleIndex % pAtlas->numSprites) != (pAtlas->angleIndex % pAtlas->numSprites)))
+   {
+      sprite_atlas_load(pAtlas, angleIndex % pAtlas->numSprites);
+   }
+
+   pAtlas->angleIndex = angleIndex;
+   layer_mark_dirty(pAtlas->pLayer);
+
+   return true;
+
+}  /* end of sprite_atlas_set_angle */
+
+
+GRect  sprite_atlas_get_bounds(SpriteAtlas *pAtlas)
+{
+
+   if ((pAtlas->pSprite == NULL) || (pAtlas->spriteRect.size.w == 0))
+   {
+      return GRect(0, 0, 0, 0);
+   }
+
+   //  Turn the two corner pixels, then put them back in order.
+   int quarterTurns = pAtlas->angleIndex / pAtlas->numSprites;
+   GRect r = pAtlas->spriteRect;
+
+   GPoint p0 = sprite_atlas_place(pAtlas->pivot, quarterTurns,
+                                  r.origin.x, r.origin.y);
+   GPoint p1 = sprite_atlas_place(pAtlas->pivot, quarterTurns,
+                                  r.origin.x + r.size.w - 1, r.origin.y + r.size.h - 1);
+
+   int16_t left   = (p0.x < p1.x) ? p0.x : p1.x;
+   int16_t top    = (p0.y < p1.y) ? p0.y : p1.y;
+   int16_t right  = (p0.x < p1.x) ? p1.x : p0.x;
+   int16_t bottom = (p0.y < p1.y) ? p1.y : p0.y;
+
+   return GRect(left, top, right - left + 1, bottom - top + 1);
+
+}  /* end of sprite_atlas_get_bounds */
+
+
+void  sprite_atlas_destroy(SpriteAtlas *pAtlas)
+{
+
+   if (pAtlas == 0)
+      return;
+
+   if (pAtlas->pLayer != NULL)
+   {
+      layer_remove_from_parent(pAtlas->pLayer);
+   }
+   SAFE_DESTROY(layer, pAtlas->pLayer);
+
+   if (pAtlas->pSprite != NULL)
+   {
+      free(pAtlas->pSprite);
+   }
+
+   free(pAtlas);
+
+}  /* end of sprite_atlas_destroy */
@@ -0,0 +1,89 @@
+/**
+ *  @file
+ *
+ *  Draws an image at any angle from a resource of pre-rotated sprites,
+ *  as built by tools/gen_hour_atlas.py.  This replaces rotating a
+ *  "png-trans" image with a pair of RotBitmapLayers: no rotation is done
+ *  on the watch, and there's only one layer to draw.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+///  Carries all data needed to draw a sprite atlas resource.
+typedef struct
+{
+
+   ///  Resource holding the atlas.
+   ResHandle hResource;
+
+   ///  Number of distinct angles the atlas covers, over a full turn.
+   uint8_t  numAngles;
+
+   ///  Number of sprites stored: one quarter turn's worth.
+   uint8_t  numSprites;
+
+   ///  Angle step currently shown, 0 to numAngles - 1.
+   int      angleIndex;
+
+   /**
+    *  Run-coded sprite for angleIndex, read from the resource when the
+    *  angle step changes.  NULL if not loaded.
+    */
+   uint8_t* pSprite;
+
+   ///  Bytes in pSprite.
+   uint16_t usSpriteBytes;
+
+   ///  Area pSprite covers before any quarter turn, relative to the pivot.
+   GRect    spriteRect;
+
+   ///  Screen point which the image rotates about.
+   GPoint   pivot;
+
+   ///  Layer we draw in.  Its data is a pointer back to us.
+   Layer*   pLayer;
+
+} SpriteAtlas;
+
+
+/**
+ *  Create a sprite atlas and the layer it draws in.
+ *
+ *  @param resourceId Raw resource holding the atlas.
+ *  @param frame Frame for our layer.  Typically the whole window, since the
+ *             image may be turned to point anywhere from the pivot.
+ *
+ *  @return New instance, or NULL on failure.
+ */
+SpriteAtlas* sprite_atlas_create(uint32_t resourceId, GRect frame);
+
+///  Add our layer to the supplied parent layer.
+void  sprite_atlas_add_to_layer(SpriteAtlas *pAtlas, Layer *parent);
+
+/**
+ *  Set the point, in our layer's coordinates, which the image rotates about.
+ */
+void  sprite_atlas_set_pivot(SpriteAtlas *pAtlas, GPoint pivot);
+
+/**
+ *  Set the angle at which the image is drawn, clockwise from its original
+ *  orientation in TRIG_MAX_ANGLE units.  The angle is rounded to the
+ *  nearest step the atlas holds; our layer is only marked dirty if that
+ *  changes the step shown.
+ * 
+ *  @return \c true if the step shown changed, else \c false.
+ */
+bool  sprite_atlas_set_angle(SpriteAtlas *pAtlas, int32_t angle);
+
+/**
+ *  Area of the screen (in our layer's coordinates) the image presently
+ *  covers, for redrawing just that part.
+ * 
+ *  @return Bounding box of the image, or an empty rectangle if none is shown.
+ */
+GRect  sprite_atlas_get_bounds(SpriteAtlas *pAtlas);
+
+void  sprite_atlas_destroy(SpriteAtlas *pAtlas);
@@ -0,0 +1,250 @@
+/**
+ *  @file
+ *
+ */
+
+#include  "TaskScheduler.h"
+
+
+///  A queued task.  Unused if handle == TASK_HANDLE_NONE.
+typedef struct
+{
+
+   TaskHandle       handle;
+   TaskPriority     priority;
+   TaskStepCallback stepCallback;
+   TaskDoneCallback doneCallback;
+   void            *pContext;
+
+   ///  For the log when the task is done: steps and slices run, and time
+   ///  spent in its steps.
+   uint16_t         usSteps;
+   uint16_t         usSlices;
+   uint32_t         ulMs;
+
+} Task;
+
+
+static Task aTasks[TASK_SCHEDULER_MAX_TASKS];
+
+///  Last handle given out.  Handles increase in submission order.
+static TaskHandle lastHandle = TASK_HANDLE_NONE;
+
+///  Timer for the next slice, or NULL if there are no tasks.
+static AppTimer *pTimer = NULL;
+
+
+static void task_scheduler_run_slice(void *pData);
+
+
+///  Milliseconds since some arbitrary moment; wraps, so only differences mean anything.
+static uint32_t task_scheduler_now_ms(void)
+{
+   time_t   secs;
+   uint16_t ms;
+
+   time_ms(&secs, &ms);
+
+   return ((uint32_t) secs * 1000) + ms;
+}
+
+
+///  Task to run next, or NULL if none.
+static Task * task_scheduler_pick(void)
+{
+
+   Task *pBest = NULL;
+
+   for (int i = 0; i < TASK_SCHEDULER_MAX_TASKS; i++)
+   {
+      Task *pTask = &aTasks[i];
+      if (pTask->handle == TASK_HANDLE_NONE)
+      {
+         continue;
+      }
+
+      if ((pBest == NULL) ||
+          (pTask->priority > pBest->priority) ||
+          ((pTask->priority == pBest->priority) &&
+           ((TaskHandle) (pTask->handle - pBest->handle) > (TaskHandle) 0x8000)))
+      {
+         pBest = pTask;
+      }
+   }
+
+   return pBest;
+
+}  /* end of task_scheduler_pick */
+
+
+///  Start the slice timer if it isn't going.
+static void task_scheduler_arm(uint32_t ms)
+{
+   if (pTimer == NULL)
+   {
+      pTimer = app_timer_register(ms, task_scheduler_run_slice, NULL);
+   }
+}
+
+
+///  Timer callback: run steps until out of tasks or time.
+static void task_scheduler_run_slice(void *pData)
+{
+
+   (void) pData;
+
+   pTimer = NULL;
+
+   uint32_t startMs = task_scheduler_now_ms();
+   uint32_t elapsedMs = 0;
+   TaskHandle lastRun = TASK_HANDLE_NONE;
+
+   Task *pTask;
+   while ((pTask = task_scheduler_pick()) != NULL)
+   {
+      TaskHandle handle = pTask->handle;
+      if (handle != lastRun)
+      {
+         pTask->usSlices++;
+         lastRun = handle;
+      }
+
+      uint32_t stepStartMs = task_scheduler_now_ms();
+      bool fDone = (*pTask->stepCallback)(pTask->pContext);
+      uint32_t nowMs = task_scheduler_now_ms();
+
+      //  (the step may have cancelled its own or another task.)
+      if (pTask->handle == handle)
+      {
+         pTask->usSteps++;
+         pTask->ulMs += nowMs - stepStartMs;
+
+         if (fDone)
+         {
+            APP_LOG(APP_LOG_LEVEL_DEBUG, "task %d done: %d steps in %d slices, %d ms",
+                    (int) handle, pTask->usSteps, pTask->usSlices, (int) pTask->ulMs);
+
+            //  free the slot first, so the done callback can submit more.
+            Task done = *pTask;
+            pTask->handle = TASK_HANDLE_NONE;
+
+            if (done.doneCallback != NULL)
+            {
+               (*done.doneCallback)(done.pContext);
+            }
+         }
+      }
+
+      elapsedMs = nowMs - startMs;
+      if (elapsedMs >= TASK_SCHEDULER_SLICE_MS)
+      {
+         break;
+      }
+   }
+
+   if (task_scheduler_pick() != NULL)
+   {
+      task_scheduler_arm(TASK_SCHEDULER_GAP_MS);
+   }
+
+}  /* end of task_scheduler_run_slice */
+
+
+TaskHandle  task_scheduler_submit(TaskStepCallback stepCallback,
+                                  TaskDoneCallback doneCallback,
+                                  void *pContext, TaskPriority priority)
+{
+
+   for (int i = 0; i < TASK_SCHEDULER_MAX_TASKS; i++)
+   {
+      Task *pTask = &aTasks[i];
+      if (pTask->handle != TASK_HANDLE_NONE)
+      {
+         continue;
+      }
+
+      if (++lastHandle == TASK_HANDLE_NONE)
+      {
+         lastHandle++;
+      }
+
+      memset(pTask, 0, sizeof(*pTask));
+      pTask->handle       = lastHandle;
+      pTask->priority     = priority;
+      pTask->stepCallback = stepCallback;
+      pTask->doneCallback = doneCallback;
+      pTask->pContext     = pContext;
+
+      task_scheduler_arm(0);
+
+      return pTask->handle;
+   }
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "task queue full");
+   return TASK_HANDLE_NONE;
+
+}  /* end of task_scheduler_submit */
+
+
+///  Slot holding the task, or NULL if it isn't queued.
+static Task * task_scheduler_find(TaskHandle handle)
+{
+
+   if (handle == TASK_HANDLE_NONE)
+   {
+      return NULL;
+   }
+
+   for (int i = 0; i < TASK_SCHEDULER_MAX_TASKS; i++)
+   {
+      if (aTasks[i].handle == handle)
+      {
+         return &aTasks[i];
+      }
+   }
+
+   return NULL;
+
+}  /* end of task_scheduler_find */
+
+
+bool  task_scheduler_cancel(TaskHandle handle)
+{
+
+   Task *pTask = task_scheduler_find(handle);
+   if (pTask == NULL)
+   {
+      return false;
+   }
+
+   pTask->handle = TASK_HANDLE_NONE;
+
+   if ((task_scheduler_pick() == NULL) && (pTimer != NULL))
+   {
+      app_timer_cancel(pTimer);
+      pTimer = NULL;
+   }
+
+   return true;
+
+}  /* end of task_scheduler_cancel */
+
+
+bool  task_scheduler_is_queued(TaskHandle handle)
+{
+   return (task_scheduler_find(handle) != NULL);
+}
+
+
+void  task_scheduler_deinit(void)
+{
+
+   if (pTimer != NULL)
+   {
+      app_timer_cancel(pTimer);
+      pTimer = NULL;
+   }
+
+   memset(aTasks, 0, sizeof(aTasks));
+
+}  /* end of task_scheduler_deinit */
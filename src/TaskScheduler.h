@@ -0,0 +1,88 @@
+/**
+ *  @file
+ *
+ *  Runs long computations a slice at a time from an app_timer, so that they
+ *  never hold up the UI for long or trip the PebbleOS watchdog.
+ *
+ *  A task is a step callback, called over and over until it says it is
+ *  done.  Each timer callback runs steps for up to TASK_SCHEDULER_SLICE_MS,
+ *  always of the highest priority task waiting (oldest first among equals),
+ *  then gives the event loop TASK_SCHEDULER_GAP_MS before the next slice.
+ *  A step itself is never interrupted, so keep each one short.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+
+///  Most tasks waiting or running at once.
+#define  TASK_SCHEDULER_MAX_TASKS   4
+
+///  Time budget of one slice of steps.  At least one step runs per slice.
+#define  TASK_SCHEDULER_SLICE_MS    40
+
+///  Pause between slices, for the event loop to handle input and drawing.
+#define  TASK_SCHEDULER_GAP_MS      20
+
+
+///  Identifies a submitted task.  Never reused in a run of the app.
+typedef uint16_t TaskHandle;
+
+///  Not a task: what task_scheduler_submit() returns on failure.
+#define  TASK_HANDLE_NONE  ((TaskHandle) 0)
+
+///  Order tasks are run in.  A waiting higher priority task is always run first.
+typedef enum
+{
+   TASK_PRIORITY_LOW,
+   TASK_PRIORITY_NORMAL,
+   TASK_PRIORITY_HIGH,
+} TaskPriority;
+
+/**
+ *  Do the next piece of a task's work.
+ *
+ *  @param pContext As given to task_scheduler_submit().
+ *
+ *  @return \c true when the work is all done, \c false to be called again.
+ */
+typedef bool (*TaskStepCallback)(void *pContext);
+
+/**
+ *  Called once a task's work is done.  Not called for a cancelled task.
+ *
+ *  @param pContext As given to task_scheduler_submit().
+ */
+typedef void (*TaskDoneCallback)(void *pContext);
+
+
+/**
+ *  Queue up a task.  Its first step runs from a timer, never from in here.
+ *
+ *  @param stepCallback Called for each step.
+ *  @param doneCallback Called when done.  May be NULL.
+ *  @param pContext Passed to both callbacks.
+ *  @param priority Priority of the task.
+ *
+ *  @return Handle for task_scheduler_cancel(), or TASK_HANDLE_NONE if
+ *          TASK_SCHEDULER_MAX_TASKS are already queued.
+ */
+TaskHandle  task_scheduler_submit(TaskStepCallback stepCallback,
+                                  TaskDoneCallback doneCallback,
+                                  void *pContext, TaskPriority priority);
+
+/**
+ *  Drop a task.  No more of its steps run, and its done callback isn't
+ *  called.  Safe to call from the task's own step, or for a task already
+ *  done.
+ *
+ *  @return \c true if the task was still queued.
+ */
+bool  task_scheduler_cancel(TaskHandle handle);
+
+///  Is the task still queued (not yet done nor cancelled)?
+bool  task_scheduler_is_queued(TaskHandle handle);
+
+///  Drop all tasks.  Call at program exit.
+void  task_scheduler_deinit(void);
@@ -8,7 +8,6 @@
 
 #include  "ConfigData.h"
 #include  "helpers.h"
-#include  "my_math.h"
 #include  "suncalc.h"
 
 
@@ -21,7 +20,7 @@
 
 
 TwilightPath * twilight_path_create(float zenithAngle, ScreenPartToEnclose toEnclose,
-                                    uint32_t greyBitmapResourceId)
+                                    TwilightShade shade)
 {
 
    TwilightPath * pMyRet = malloc(sizeof(TwilightPath));
@@ -33,19 +32,10 @@ TwilightPath * twilight_path_create(float zenithAngle, ScreenPartToEnclose toEnc
    pMyRet->fZenith = zenithAngle;
    pMyRet->toEnclose = toEnclose;
 
-   if (greyBitmapResourceId != INVALID_RESOURCE)
-   {
-      pMyRet->pBmpGrey = gbitmap_create_with_resource(greyBitmapResourceId);
-      if (pMyRet->pBmpGrey == NULL)
-      {
-         free(pMyRet);
-         return NULL;
-      }
-   }
-   else
-   {
-      pMyRet->pBmpGrey = NULL;
-   }
+   pMyRet->shade = shade;
+
+   //  until twilight_path_render() needs it:
+   pMyRet->pBmpGrey = NULL;
 
    //  Most path points are constant for life of this TwilightPath instance
    //  (they depend only on ScreenPartToEnclose).  But the point order varies
@@ -79,48 +69,21 @@ TwilightPath * twilight_path_create(float zenithAngle, ScreenPartToEnclose toEnc
 
 
 /**
- *  Adjust UTC hour + fraction to same in local time.
- *  
- *  Relies on config_data_get_tz_in_hours() correctly reflecting the current
- *  timezone + DST setting for the currently configured location.
- * 
- *  @param time Points to var holding a UTC hour + fraction (minutes etc.).
- *             We update the value of this var to the local time equivalent
- *             of its original value.
- *             Or, if input time is NO_RISE_SET_TIME then we return the same.
- */
-static void adjustTimezone(float *time)
-{
-   float newTime;
-
-   if (*time != NO_RISE_SET_TIME)
-   {
-      newTime = *time + config_data_get_tz_in_hours(); 
-      if (newTime > 24)
-         newTime -= 24;
-      if (newTime < 0)
-         newTime += 24;
-
-      *time = newTime;
-   }
-
-}  /* end of adjustTimezone */
-
-
-/**
- *  Calculate rise / set time pair for a given zenith value and UTC date.
+ *  Calculate rise / set time pairs for several zenith values and a UTC date.
  * 
- * @param riseTime Set to local time (hour + fraction) sun rises to specified 
- *                zenith on given date.
- * @param setTime Set to local time (hour + fraction) sun sets to specified 
- *                zenith on given date.
+ * @param riseTimes Set to local time (hour + fraction) sun rises to each
+ *                specified zenith on given date.
+ * @param setTimes Set to local time (hour + fraction) sun sets to each
+ *                specified zenith on given date.
  * @param dateLocal Local date to find rise/set values for.
- * @param zenith Definition of "rise" / "set": used to select true rise / set,
- *                or various flavors of twilight. This is an unsigned deflection
+ * @param zeniths Definitions of "rise" / "set": used to select true rise / set,
+ *                or various flavors of twilight. Each is an unsigned deflection
  *                angle in degrees, with zero representing "directly overhead" (noon).
+ * @param numZeniths Number of entries in each of the above arrays.
  */
-static void  calcRiseAndSet(float *riseTime, float *setTime,
-                            const struct tm* dateLocal, float zenith)
+static void  calcRiseAndSetMulti(float *riseTimes, float *setTimes,
+                                 const struct tm* dateLocal,
+                                 const float *zeniths, int numZeniths)
 {
 
    float latitude = config_data_get_latitude();
@@ -128,46 +91,54 @@ static void  calcRiseAndSet(float *riseTime, float *setTime,
 
    //BUGBUG - date should be UTC!
 
-   *riseTime = calcSunRise(dateLocal->tm_year, dateLocal->tm_mon + 1, dateLocal->tm_mday,
-                           latitude, longitude, zenith);
-
-   *setTime = calcSunSet(dateLocal->tm_year, dateLocal->tm_mon + 1, dateLocal->tm_mday,
-                         latitude, longitude, zenith);
+   calcSunRiseSetMulti(dateLocal->tm_year, dateLocal->tm_mon + 1, dateLocal->tm_mday,
+                       latitude, longitude, zeniths, numZeniths,
+                       riseTimes, setTimes);
 
    //  convert UTC outputs to local time
-   adjustTimezone(riseTime);
-   adjustTimezone(setTime);
+   for (int i = 0; i < numZeniths; i++)
+   {
+      twilight_path_adjust_timezone(&riseTimes[i]);
+      twilight_path_adjust_timezone(&setTimes[i]);
+   }
 
-}
+}  /* end of calcRiseAndSetMulti */
 
 
-void  twilight_path_compute_current(TwilightPath *pTwilightPath,
-                                    struct tm * localTime)
+/**
+ *  Point where a time of day's line meets the edge of the screen, relative to
+ *  the hour hand's axis.  The line reaches past the screen's corners, so the
+ *  point is off screen: it just sets the line's direction.
+ * 
+ *  @param minuteOfDay Local time, in minutes since midnight.
+ */
+static GPoint twilight_path_edge_point(int16_t minuteOfDay)
 {
+   int32_t angle = twilight_path_dial_angle(minuteOfDay);
 
-///BUGBUG: This is 12 hours, or 1/2 day.  Why is this value needed?
-const float timeFudge = 12.0f;
+   return GPoint((int16_t) ((sin_lookup(angle) * 120) / TRIG_MAX_RATIO),
+                 9 - (int16_t) ((cos_lookup(angle) * 120) / TRIG_MAX_RATIO));
+}
 
 
-   //  Find time of day for dawn and dusk times.  Results are expressed
-   //  as local hour-of-day, with minutes as fraction of an hour.
-   float fDawnTime;
-   float fDuskTime;
-   calcRiseAndSet(&fDawnTime, &fDuskTime, localTime, pTwilightPath->fZenith);
+/**
+ *  Update a twilight path's dawn / dusk points to match its dawnMinute
+ *  and duskMinute.
+ */
+static void  twilight_path_set_points(TwilightPath *pTwilightPath)
+{
 
-   //  save true dawn / dusk times
-   pTwilightPath->fDawnTime = fDawnTime;
-   pTwilightPath->fDuskTime = fDuskTime;
+   if ((pTwilightPath->dawnMinute == TWILIGHT_NO_MINUTE) ||
+       (pTwilightPath->duskMinute == TWILIGHT_NO_MINUTE))
+   {
+      //  path won't be drawn (see twilight_path_render()), so its points
+      //  don't matter.
+      return;
+   }
 
    //  Update dawn / dusk points to reflect zenith at present location / date.
-
-   fDawnTime += timeFudge;
-   GPoint dawnPoint = GPoint((int16_t)(my_sin(fDawnTime / 24 * M_PI * 2) * 120),
-                             9 - (int16_t)(my_cos(fDawnTime / 24 * M_PI * 2) * 120));
-
-   fDuskTime += timeFudge;
-   GPoint duskPoint = GPoint((int16_t)(my_sin(fDuskTime / 24 * M_PI * 2) * 120),
-                             9 - (int16_t)(my_cos(fDuskTime / 24 * M_PI * 2) * 120));
+   GPoint dawnPoint = twilight_path_edge_point(pTwilightPath->dawnMinute);
+   GPoint duskPoint = twilight_path_edge_point(pTwilightPath->duskMinute);
 
    //  do the point init which twilight_path_create() couldn't.
    if (pTwilightPath->toEnclose == ENCLOSE_SCREEN_TOP)
@@ -183,9 +154,131 @@ const float timeFudge = 12.0f;
 
    //  (Actual GPath creation is done in twilight_path_draw_filled().)
 
-   return;
+}  /* end of twilight_path_set_points */
+
+
+/**
+ *  Save dawn / dusk times in a twilight path, and update its dawn / dusk
+ *  points to match.
+ *  
+ *  This is the only float work between the solar math and the screen: the
+ *  times are rounded to whole minutes here, and the points are found from
+ *  those with integer trig.
+ * 
+ *  @param pTwilightPath Twilight path instance to update.
+ *  @param fDawnTime Local time (hour + fraction) of zenith dawn.
+ *  @param fDuskTime Local time (hour + fraction) of zenith dusk.
+ */
+static void  twilight_path_set_times(TwilightPath *pTwilightPath,
+                                     float fDawnTime, float fDuskTime)
+{
+
+   //  save true dawn / dusk times
+   pTwilightPath->fDawnTime = fDawnTime;
+   pTwilightPath->fDuskTime = fDuskTime;
+
+   pTwilightPath->dawnMinute = twilight_path_time_to_minute(fDawnTime);
+   pTwilightPath->duskMinute = twilight_path_time_to_minute(fDuskTime);
+
+   twilight_path_set_points(pTwilightPath);
+
+}  /* end of twilight_path_set_times */
+
+
+void  twilight_path_set_minutes(TwilightPath *pTwilightPath,
+                                int16_t dawnMinute, int16_t duskMinute)
+{
+
+   pTwilightPath->dawnMinute = dawnMinute;
+   pTwilightPath->duskMinute = duskMinute;
+
+   pTwilightPath->fDawnTime = twilight_path_minute_to_time(dawnMinute);
+   pTwilightPath->fDuskTime = twilight_path_minute_to_time(duskMinute);
+
+   twilight_path_set_points(pTwilightPath);
+
+}  /* end of twilight_path_set_minutes */
+
+
+void  twilight_path_compute_current(TwilightPath *pTwilightPath,
+                                    struct tm * localTime)
+{
+   twilight_path_compute_current_multi(&pTwilightPath, 1, localTime);
+}
+
+
+void  twilight_path_compute_current_multi(TwilightPath *apTwilightPaths[],
+                                          int numPaths, struct tm * localTime)
+{
+
+   float aZeniths[TWILIGHT_PATH_MAX_MULTI];
+   float aDawnTimes[TWILIGHT_PATH_MAX_MULTI];
+   float aDuskTimes[TWILIGHT_PATH_MAX_MULTI];
+
+   if (numPaths > TWILIGHT_PATH_MAX_MULTI)
+   {
+      numPaths = TWILIGHT_PATH_MAX_MULTI;
+   }
+
+   for (int i = 0; i < numPaths; i++)
+   {
+      aZeniths[i] = apTwilightPaths[i]->fZenith;
+   }
+
+   //  Find time of day for dawn and dusk times, for all zeniths in one go.
+   //  Results are expressed as local hour-of-day, with minutes as fraction
+   //  of an hour.
+   calcRiseAndSetMulti(aDawnTimes, aDuskTimes, localTime, aZeniths, numPaths);
+
+   for (int i = 0; i < numPaths; i++)
+   {
+      twilight_path_set_times(apTwilightPaths[i], aDawnTimes[i], aDuskTimes[i]);
+   }
+
+}  /* end of twilight_path_compute_current_multi */
+
+
+/**
+ *  Expand one row of a dither tile to a 32-bit pattern word, in the
+ *  framebuffer's pixel order (see the rasterizer notes below).
+ * 
+ *  @param shade Dither tile.
+ *  @param y Row, relative to top of the shaded area.
+ */
+static uint32_t twilight_shade_row(TwilightShade shade, int16_t y)
+{
+   return ((shade >> (4 * (y & 3))) & 0xF) * 0x11111111UL;
+}
+
+
+/**
+ *  Build a bitmap of one shade tile, wide enough for a whole 32-bit word
+ *  per row, which graphics_draw_bitmap_in_rect() will repeat across the
+ *  screen.
+ * 
+ *  @return New bitmap, or NULL if we are out of heap.
+ */
+static GBitmap * twilight_shade_create_bitmap(TwilightShade shade)
+{
+
+   GBitmap *pBmp = gbitmap_create_blank(GSize(32, 4), GBitmapFormat1Bit);
+   if (pBmp == NULL)
+   {
+      return NULL;
+   }
+
+   uint8_t *pData = gbitmap_get_data(pBmp);
+   uint16_t rowBytes = gbitmap_get_bytes_per_row(pBmp);
+
+   for (int16_t y = 0; y < 4; y++)
+   {
+      uint32_t word = twilight_shade_row(shade, y);
+      memcpy(pData + (y * rowBytes), &word, sizeof(word));
+   }
+
+   return pBmp;
 
-}  /* end of twilight_path_compute_current */
+}  /* end of twilight_shade_create_bitmap */
 
 
 void  twilight_path_render(TwilightPath *pTwilightPath, GContext *ctx,
@@ -214,6 +307,11 @@ void  twilight_path_render(TwilightPath *pTwilightPath, GContext *ctx,
 
    //  do rendering
 
+   if ((pTwilightPath->shade != TWILIGHT_SHADE_NONE) && (pTwilightPath->pBmpGrey == NULL))
+   {
+      pTwilightPath->pBmpGrey = twilight_shade_create_bitmap(pTwilightPath->shade);
+   }
+
    if (pTwilightPath->pBmpGrey != NULL)
    {
       graphics_context_set_compositing_mode(ctx, GCompOpAnd); 
@@ -229,6 +327,236 @@ void  twilight_path_render(TwilightPath *pTwilightPath, GContext *ctx,
 }  /* end of twilight_path_render */
 
 
+//  Scanline rasterizer used by twilight_path_render_multi().
+//  
+//  Screen rows are built up in a local buffer of 32-bit words and then
+//  copied to the framebuffer once.  In 1-bit Pebble bitmaps the leftmost
+//  pixel of each byte is its least significant bit, so on this
+//  little-endian CPU pixel x of a row is bit (x % 32) of word (x / 32).
+
+///  Most 32-bit words in one framebuffer row that we handle.
+#define  RASTER_MAX_ROW_WORDS   8
+
+///  Crossing x coords are kept with this many fraction bits.
+#define  RASTER_FRAC_BITS       8
+
+///  Most edge crossings on one scanline of a twilight path.
+#define  RASTER_MAX_CROSSINGS   POINTS_IN_TWILIGHT_PATH
+
+
+/**
+ *  Find the spans of a scanline covered by a twilight path.
+ *  
+ *  Each edge of the (closed) path is intersected with the horizontal line
+ *  through the centers of row y's pixels, and the crossings paired up
+ *  even-odd.  This works for the concave paths we get when a band spans
+ *  more than 12 hours.
+ * 
+ *  @param aPoints Path points, in screen coordinates.
+ *  @param y Screen row.
+ *  @param aStarts Receives first pixel of each span.
+ *  @param aEnds Receives pixel just past the end of each span.
+ * 
+ *  @return Number of spans found.
+ */
+static int raster_path_spans(const GPoint aPoints[], int16_t y,
+                             int16_t aStarts[], int16_t aEnds[])
+{
+
+   int32_t aCrossings[RASTER_MAX_CROSSINGS];
+   int numCrossings = 0;
+
+   //  Work in half pixels so that the pixel-center line is an integer.
+   int32_t y2 = (2 * y) + 1;
+
+   for (int i = 0; i < POINTS_IN_TWILIGHT_PATH; i++)
+   {
+      GPoint p0 = aPoints[i];
+      GPoint p1 = aPoints[(i + 1) % POINTS_IN_TWILIGHT_PATH];
+
+      int32_t y0 = 2 * p0.y;
+      int32_t y1 = 2 * p1.y;
+
+      if ((y0 <= y2) == (y1 <= y2))
+      {
+         //  edge doesn't cross this scanline (horizontal edges never do).
+         continue;
+      }
+
+      int32_t x = (p0.x << RASTER_FRAC_BITS) +
+                  (((y2 - y0) * (p1.x - p0.x)) << RASTER_FRAC_BITS) / (y1 - y0);
+
+      //  insertion sort as we go: there are only a handful.
+      int j = numCrossings++;
+      while ((j > 0) && (aCrossings[j - 1] > x))
+      {
+         aCrossings[j] = aCrossings[j - 1];
+         j--;
+      }
+      aCrossings[j] = x;
+   }
+
+   int numSpans = 0;
+
+   for (int i = 0; i + 1 < numCrossings; i += 2)
+   {
+      //  pixel is in the span if its center is: first and last pixels
+      //  are ceil(crossing - 1/2).
+      const int32_t half = 1 << (RASTER_FRAC_BITS - 1);
+      const int32_t roundUp = (1 << RASTER_FRAC_BITS) - 1;
+
+      aStarts[numSpans] = (aCrossings[i]     - half + roundUp) >> RASTER_FRAC_BITS;
+      aEnds[numSpans]   = (aCrossings[i + 1] - half + roundUp) >> RASTER_FRAC_BITS;
+      numSpans++;
+   }
+
+   return numSpans;
+
+}  /* end of raster_path_spans */
+
+
+/**
+ *  Set pixels [xStart, xEnd) of a row buffer to a solid color.
+ *  Whole words are written directly, with masks only at the two ends.
+ */
+static void raster_fill_span(uint32_t aRow[], int16_t xStart, int16_t xEnd,
+                             uint32_t colorWord)
+{
+
+   int wordStart = xStart >> 5;
+   int wordEnd = (xEnd - 1) >> 5;
+
+   uint32_t maskStart = 0xFFFFFFFFUL << (xStart & 31);
+   uint32_t maskEnd = 0xFFFFFFFFUL >> (31 - ((xEnd - 1) & 31));
+
+   if (wordStart == wordEnd)
+   {
+      uint32_t mask = maskStart & maskEnd;
+      aRow[wordStart] = (aRow[wordStart] & ~mask) | (colorWord & mask);
+      return;
+   }
+
+   aRow[wordStart] = (aRow[wordStart] & ~maskStart) | (colorWord & maskStart);
+
+   for (int w = wordStart + 1; w < wordEnd; w++)
+   {
+      aRow[w] = colorWord;
+   }
+
+   aRow[wordEnd] = (aRow[wordEnd] & ~maskEnd) | (colorWord & maskEnd);
+
+}  /* end of raster_fill_span */
+
+
+bool  twilight_path_render_multi(TwilightPath *apTwilightPaths[], const GColor aColors[],
+                                 int numPaths, GContext *ctx, GRect frameDst)
+{
+
+   if (numPaths > TWILIGHT_PATH_MAX_MULTI)
+   {
+      numPaths = TWILIGHT_PATH_MAX_MULTI;
+   }
+
+   //  Paths' points are relative to the hour hand axis, at the frame center.
+   GPoint center = grect_center_point(&frameDst);
+   GPoint aaPoints[TWILIGHT_PATH_MAX_MULTI][POINTS_IN_TWILIGHT_PATH];
+   bool afActive[TWILIGHT_PATH_MAX_MULTI];
+
+   for (int i = 0; i < numPaths; i++)
+   {
+      //  as in twilight_path_render(), a path with no rise or set renders nothing.
+      afActive[i] = (apTwilightPaths[i]->fDawnTime != NO_RISE_SET_TIME) &&
+                    (apTwilightPaths[i]->fDuskTime != NO_RISE_SET_TIME);
+
+      for (int j = 0; j < POINTS_IN_TWILIGHT_PATH; j++)
+      {
+         aaPoints[i][j] = GPoint(apTwilightPaths[i]->aPathPoints[j].x + center.x,
+                                 apTwilightPaths[i]->aPathPoints[j].y + center.y);
+      }
+   }
+
+   GBitmap *pFrameBuf = graphics_capture_frame_buffer(ctx);
+   if (pFrameBuf == NULL)
+   {
+      return false;
+   }
+
+   uint16_t rowBytes = gbitmap_get_bytes_per_row(pFrameBuf);
+   GRect fbBounds = gbitmap_get_bounds(pFrameBuf);
+   int rowWords = (rowBytes + 3) / 4;
+
+   if (rowWords > RASTER_MAX_ROW_WORDS)
+   {
+      graphics_release_frame_buffer(ctx, pFrameBuf);
+      return false;
+   }
+
+   int16_t xLimit = fbBounds.size.w;
+   int16_t yStart = frameDst.origin.y;
+   int16_t yEnd = frameDst.origin.y + frameDst.size.h;
+   if (yStart < 0)
+      yStart = 0;
+   if (yEnd > fbBounds.size.h)
+      yEnd = fbBounds.size.h;
+
+   uint8_t *pFrameData = gbitmap_get_data(pFrameBuf);
+
+   for (int16_t y = yStart; y < yEnd; y++)
+   {
+      uint32_t aRow[RASTER_MAX_ROW_WORDS];
+
+      //  start out with white row, as twilight_path_render() does.
+      for (int w = 0; w < rowWords; w++)
+      {
+         aRow[w] = 0xFFFFFFFFUL;
+      }
+
+      //  Same layering as repeated twilight_path_render() calls: each path
+      //  ANDs its grey into the whole row, then fills its own spans.
+      for (int i = 0; i < numPaths; i++)
+      {
+         if (!afActive[i])
+         {
+            continue;
+         }
+
+         if (apTwilightPaths[i]->shade != TWILIGHT_SHADE_NONE)
+         {
+            uint32_t grey = twilight_shade_row(apTwilightPaths[i]->shade, y - frameDst.origin.y);
+            for (int w = 0; w < rowWords; w++)
+            {
+               aRow[w] &= grey;
+            }
+         }
+
+         int16_t aStarts[RASTER_MAX_CROSSINGS / 2];
+         int16_t aEnds[RASTER_MAX_CROSSINGS / 2];
+         int numSpans = raster_path_spans(aaPoints[i], y, aStarts, aEnds);
+
+         uint32_t colorWord = gcolor_equal(aColors[i], GColorBlack) ? 0 : 0xFFFFFFFFUL;
+
+         for (int k = 0; k < numSpans; k++)
+         {
+            int16_t xStart = (aStarts[k] < 0) ? 0 : aStarts[k];
+            int16_t xEnd = (aEnds[k] > xLimit) ? xLimit : aEnds[k];
+
+            if (xStart < xEnd)
+            {
+               raster_fill_span(aRow, xStart, xEnd, colorWord);
+            }
+         }
+      }
+
+      memcpy(pFrameData + (y * rowBytes), aRow, rowBytes);
+   }
+
+   graphics_release_frame_buffer(ctx, pFrameBuf);
+
+   return true;
+
+}  /* end of twilight_path_render_multi */
+
+
 void  twilight_path_destroy(TwilightPath *pTwilightPath)
 {
 
@@ -15,9 +15,37 @@ typedef enum {
 } ScreenPartToEnclose;
 
 
+/**
+ *  Shade of grey a twilight path lays down under its band, as a 4x4 dither
+ *  tile repeated across the screen.  Each row of the tile is one nibble,
+ *  top row in the low nibble, and within a nibble bit 0 is the leftmost
+ *  pixel.  A set bit leaves the pixel white, a clear bit makes it black.
+ */
+typedef uint16_t TwilightShade;
+
+///  No grey: leave the screen as it is.
+#define  TWILIGHT_SHADE_NONE        0xFFFF
+///  One pixel in four black.
+#define  TWILIGHT_SHADE_LIGHT_GREY  0xB7DE
+///  Half the pixels black.
+#define  TWILIGHT_SHADE_GREY        0x965A
+///  Three pixels in four black.
+#define  TWILIGHT_SHADE_DARK_GREY   0x8412
+
+
+///  Minutes in a day, the units of TwilightPath's dawnMinute / duskMinute.
+#define  TWILIGHT_MINUTES_PER_DAY  (24 * 60)
+
+///  dawnMinute / duskMinute value when there is no dawn / dusk that day.
+#define  TWILIGHT_NO_MINUTE        ((int16_t) -1)
+
+
 ///  Four "corners" plus center point.
 #define  POINTS_IN_TWILIGHT_PATH   5
 
+///  Most twilight paths which twilight_path_compute_current_multi() handles per call.
+#define  TWILIGHT_PATH_MAX_MULTI   4
+
 /** 
  *  Carries data about a single path which includes two lines, roughly
  *  like hands of a clock, which show the specific times of the sun
@@ -35,11 +63,10 @@ typedef enum {
  *  Our computed path coords are relative, using as a zero-point the axis
  *  of the hour hand's rotation.
  *  
- *  This structure also includes an optional bitmap resource.  When
- *  present, the bitmap is rendered immediately before we fill our path.
- *  When a bitmap is present, our path fill typically is used to carve out
- *  part of the bitmap (which can only be rendered to a rectangle) and
- *  change it back to white.
+ *  This structure also includes an optional grey shade.  When present, the
+ *  shade is applied to the whole screen immediately before we fill our
+ *  path.  Our path fill typically is then used to carve out part of the
+ *  grey and change it back to white.
  */
 typedef struct {
 
@@ -71,11 +98,17 @@ typedef struct {
    GPath *pPath;
 
    /**
-    *  Bitmap resource to render to screen immediately before path fill.
-    *  NULL if there is no bitmap to render (i.e., for our initial
+    *  Grey to apply to screen immediately before path fill.
+    *  TWILIGHT_SHADE_NONE if there is no grey (i.e., for our initial
     *  black-fill of the bottom part of the screen).
     */
-   GBitmap* pBmpGrey;   // some shade of gray
+   TwilightShade shade;
+
+   /**
+    *  One tile of shade as a bitmap, only for twilight_path_render().
+    *  Built the first time it is needed.
+    */
+   GBitmap* pBmpGrey;
 
    /**
     *  Zenith value for our path.  This is the angle between the sun's zenith
@@ -100,6 +133,16 @@ typedef struct {
     */
    float  fDuskTime;
 
+   /**
+    *  fDawnTime rounded to the nearest minute of the day (0 - 1439), or
+    *  TWILIGHT_NO_MINUTE if fDawnTime is NO_RISE_SET_TIME.  Everything
+    *  drawn from the dawn time works from this, in integer units.
+    */
+   int16_t  dawnMinute;
+
+   ///  fDuskTime rounded to the nearest minute of the day, as for dawnMinute.
+   int16_t  duskMinute;
+
 } TwilightPath;
 
 
@@ -113,11 +156,11 @@ typedef struct {
  *  @param zenithAngle Angle in degrees of sun position relative to zenith
  *             which we should use in calculating our graphics path.
  *  @param toEnclose Should graphics path enclose top or bottom of screen?
- *  @param bitmapResId Resource ID of bitmap to use when rendering.
- *                Set to INVALID_RESOURCE for no bitmap.
+ *  @param shade Grey to use when rendering, one of the TWILIGHT_SHADE_ values.
+ *                Set to TWILIGHT_SHADE_NONE for no grey.
  */
 TwilightPath * twilight_path_create(float zenithAngle, ScreenPartToEnclose toEnclose,
-                                    uint32_t greyBitmapResourceId);
+                                    TwilightShade shade);
 
 
 /**
@@ -135,15 +178,46 @@ TwilightPath * twilight_path_create(float zenithAngle, ScreenPartToEnclose toEnc
 void  twilight_path_compute_current(TwilightPath *pTwilightPath,
                                     struct tm * localTime);
 
+/**
+ *  Same as twilight_path_compute_current(), but for several twilight paths
+ *  at once.  The solar math which does not depend on zenith is done only
+ *  once for the whole set, so this is much cheaper than calling
+ *  twilight_path_compute_current() for each path.
+ * 
+ *  @param apTwilightPaths Twilight path instances to update for present
+ *             location/date.
+ *  @param numPaths Number of entries in apTwilightPaths.  At most
+ *             TWILIGHT_PATH_MAX_MULTI.
+ *  @param localTime Local date to compute dawn / dusk for.
+ */
+void  twilight_path_compute_current_multi(TwilightPath *apTwilightPaths[],
+                                          int numPaths, struct tm * localTime);
+
+
+/**
+ *  Set a twilight path's dawn / dusk from minutes already worked out, as
+ *  from a saved copy of twilight_path_compute_current() results, without
+ *  redoing the solar math.  fDawnTime and fDuskTime are set to the same
+ *  times, to the minute.
+ * 
+ *  @param dawnMinute Minute of the day of dawn, or TWILIGHT_NO_MINUTE.
+ *  @param duskMinute Minute of the day of dusk, or TWILIGHT_NO_MINUTE.
+ */
+void  twilight_path_set_minutes(TwilightPath *pTwilightPath,
+                                int16_t dawnMinute, int16_t duskMinute);
+
 
 /**
- *  Render optional bitmap (specified during _create()) to full screen using
+ *  Render optional shade (specified during _create()) to full screen using
  *  GCompAnd compositing, and then fill our path with the specified color.
- *  Thus we write the bitmap and then carve out a chunk of it corresponding
+ *  Thus we write the grey and then carve out a chunk of it corresponding
  *  to the "daytime" part beyond our twilight range.
+ *  
+ *  This is the slow path, used only when twilight_path_render_multi()
+ *  can't get at the framebuffer.
  * 
  *  @param pTwilightPath Contains path info for filling.
- *  @param ctx Graphics context to render to.  Iff we are supplied a bitmap
+ *  @param ctx Graphics context to render to.  Iff our path has a shade
  *              then we change the context's compositing mode to GCompAnd.
  *  @param color Color to fill our path with.
  *  @param frameDst Frame to constrain rendering to (whole window).
@@ -152,5 +226,80 @@ void  twilight_path_render(TwilightPath *pTwilightPath, GContext *ctx,
                            GColor color, GRect frameDst);
 
 
+/**
+ *  Render several twilight paths, with the same result as calling
+ *  twilight_path_render() for each in turn, but in a single pass written
+ *  straight to the framebuffer.
+ *  
+ *  Each screen row's coverage by each path is computed analytically, and
+ *  the grey ANDs and color fills are applied a 32-bit word at a time to a
+ *  row buffer which is then written to the framebuffer once.  Greys are
+ *  expanded from their dither tiles as each row is built, so no bitmap is
+ *  needed.  This avoids the overdraw of the one-path-at-a-time bitmap and
+ *  gpath passes.
+ * 
+ *  @param apTwilightPaths Twilight paths to render, bottom-most first.
+ *  @param aColors Fill color for each path, as for twilight_path_render().
+ *  @param numPaths Number of entries in the above arrays.  At most
+ *              TWILIGHT_PATH_MAX_MULTI.
+ *  @param ctx Graphics context to render to.
+ *  @param frameDst Frame to constrain rendering to (whole window).
+ * 
+ *  @return \c true if rendered, \c false if the framebuffer was not
+ *          available, in which case the caller should fall back to
+ *          twilight_path_render().
+ */
+bool  twilight_path_render_multi(TwilightPath *apTwilightPaths[], const GColor aColors[],
+                                 int numPaths, GContext *ctx, GRect frameDst);
+
+
+/**
+ *  Adjust UTC hour + fraction to same in local time.
+ *  
+ *  Relies on config_data_get_tz_in_hours() correctly reflecting the current
+ *  timezone + DST setting for the currently configured location.
+ * 
+ *  @param time Points to var holding a UTC hour + fraction (minutes etc.).
+ *             We update the value of this var to the local time equivalent
+ *             of its original value.
+ *             Or, if input time is NO_RISE_SET_TIME then we return the same.
+ */
+void  twilight_path_adjust_timezone(float *time);
+
+/**
+ *  Convert a local hour + fraction to the nearest minute of the day.
+ *  
+ *  @param time Local hour + fraction, or NO_RISE_SET_TIME.
+ *  
+ *  @return 0 - 1439, or TWILIGHT_NO_MINUTE for NO_RISE_SET_TIME.
+ */
+int16_t  twilight_path_time_to_minute(float time);
+
+///  Inverse of twilight_path_time_to_minute(), as near as minutes allow.
+float  twilight_path_minute_to_time(int16_t minuteOfDay);
+
+/**
+ *  Convert a rise / set time from the solar math to a minute of the local
+ *  day, as twilight_path_compute_current() does for dawnMinute / duskMinute.
+ * 
+ *  @param utcTime UTC hour + fraction, or NO_RISE_SET_TIME.
+ * 
+ *  @return 0 - 1439, or TWILIGHT_NO_MINUTE.
+ */
+int16_t  twilight_path_utc_to_minute(float utcTime);
+
+
+/**
+ *  Angle on our 24 hour dial which shows a given time of day, as used both
+ *  for the twilight paths and for the hour hand.  Midnight is at the bottom
+ *  of the dial and noon at the top.
+ * 
+ *  @param minuteOfDay Local time, in minutes since midnight.
+ * 
+ *  @return Angle clockwise from the top of the dial, in TRIG_MAX_ANGLE units.
+ */
+int32_t  twilight_path_dial_angle(int minuteOfDay);
+
+
 void  twilight_path_destroy(TwilightPath *pTwilightPath);
 
@@ -0,0 +1,64 @@
+/**
+ *  @file
+ *  
+ *  The time of day parts of TwilightPath.h.  Kept apart from the drawing
+ *  code so that the background worker can build with them too.
+ */
+
+
+#include  "TwilightPath.h"
+
+#include  "ConfigData.h"
+#include  "suncalc.h"
+
+
+void  twilight_path_adjust_timezone(float *time)
+{
+   float newTime;
+
+   if (*time != NO_RISE_SET_TIME)
+   {
+      newTime = *time + config_data_get_tz_in_hours(); 
+      if (newTime > 24)
+         newTime -= 24;
+      if (newTime < 0)
+         newTime += 24;
+
+      *time = newTime;
+   }
+
+}  /* end of twilight_path_adjust_timezone */
+
+
+int16_t  twilight_path_time_to_minute(float time)
+{
+   if (time == NO_RISE_SET_TIME)
+   {
+      return TWILIGHT_NO_MINUTE;
+   }
+
+   //  (times just before midnight round up to 24:00, i.e. 00:00)
+   return ((int16_t) ((time * 60) + 0.5f)) % TWILIGHT_MINUTES_PER_DAY;
+}
+
+
+float  twilight_path_minute_to_time(int16_t minuteOfDay)
+{
+   return (minuteOfDay == TWILIGHT_NO_MINUTE) ? NO_RISE_SET_TIME : (minuteOfDay / 60.0f);
+}
+
+
+int16_t  twilight_path_utc_to_minute(float utcTime)
+{
+   twilight_path_adjust_timezone(&utcTime);
+   return twilight_path_time_to_minute(utcTime);
+}
+
+
+int32_t  twilight_path_dial_angle(int minuteOfDay)
+{
+   //  noon, not midnight, is at the top of the dial.
+   minuteOfDay = (minuteOfDay + (TWILIGHT_MINUTES_PER_DAY / 2)) % TWILIGHT_MINUTES_PER_DAY;
+
+   return (minuteOfDay * TRIG_MAX_ANGLE) / TWILIGHT_MINUTES_PER_DAY;
+}
@@ -0,0 +1,708 @@
+/**
+ *  @file
+ *
+ */
+
+#include  "TwilightSchedule.h"
+
+#include  "ConfigData.h"
+#include  "my_math.h"
+#include  "PersistBudget.h"
+#include  "suncalc.h"
+#include  "TaskScheduler.h"
+#include  "TwilightPath.h"
+
+
+///  Version of code's current schedule layout.
+#define  SCHEDULE_VERSION         2
+
+///  PebbleOS persist_* key for ScheduleHeader.
+#define  SCHEDULE_KEY_HEADER      TWILIGHT_SCHEDULE_KEY_HEADER
+
+///  Blocks go in consecutive keys from here.
+#define  SCHEDULE_KEY_FIRST       PERSIST_KEY_SCHEDULE_FIRST
+
+///  Most blocks we'll use, which caps the schedule's flash use.
+#define  SCHEDULE_MAX_BLOCKS      PERSIST_SCHEDULE_MAX_BLOCKS
+
+///  Bytes in each block.
+#define  SCHEDULE_BLOCK_BYTES     PERSIST_DATA_MAX_LENGTH
+
+///  Minute-of-day values per day: dawn then dusk of each band.
+#define  SCHEDULE_MAX_VALUES      (2 * TWILIGHT_SCHEDULE_MAX_BANDS)
+
+///  Delta byte meaning "next two bytes are the value itself".
+#define  SCHEDULE_ESCAPE          ((int8_t) -128)
+
+///  Days worked out per task step while building.
+#define  SCHEDULE_DAYS_PER_STEP   8
+
+///  Kilometres per degree of latitude.
+#define  SCHEDULE_KM_PER_DEGREE   111.2f
+
+
+/**
+ *  Written to flash last, once all blocks are, so that a schedule is only
+ *  ever read whole.
+ *
+ *  Each block is a byte count of days, then the first day's values as
+ *  uint16s, then for each later day one int8 change per value (or
+ *  SCHEDULE_ESCAPE and the uint16 value).
+ */
+typedef struct
+{
+
+   ///  Always SCHEDULE_VERSION now.
+   uint16_t usVersion;
+
+   ///  Days held.  Zero if there is no schedule.
+   uint16_t usDays;
+
+   ///  Local date of the first day held: years since 1900, and day of year (0 - 365).
+   int16_t  year;
+   int16_t  yday;
+
+   ///  Location config the schedule was built for, as ConfigData keeps it:
+   ///  degrees times CONFIG_DATA_DEGREE_SCALE, and UTC offset in seconds.
+   int32_t  iLatitude;
+   int32_t  iLongitude;
+   int32_t  iUtcOffset;
+
+   ///  Dawn / dusk pairs per day.
+   uint8_t  numBands;
+
+   ///  Blocks used.
+   uint8_t  numBlocks;
+
+   ///  Index of the first day held in each block.
+   uint16_t ausBlockFirstDay[SCHEDULE_MAX_BLOCKS];
+
+} __attribute__((__packed__))  ScheduleHeader;
+
+_Static_assert(sizeof(ScheduleHeader) <= PERSIST_BYTES_SCHEDULE_HEADER,
+               "ScheduleHeader is over its PersistBudget.h line");
+
+
+///  State of a build under way.
+typedef struct
+{
+
+   ///  Header being built.  Written to flash when all days are done.
+   ScheduleHeader header;
+
+   ///  Zenith angle of each band.
+   float    aZeniths[TWILIGHT_SCHEDULE_MAX_BANDS];
+
+   ///  Next day to work out, in calcSunRiseSetDays() terms.
+   int      year;
+   int      dayOfYear;
+
+   ///  Block being filled.
+   uint8_t  aBlock[SCHEDULE_BLOCK_BYTES];
+   uint16_t usBlockBytes;
+
+   ///  Bytes of blocks written so far.
+   uint16_t usFlashBytes;
+
+   ///  Time spent in build steps so far.
+   uint32_t ulBuildMs;
+
+   ///  Values of the last day added to aBlock.
+   uint16_t ausPrev[SCHEDULE_MAX_VALUES];
+
+   ///  TaskScheduler task doing the build.
+   TaskHandle task;
+
+} ScheduleBuild;
+
+
+///  RAM copy of the flash header.  usDays == 0 if none.
+static ScheduleHeader header;
+
+///  Has header been read from flash yet?
+static bool fHeaderRead = false;
+
+///  Build under way, or NULL.
+static ScheduleBuild *pBuild = NULL;
+
+///  Told of each finished build, if not NULL.
+static TwilightScheduleBuiltCallback builtCallback = NULL;
+
+
+///  Make sure header holds the flash header, if there is one.
+static void schedule_read_header(void)
+{
+
+   if (fHeaderRead)
+   {
+      return;
+   }
+   fHeaderRead = true;
+
+   int iRet = persist_read_data(SCHEDULE_KEY_HEADER, &header, sizeof(header));
+   if ((iRet != (int) sizeof(header)) ||
+       (header.usVersion != SCHEDULE_VERSION) ||
+       (header.numBands > TWILIGHT_SCHEDULE_MAX_BANDS) ||
+       (header.numBlocks > SCHEDULE_MAX_BLOCKS))
+   {
+      memset(&header, 0, sizeof(header));
+   }
+
+}  /* end of schedule_read_header */
+
+
+/**
+ *  Days from the schedule's first day to a local date, or -1 if before it.
+ *  The schedule never spans more than one new year.
+ */
+static int schedule_day_index(const ScheduleHeader *pHeader, const struct tm *pLocalTime)
+{
+
+   int index = pLocalTime->tm_yday - pHeader->yday;
+
+   if (pLocalTime->tm_year == pHeader->year + 1)
+   {
+      //  (tm_year counts from 1900, itself a multiple of four)
+      index += ((pHeader->year % 4) == 0) ? 366 : 365;
+   }
+   else if (pLocalTime->tm_year != pHeader->year)
+   {
+      return -1;
+   }
+
+   return (index < 0) ? -1 : index;
+
+}  /* end of schedule_day_index */
+
+
+/**
+ *  Is the present location config close enough to where the schedule was
+ *  built to use it?
+ */
+static bool schedule_location_ok(const ScheduleHeader *pHeader)
+{
+
+   int32_t latitude, longitude, utcOffset;
+   if (!config_data_location_get_scaled(&latitude, &longitude, &utcOffset) ||
+       (utcOffset != pHeader->iUtcOffset))
+   {
+      return false;
+   }
+
+   //  (differences taken exactly, before going to float degrees)
+   int32_t iLongDiff = longitude - pHeader->iLongitude;
+   if (iLongDiff > 180 * CONFIG_DATA_DEGREE_SCALE) iLongDiff -= 360 * CONFIG_DATA_DEGREE_SCALE;
+   if (iLongDiff < -180 * CONFIG_DATA_DEGREE_SCALE) iLongDiff += 360 * CONFIG_DATA_DEGREE_SCALE;
+
+   float dLat = (latitude - pHeader->iLatitude) * (1.0f / CONFIG_DATA_DEGREE_SCALE);
+   float dLong = iLongDiff * (1.0f / CONFIG_DATA_DEGREE_SCALE);
+   dLong *= my_cos((M_PI / 180.0f) * config_data_get_latitude());
+
+   //  (compare squares, and save a square root)
+   float maxDrift = TWILIGHT_SCHEDULE_MAX_DRIFT_KM / SCHEDULE_KM_PER_DEGREE;
+   return ((dLat * dLat) + (dLong * dLong)) <= (maxDrift * maxDrift);
+
+}  /* end of schedule_location_ok */
+
+
+///  Read a little-endian uint16 from a block.
+static uint16_t schedule_get_u16(const uint8_t *p)
+{
+   return p[0] | (p[1] << 8);
+}
+
+
+bool  twilight_schedule_lookup(const struct tm *pLocalTime, int16_t aDawnMinutes[],
+                               int16_t aDuskMinutes[], int numBands)
+{
+
+   schedule_read_header();
+
+   if ((header.usDays == 0) || (header.numBlocks == 0) ||
+       (header.numBands != numBands) || !schedule_location_ok(&header))
+   {
+      return false;
+   }
+
+   int index = schedule_day_index(&header, pLocalTime);
+   if ((index < 0) || (index >= header.usDays))
+   {
+      return false;
+   }
+
+   int block = header.numBlocks - 1;
+   while ((block > 0) && (header.ausBlockFirstDay[block] > index))
+   {
+      block--;
+   }
+
+   uint8_t *pBlock = malloc(SCHEDULE_BLOCK_BYTES);
+   if (pBlock == NULL)
+   {
+      return false;
+   }
+
+   int iRet = persist_read_data(SCHEDULE_KEY_FIRST + block, pBlock, SCHEDULE_BLOCK_BYTES);
+   int numValues = 2 * numBands;
+   int dayInBlock = index - header.ausBlockFirstDay[block];
+   bool fOk = (iRet >= 1 + (2 * numValues)) && (dayInBlock < pBlock[0]);
+
+   uint16_t ausValues[SCHEDULE_MAX_VALUES];
+   int pos = 1;
+
+   for (int i = 0; fOk && (i < numValues); i++, pos += 2)
+   {
+      ausValues[i] = schedule_get_u16(&pBlock[pos]);
+   }
+
+   //  walk forward through the changes to the day we want.
+   for (int day = 0; fOk && (day < dayInBlock); day++)
+   {
+      for (int i = 0; i < numValues; i++)
+      {
+         if (pos >= iRet)
+         {
+            fOk = false;
+            break;
+         }
+
+         int8_t delta = (int8_t) pBlock[pos++];
+         if (delta != SCHEDULE_ESCAPE)
+         {
+            ausValues[i] += delta;
+         }
+         else if (pos + 2 <= iRet)
+         {
+            ausValues[i] = schedule_get_u16(&pBlock[pos]);
+            pos += 2;
+         }
+         else
+         {
+            fOk = false;
+            break;
+         }
+      }
+   }
+
+   free(pBlock);
+
+   if (!fOk)
+   {
+      return false;
+   }
+
+   for (int i = 0; i < numBands; i++)
+   {
+      aDawnMinutes[i] = (int16_t) ausValues[i];
+      aDuskMinutes[i] = (int16_t) ausValues[numBands + i];
+   }
+
+   return true;
+
+}  /* end of twilight_schedule_lookup */
+
+
+// ------------------------------------------------
+//  Building
+
+
+///  Write out the block being filled, and start a new one.
+static bool schedule_flush_block(ScheduleBuild *pB)
+{
+
+   ScheduleHeader *pH = &pB->header;
+
+   if (pB->usBlockBytes == 0)
+   {
+      return true;
+   }
+
+   if (persist_write_data(SCHEDULE_KEY_FIRST + pH->numBlocks, pB->aBlock, pB->usBlockBytes)
+          != pB->usBlockBytes)
+   {
+      return false;
+   }
+
+   pH->numBlocks++;
+   pB->usFlashBytes += pB->usBlockBytes;
+   pB->usBlockBytes = 0;
+   return true;
+
+}  /* end of schedule_flush_block */
+
+
+/**
+ *  Add one day's values to the block being filled, starting a new block
+ *  if they don't fit.
+ *
+ *  @return \c false if out of blocks or the write failed.
+ */
+static bool schedule_add_day(ScheduleBuild *pB, const uint16_t ausValues[])
+{
+
+   ScheduleHeader *pH = &pB->header;
+   int numValues = 2 * pH->numBands;
+
+   //  Worst case for a day that's not first in its block: all escaped.
+   if ((pB->usBlockBytes > 0) &&
+       (pB->usBlockBytes + (3 * numValues) > SCHEDULE_BLOCK_BYTES))
+   {
+      if (!schedule_flush_block(pB))
+      {
+         return false;
+      }
+   }
+
+   if (pB->usBlockBytes == 0)
+   {
+      if (pH->numBlocks == SCHEDULE_MAX_BLOCKS)
+      {
+         return false;
+      }
+
+      //  First day of a block is stored whole.
+      pH->ausBlockFirstDay[pH->numBlocks] = pH->usDays;
+      pB->aBlock[0] = 0;
+      pB->usBlockBytes = 1;
+      for (int i = 0; i < numValues; i++)
+      {
+         pB->aBlock[pB->usBlockBytes++] = ausValues[i] & 0xFF;
+         pB->aBlock[pB->usBlockBytes++] = ausValues[i] >> 8;
+      }
+   }
+   else
+   {
+      for (int i = 0; i < numValues; i++)
+      {
+         int delta = (int) ausValues[i] - (int) pB->ausPrev[i];
+         if ((delta > -128) && (delta <= 127))
+         {
+            pB->aBlock[pB->usBlockBytes++] = (uint8_t) (int8_t) delta;
+         }
+         else
+         {
+            pB->aBlock[pB->usBlockBytes++] = (uint8_t) SCHEDULE_ESCAPE;
+            pB->aBlock[pB->usBlockBytes++] = ausValues[i] & 0xFF;
+            pB->aBlock[pB->usBlockBytes++] = ausValues[i] >> 8;
+         }
+      }
+   }
+
+   pB->aBlock[0]++;
+   memcpy(pB->ausPrev, ausValues, numValues * sizeof(ausValues[0]));
+   pH->usDays++;
+
+   return true;
+
+}  /* end of schedule_add_day */
+
+
+///  Finish a build: the header goes to flash, and the schedule into use.
+static void schedule_finish(ScheduleBuild *pB)
+{
+
+   if (schedule_flush_block(pB) && (pB->header.usDays > 0) &&
+       (persist_write_data(SCHEDULE_KEY_HEADER, &pB->header, sizeof(pB->header))
+           == (int) sizeof(pB->header)))
+   {
+      header = pB->header;
+
+      //  Blocks past ours, from a longer schedule (or an older version
+      //  that allowed more), would only hold on to flash.
+      for (int key = SCHEDULE_KEY_FIRST + header.numBlocks;
+           key <= PERSIST_KEY_SCHEDULE_LAST; key++)
+      {
+         persist_delete(key);
+      }
+
+      APP_LOG(APP_LOG_LEVEL_DEBUG,
+              "schedule: %d days in %d blocks, %d bytes flash, %d bytes RAM (%d while building)",
+              header.usDays, header.numBlocks,
+              (int) (sizeof(header) + pB->usFlashBytes),
+              (int) sizeof(header), (int) sizeof(ScheduleBuild));
+
+      if (builtCallback != NULL)
+      {
+         TwilightScheduleStats stats;
+         stats.usDays       = header.usDays;
+         stats.usFlashBytes = sizeof(header) + pB->usFlashBytes;
+         stats.ulBuildMs    = pB->ulBuildMs;
+         (*builtCallback)(&stats);
+      }
+   }
+
+}  /* end of schedule_finish */
+
+
+///  TaskScheduler step: work out the next few days of a build.
+static bool twilight_schedule_step(void *pContext)
+{
+
+   ScheduleBuild *pB = (ScheduleBuild *) pContext;
+
+   time_t   startSecs, endSecs;
+   uint16_t startMs, endMs;
+   time_ms(&startSecs, &startMs);
+
+   ScheduleHeader *pH = &pB->header;
+   int numBands = pH->numBands;
+
+   int numDays = TWILIGHT_SCHEDULE_DAYS - pH->usDays;
+   if (numDays > SCHEDULE_DAYS_PER_STEP)
+   {
+      numDays = SCHEDULE_DAYS_PER_STEP;
+   }
+
+   float aRise[SCHEDULE_DAYS_PER_STEP * TWILIGHT_SCHEDULE_MAX_BANDS];
+   float aSet[SCHEDULE_DAYS_PER_STEP * TWILIGHT_SCHEDULE_MAX_BANDS];
+
+   //  (the date is treated as UTC, as twilight_path_compute_current() does.)
+   if (!calcSunRiseSetDays(pB->year, pB->dayOfYear, numDays,
+                           pH->iLatitude * (1.0f / CONFIG_DATA_DEGREE_SCALE),
+                           pH->iLongitude * (1.0f / CONFIG_DATA_DEGREE_SCALE),
+                           pB->aZeniths, numBands, aRise, aSet))
+   {
+      //  more bands than the solver takes: give up, leaving no schedule.
+      APP_LOG(APP_LOG_LEVEL_WARNING, "schedule: can't work out %d bands", numBands);
+      return true;
+   }
+
+   bool fFull = false;
+   for (int day = 0; (day < numDays) && !fFull; day++)
+   {
+      uint16_t ausValues[SCHEDULE_MAX_VALUES];
+      for (int i = 0; i < numBands; i++)
+      {
+         ausValues[i] = (uint16_t) twilight_path_utc_to_minute(aRise[(day * numBands) + i]);
+         ausValues[numBands + i] = (uint16_t) twilight_path_utc_to_minute(aSet[(day * numBands) + i]);
+      }
+
+      //  (out of room: keep what fits.)
+      fFull = !schedule_add_day(pB, ausValues);
+   }
+
+   time_ms(&endSecs, &endMs);
+   pB->ulBuildMs += ((endSecs - startSecs) * 1000) + endMs - startMs;
+
+   //  calcSunRiseSetDays() has its own rollover; keep up with it.
+   for (int day = 0; day < numDays; day++)
+   {
+      if (++pB->dayOfYear > calcDayOfYear(pB->year, 12, 31))
+      {
+         pB->dayOfYear = 1;
+         pB->year++;
+      }
+   }
+
+   if (fFull || (pH->usDays >= TWILIGHT_SCHEDULE_DAYS))
+   {
+      schedule_finish(pB);
+      return true;
+   }
+
+   return false;
+
+}  /* end of twilight_schedule_step */
+
+
+///  TaskScheduler done callback: the build is over.
+static void twilight_schedule_done(void *pContext)
+{
+   (void) pContext;
+
+   free(pBuild);
+   pBuild = NULL;
+}
+
+
+bool  twilight_schedule_is_current(int numBands, const struct tm *pLocalTime)
+{
+
+   schedule_read_header();
+
+   int index = schedule_day_index(&header, pLocalTime);
+   return (header.usDays > 0) && (header.numBands == numBands) &&
+          schedule_location_ok(&header) &&
+          (index >= 0) && (index + TWILIGHT_SCHEDULE_REFILL_DAYS <= header.usDays);
+
+}  /* end of twilight_schedule_is_current */
+
+
+/**
+ *  Set up pBuild for a new schedule starting on the given day, at the
+ *  present location, and remove the old schedule.
+ *
+ *  @return \c true if ready, \c false if there is no location or no memory.
+ */
+static bool schedule_start_build(int numBands, const struct tm *pLocalTime)
+{
+
+   int32_t latitude, longitude, utcOffset;
+   if (!config_data_location_get_scaled(&latitude, &longitude, &utcOffset))
+   {
+      return false;
+   }
+
+   pBuild = malloc(sizeof(ScheduleBuild));
+   if (pBuild == NULL)
+   {
+      return false;
+   }
+   memset(pBuild, 0, sizeof(*pBuild));
+
+   ScheduleHeader *pH = &pBuild->header;
+   pH->usVersion = SCHEDULE_VERSION;
+   pH->year      = pLocalTime->tm_year;
+   pH->yday      = pLocalTime->tm_yday;
+   pH->numBands  = numBands;
+   pH->iLatitude  = latitude;
+   pH->iLongitude = longitude;
+   pH->iUtcOffset = utcOffset;
+
+   pBuild->year = pLocalTime->tm_year;
+   pBuild->dayOfYear = calcDayOfYear(pLocalTime->tm_year, pLocalTime->tm_mon + 1,
+                                     pLocalTime->tm_mday);
+
+   //  Old schedule goes now: its header first, so it's never read part-overwritten.
+   persist_delete(SCHEDULE_KEY_HEADER);
+   memset(&header, 0, sizeof(header));
+
+   return true;
+
+}  /* end of schedule_start_build */
+
+
+void  twilight_schedule_refresh(const float aZeniths[], int numBands,
+                                const struct tm *pLocalTime)
+{
+
+   if ((pBuild != NULL) || (numBands > TWILIGHT_SCHEDULE_MAX_BANDS) ||
+       twilight_schedule_is_current(numBands, pLocalTime) ||
+       !schedule_start_build(numBands, pLocalTime))
+   {
+      return;
+   }
+
+   memcpy(pBuild->aZeniths, aZeniths, numBands * sizeof(aZeniths[0]));
+
+   //  Low priority: nothing waits on it, as the day's times are worked out
+   //  live until it is done.
+   pBuild->task = task_scheduler_submit(twilight_schedule_step, twilight_schedule_done,
+                                        pBuild, TASK_PRIORITY_LOW);
+   if (pBuild->task == TASK_HANDLE_NONE)
+   {
+      twilight_schedule_done(pBuild);
+   }
+
+}  /* end of twilight_schedule_refresh */
+
+
+// ------------------------------------------------
+//  Building from times worked out elsewhere
+
+
+bool  twilight_schedule_stream_begin(int numBands, const struct tm *pLocalTime)
+{
+
+   if ((pBuild != NULL) || (numBands > TWILIGHT_SCHEDULE_MAX_BANDS))
+   {
+      return false;
+   }
+
+   //  (no task: days come in as twilight_schedule_stream_add_day() is called.)
+   return schedule_start_build(numBands, pLocalTime);
+
+}  /* end of twilight_schedule_stream_begin */
+
+
+///  A UTC minute of the day as a local one, by the schedule's UTC offset.
+static uint16_t schedule_local_minute(const ScheduleHeader *pH, int16_t utcMinute)
+{
+
+   if (utcMinute == TWILIGHT_NO_MINUTE)
+   {
+      return (uint16_t) TWILIGHT_NO_MINUTE;
+   }
+
+   //  (local time plus iUtcOffset is UTC)
+   int minute = (utcMinute - (pH->iUtcOffset / 60)) % TWILIGHT_MINUTES_PER_DAY;
+   return (uint16_t) ((minute < 0) ? (minute + TWILIGHT_MINUTES_PER_DAY) : minute);
+
+}  /* end of schedule_local_minute */
+
+
+bool  twilight_schedule_stream_add_day(const int16_t aUtcDawnMinutes[],
+                                       const int16_t aUtcDuskMinutes[])
+{
+
+   if ((pBuild == NULL) || (pBuild->task != TASK_HANDLE_NONE) ||
+       (pBuild->header.usDays >= TWILIGHT_SCHEDULE_DAYS))
+   {
+      return false;
+   }
+
+   ScheduleHeader *pH = &pBuild->header;
+   uint16_t ausValues[SCHEDULE_MAX_VALUES];
+   for (int i = 0; i < pH->numBands; i++)
+   {
+      ausValues[i] = schedule_local_minute(pH, aUtcDawnMinutes[i]);
+      ausValues[pH->numBands + i] = schedule_local_minute(pH, aUtcDuskMinutes[i]);
+   }
+
+   return schedule_add_day(pBuild, ausValues);
+
+}  /* end of twilight_schedule_stream_add_day */
+
+
+int  twilight_schedule_stream_days(void)
+{
+   return ((pBuild == NULL) || (pBuild->task != TASK_HANDLE_NONE)) ?
+             -1 : pBuild->header.usDays;
+}
+
+
+void  twilight_schedule_stream_end(bool fKeep)
+{
+
+   if ((pBuild == NULL) || (pBuild->task != TASK_HANDLE_NONE))
+   {
+      return;
+   }
+
+   if (fKeep)
+   {
+      schedule_finish(pBuild);
+   }
+
+   twilight_schedule_done(pBuild);
+
+}  /* end of twilight_schedule_stream_end */
+
+
+void  twilight_schedule_reload(void)
+{
+   fHeaderRead = false;
+}
+
+
+void  twilight_schedule_set_built_callback(TwilightScheduleBuiltCallback callback)
+{
+   builtCallback = callback;
+}
+
+
+void  twilight_schedule_cancel(void)
+{
+
+   if (pBuild == NULL)
+   {
+      return;
+   }
+
+   if (pBuild->task != TASK_HANDLE_NONE)
+   {
+      task_scheduler_cancel(pBuild->task);
+   }
+   twilight_schedule_done(pBuild);
+
+}  /* end of twilight_schedule_cancel */
@@ -0,0 +1,150 @@
+/**
+ *  @file
+ *
+ *  Twilight band times for the days ahead, worked out in the background
+ *  and kept in watch flash, so that the daily update is just a table
+ *  lookup.
+ *
+ *  Each day is one minute-of-day value per band dawn and dusk.  Days are
+ *  grouped into blocks of one persist_* key each: the first day of a block
+ *  is stored whole, and each later day as one signed byte per value giving
+ *  its change from the day before (a few minutes at most, away from the
+ *  poles).  Changes too big for a byte are escaped and stored whole.
+ *
+ *  The schedule is for one location.  Small moves (up to
+ *  TWILIGHT_SCHEDULE_MAX_DRIFT_KM) leave it in use, so that the usual
+ *  jitter in phone location fixes doesn't cost a rebuild.
+ */
+
+#pragma once
+
+#include  "pebble.h"
+
+#include  "PersistBudget.h"
+
+
+///  PebbleOS persist_* key of the schedule's header (see PersistBudget.h).
+///  Its blocks go in the keys after it.
+#define  TWILIGHT_SCHEDULE_KEY_HEADER    PERSIST_KEY_SCHEDULE_HEADER
+
+///  Days ahead the schedule covers, from the day it is (re)built.
+#define  TWILIGHT_SCHEDULE_DAYS          90
+
+///  Rebuild once fewer than this many days are left.
+#define  TWILIGHT_SCHEDULE_REFILL_DAYS   7
+
+///  Rebuild if the location moves further than this from where the
+///  schedule was built.  At mid latitudes, 10 km moves sunrise by 30 s or so.
+#define  TWILIGHT_SCHEDULE_MAX_DRIFT_KM  10
+
+///  Most band dawn / dusk pairs per day.
+#define  TWILIGHT_SCHEDULE_MAX_BANDS     4
+
+
+///  What a finished build made, and what it cost.
+typedef struct
+{
+   ///  Days in the schedule.
+   uint16_t usDays;
+
+   ///  Flash used by the schedule, header included.
+   uint16_t usFlashBytes;
+
+   ///  Time spent working out the days, not counting flash writes.
+   uint32_t ulBuildMs;
+
+} TwilightScheduleStats;
+
+///  See twilight_schedule_set_built_callback().
+typedef void (*TwilightScheduleBuiltCallback)(const TwilightScheduleStats *pStats);
+
+
+/**
+ *  Look up dawn and dusk of each band for a day.
+ *
+ *  @param pLocalTime Local date wanted.
+ *  @param aDawnMinutes Receives numBands dawn times, as minutes of the
+ *             day, or TWILIGHT_NO_MINUTE.
+ *  @param aDuskMinutes Likewise for dusk.
+ *  @param numBands Bands wanted.  Must match what the schedule was built
+ *             with.
+ *
+ *  @return \c true if found, \c false if the schedule doesn't cover that
+ *          day at the present location (or isn't built yet).
+ */
+bool  twilight_schedule_lookup(const struct tm *pLocalTime, int16_t aDawnMinutes[],
+                               int16_t aDuskMinutes[], int numBands);
+
+/**
+ *  Is the schedule good for some days yet, at the present location?  If
+ *  not, twilight_schedule_refresh() would start a rebuild.
+ *
+ *  @param numBands Bands wanted.
+ *  @param pLocalTime Local date of today.
+ */
+bool  twilight_schedule_is_current(int numBands, const struct tm *pLocalTime);
+
+/**
+ *  Start a rebuild of the schedule if it is missing, running out, or for
+ *  somewhere else.  The work is done a few days at a time as a low
+ *  priority TaskScheduler task, so this returns right away.  Does nothing if a rebuild is
+ *  already under way.
+ *
+ *  @param aZeniths Zenith angle of each band, in degrees.
+ *  @param numBands Entries in aZeniths.  At most TWILIGHT_SCHEDULE_MAX_BANDS.
+ *  @param pLocalTime Local date of the first day to schedule (today).
+ */
+void  twilight_schedule_refresh(const float aZeniths[], int numBands,
+                                const struct tm *pLocalTime);
+
+///  Stop any rebuild under way.  The part-built schedule is discarded.
+void  twilight_schedule_cancel(void);
+
+/**
+ *  Start a new schedule whose times are worked out elsewhere (by the
+ *  phone), and fed in a day at a time with twilight_schedule_stream_add_day().
+ *  The old schedule is removed.  The location is the present one.
+ *
+ *  @param numBands Dawn / dusk pairs per day.  At most TWILIGHT_SCHEDULE_MAX_BANDS.
+ *  @param pLocalTime Local date of the first day (today).
+ *
+ *  @return \c true if started, \c false if a build is already under way,
+ *          or there is no location or memory.
+ */
+bool  twilight_schedule_stream_begin(int numBands, const struct tm *pLocalTime);
+
+/**
+ *  Add the next day to a schedule started by twilight_schedule_stream_begin().
+ *  Full blocks are written to flash as they fill.
+ *
+ *  @param aUtcDawnMinutes Dawn of each band, as minutes of the UTC day, or
+ *             TWILIGHT_NO_MINUTE.
+ *  @param aUtcDuskMinutes Likewise for dusk.
+ *
+ *  @return \c true if added, \c false if there is no streamed build, it
+ *          is full, or a flash write failed.
+ */
+bool  twilight_schedule_stream_add_day(const int16_t aUtcDawnMinutes[],
+                                       const int16_t aUtcDuskMinutes[]);
+
+///  Days added to the streamed build so far, or -1 if there is none.
+int  twilight_schedule_stream_days(void);
+
+/**
+ *  Finish a streamed build.
+ *
+ *  @param fKeep \c true to put the days added so far into use (a short
+ *             schedule is still good for the days it has), \c false to
+ *             discard them.
+ */
+void  twilight_schedule_stream_end(bool fKeep);
+
+/**
+ *  Forget the RAM copy of the schedule's header, so that the next lookup
+ *  reads it from flash again.  For when another process (the background
+ *  worker) has written a new schedule.
+ */
+void  twilight_schedule_reload(void);
+
+///  Have callback called after each build is written to flash.  NULL for none.
+void  twilight_schedule_set_built_callback(TwilightScheduleBuiltCallback callback);
@@ -8,3 +8,14 @@
 //NOTE: Change false to true if you want to enable the vibe function
 #define HOUR_VIBRATION false
 
+
+/**
+ *  Change 0 to 1 to compute twilight times with the integer-only solar
+ *  engine (suncalc_fixed.c) rather than the float one.  The watch has no
+ *  FPU, so every float operation goes through the soft-float runtime.
+ *  
+ *  Left off: times are worked out a schedule at a time, in the background,
+ *  so the float engine's cost is seldom paid; and near polar day or night
+ *  the fixed-point one is over a minute further out (test_suncalc_fixed).
+ */
+#define SUNCALC_USE_FIXED_POINT 0
@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include  <stddef.h>
+#include  <stdint.h>
+
 
 ///  Helper for destroying a possibly allocated Pebble entity.
 #define SAFE_DESTROY(prefix, pAlloc) \
@@ -15,3 +18,19 @@
       pAlloc = NULL;                 \
    }
 
+
+/**
+ *  32-bit FNV-1a hash of a block of memory.  Used to tag results saved in
+ *  flash with the inputs they were worked out from: hashed structures
+ *  should be cleared first, so padding doesn't count.
+ */
+static inline uint32_t  fnv1a32(const void *pData, size_t size)
+{
+   uint32_t hash = 2166136261UL;
+   const uint8_t *pBytes = (const uint8_t *) pData;
+   for (size_t i = 0; i < size; i++)
+   {
+      hash = (hash ^ pBytes[i]) * 16777619UL;
+   }
+   return hash;
+}
@@ -32,6 +32,34 @@ var locationOptions = { "enableHighAccuracy ": false,
                         "timeout": 10000,
                         "maximumAge": 60000};
  
+///  Layout version of the "location" byte array.  Must match the watch's
+///  APP_MSG_LOCATION_VERSION (messaging.h), as must the limits below.
+var locationVersion = 1;
+
+///  Most UTC offset changes sent ahead, and the longest failure message text.
+var maxUtcOffsetChanges = 2;
+var maxFailMessageChars = 31;
+
+///  How far ahead we look for UTC offset (DST) changes, in days.
+var utcOffsetLookaheadDays = 366;
+
+///  Twilight schedule messages: layout version and largest chunk, as the
+///  watch's APP_MSG_SCHEDULE_VERSION and APP_MSG_SCHEDULE_CHUNK_MAX_BYTES.
+var scheduleVersion = 1;
+var scheduleChunkMaxBytes = 55;
+var scheduleChunkFixedBytes = 7;
+
+///  Schedule chunks sent ahead of the watch's acks.
+var scheduleWindowChunks = 4;
+
+///  Go back to the first unacked chunk if no ack comes for this long (ms),
+///  at most this many times in a row.
+var scheduleAckTimeout = 5000;
+var scheduleMaxRetries = 5;
+
+///  Schedule stream under way, or null.
+var scheduleStream = null;
+
 ///  Last "real" (non-CANCELLED) response received for webviewclosed
 var realResponse = "";
 
@@ -123,6 +151,117 @@ function displayCoords(coords) {
 }
 
 
+/**
+ *  Append a little-endian integer to a byte array.
+ *  
+ *  @param bytes Array to append to.
+ *  @param value Integer value.  Negative values are sent as two's complement.
+ *  @param numBytes Size of the integer in bytes.
+ */
+function pushLittleEndian(bytes, value, numBytes) {
+   "use strict";
+
+   var i;
+   for (i = 0; i < numBytes; i++) {
+      bytes.push(value & 0xFF);
+      value = value >> 8;    // (after the last byte, no longer matters.)
+   }
+}
+
+
+/**
+ *  UTC offset in the watch's sense (seconds to add to local time to get UTC)
+ *  in effect at a given time.
+ */
+function utcOffsetAt(msecs) {
+   "use strict";
+
+   return new Date(msecs).getTimezoneOffset() * 60;
+}
+
+
+/**
+ *  Find the coming changes of UTC offset (DST starting or ending), so the
+ *  watch can apply them on its own.
+ *  
+ *  @param nowMsecs Time to look ahead from, as from Date.getTime().
+ *  
+ *  @return Array of up to maxUtcOffsetChanges { "time": UTC seconds,
+ *          "utcOffset": seconds } objects, soonest first.
+ */
+function findUtcOffsetChanges(nowMsecs) {
+   "use strict";
+
+   var changes = [];
+   var dayMsecs = 24 * 60 * 60 * 1000;
+   var lastMsecs = nowMsecs;
+   var lastOffset = utcOffsetAt(nowMsecs);
+   var day;
+
+   for (day = 1; (day <= utcOffsetLookaheadDays) &&
+                 (changes.length < maxUtcOffsetChanges); day++) {
+      var dayMsecsAhead = nowMsecs + (day * dayMsecs);
+      var offset = utcOffsetAt(dayMsecsAhead);
+      if (offset !== lastOffset) {
+         //  changed during the last day: narrow down to the minute.
+         var before = lastMsecs;
+         var after = dayMsecsAhead;
+         while (after - before > 60000) {
+            var middle = Math.floor((before + after) / 2);
+            if (utcOffsetAt(middle) === lastOffset) {
+               before = middle;
+            }
+            else {
+               after = middle;
+            }
+         }
+
+         //  after is within the minute following the change, and changes
+         //  happen on the minute.
+         changes.push({ "time": Math.floor(after / 60000) * 60,
+                        "utcOffset": offset });
+         lastOffset = offset;
+      }
+      lastMsecs = dayMsecsAhead;
+   }
+
+   return changes;
+}
+
+
+/**
+ *  Pack a location fix into the "location" byte array the watch expects.
+ *  See MSG_KEY_LOCATION in messaging.h for the layout.
+ */
+function packLocation(pos, utcOffset) {
+   "use strict";
+
+   var coordinates = pos.coords;
+   var changes = findUtcOffsetChanges(new Date().getTime());
+   var accuracy = Math.min(Math.round(coordinates.accuracy || 0xFFFF), 0xFFFF);
+   var fixTime = Math.floor((pos.timestamp || new Date().getTime()) / 1000);
+   var bytes = [];
+   var i;
+
+   bytes.push(locationVersion);
+   bytes.push(changes.length);
+   pushLittleEndian(bytes, Math.round(coordinates.latitude * 1000000), 4);
+   pushLittleEndian(bytes, Math.round(coordinates.longitude * 1000000), 4);
+   pushLittleEndian(bytes, utcOffset, 4);
+   pushLittleEndian(bytes, fixTime, 4);
+   pushLittleEndian(bytes, accuracy, 2);
+
+   for (i = 0; i < changes.length; i++) {
+      console.log("UTC offset becomes " + changes[i].utcOffset + " at " +
+                  new Date(changes[i].time * 1000).toString());
+      pushLittleEndian(bytes, changes[i].time, 4);
+      pushLittleEndian(bytes, changes[i].utcOffset, 4);
+   }
+
+   return bytes;
+}
+
+
 function locationSuccess(pos) {
    "use strict";
 
@@ -140,13 +279,10 @@ function locationSuccess(pos) {
                " / " + coordinates.longitude + ", utcOff secs = " + utcOffset);
 
    if (coordsToPebble) {
-      //  Even though the coords are floats sendAppMessage transfers them as int32,
-      //  dropping the fractional part.  So we make it official, using a scaled integer
-      //  representation.  This is easier to handle in the Pebble anyway, since float
-      //  string parsing support isn't present.
-      Pebble.sendAppMessage({"latitudeData":  Math.round(coordinates.latitude * 1000000),
-                            "longitudeData": Math.round(coordinates.longitude * 1000000),
-                            "utcOffset": utcOffset});
+      //  One packed byte array, rather than a dictionary entry per value:
+      //  coords as scaled integers (the watch has no float parsing), plus
+      //  the fix's time and accuracy and the coming DST changes.
+      Pebble.sendAppMessage({"location": packLocation(pos, utcOffset)});
 
       if (showSendInitiatedPage) {
          showSendInitiatedPage = false;
@@ -169,8 +305,9 @@ function sendLocationError(code, message) {
    "use strict";
 
    if (coordsToPebble) {
+      //  (the watch's inbox only has room for a short message.)
       Pebble.sendAppMessage({"locationFailCode": code,
-                             "locationFailMessage": message
+                             "locationFailMessage": String(message).substring(0, maxFailMessageChars)
                             });
    }
    else {
@@ -211,6 +348,286 @@ function outerTimeoutError() {
 }
 
 
+// ------------------------------------------------
+//  Twilight schedule: a port of the watch's suncalc.c (float engine),
+//  with the phone's doubles in place of its approximations.
+
+
+var degToRad = Math.PI / 180;
+
+///  As the watch's calcDayOfYear(): day of year, 1 - 366.
+function calcDayOfYear(year, month, day) {
+   "use strict";
+
+   var N1 = Math.floor(275 * month / 9);
+   var N2 = Math.floor((month + 9) / 12);
+   var N3 = (1 + Math.floor((year - 4 * Math.floor(year / 4) + 2) / 3));
+   return N1 - (N2 * N3) + day - 30;
+}
+
+///  As the watch's calcSunPosition(): steps 2 - 6 of the almanac algorithm.
+function calcSunPosition(N, lngHour, sunset) {
+   "use strict";
+
+   var t = N + (((sunset ? 18 : 6) - lngHour) / 24);
+
+   var M = (0.9856 * t) - 3.289;
+
+   var L = M + (1.916 * Math.sin(M * degToRad)) + (0.020 * Math.sin(2 * M * degToRad)) + 282.634;
+   if (L < 0) { L += 360; }
+   if (L > 360) { L -= 360; }
+
+   var RA = Math.atan(0.91764 * Math.tan(L * degToRad)) / degToRad;
+   if (RA < 0) { RA += 360; }
+   if (RA > 360) { RA -= 360; }
+
+   RA += (Math.floor(L / 90) * 90) - (Math.floor(RA / 90) * 90);
+   RA /= 15;
+
+   var sinDec = 0.39782 * Math.sin(L * degToRad);
+
+   return { "eqnTime": RA - (0.06571 * t) - 6.622,
+            "sinDec": sinDec,
+            "cosDec": Math.cos(Math.asin(sinDec)) };
+}
+
+///  As the watch's calcSunEventTime(): UTC hours, or null for none.
+function calcSunEventTime(pos, lngHour, sinLat, cosLat, sunset, cosZenith) {
+   "use strict";
+
+   var cosH = (cosZenith - (pos.sinDec * sinLat)) / (pos.cosDec * cosLat);
+   if ((cosH > 1) || (cosH < -1)) {
+      return null;
+   }
+
+   var H = Math.acos(cosH) / degToRad;
+   if (!sunset) {
+      H = 360 - H;
+   }
+
+   var UT = (H / 15) + pos.eqnTime - lngHour;
+   if (UT < 0) { UT += 24; }
+   if (UT > 24) { UT -= 24; }
+   return UT;
+}
+
+///  UTC hours as the watch's minute of the UTC day, 0xFFFF for none.
+function utcMinute(hours) {
+   "use strict";
+
+   return (hours === null) ? 0xFFFF : (Math.round(hours * 60) % (24 * 60));
+}
+
+/**
+ *  As the watch's calcSunRiseSetDays(), for a run of days from a date.
+ *  
+ *  @return Array per day of [dawn minute of each band, then dusk minute
+ *          of each band], as utcMinute() gives.
+ */
+function calcScheduleDays(year, month, day, numDays, latitude, longitude, zeniths) {
+   "use strict";
+
+   var lngHour = longitude / 15;
+   var sinLat = Math.sin(latitude * degToRad);
+   var cosLat = Math.cos(latitude * degToRad);
+   var N = calcDayOfYear(year, month, day);
+   var daysInYear = calcDayOfYear(year, 12, 31);
+   var days = [];
+   var d, i;
+
+   for (d = 0; d < numDays; d++) {
+      var posRise = calcSunPosition(N, lngHour, false);
+      var posSet = calcSunPosition(N, lngHour, true);
+      var dawns = [];
+      var dusks = [];
+
+      for (i = 0; i < zeniths.length; i++) {
+         var cosZenith = Math.cos(zeniths[i] * degToRad);
+         dawns.push(utcMinute(calcSunEventTime(posRise, lngHour, sinLat, cosLat, false, cosZenith)));
+         dusks.push(utcMinute(calcSunEventTime(posSet, lngHour, sinLat, cosLat, true, cosZenith)));
+      }
+      days.push(dawns.concat(dusks));
+
+      if (++N > daysInYear) {
+         N = 1;
+         year++;
+         daysInYear = calcDayOfYear(year, 12, 31);
+      }
+   }
+
+   return days;
+}
+
+
+///  Little-endian unsigned value from a byte array.
+function readLittleEndian(bytes, offset, numBytes) {
+   "use strict";
+
+   var value = 0;
+   var i;
+   for (i = numBytes - 1; i >= 0; i--) {
+      value = (value * 256) + bytes[offset + i];
+   }
+   return value;
+}
+
+
+///  Send the schedule chunk starting at a day.
+function sendScheduleChunk(stream, firstDay) {
+   "use strict";
+
+   var numDays = Math.min(stream.daysPerChunk, stream.totalDays - firstDay);
+   var bytes = [scheduleVersion, stream.numBands];
+   var d, i;
+
+   pushLittleEndian(bytes, firstDay, 2);
+   pushLittleEndian(bytes, stream.totalDays, 2);
+   bytes.push(numDays);
+   for (d = firstDay; d < firstDay + numDays; d++) {
+      for (i = 0; i < stream.days[d].length; i++) {
+         pushLittleEndian(bytes, stream.days[d][i], 2);
+      }
+   }
+
+   stream.chunksSent++;
+   stream.bytesSent += bytes.length;
+
+   //  (a failed send shows up as a missing ack.)
+   Pebble.sendAppMessage({"scheduleChunk": bytes});
+
+   return numDays;
+}
+
+
+function scheduleAckTimedOut() {
+   "use strict";
+
+   var stream = scheduleStream;
+   stream.timer = null;
+
+   if (++stream.retries > scheduleMaxRetries) {
+      console.warn("schedule: no ack for day " + stream.acked + ", giving up");
+      scheduleStream = null;
+      return;
+   }
+
+   //  go back to the first day not acked.
+   stream.nextToSend = stream.acked;
+   sendScheduleWindow();
+}
+
+
+///  Send chunks until the window is full, and (re)start the ack timer.
+function sendScheduleWindow() {
+   "use strict";
+
+   var stream = scheduleStream;
+   var windowEnd = stream.acked + (scheduleWindowChunks * stream.daysPerChunk);
+
+   while ((stream.nextToSend < stream.totalDays) && (stream.nextToSend < windowEnd)) {
+      stream.nextToSend += sendScheduleChunk(stream, stream.nextToSend);
+   }
+
+   if (stream.timer !== null) {
+      window.clearTimeout(stream.timer);
+   }
+   stream.timer = window.setTimeout(scheduleAckTimedOut, scheduleAckTimeout);
+}
+
+
+/**
+ *  Watch wants twilight schedule days: work them out and start sending.
+ *  See MSG_KEY_SCHEDULE_REQUEST in messaging.h for the layout.
+ */
+function scheduleRequestReceived(bytes) {
+   "use strict";
+
+   if ((bytes.length < 18) || (bytes[0] !== scheduleVersion)) {
+      console.warn("schedule: bad request");
+      return;
+   }
+
+   var numBands = bytes[1];
+   var firstDay = readLittleEndian(bytes, 2, 2);
+   var totalDays = readLittleEndian(bytes, 4, 2);
+   var year = readLittleEndian(bytes, 6, 2);
+   var latitude = (readLittleEndian(bytes, 10, 4) | 0) / 1000000;
+   var longitude = (readLittleEndian(bytes, 14, 4) | 0) / 1000000;
+   var zeniths = [];
+   var i;
+   for (i = 0; i < numBands; i++) {
+      zeniths.push(readLittleEndian(bytes, 18 + (4 * i), 4) / 1000);
+   }
+
+   if (scheduleStream !== null) {
+      //  a resume: start again from wherever the watch says.
+      if (scheduleStream.timer !== null) {
+         window.clearTimeout(scheduleStream.timer);
+      }
+   }
+
+   var start = new Date().getTime();
+   var days = calcScheduleDays(year, bytes[8], bytes[9], totalDays,
+                               latitude, longitude, zeniths);
+
+   scheduleStream = {
+      "numBands": numBands,
+      "totalDays": totalDays,
+      "daysPerChunk": Math.floor((scheduleChunkMaxBytes - scheduleChunkFixedBytes) /
+                                 (2 * 2 * numBands)),
+      "days": days,
+      "acked": firstDay,
+      "nextToSend": firstDay,
+      "retries": 0,
+      "timer": null,
+      "start": start,
+      "chunksSent": 0,
+      "bytesSent": 0
+   };
+
+   console.log("schedule: " + totalDays + " days from day " + firstDay + " at " +
+               latitude + " / " + longitude + " worked out in " +
+               (new Date().getTime() - start) + " ms");
+
+   sendScheduleWindow();
+}
+
+
+///  Watch has every day before nextDay.
+function scheduleAckReceived(nextDay) {
+   "use strict";
+
+   var stream = scheduleStream;
+   if (stream === null) {
+      return;
+   }
+
+   if (nextDay >= stream.totalDays) {
+      window.clearTimeout(stream.timer);
+      console.log("schedule: " + stream.totalDays + " days sent in " +
+                  (new Date().getTime() - stream.start) + " ms, " + stream.chunksSent +
+                  " chunks, " + stream.bytesSent + " bytes");
+      scheduleStream = null;
+      return;
+   }
+
+   if (nextDay > stream.acked) {
+      stream.acked = nextDay;
+      stream.retries = 0;
+   }
+   else if (stream.nextToSend > stream.acked) {
+      //  the watch dropped a chunk, and everything we sent after it: go back.
+      //  (only once per chunk, though each of those after it is acked the same.)
+      if (stream.rewoundAt !== nextDay) {
+         stream.rewoundAt = nextDay;
+         stream.nextToSend = nextDay;
+      }
+   }
+
+   sendScheduleWindow();
+}
+
+
 function setOuterTimer() {
    "use strict";
 
@@ -377,6 +794,14 @@ Pebble.addEventListener("appmessage",
                               timeout = -1;
                            }
 
+                           if (e.payload.scheduleRequest !== undefined) {
+                              scheduleRequestReceived(e.payload.scheduleRequest);
+                           }
+
+                           if (e.payload.scheduleAck !== undefined) {
+                              scheduleAckReceived(e.payload.scheduleAck);
+                           }
+
                            if (e.payload.getLatLong){
                               // Note: without this dummy read of getLatLong, writes back
                               // to the watch never seem to complete. ??!!?
@@ -6,10 +6,18 @@
 
 #include  <pebble.h>
 
+#include  "Benchmark.h"
 #include  "ConfigData.h"
+#include  "MathSweep.h"
 #include  "messaging.h"
 #include  "MessageWindow.h"
+#include  "RefreshPolicy.h"
+#include  "ScheduleStream.h"
+#include  "SolarWorker.h"
 #include  "sunclock.h"
+#include  "suncalc.h"
+#include  "TaskScheduler.h"
+#include  "testing.h"
 
 
 
@@ -17,11 +25,9 @@
  *  Where coords data initially comes when received from the phone.
  *  We check system state and update with coords as needed.
  * 
- * @param latitude 
- * @param longitude 
- * @param utcOffset Seconds to add to watch's time() value in order to obtain UTC.
+ * @param pLocation Location fix, and the UTC offset now and to come.
  */
-void coords_recvd_callback(float latitude, float longitude, int32_t utcOffset)
+void coords_recvd_callback(const AppMsgLocation *pLocation)
 {
 
    //  Got data now, so if we had an error / search message window up,
@@ -29,7 +35,7 @@ void coords_recvd_callback(float latitude, float longitude, int32_t utcOffset)
    message_window_hide();
 
    //  Pass data on to main watchface window.
-   sunclock_coords_recvd(latitude, longitude, utcOffset);
+   sunclock_coords_recvd(pLocation);
 
 }  /* end of coords_recvd_callback */
 
@@ -41,6 +47,8 @@ void coords_failed_callback (FailureSource eErrSrc,
    APP_LOG(APP_LOG_LEVEL_DEBUG, "coords failure, src=%d, err=%d, msg=\"%s\"",
            (int) eErrSrc, (int) errCode, pszErrMsg);
 
+   refresh_policy_query_failed(eErrSrc, errCode);
+
    if (config_data_location_avail())
    {
       //  already have locally persisted location info, so silently ignore this.
@@ -58,9 +66,30 @@ int  main()
    //  make sure config data can be read before setting up main window
    config_data_init();
 
+   refresh_policy_init();
+
+#if TESTING_COMPARE_SUNCALC_FIXED
+   if (config_data_location_avail())
+   {
+      suncalc_fixed_compare(config_data_get_latitude(), config_data_get_longitude());
+   }
+#endif
+
+#if TESTING_BENCHMARK_DAILY_UPDATE
+   benchmark_run();
+#endif
+
+#if TESTING_SWEEP_MY_MATH
+   math_sweep_run();
+#endif
+
    //  want to have messaging up for whichever window needs it.
    app_msg_init(coords_recvd_callback, coords_failed_callback);
 
+   solar_worker_init();
+
+   schedule_stream_init();
+
    sunclock_handle_init();
 
    message_window_init();
@@ -74,9 +103,21 @@ int  main()
 
    app_msg_deinit();
 
+   //  keeps whatever part of a schedule has come from the phone.
+   schedule_stream_deinit();
+
+   solar_worker_deinit();
+
    message_window_deinit();
 
    sunclock_handle_deinit();
 
+   refresh_policy_deinit();
+
+   //  write any location change held back to spare flash.
+   config_data_deinit();
+
+   task_scheduler_deinit();
+
 }  /* end of main() */
 
@@ -19,33 +19,49 @@ static app_msg_coords_recvd_callback  coords_recvd_callback = 0;
 
 static app_msg_coords_failed_callback coords_failed_callback = 0;
 
+static app_msg_schedule_chunk_callback schedule_chunk_callback = 0;
+
 
 ///  When a request is already outstanding, another one will be ignored.
 ///  [Curiously, that volatile qualifier seems to be needed when replies
 ///   get stacked up.]
 static volatile bool  fRequestOutstanding = false;
 
-///  When the currently outstanding request was submitted.
-static time_t timeRequestSubmitted;
+///  Sends of the outstanding request so far, first included.
+static uint8_t numAttempts = 0;
+
+///  Times the outstanding request found the outbox busy.
+static uint8_t numBusy = 0;
+
+///  Next send of the outstanding request, if one is waiting on a timer.
+static AppTimer *pRetryTimer = NULL;
+
+///  Gives up on the outstanding request if its answer doesn't come.
+static AppTimer *pAnswerTimer = NULL;
 
-///  Max elapsed time before we give up on retries for a request.
-#define  RETRY_TIMEOUT  20  /* time_t == seconds */
+///  Is the outstanding request waiting for the phone to connect?
+static bool fWaitingForConnection = false;
+
+///  Counts of our dealings with the phone since launch.
+static AppMsgStats stats;
+
+///  stats as they were at the last fix, to log the costs of each.
+static AppMsgStats statsLastFix;
 
 ///  "Safe" copy of error message in failure tuple received from phone.
-static char achErrMessage[64];
+static char achErrMessage[APP_MSG_FAIL_MESSAGE_BYTES];
 
 
-static bool  app_msg_RequestLatLong_internal(void)
+/**
+ *  Send a message of one tuplet to the phone.
+ * 
+ *  @return \c true if the message is on its way, else \c false.
+ */
+static bool  app_msg_send_tuplet(const Tuplet *pTuplet)
 {
 
    bool fMyRet = true;
 
-#if TESTING_DISABLE_LOCATION_REQUEST
-   return true;
-#endif
-
-   Tuplet fetch_tuple = TupletInteger(MSG_KEY_GET_LAT_LONG, 1); 
-
    DictionaryIterator *iter;
    AppMessageResult amRet;
 
@@ -65,7 +81,7 @@ static bool  app_msg_RequestLatLong_internal(void)
 
    DictionaryResult dRet;
 
-   dRet = dict_write_tuplet(iter, &fetch_tuple);
+   dRet = dict_write_tuplet(iter, pTuplet);
    if (dRet != DICT_OK)
    {
       APP_LOG(APP_LOG_LEVEL_DEBUG, "dict_write_tuplet failed, ret = %04X", dRet);
@@ -83,6 +99,7 @@ static bool  app_msg_RequestLatLong_internal(void)
 
    if (fMyRet)
    {
+      stats.usRadioWakeups++;
       amRet = app_message_outbox_send();
       if (amRet != APP_MSG_OK)
       {
@@ -93,9 +110,199 @@ static bool  app_msg_RequestLatLong_internal(void)
 
    return fMyRet;
 
+}  /* end of app_msg_send_tuplet */
+
+
+static bool  app_msg_RequestLatLong_internal(void)
+{
+
+#if TESTING_DISABLE_LOCATION_REQUEST
+   return true;
+#endif
+
+   Tuplet fetch_tuple = TupletInteger(MSG_KEY_GET_LAT_LONG, 1); 
+
+   return app_msg_send_tuplet(&fetch_tuple);
+
 }  /* end of app_msg_RequestLatLong_internal(void) */
 
 
+static void  app_msg_retry_timer_callback(void *pData);
+
+
+/**
+ *  Have the outstanding request sent again after a while.
+ *  
+ *  @param delayMs Nominal delay.  The actual one is somewhere between half
+ *             and all of it, so that retries don't fall into step with
+ *             whatever is keeping the link busy.
+ */
+static void  app_msg_schedule_retry(uint32_t delayMs)
+{
+
+   if (pRetryTimer != NULL)
+   {
+      return;
+   }
+
+   delayMs = (delayMs / 2) + (rand() % ((delayMs / 2) + 1));
+   pRetryTimer = app_timer_register(delayMs, app_msg_retry_timer_callback, NULL);
+
+}  /* end of app_msg_schedule_retry */
+
+
+///  Retry delay after numAttempts sends: doubles each time, up to a limit.
+static uint32_t  app_msg_backoff_ms(void)
+{
+   uint32_t delayMs = APP_MSG_RETRY_FIRST_MS << (numAttempts - 1);
+
+   return (delayMs > APP_MSG_RETRY_MAX_MS) ? APP_MSG_RETRY_MAX_MS : delayMs;
+}
+
+
+///  Stop waiting for the answer to the outstanding request.
+static void  app_msg_cancel_answer_timer(void)
+{
+   if (pAnswerTimer != NULL)
+   {
+      app_timer_cancel(pAnswerTimer);
+      pAnswerTimer = NULL;
+   }
+}
+
+
+///  Give up on the outstanding request, and tell the requestor why.
+static void  app_msg_request_failed(int32_t errCode, const char *pszErrMsg)
+{
+   fRequestOutstanding = false;
+   app_msg_cancel_answer_timer();
+
+   (*coords_failed_callback)(FAIL_SRC_APP_MSG, errCode, pszErrMsg);
+}
+
+
+/**
+ *  The outbox (ours, or the phone's inbox) is in use by another message.
+ *  Not the link's fault, so try again soon, without counting it as a send.
+ */
+static void  app_msg_request_busy(void)
+{
+
+   if (++numBusy <= APP_MSG_BUSY_MAX_RETRIES)
+   {
+      app_msg_schedule_retry(APP_MSG_BUSY_RETRY_MS);
+   }
+   else
+   {
+      app_msg_request_failed(APP_MSG_BUSY, "comms busy");
+   }
+
+}  /* end of app_msg_request_busy */
+
+
+///  No answer APP_MSG_ANSWER_TIMEOUT_SECS after the last send.
+static void  app_msg_answer_timer_callback(void *pData)
+{
+   (void) pData;
+
+   pAnswerTimer = NULL;
+
+   if (fRequestOutstanding && (pRetryTimer == NULL) && !fWaitingForConnection)
+   {
+      //  The phone took the request, but its answer was lost on the way
+      //  back.  Ask again, as for a lost send; but don't take later
+      //  requests as repeats of this one forever.
+      if (numAttempts < APP_MSG_RETRY_MAX_ATTEMPTS)
+      {
+         app_msg_schedule_retry(app_msg_backoff_ms());
+      }
+      else
+      {
+         app_msg_request_failed(APP_MSG_FAIL_RETRY_LIMIT, "No answer");
+      }
+   }
+
+}  /* end of app_msg_answer_timer_callback */
+
+
+///  Send the outstanding request.
+static void  app_msg_send_request(void)
+{
+
+   if (app_msg_RequestLatLong_internal())
+   {
+      numAttempts++;
+
+      //  (a failed send cancels this, and retries or gives up instead.)
+      app_msg_cancel_answer_timer();
+      pAnswerTimer = app_timer_register(APP_MSG_ANSWER_TIMEOUT_SECS * 1000,
+                                        app_msg_answer_timer_callback, NULL);
+   }
+   else
+   {
+      //  most likely busy with a schedule message.
+      stats.usOutboxFailures++;
+      app_msg_request_busy();
+   }
+
+}  /* end of app_msg_send_request */
+
+
+static void  app_msg_retry_timer_callback(void *pData)
+{
+   (void) pData;
+
+   pRetryTimer = NULL;
+
+   if (fRequestOutstanding && !fWaitingForConnection)
+   {
+      stats.usRetries++;
+      app_msg_send_request();
+   }
+
+}  /* end of app_msg_retry_timer_callback */
+
+
+///  Phone app (dis)connected, while a request waits for it.
+static void  app_msg_connection_handler(bool fConnected)
+{
+
+   if (!fConnected)
+   {
+      return;
+   }
+
+   connection_service_unsubscribe();
+   fWaitingForConnection = false;
+
+   if (fRequestOutstanding)
+   {
+      //  a fresh start: the earlier failures weren't the link's fault.
+      numAttempts = 0;
+      numBusy = 0;
+      app_msg_send_request();
+   }
+
+}  /* end of app_msg_connection_handler */
+
+
+///  Hold the outstanding request until the phone app connects.
+static void  app_msg_wait_for_connection(void)
+{
+
+   if (fWaitingForConnection)
+   {
+      return;
+   }
+
+   fWaitingForConnection = true;
+   connection_service_subscribe((ConnectionHandlers) {
+      .pebble_app_connection_handler = app_msg_connection_handler
+   });
+
+}  /* end of app_msg_wait_for_connection */
+
+
 bool  app_msg_RequestLatLong(void)
 {
    if (fRequestOutstanding)
@@ -105,11 +312,183 @@ bool  app_msg_RequestLatLong(void)
    }
 
    fRequestOutstanding = true;
-   timeRequestSubmitted = time(NULL);
-   return app_msg_RequestLatLong_internal();
+   numAttempts = 0;
+   numBusy = 0;
+   stats.usRequests++;
+
+   if (!connection_service_peek_pebble_app_connection())
+   {
+      //  no use trying until the phone is there.
+      app_msg_wait_for_connection();
+      return true;
+   }
+
+   app_msg_send_request();
+   return true;
+}
+
+
+void  app_msg_get_stats(AppMsgStats *pStats)
+{
+   *pStats = stats;
+}
+
+
+///  Little-endian 32 bit value from a message byte array.
+static uint32_t  app_msg_read_uint32(const uint8_t *pBytes)
+{
+   return ((uint32_t) pBytes[0]) | ((uint32_t) pBytes[1] << 8) |
+          ((uint32_t) pBytes[2] << 16) | ((uint32_t) pBytes[3] << 24);
+}
+
+///  Little-endian 16 bit value from a message byte array.
+static uint16_t  app_msg_read_uint16(const uint8_t *pBytes)
+{
+   return pBytes[0] | (pBytes[1] << 8);
+}
+
+///  Append a little-endian value of numBytes bytes to a message byte array.
+static uint8_t *  app_msg_write_le(uint8_t *pBytes, uint32_t value, int numBytes)
+{
+   for (int i = 0; i < numBytes; i++)
+   {
+      *pBytes++ = (uint8_t) value;
+      value >>= 8;
+   }
+   return pBytes;
+}
+
+
+bool  app_msg_request_schedule(const AppMsgScheduleRequest *pRequest)
+{
+
+   uint8_t aBytes[APP_MSG_SCHEDULE_REQUEST_FIXED_BYTES + (4 * APP_MSG_SCHEDULE_MAX_BANDS)];
+
+   if ((pRequest->numBands == 0) || (pRequest->numBands > APP_MSG_SCHEDULE_MAX_BANDS))
+   {
+      return false;
+   }
+
+   uint8_t *p = aBytes;
+   *p++ = APP_MSG_SCHEDULE_VERSION;
+   *p++ = pRequest->numBands;
+   p = app_msg_write_le(p, pRequest->usFirstDay, 2);
+   p = app_msg_write_le(p, pRequest->usDays, 2);
+   p = app_msg_write_le(p, pRequest->usYear, 2);
+   *p++ = pRequest->month;
+   *p++ = pRequest->mday;
+   p = app_msg_write_le(p, (uint32_t) pRequest->latitude, 4);
+   p = app_msg_write_le(p, (uint32_t) pRequest->longitude, 4);
+   for (int i = 0; i < pRequest->numBands; i++)
+   {
+      p = app_msg_write_le(p, pRequest->aZeniths[i], 4);
+   }
+
+   Tuplet request_tuple = TupletBytes(MSG_KEY_SCHEDULE_REQUEST, aBytes, p - aBytes);
+
+   return app_msg_send_tuplet(&request_tuple);
+
+}  /* end of app_msg_request_schedule */
+
+
+bool  app_msg_ack_schedule(uint16_t usNextDay)
+{
+   Tuplet ack_tuple = TupletInteger(MSG_KEY_SCHEDULE_ACK, usNextDay);
+
+   return app_msg_send_tuplet(&ack_tuple);
 }
 
 
+void  app_msg_set_schedule_callback(app_msg_schedule_chunk_callback callback)
+{
+   schedule_chunk_callback = callback;
+}
+
+
+int16_t  app_msg_schedule_chunk_minute(const AppMsgScheduleChunk *pChunk, int day, int value)
+{
+   int index = (day * 2 * pChunk->numBands) + value;
+
+   uint16_t minute = app_msg_read_uint16(&pChunk->pTimes[2 * index]);
+
+   return (minute == 0xFFFF) ? -1 : (int16_t) minute;
+}
+
+
+/**
+ *  Decode a MSG_KEY_SCHEDULE_CHUNK byte array.  The times are left in
+ *  place, so *pChunk is only good while the tuple is.
+ * 
+ *  @return \c true if it was good, else \c false.
+ */
+static bool  app_msg_decode_schedule_chunk(const Tuple *pTuple, AppMsgScheduleChunk *pChunk)
+{
+
+   const uint8_t *pBytes = pTuple->value->data;
+
+   if ((pTuple->type != TUPLE_BYTE_ARRAY) ||
+       (pTuple->length < APP_MSG_SCHEDULE_CHUNK_FIXED_BYTES) ||
+       (pBytes[0] != APP_MSG_SCHEDULE_VERSION) ||
+       (pBytes[1] == 0) || (pBytes[1] > APP_MSG_SCHEDULE_MAX_BANDS) ||
+       (pTuple->length < APP_MSG_SCHEDULE_CHUNK_FIXED_BYTES +
+                         (pBytes[6] * 2 * 2 * pBytes[1])))
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "bad schedule chunk, %d bytes", pTuple->length);
+      return false;
+   }
+
+   pChunk->numBands    = pBytes[1];
+   pChunk->usFirstDay  = app_msg_read_uint16(&pBytes[2]);
+   pChunk->usTotalDays = app_msg_read_uint16(&pBytes[4]);
+   pChunk->numDays     = pBytes[6];
+   pChunk->pTimes      = &pBytes[APP_MSG_SCHEDULE_CHUNK_FIXED_BYTES];
+
+   return true;
+
+}  /* end of app_msg_decode_schedule_chunk */
+
+
+/**
+ *  Decode a MSG_KEY_LOCATION byte array.
+ * 
+ *  @return \c true if it was good, else \c false.
+ */
+static bool  app_msg_decode_location(const Tuple *pTuple, AppMsgLocation *pLocation)
+{
+
+   const uint8_t *pBytes = pTuple->value->data;
+
+   if ((pTuple->type != TUPLE_BYTE_ARRAY) ||
+       (pTuple->length < APP_MSG_LOCATION_FIXED_BYTES) ||
+       (pBytes[0] != APP_MSG_LOCATION_VERSION) ||
+       (pBytes[1] > APP_MSG_MAX_UTC_OFFSET_CHANGES) ||
+       (pTuple->length < APP_MSG_LOCATION_FIXED_BYTES +
+                         (pBytes[1] * APP_MSG_LOCATION_CHANGE_BYTES)))
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "bad location message, %d bytes", pTuple->length);
+      return false;
+   }
+
+   pLocation->numUtcOffsetChanges = pBytes[1];
+   pLocation->latitude   = (int32_t) app_msg_read_uint32(&pBytes[2]);
+   pLocation->longitude  = (int32_t) app_msg_read_uint32(&pBytes[6]);
+   pLocation->utcOffset  = (int32_t) app_msg_read_uint32(&pBytes[10]);
+   pLocation->timeFix    = (time_t) app_msg_read_uint32(&pBytes[14]);
+   pLocation->usAccuracy = pBytes[18] | (pBytes[19] << 8);
+
+   const uint8_t *pChange = &pBytes[APP_MSG_LOCATION_FIXED_BYTES];
+   for (int i = 0; i < pLocation->numUtcOffsetChanges; i++)
+   {
+      pLocation->aUtcOffsetChanges[i].timeChange = (time_t) app_msg_read_uint32(&pChange[0]);
+      pLocation->aUtcOffsetChanges[i].utcOffset  = (int32_t) app_msg_read_uint32(&pChange[4]);
+      pChange += APP_MSG_LOCATION_CHANGE_BYTES;
+   }
+
+   return true;
+
+}  /* end of app_msg_decode_location */
+
+
 /** 
  *  Callback function notified by the app_message_* Pebble subsystem
  *  when the watch has received a message from the phone.
@@ -121,44 +500,82 @@ bool  app_msg_RequestLatLong(void)
  */
 static void in_received_handler(DictionaryIterator *iter, void *context)
 {
-   Tuple *lat_tuple = dict_find(iter, MSG_KEY_LATITUDE);
-   Tuple *long_tuple = dict_find(iter, MSG_KEY_LONGITUDE);
-   Tuple *utcOff_tuple = dict_find(iter, MSG_KEY_UTC_OFFSET);
+   Tuple *location_tuple = 0;
+   Tuple *chunk_tuple = 0;
    Tuple *errCode_tuple = 0;
    Tuple *errMsg_tuple = 0;
 
-   if ((lat_tuple != 0) && (long_tuple != 0) && (utcOff_tuple != 0))
+   //  one pass over the message for everything we might want.
+   for (Tuple *pTuple = dict_read_first(iter); pTuple != 0; pTuple = dict_read_next(iter))
    {
-      fRequestOutstanding = false;
+      switch (pTuple->key)
+      {
+         case MSG_KEY_LOCATION:
+            location_tuple = pTuple;
+            break;
 
-      //  Our coordinates come back as scaled integer degrees, where the original
-      //  float values have been multiplied by 1000000 and then rounded.
-      //  We convert them back to float since that is what the app needs.
+         case MSG_KEY_SCHEDULE_CHUNK:
+            chunk_tuple = pTuple;
+            break;
 
-      if (coords_recvd_callback != 0)
-      {
-         float fLat = lat_tuple->value->int32;
-         fLat /= 1000000;
-         float fLong = long_tuple->value->int32;
-         fLong /= 1000000;
+         case MSG_KEY_FAIL_CODE:
+            errCode_tuple = pTuple;
+            break;
 
-         (*coords_recvd_callback)(fLat, fLong, utcOff_tuple->value->int32); 
+         case MSG_KEY_FAIL_MESSAGE:
+            errMsg_tuple = pTuple;
+            break;
       }
    }
-   else
+
+   if (chunk_tuple != 0)
    {
-      errCode_tuple = dict_find(iter, MSG_KEY_FAIL_CODE);
-      errMsg_tuple = dict_find(iter, MSG_KEY_FAIL_MESSAGE);
+      AppMsgScheduleChunk chunk;
 
-      if ((errCode_tuple != 0) && (errMsg_tuple != 0))
+      if ((schedule_chunk_callback != 0) &&
+          app_msg_decode_schedule_chunk(chunk_tuple, &chunk))
       {
-         strncpy(achErrMessage, errMsg_tuple->value->cstring, sizeof(achErrMessage));
+         (*schedule_chunk_callback)(&chunk);
+      }
+   }
+
+   if (location_tuple != 0)
+   {
+      AppMsgLocation location;
 
-         //  relay phone-reported error to requestor:
-         (*coords_failed_callback)(FAIL_SRC_PHONE,
-                                   errCode_tuple->value->uint32, achErrMessage);
+      if (app_msg_decode_location(location_tuple, &location))
+      {
+         fRequestOutstanding = false;
+         if (pRetryTimer != NULL)
+         {
+            app_timer_cancel(pRetryTimer);
+            pRetryTimer = NULL;
+         }
+         app_msg_cancel_answer_timer();
+
+         stats.usFixes++;
+         APP_LOG(APP_LOG_LEVEL_DEBUG,
+                 "fix %d: %d radio wakeups, %d outbox failures (all fixes: %d, %d)",
+                 stats.usFixes, stats.usRadioWakeups - statsLastFix.usRadioWakeups,
+                 stats.usOutboxFailures - statsLastFix.usOutboxFailures,
+                 stats.usRadioWakeups, stats.usOutboxFailures);
+         statsLastFix = stats;
+
+         if (coords_recvd_callback != 0)
+         {
+            (*coords_recvd_callback)(&location);
+         }
       }
    }
+   else if ((errCode_tuple != 0) && (errMsg_tuple != 0))
+   {
+      strncpy(achErrMessage, errMsg_tuple->value->cstring, sizeof(achErrMessage) - 1);
+      achErrMessage[sizeof(achErrMessage) - 1] = '\0';
+
+      //  relay phone-reported error to requestor:
+      (*coords_failed_callback)(FAIL_SRC_PHONE,
+                                errCode_tuple->value->uint32, achErrMessage);
+   }
 }
 
 
@@ -170,32 +587,52 @@ static void in_dropped_handler(AppMessageResult reason, void *context)
 
 static void out_failed_handler(DictionaryIterator *failed, AppMessageResult reason, void *context)
 {
-   static int failCount = 0;
-   failCount ++;
+   stats.usOutboxFailures++;
    APP_LOG(APP_LOG_LEVEL_DEBUG, "App Message Failed to Send! [%d]  reason = %04X",
-           failCount, reason);
+           stats.usOutboxFailures, reason);
+
+   if (dict_find(failed, MSG_KEY_GET_LAT_LONG) == 0)
+   {
+      //  schedule request or ack: the schedule stream times out and asks
+      //  again by itself.
+      return;
+   }
+
    if (fRequestOutstanding)
    {
-      if (reason == APP_MSG_SEND_TIMEOUT)
+      //  That send was never taken, so there's no answer to wait for.
+      app_msg_cancel_answer_timer();
+
+      if ((reason == APP_MSG_SEND_TIMEOUT) || (reason == APP_MSG_APP_NOT_RUNNING))
       {
-         if ((time(NULL) - timeRequestSubmitted) < RETRY_TIMEOUT)
+         if (numAttempts < APP_MSG_RETRY_MAX_ATTEMPTS)
          {
             //  Worth trying again, at least a few times.  It seems that, perhaps
             //  especially during watch/phone app startup, app_message_* is lossy.
+            //  Backing off gives the phone app time to start, rather than
+            //  keeping the radio busy asking.
             //  [Then other times, we seem to get multiple (2?) requests stacked up
             //   and keep getting answers back after we stop asking.  This is tidied
             //   via fRequestOutstanding.]
-            app_msg_RequestLatLong_internal();
+            app_msg_schedule_retry(app_msg_backoff_ms());
          }
          else
          {
-            fRequestOutstanding = false;
-
             //  Let requestor know about watch/phone comms failure:
-            (*coords_failed_callback)(FAIL_SRC_APP_MSG,
-                                      01, "Send retry timeout");
+            app_msg_request_failed(APP_MSG_FAIL_RETRY_LIMIT, "Send retry limit");
          }
       }
+      else if (reason == APP_MSG_BUSY)
+      {
+         app_msg_request_busy();
+      }
+      else if (reason == APP_MSG_NOT_CONNECTED)
+      {
+         //  Tell the requestor (who may show it), but keep the request to
+         //  send when the phone is back, rather than polling for it.
+         app_msg_wait_for_connection();
+         (*coords_failed_callback)(FAIL_SRC_APP_MSG, reason, "not connected");
+      }
       else
       {
          const char * pszReason;
@@ -263,7 +700,7 @@ static void out_failed_handler(DictionaryIterator *failed, AppMessageResult reas
                pszReason = "unknown, see int code";
          }
 
-         (*coords_failed_callback)(FAIL_SRC_APP_MSG, reason, pszReason);
+         app_msg_request_failed(reason, pszReason);
       }
    }
 }
@@ -279,6 +716,9 @@ void  app_msg_init(app_msg_coords_recvd_callback successCallback,
 
    fRequestOutstanding = false;
 
+   //  (for retry jitter.)
+   srand(time(NULL));
+
    // Register PebbleOS message handlers
    app_message_register_inbox_received(in_received_handler);
    app_message_register_inbox_dropped(in_dropped_handler);
@@ -287,8 +727,21 @@ void  app_msg_init(app_msg_coords_recvd_callback successCallback,
    // Init buffers
 
    //  Pebble's current minima are larger than we need, and using the larger
-   //  values may cost heap we don't have.
-   app_message_open(min(64, APP_MESSAGE_INBOX_SIZE_MINIMUM),
+   //  values may cost heap we don't have.  In comes a location, a failure
+   //  code and message, or a schedule chunk; out goes a request or an ack.
+   uint32_t inboxSize = dict_calc_buffer_size(1, APP_MSG_LOCATION_MAX_BYTES);
+   uint32_t failSize = dict_calc_buffer_size(2, sizeof(int32_t), APP_MSG_FAIL_MESSAGE_BYTES);
+   uint32_t chunkSize = dict_calc_buffer_size(1, APP_MSG_SCHEDULE_CHUNK_MAX_BYTES);
+   if (failSize > inboxSize)
+   {
+      inboxSize = failSize;
+   }
+   if (chunkSize > inboxSize)
+   {
+      inboxSize = chunkSize;
+   }
+
+   app_message_open(min(inboxSize, APP_MESSAGE_INBOX_SIZE_MINIMUM),
                     min(64, APP_MESSAGE_OUTBOX_SIZE_MINIMUM));
 
    //  too early here: better for caller to explicitly request from window_load()
@@ -303,6 +756,25 @@ void app_msg_deinit(void)
    app_message_deregister_callbacks();
 
    coords_recvd_callback = 0;
+   schedule_chunk_callback = 0;
+
+   if (pRetryTimer != NULL)
+   {
+      app_timer_cancel(pRetryTimer);
+      pRetryTimer = NULL;
+   }
+   app_msg_cancel_answer_timer();
+
+   if (fWaitingForConnection)
+   {
+      connection_service_unsubscribe();
+      fWaitingForConnection = false;
+   }
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "app msg: %d requests, %d fixes, %d radio wakeups, "
+           "%d outbox failures, %d retries",
+           stats.usRequests, stats.usFixes, stats.usRadioWakeups,
+           stats.usOutboxFailures, stats.usRetries);
 
    fRequestOutstanding = false;
 
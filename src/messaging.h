@@ -11,30 +11,254 @@
 ///  Values must match those in our appinfo.json "appKeys" section.
 enum {
    MSG_KEY_GET_LAT_LONG = 0x0,      // arg ignored, key is the message.
-   MSG_KEY_LATITUDE = 0x1,          // scaled integer: degrees * 1000000
-   MSG_KEY_LONGITUDE = 0x2,         // scaled integer: degrees * 1000000
-   MSG_KEY_UTC_OFFSET = 0x3,        // integer offset from local time to UTC.
+   //  0x1 - 0x3 were separate latitude, longitude and UTC offset ints,
+   //  before MSG_KEY_LOCATION.
    MSG_KEY_FAIL_CODE = 0x4,         // integer? error from js w3c location API
    MSG_KEY_FAIL_MESSAGE = 0x5,      // cstring? error message from js w3c location API
+   MSG_KEY_LOCATION = 0x6,          // byte array, see APP_MSG_LOCATION_VERSION.
+   MSG_KEY_SCHEDULE_REQUEST = 0x7,  // byte array, see APP_MSG_SCHEDULE_VERSION.
+   MSG_KEY_SCHEDULE_CHUNK = 0x8,    // byte array, see APP_MSG_SCHEDULE_VERSION.
+   MSG_KEY_SCHEDULE_ACK = 0x9,      // integer, next schedule day wanted.
 };
 
 
+/**
+ *  Layout version of the MSG_KEY_LOCATION byte array, its first byte.
+ *  All fields are little-endian:
+ *  
+ *     0  uint8   version
+ *     1  uint8   count of UTC offset changes at the end, 0 - APP_MSG_MAX_UTC_OFFSET_CHANGES
+ *     2  int32   latitude, degrees * APP_MSG_DEGREE_SCALE
+ *     6  int32   longitude, degrees * APP_MSG_DEGREE_SCALE
+ *    10  int32   UTC offset now, in seconds
+ *    14  uint32  time of the fix, UTC seconds since 1970
+ *    18  uint16  accuracy of the fix, metres (0xFFFF for that or worse)
+ *    20  for each UTC offset change, soonest first:
+ *        uint32  UTC seconds since 1970 it happens
+ *        int32   UTC offset from then on, in seconds
+ *  
+ *  Changes are for DST starting or ending, so the watch can keep time with
+ *  no phone about.
+ */
+#define  APP_MSG_LOCATION_VERSION        1
+
+///  Units per degree of latitude / longitude in MSG_KEY_LOCATION.
+#define  APP_MSG_DEGREE_SCALE            1000000
+
+///  Most UTC offset changes one MSG_KEY_LOCATION message carries.
+#define  APP_MSG_MAX_UTC_OFFSET_CHANGES  2
+
+///  Bytes of MSG_KEY_LOCATION before the UTC offset changes, and of each change.
+#define  APP_MSG_LOCATION_FIXED_BYTES    20
+#define  APP_MSG_LOCATION_CHANGE_BYTES   8
+
+///  Largest MSG_KEY_LOCATION byte array.
+#define  APP_MSG_LOCATION_MAX_BYTES  \
+   (APP_MSG_LOCATION_FIXED_BYTES + (APP_MSG_MAX_UTC_OFFSET_CHANGES * APP_MSG_LOCATION_CHANGE_BYTES))
+
+///  Longest MSG_KEY_FAIL_MESSAGE, with its terminator.  The phone truncates to fit.
+#define  APP_MSG_FAIL_MESSAGE_BYTES      32
+
+
+/**
+ *  Layout version of the twilight schedule messages, their first byte.
+ *  The watch asks for days with MSG_KEY_SCHEDULE_REQUEST:
+ *  
+ *     0  uint8   version
+ *     1  uint8   bands, 1 - APP_MSG_SCHEDULE_MAX_BANDS
+ *     2  uint16  first day wanted, 0 for the date below (more to resume)
+ *     4  uint16  days in the whole schedule
+ *     6  uint16  year of day 0
+ *     8  uint8   month of day 0, 1 - 12
+ *     9  uint8   day of month of day 0
+ *    10  int32   latitude, degrees * APP_MSG_DEGREE_SCALE
+ *    14  int32   longitude, degrees * APP_MSG_DEGREE_SCALE
+ *    18  for each band:
+ *        uint32  zenith angle, degrees * 1000
+ *  
+ *  The phone answers with MSG_KEY_SCHEDULE_CHUNKs of a few days each:
+ *  
+ *     0  uint8   version
+ *     1  uint8   bands
+ *     2  uint16  index of the chunk's first day, which serves as its sequence number
+ *     4  uint16  days in the whole schedule
+ *     6  uint8   days in this chunk
+ *     7  for each day, dawn of each band then dusk of each band:
+ *        uint16  minute of the UTC day, 0 - 1439, or 0xFFFF for none
+ *  
+ *  The watch acks each chunk with MSG_KEY_SCHEDULE_ACK, giving the next
+ *  day it wants: chunks out of order are dropped and acked again, so the
+ *  phone goes back to the first day not yet acked.  All little-endian.
+ */
+#define  APP_MSG_SCHEDULE_VERSION        1
+
+///  Most bands a schedule request names.
+#define  APP_MSG_SCHEDULE_MAX_BANDS      4
+
+///  Bytes of MSG_KEY_SCHEDULE_REQUEST before the zeniths.
+#define  APP_MSG_SCHEDULE_REQUEST_FIXED_BYTES  18
+
+///  Bytes of MSG_KEY_SCHEDULE_CHUNK before the times.
+#define  APP_MSG_SCHEDULE_CHUNK_FIXED_BYTES    7
+
+/**
+ *  Largest MSG_KEY_SCHEDULE_CHUNK.  The phone fits as many days as it can:
+ *  three of four bands each.  Sized to keep the inbox within the 64 bytes
+ *  it was before the location message was packed.
+ */
+#define  APP_MSG_SCHEDULE_CHUNK_MAX_BYTES      55
+
+
+///  First retry of a location request after a send timeout, in ms.  Each
+///  retry after waits twice as long as the last, up to APP_MSG_RETRY_MAX_MS.
+#define  APP_MSG_RETRY_FIRST_MS          1000
+
+///  Longest wait between location request retries, in ms.
+#define  APP_MSG_RETRY_MAX_MS            8000
+
+///  Sends of a location request before giving up.
+#define  APP_MSG_RETRY_MAX_ATTEMPTS      6
+
+///  Wait before sending again when the outbox is busy, in ms, and the
+///  most times we wait for it.  These don't count as attempts.
+#define  APP_MSG_BUSY_RETRY_MS           250
+#define  APP_MSG_BUSY_MAX_RETRIES        20
+
+///  The phone answers within about 15 s (its getCurrentPosition() guard),
+///  so a request sent this long ago with no answer was lost on the way
+///  back.  It is sent again, with the same backoff and attempt limit as a
+///  failed send; then given up as failed, and a further
+///  app_msg_RequestLatLong() sends afresh, rather than being taken as a
+///  repeat.
+#define  APP_MSG_ANSWER_TIMEOUT_SECS     20
+
+///  errCode of a FAIL_SRC_APP_MSG failure when APP_MSG_RETRY_MAX_ATTEMPTS
+///  sends went unacknowledged or unanswered.  (Others are AppMessageResults.)
+#define  APP_MSG_FAIL_RETRY_LIMIT        1
+
+
+///  Counts of our dealings with the phone since launch.
+typedef struct
+{
+
+   ///  app_msg_RequestLatLong() calls which sent a request.
+   uint16_t usRequests;
+
+   ///  Locations received.
+   uint16_t usFixes;
+
+   ///  Messages handed to the radio, of every kind.
+   uint16_t usRadioWakeups;
+
+   ///  Messages which failed to send, or couldn't be started.
+   uint16_t usOutboxFailures;
+
+   ///  Location requests sent again after a failure.
+   uint16_t usRetries;
+
+} AppMsgStats;
+
+
+///  A UTC offset change, from MSG_KEY_LOCATION.
+typedef struct
+{
+   ///  When it happens: UTC seconds since 1970.
+   time_t   timeChange;
+
+   ///  UTC offset from then on, in seconds.
+   int32_t  utcOffset;
+
+} AppMsgUtcOffsetChange;
+
+///  Decoded MSG_KEY_LOCATION.
+typedef struct
+{
+
+   ///  Degrees from the equator times APP_MSG_DEGREE_SCALE, positive for North.
+   int32_t  latitude;
+
+   ///  Degrees from Greenwich times APP_MSG_DEGREE_SCALE, positive for East.
+   int32_t  longitude;
+
+   /**
+    *  Offset from Pebble / phone's local time to UTC, in seconds.
+    *  Note in the PST (winter) timezone, on Android (CM) 4.2.2, this
+    *  returns +8 hours.  So it really is an offset from local time to
+    *  UTC, and not the usual -8 hour timezone offset from UTC to local.
+    */
+   int32_t  utcOffset;
+
+   ///  When the phone got the fix: UTC seconds since 1970.
+   time_t   timeFix;
+
+   ///  Accuracy of the fix, in metres, or 0xFFFF for that or worse.
+   uint16_t usAccuracy;
+
+   ///  Upcoming UTC offset changes, soonest first.
+   uint8_t  numUtcOffsetChanges;
+   AppMsgUtcOffsetChange aUtcOffsetChanges[APP_MSG_MAX_UTC_OFFSET_CHANGES];
+
+} AppMsgLocation;
+
+
+///  Days wanted from the phone, for MSG_KEY_SCHEDULE_REQUEST.
+typedef struct
+{
+
+   ///  Entries used in aZeniths.
+   uint8_t  numBands;
+
+   ///  First day wanted, counting from the date below, and days in all.
+   uint16_t usFirstDay;
+   uint16_t usDays;
+
+   ///  Local date of day 0: year (e.g. 2015), month (1 - 12), day of month.
+   uint16_t usYear;
+   uint8_t  month;
+   uint8_t  mday;
+
+   ///  Location, degrees times APP_MSG_DEGREE_SCALE.
+   int32_t  latitude;
+   int32_t  longitude;
+
+   ///  Zenith angle of each band, degrees times 1000.
+   uint32_t aZeniths[APP_MSG_SCHEDULE_MAX_BANDS];
+
+} AppMsgScheduleRequest;
+
+///  Decoded MSG_KEY_SCHEDULE_CHUNK.
+typedef struct
+{
+
+   ///  Bands per day.
+   uint8_t  numBands;
+
+   ///  Index of the first day in the chunk, and days in the whole schedule.
+   uint16_t usFirstDay;
+   uint16_t usTotalDays;
+
+   ///  Days in the chunk.
+   uint8_t  numDays;
+
+   /**
+    *  numDays days of times as sent: per day, dawn of each band then dusk
+    *  of each band, as little-endian uint16 UTC minutes.  Read with
+    *  app_msg_schedule_chunk_minute().
+    */
+   const uint8_t *pTimes;
+
+} AppMsgScheduleChunk;
+
+
 /**
  *  Callback used to notify application when a location update has been received
  *  from the phone.  This is typically in response to an app_msg_RequestLatLong()
  *  call, but may also be initiated by the phone end.
  *  
- *  @param latitude Phone's most recently-known latitude value: degrees from the
- *             equator, positive for North, negative for South.
- *  @param longitude Phone's most recently-known longitude value: degrees from
- *             Greenwich, positive for East, negative for West.
- *  @param utcOffset Offset from Pebble / phone's local time to UTC, in seconds.
- *             Note in the PST (winter) timezone, on Android (CM) 4.2.2, this
- *             returns +8 hours.  So it really is an offset from local time to
- *             UTC, and not the usual -8 hour timezone offset from UTC to local.
+ *  @param pLocation Phone's most recently-known location.  Only valid
+ *             during the call.
  */
-typedef void (*app_msg_coords_recvd_callback) (float latitude, float longitude,
-                                               int32_t utcOffset);
+typedef void (*app_msg_coords_recvd_callback) (const AppMsgLocation *pLocation);
 
 typedef enum  {
    FAIL_SRC_APP_MSG,
@@ -48,6 +272,13 @@ typedef enum  {
 typedef void (*app_msg_coords_failed_callback) (FailureSource eErrSrc,
                                                 int32_t errCode, const char *pszErrMsg);
 
+/**
+ *  Callback used to pass on each twilight schedule chunk from the phone.
+ *  
+ *  @param pChunk The chunk.  Only valid during the call.
+ */
+typedef void (*app_msg_schedule_chunk_callback) (const AppMsgScheduleChunk *pChunk);
+
 
 /**
  *  Initialize the Pebble / phone communications subsystem, and supply a callback
@@ -77,8 +308,46 @@ void  app_msg_init(app_msg_coords_recvd_callback successCallback,
  *        made in response to this call.  There are many failure modes, not
  *        least if the phone has its bluetooth radio turned off.
  * 
- *  @return bool \c true if initial message processing is successful, else \c false.
+ *  Failed sends, and sends with no answer APP_MSG_ANSWER_TIMEOUT_SECS
+ *  later, are retried with backoff, up to APP_MSG_RETRY_MAX_ATTEMPTS sends.
+ *  If the phone is not connected, the request waits until it is.  After
+ *  the last, the failure callback is told (APP_MSG_FAIL_RETRY_LIMIT), and
+ *  a further call sends it afresh.
+ *  
+ *  @return bool \c true, as the request is either sent or will be.
  */
 bool  app_msg_RequestLatLong(void);
 
+/**
+ *  Ask the phone to work out twilight schedule days, which come back
+ *  through the callback given to app_msg_set_schedule_callback().
+ *  
+ *  @return \c true if the request is on its way, else \c false.
+ */
+bool  app_msg_request_schedule(const AppMsgScheduleRequest *pRequest);
+
+/**
+ *  Tell the phone which schedule day we want next: all before it are in.
+ *  
+ *  @return \c true if the ack is on its way, else \c false (the phone will
+ *          send again after a while anyway).
+ */
+bool  app_msg_ack_schedule(uint16_t usNextDay);
+
+///  Have schedule chunks passed to callback.  NULL to ignore them.
+void  app_msg_set_schedule_callback(app_msg_schedule_chunk_callback callback);
+
+/**
+ *  One time from a schedule chunk.
+ *  
+ *  @param day Day within the chunk, 0 - numDays - 1.
+ *  @param value Dawn of each band, then dusk of each band.
+ *  
+ *  @return Minute of the UTC day, or TWILIGHT_NO_MINUTE (-1).
+ */
+int16_t  app_msg_schedule_chunk_minute(const AppMsgScheduleChunk *pChunk, int day, int value);
+
+///  Counts since launch, for logging.
+void  app_msg_get_stats(AppMsgStats *pStats);
+
 void  app_msg_deinit(void);
@@ -33,9 +33,9 @@ float my_fabs(float x)
 
 float my_atan(float x)
 {
-  if (x>0) 
+  if (x>=0)
   {
-    return (M_PI/2)*(0.596227*x + x*x)/(1 + 2*0.596227*x + x*x);
+    return (M_PI/2)*(0.596227f*x + x*x)/(1 + 2*0.596227f*x + x*x);
   } 
   else
   {
@@ -46,8 +46,8 @@ float my_atan(float x)
 /* not quite rint(), i.e. results not properly rounded to nearest-or-even */
 float my_rint (float x)
 {
-  float t = my_floor (my_fabs(x) + 0.5);
-  return (x < 0.0) ? -t : t;
+  float t = my_floor (my_fabs(x) + 0.5f);
+  return (x < 0.0f) ? -t : t;
 }
 
 /* minimax approximation to cos on [-pi/4, pi/4] with rel. err. ~= 7.5e-13 */
@@ -58,9 +58,9 @@ float cos_core (float x)
   x4 = x2 * x2;
   x8 = x4 * x4;
   /* evaluate polynomial using Estrin's scheme */
-  return (-2.7236370439787708e-7 * x2 + 2.4799852696610628e-5) * x8 +
-         (-1.3888885054799695e-3 * x2 + 4.1666666636943683e-2) * x4 +
-         (-4.9999999999963024e-1 * x2 + 1.0000000000000000e+0);
+  return (-2.7236370439787708e-7f * x2 + 2.4799852696610628e-5f) * x8 +
+         (-1.3888885054799695e-3f * x2 + 4.1666666636943683e-2f) * x4 +
+         (-4.9999999999963024e-1f * x2 + 1.0000000000000000e+0f);
 }
 
 /* minimax approximation to sin on [-pi/4, pi/4] with rel. err. ~= 5.5e-12 */
@@ -70,8 +70,8 @@ float sin_core (float x)
   x2 = x * x;
   x4 = x2 * x2;
   /* evaluate polynomial using a mix of Estrin's and Horner's scheme */
-  return ((2.7181216275479732e-6 * x2 - 1.9839312269456257e-4) * x4 + 
-          (8.3333293048425631e-3 * x2 - 1.6666666640797048e-1)) * x2 * x + x;
+  return ((2.7181216275479732e-6f * x2 - 1.9839312269456257e-4f) * x4 + 
+          (8.3333293048425631e-3f * x2 - 1.6666666640797048e-1f)) * x2 * x + x;
 }
 
 /* minimax approximation to arcsin on [0, 0.5625] with rel. err. ~= 1.5e-11 */
@@ -82,22 +82,33 @@ float asin_core (float x)
   x4 = x2 * x2;
   x8 = x4 * x4;
   /* evaluate polynomial using a mix of Estrin's and Horner's scheme */
-  return (((4.5334220547132049e-2 * x2 - 1.1226216762576600e-2) * x4 +
-           (2.6334281471361822e-2 * x2 + 2.0596336163223834e-2)) * x8 +
-          (3.0582043602875735e-2 * x2 + 4.4630538556294605e-2) * x4 +
-          (7.5000364034134126e-2 * x2 + 1.6666666300567365e-1)) * x2 * x + x; 
+  return (((4.5334220547132049e-2f * x2 - 1.1226216762576600e-2f) * x4 +
+           (2.6334281471361822e-2f * x2 + 2.0596336163223834e-2f)) * x8 +
+          (3.0582043602875735e-2f * x2 + 4.4630538556294605e-2f) * x4 +
+          (7.5000364034134126e-2f * x2 + 1.6666666300567365e-1f)) * x2 * x + x; 
+}
+
+/* Cody-Waite style argument reduction: returns t = x - q * pi/2, with
+ * |t| <= pi/4, and sets *pQuadrant to q.  Shared by my_sin, my_cos and
+ * my_sincos so that a sin / cos pair costs only one reduction.
+ */
+static float my_reduce (float x, int *pQuadrant)
+{
+  float q, t;
+  q = my_rint (x * 6.3661977236758138e-1f);
+  *pQuadrant = (int)q;
+  /* (two-part split of pi/2 chosen for float, not double, arithmetic) */
+  t = x - q * 1.5707963705062866e+00f;
+  t = t - q * -4.3711388286737929e-08f;
+  return t;
 }
 
 /* relative error < 7e-12 on [-50000, 50000] */
 float my_sin (float x)
 {
-  float q, t;
+  float t;
   int quadrant;
-  /* Cody-Waite style argument reduction */
-  q = my_rint (x * 6.3661977236758138e-1);
-  quadrant = (int)q;
-  t = x - q * 1.5707963267923333e+00;
-  t = t - q * 2.5633441515945189e-12;
+  t = my_reduce (x, &quadrant);
   if (quadrant & 1) {
     t = cos_core(t);
   } else {
@@ -108,7 +119,38 @@ float my_sin (float x)
 
 float my_cos(float x)
 {
-  return my_sin(x + (M_PI/2));
+  float t;
+  int quadrant;
+  /* cos(x) = sin(x + pi/2), i.e. sin one quadrant on */
+  t = my_reduce (x, &quadrant);
+  quadrant++;
+  if (quadrant & 1) {
+    t = cos_core(t);
+  } else {
+    t = sin_core(t);
+  }
+  return (quadrant & 2) ? -t : t;
+}
+
+void my_sincos (float x, float *pSin, float *pCos)
+{
+  float t, s, c;
+  int quadrant;
+  t = my_reduce (x, &quadrant);
+  s = sin_core(t);
+  c = cos_core(t);
+  /* quadrant q turns (sin, cos) of t into: 0 (s, c), 1 (c, -s), 2 (-s, -c), 3 (-c, s) */
+  if (quadrant & 1) {
+    t = s;
+    s = c;
+    c = -t;
+  }
+  if (quadrant & 2) {
+    s = -s;
+    c = -c;
+  }
+  *pSin = s;
+  *pCos = c;
 }
 
 /* relative error < 2e-11 on [-1, 1] */
@@ -120,13 +162,13 @@ float my_acos (float x)
    * arccos(x) = pi/2 - arcsin(x)
    * arccos(x) = 2 * arcsin (sqrt ((1-x) / 2))
    */
-  if (xa > 0.5625) {
-    t = 2.0 * asin_core (my_sqrt (0.5 * (1.0 - xa)));
+  if (xa > 0.5625f) {
+    t = 2.0f * asin_core (my_sqrt (0.5f * (1.0f - xa)));
   } else {
-    t = 1.5707963267948966 - asin_core (xa);
+    t = 1.5707963267948966f - asin_core (xa);
   }
   /* arccos (-x) = pi - arccos(x) */
-  return (x < 0.0) ? (3.1415926535897932 - t) : t;
+  return (x < 0.0f) ? (3.1415926535897932f - t) : t;
 }
 
 float my_asin (float x)
@@ -136,7 +178,9 @@ float my_asin (float x)
 
 float my_tan(float x)
 {
-  return my_sin(x) / my_cos(x);
+  float s, c;
+  my_sincos(x, &s, &c);
+  return s / c;
 }
 
 float my_max(float x, float y)
@@ -8,7 +8,7 @@
 //  NB: IEEE single-precision float has a 24 bit significand,
 //      or about 7.2 significant decimal digits.
 //      Presumably, the extras given here don't hurt anything.
-#define M_PI 3.141592653589793
+#define M_PI 3.141592653589793f
 
 float my_sqrt(const float x);
 float my_floor(float x); 
@@ -17,6 +17,12 @@ float my_atan(float x);
 float my_rint (float x);
 float my_sin (float x);
 float my_cos(float x);
+
+/**
+ *  Sine and cosine of the same angle, sharing one argument reduction.
+ *  Much cheaper than my_sin() and my_cos() separately.
+ */
+void  my_sincos(float x, float *pSin, float *pCos);
 float my_acos (float x);
 float my_asin (float x);
 float my_tan(float x);
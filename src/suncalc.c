@@ -3,54 +3,56 @@
  *  
  */
 #include "suncalc.h"
+
+#include "config.h"
 #include "my_math.h"
+#include "SolarEphemeris.h"
 
-/** 
- *  Given a date and geographical location (lat/long), calculate
- *  rise or set time. Nominally of sun, but may be adjusted to
- *  return various twilight times instead by means of our zenith
- *  argument.
- *  
- *  Math based on 
- *    http://williams.best.vwh.net/sunrise_sunset_algorithm.htm
- *  which in turn cites
- *  	Almanac for Computers, 1990
- * 	published by Nautical Almanac Office
- * 	United States Naval Observatory
- *    Washington, DC 20392
- *  
- *  @param year Four-digit gregorian year value. UTC. ?
- *  @param month Month of year, 1 - 12. UTC. ?
- *  @param day Day of month, 1 - 31. UTC. ?
- *  @param latitude -90.0 - +90.0. ?
- *  @param longitude -180 - +180. ?
- *  @param sunset True (non-zero) to calculate set time, false
- *                (zero) for rise time.
- *  @param zenith. Per the page cited above, useful zenith values are:
- *                   official rise/set     = 90 degrees 50'
- *                   civil twilight end    = 96 degrees
- *                   nautical twilight end = 102 degrees
- *                   astronomical twi. end = 108 degrees (i.e., night)
- *  
- *  @return Requested time given as UTC hour and fraction.  Or NO_RISE_SET_TIME
- *          if there is no rise/set for this location on this date (i.e., near
- *          a pole).
+/**
+ *  Zenith-independent part of a single rise or set calculation: everything
+ *  the almanac algorithm derives from date and longitude alone.  Computed
+ *  once per rise (or set) by \ref calcSunPosition(), then shared by every
+ *  zenith of interest.
  */
-float calcSun(int year, int month, int day,
-              float latitude, float longitude, int sunset, float zenith)
+typedef struct
 {
+   ///  Sun's right ascension less the local mean time correction
+   ///  (RA - 0.06571 * t - 6.622), in hours.
+   float eqnTime;
 
+   ///  Sine and cosine of the sun's declination.
+   float sinDec;
+   float cosDec;
+
+} SunPosition;
 
-   // 1. first calculate the day of the year
 
+int calcDayOfYear(int year, int month, int day)
+{
    int N1 = my_floor(275 * month / 9);
    int N2 = my_floor((month + 9) / 12);  // 1 = after Feb, 0 = not.
    int N3 = (1 + my_floor((year - 4 * my_floor(year / 4) + 2) / 3));
-   int N = N1 - (N2 * N3) + day - 30;
 
-   // 2. convert the longitude to hour value and calculate an approximate time
+   return N1 - (N2 * N3) + day - 30;
+}
 
-   float lngHour = longitude / 15;
+
+/**
+ *  Steps 2 - 6 of the almanac algorithm: find the sun's position at the
+ *  approximate time of rise or set.  None of this depends on zenith.
+ *  
+ *  Normally this is read from the precomputed ephemeris table, with the
+ *  math here only used if the table is unavailable.
+ * 
+ *  @param N Day of year, from calcDayOfYear().
+ *  @param lngHour Longitude converted to hours.
+ *  @param sunset True (non-zero) for set time, false (zero) for rise time.
+ *  @param pPos Receives the computed sun position.
+ */
+static void calcSunPosition(int N, float lngHour, int sunset, SunPosition *pPos)
+{
+
+   // 2. calculate an approximate time
 
    float t;
    if (!sunset)
@@ -64,20 +66,37 @@ float calcSun(int year, int month, int day,
       t = N + ((18 - lngHour) / 24);
    }
 
+   int32_t sinDecFixed, cosDecFixed, eqnTimeFixed;
+   if (solar_ephemeris_lookup((int32_t) (t * 0x10000),
+                              &sinDecFixed, &cosDecFixed, &eqnTimeFixed))
+   {
+      pPos->eqnTime = eqnTimeFixed * (24.0f / 0x10000);
+      pPos->sinDec  = sinDecFixed * (1.0f / 0x10000);
+      pPos->cosDec  = cosDecFixed * (1.0f / 0x10000);
+      return;
+   }
+
    // 3. calculate the Sun's mean anomaly
-   float M = (0.9856 * t) - 3.289;
+   float M = (0.9856f * t) - 3.289f;
 
    // 4. calculate the Sun's true longitude
 
    //L = M + (1.916 * sin(M)) + (0.020 * sin(2 * M)) + 282.634
-   float L = M + (1.916 * my_sin((M_PI / 180.0f) * M)) + (0.020 * my_sin((M_PI / 180.0f) * 2 * M)) + 282.634;
+   //  (sin(2M) = 2 sin(M) cos(M), so one reduction serves both terms)
+   float sinM, cosM;
+   my_sincos((M_PI / 180.0f) * M, &sinM, &cosM);
+   float L = M + (1.916f * sinM) + (0.020f * 2 * sinM * cosM) + 282.634f;
    if (L < 0) L += 360.0f;
    if (L > 360) L -= 360.0f;
 
+   //  sin(L) is needed for both steps 5a and 6.
+   float sinL, cosL;
+   my_sincos((M_PI / 180.0f) * L, &sinL, &cosL);
+
    //5a. calculate the Sun's right ascension
 
    //RA = atan(0.91764 * tan(L))
-   float RA = (180.0f / M_PI) * my_atan(0.91764 * my_tan((M_PI / 180.0f) * L));
+   float RA = (180.0f / M_PI) * my_atan(0.91764f * (sinL / cosL));
    if (RA < 0) RA += 360;
    if (RA > 360) RA -= 360;
 
@@ -92,13 +111,40 @@ float calcSun(int year, int month, int day,
 
    //6. calculate the Sun's declination
 
-   float sinDec = 0.39782 * my_sin((M_PI / 180.0f) * L);
+   float sinDec = 0.39782f * sinL;
    float cosDec = my_cos(my_asin(sinDec));
 
+   //  (step 8's date-dependent terms are folded in here too)
+   pPos->eqnTime = RA - (0.06571f * t) - 6.622f;
+   pPos->sinDec  = sinDec;
+   pPos->cosDec = cosDec;
+
+}  /* end of calcSunPosition */
+
+
+/**
+ *  Steps 7 - 9 of the almanac algorithm: given the sun's position, find
+ *  the UTC time at which it crosses the requested zenith.
+ * 
+ *  @param pPos Sun position from calcSunPosition(), for the same value
+ *             of sunset.
+ *  @param lngHour Longitude converted to hours.
+ *  @param sinLat Sine of observer's latitude.
+ *  @param cosLat Cosine of observer's latitude.
+ *  @param sunset True (non-zero) for set time, false (zero) for rise time.
+ *  @param cosZenith Cosine of zenith angle (see calcSun()).  Kept separate
+ *             so callers can reuse it across days and across rise / set.
+ * 
+ *  @return UTC hour and fraction, or NO_RISE_SET_TIME.
+ */
+static float calcSunEventTime(const SunPosition *pPos, float lngHour,
+                              float sinLat, float cosLat, int sunset, float cosZenith)
+{
+
    //7a. calculate the Sun's local hour angle
 
    //cosH = (cos(zenith) - (sinDec * sin(latitude))) / (cosDec * cos(latitude))
-   float cosH = (my_cos((M_PI / 180.0f) * zenith) - (sinDec * my_sin((M_PI / 180.0f) * latitude))) / (cosDec * my_cos((M_PI / 180.0f) * latitude));
+   float cosH = (cosZenith - (pPos->sinDec * sinLat)) / (pPos->cosDec * cosLat);
 
    if (cosH >  1)
    {
@@ -126,7 +172,7 @@ float calcSun(int year, int month, int day,
    H = H / 15;
 
    //8. calculate local mean time of rising/setting
-   float T = H + RA - (0.06571 * t) - 6.622;
+   float T = H + pPos->eqnTime;
 
    //9. adjust back to UTC
    float UT = T - lngHour;
@@ -141,6 +187,61 @@ float calcSun(int year, int month, int day,
 
    return UT;
 
+}  /* end of calcSunEventTime */
+
+
+/** 
+ *  Given a date and geographical location (lat/long), calculate
+ *  rise or set time. Nominally of sun, but may be adjusted to
+ *  return various twilight times instead by means of our zenith
+ *  argument.
+ *  
+ *  Math based on 
+ *    http://williams.best.vwh.net/sunrise_sunset_algorithm.htm
+ *  which in turn cites
+ *  	Almanac for Computers, 1990
+ * 	published by Nautical Almanac Office
+ * 	United States Naval Observatory
+ *    Washington, DC 20392
+ *  
+ *  @param year Four-digit gregorian year value. UTC. ?
+ *  @param month Month of year, 1 - 12. UTC. ?
+ *  @param day Day of month, 1 - 31. UTC. ?
+ *  @param latitude -90.0 - +90.0. ?
+ *  @param longitude -180 - +180. ?
+ *  @param sunset True (non-zero) to calculate set time, false
+ *                (zero) for rise time.
+ *  @param zenith. Per the page cited above, useful zenith values are:
+ *                   official rise/set     = 90 degrees 50'
+ *                   civil twilight end    = 96 degrees
+ *                   nautical twilight end = 102 degrees
+ *                   astronomical twi. end = 108 degrees (i.e., night)
+ *  
+ *  @return Requested time given as UTC hour and fraction.  Or NO_RISE_SET_TIME
+ *          if there is no rise/set for this location on this date (i.e., near
+ *          a pole).
+ */
+float calcSun(int year, int month, int day,
+              float latitude, float longitude, int sunset, float zenith)
+{
+
+   // 1. first calculate the day of the year
+
+   int N = calcDayOfYear(year, month, day);
+
+   // 2. convert the longitude to hour value
+
+   float lngHour = longitude / 15;
+
+   SunPosition pos;
+   calcSunPosition(N, lngHour, sunset, &pos);
+
+   float sinLat, cosLat;
+   my_sincos((M_PI / 180.0f) * latitude, &sinLat, &cosLat);
+
+   return calcSunEventTime(&pos, lngHour, sinLat, cosLat,
+                           sunset, my_cos((M_PI / 180.0f) * zenith));
+
 }  /* end of calcSun */
 
 float calcSunRise(int year, int month, int day, float latitude, float longitude, float zenith)
@@ -152,3 +253,181 @@ float calcSunSet(int year, int month, int day, float latitude, float longitude,
 {
    return calcSun(year, month, day, latitude, longitude, 1, zenith);
 }
+
+
+void calcSunRiseSetMultiFloat(int year, int month, int day,
+                              float latitude, float longitude,
+                              const float *zeniths, int numZeniths,
+                              float *riseTimes, float *setTimes)
+{
+
+   int N = calcDayOfYear(year, month, day);
+   float lngHour = longitude / 15;
+
+   //  latitude is also the same for every zenith, so only do its trig once.
+   float sinLat, cosLat;
+   my_sincos((M_PI / 180.0f) * latitude, &sinLat, &cosLat);
+
+   SunPosition posRise;
+   SunPosition posSet;
+   calcSunPosition(N, lngHour, 0, &posRise);
+   calcSunPosition(N, lngHour, 1, &posSet);
+
+   for (int i = 0; i < numZeniths; i++)
+   {
+      float cosZenith = my_cos((M_PI / 180.0f) * zeniths[i]);
+
+      riseTimes[i] = calcSunEventTime(&posRise, lngHour, sinLat, cosLat, 0, cosZenith);
+      setTimes[i]  = calcSunEventTime(&posSet,  lngHour, sinLat, cosLat, 1, cosZenith);
+   }
+
+}  /* end of calcSunRiseSetMultiFloat */
+
+
+void calcSunRiseSetMulti(int year, int month, int day,
+                         float latitude, float longitude,
+                         const float *zeniths, int numZeniths,
+                         float *riseTimes, float *setTimes)
+{
+
+#if SUNCALC_USE_FIXED_POINT
+
+   int32_t aZenithsFixed[SUNCALC_MAX_MULTI];
+   int32_t aRiseFixed[SUNCALC_MAX_MULTI];
+   int32_t aSetFixed[SUNCALC_MAX_MULTI];
+
+   if (numZeniths > SUNCALC_MAX_MULTI)
+   {
+      numZeniths = SUNCALC_MAX_MULTI;
+   }
+
+   for (int i = 0; i < numZeniths; i++)
+   {
+      aZenithsFixed[i] = SUNCALC_DEGREES_TO_FIXED(zeniths[i]);
+   }
+
+   calcSunRiseSetMultiFixed(calcDayOfYear(year, month, day),
+                            SUNCALC_DEGREES_TO_FIXED(latitude),
+                            SUNCALC_DEGREES_TO_FIXED(longitude),
+                            aZenithsFixed, numZeniths, aRiseFixed, aSetFixed);
+
+   for (int i = 0; i < numZeniths; i++)
+   {
+      riseTimes[i] = (aRiseFixed[i] == SUNCALC_FIXED_NO_RISE_SET) ?
+                        NO_RISE_SET_TIME : SUNCALC_FIXED_TO_HOURS(aRiseFixed[i]);
+      setTimes[i]  = (aSetFixed[i] == SUNCALC_FIXED_NO_RISE_SET) ?
+                        NO_RISE_SET_TIME : SUNCALC_FIXED_TO_HOURS(aSetFixed[i]);
+   }
+
+#else
+
+   calcSunRiseSetMultiFloat(year, month, day, latitude, longitude,
+                            zeniths, numZeniths, riseTimes, setTimes);
+
+#endif
+
+}  /* end of calcSunRiseSetMulti */
+
+
+/**
+ *  Days in the given year, by the same simplified leap year rule that
+ *  calcDayOfYear() uses.
+ */
+static int calcDaysInYear(int year)
+{
+   return calcDayOfYear(year, 12, 31);
+}
+
+
+bool calcSunRiseSetDays(int year, int dayOfYear, int numDays,
+                        float latitude, float longitude,
+                        const float *zeniths, int numZeniths,
+                        float *riseTimes, float *setTimes)
+{
+
+   //  (results are laid out numZeniths to a day, so quietly doing fewer
+   //  would leave the caller reading the wrong days.)
+   if ((numZeniths < 1) || (numZeniths > SUNCALC_MAX_MULTI))
+   {
+      return false;
+   }
+
+   //  Everything except the sun's position is the same for every day of
+   //  the run, so set it up just once.
+   float lngHour = longitude / 15;
+
+#if SUNCALC_USE_FIXED_POINT
+
+   int32_t latFixed = SUNCALC_DEGREES_TO_FIXED(latitude);
+   int32_t lngFixed = SUNCALC_DEGREES_TO_FIXED(longitude);
+   int32_t aZenithsFixed[SUNCALC_MAX_MULTI];
+   int32_t aRiseFixed[SUNCALC_MAX_MULTI];
+   int32_t aSetFixed[SUNCALC_MAX_MULTI];
+
+   for (int i = 0; i < numZeniths; i++)
+   {
+      aZenithsFixed[i] = SUNCALC_DEGREES_TO_FIXED(zeniths[i]);
+   }
+
+   (void) lngHour;
+
+#else
+
+   float sinLat, cosLat;
+   my_sincos((M_PI / 180.0f) * latitude, &sinLat, &cosLat);
+   float aCosZeniths[SUNCALC_MAX_MULTI];
+
+   for (int i = 0; i < numZeniths; i++)
+   {
+      aCosZeniths[i] = my_cos((M_PI / 180.0f) * zeniths[i]);
+   }
+
+#endif
+
+   int daysInYear = calcDaysInYear(year);
+
+   for (int day = 0; day < numDays; day++)
+   {
+      float *pRise = &riseTimes[day * numZeniths];
+      float *pSet  = &setTimes[day * numZeniths];
+
+#if SUNCALC_USE_FIXED_POINT
+
+      calcSunRiseSetMultiFixed(dayOfYear, latFixed, lngFixed,
+                               aZenithsFixed, numZeniths, aRiseFixed, aSetFixed);
+
+      for (int i = 0; i < numZeniths; i++)
+      {
+         pRise[i] = (aRiseFixed[i] == SUNCALC_FIXED_NO_RISE_SET) ?
+                       NO_RISE_SET_TIME : SUNCALC_FIXED_TO_HOURS(aRiseFixed[i]);
+         pSet[i]  = (aSetFixed[i] == SUNCALC_FIXED_NO_RISE_SET) ?
+                       NO_RISE_SET_TIME : SUNCALC_FIXED_TO_HOURS(aSetFixed[i]);
+      }
+
+#else
+
+      SunPosition posRise;
+      SunPosition posSet;
+      calcSunPosition(dayOfYear, lngHour, 0, &posRise);
+      calcSunPosition(dayOfYear, lngHour, 1, &posSet);
+
+      for (int i = 0; i < numZeniths; i++)
+      {
+         pRise[i] = calcSunEventTime(&posRise, lngHour, sinLat, cosLat, 0, aCosZeniths[i]);
+         pSet[i]  = calcSunEventTime(&posSet,  lngHour, sinLat, cosLat, 1, aCosZeniths[i]);
+      }
+
+#endif
+
+      //  on to the next day, and maybe the next year.
+      if (++dayOfYear > daysInYear)
+      {
+         dayOfYear = 1;
+         year++;
+         daysInYear = calcDaysInYear(year);
+      }
+   }
+
+   return true;
+
+}  /* end of calcSunRiseSetDays */
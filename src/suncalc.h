@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
+
 
 //  Per http://www.timeanddate.com/worldclock/aboutastronomy.html
 //  each of the twilight bands is 6 degrees wide:
@@ -25,5 +28,125 @@
  */
 #define NO_RISE_SET_TIME  ((float) 100.0)  /* (legal values are hours in a day) */
 
+/**
+ *  Day of year (1 - 366) for a given date, as used by the almanac algorithm.
+ *  (Step 1 of calcSun().)
+ */
+int calcDayOfYear(int year, int month, int day);
+
 float calcSunRise(int year, int month, int day, float latitude, float longitude, float zenith);
-float calcSunSet(int year, int month, int day, float latitude, float longitude, float zenith);
\ No newline at end of file
+float calcSunSet(int year, int month, int day, float latitude, float longitude, float zenith);
+
+/**
+ *  Calculate rise and set times for several zenith values at once.
+ *  
+ *  Everything except the final hour angle step depends only on date and
+ *  location, so that part is done just once for rise and once for set,
+ *  and then shared by all of the supplied zeniths.  Much cheaper than
+ *  calling calcSunRise() / calcSunSet() for each zenith in turn.
+ *  
+ *  @param zeniths Array of numZeniths zenith angles, in degrees.
+ *  @param numZeniths Number of entries in zeniths, riseTimes and setTimes.
+ *  @param riseTimes Receives UTC rise time (hour and fraction) for each zenith,
+ *             or NO_RISE_SET_TIME.
+ *  @param setTimes Receives UTC set time (hour and fraction) for each zenith,
+ *             or NO_RISE_SET_TIME.
+ */
+void calcSunRiseSetMulti(int year, int month, int day,
+                         float latitude, float longitude,
+                         const float *zeniths, int numZeniths,
+                         float *riseTimes, float *setTimes);
+
+///  Most zeniths calcSunRiseSetMulti() (fixed-point engine) or calcSunRiseSetDays()
+///  handle per call.
+#define SUNCALC_MAX_MULTI  4
+
+/**
+ *  Calculate rise and set times for several zeniths over a run of
+ *  consecutive days.  Like calcSunRiseSetMulti(), but the location and
+ *  zenith trig is also shared across all of the days.  Intended for
+ *  filling in a schedule of days ahead of time.
+ *  
+ *  Results are laid out day by day: entry [day * numZeniths + zenith] of
+ *  each output array.
+ *  
+ *  @param year Year of the first day.
+ *  @param dayOfYear Day of year of the first day, from calcDayOfYear().
+ *  @param numDays Number of consecutive days to calculate.
+ *  @param zeniths Array of numZeniths zenith angles, in degrees.
+ *  @param numZeniths Number of zeniths.  At most SUNCALC_MAX_MULTI.
+ *  @param riseTimes Receives numDays * numZeniths UTC rise times (hour and
+ *             fraction), or NO_RISE_SET_TIME.
+ *  @param setTimes Receives numDays * numZeniths UTC set times (hour and
+ *             fraction), or NO_RISE_SET_TIME.
+ *  
+ *  @return \c false, with nothing calculated, if numZeniths is more than
+ *          SUNCALC_MAX_MULTI (or less than one).
+ */
+bool calcSunRiseSetDays(int year, int dayOfYear, int numDays,
+                        float latitude, float longitude,
+                        const float *zeniths, int numZeniths,
+                        float *riseTimes, float *setTimes);
+
+///  Float engine behind calcSunRiseSetMulti(), regardless of SUNCALC_USE_FIXED_POINT.
+void calcSunRiseSetMultiFloat(int year, int month, int day,
+                              float latitude, float longitude,
+                              const float *zeniths, int numZeniths,
+                              float *riseTimes, float *setTimes);
+
+
+//  Integer-only engine, in suncalc_fixed.c.
+//  
+//  Angles use PebbleOS' integer trig convention, one full circle being
+//  SUNCALC_FIXED_CIRCLE (== TRIG_MAX_ANGLE).  Times of day use the same
+//  units, one full day being SUNCALC_FIXED_CIRCLE.
+
+#define SUNCALC_FIXED_CIRCLE  0x10000   /* == TRIG_MAX_ANGLE */
+
+///  Fixed-point engine's equivalent of NO_RISE_SET_TIME.
+#define SUNCALC_FIXED_NO_RISE_SET  ((int32_t) -1)
+
+///  Scale of the integer degrees SUNCALC_SCALED_DEGREES_TO_FIXED() takes
+///  (== CONFIG_DATA_DEGREE_SCALE, as ConfigData keeps latitude and longitude).
+#define SUNCALC_FIXED_DEGREE_SCALE  1000000
+
+///  Degrees scaled by SUNCALC_FIXED_DEGREE_SCALE to fixed-point angle units,
+///  rounded to nearest (halves away from zero), in integer math.
+#define SUNCALC_SCALED_DEGREES_TO_FIXED(scaled_)                              \
+   ((int32_t) ((((int64_t) (scaled_) * SUNCALC_FIXED_CIRCLE) +                \
+                (((scaled_) < 0) ? -180LL * SUNCALC_FIXED_DEGREE_SCALE :       \
+                                    180LL * SUNCALC_FIXED_DEGREE_SCALE)) /     \
+               (360LL * SUNCALC_FIXED_DEGREE_SCALE)))
+
+///  Degrees to fixed-point angle units, rounded to nearest: scaled to
+///  integer first, so the rounding is SUNCALC_SCALED_DEGREES_TO_FIXED()'s.
+#define SUNCALC_DEGREES_TO_FIXED(deg_)                                        \
+   SUNCALC_SCALED_DEGREES_TO_FIXED(                                           \
+      (int32_t) (((deg_) * SUNCALC_FIXED_DEGREE_SCALE) + (((deg_) < 0) ? -0.5f : 0.5f)))
+
+#define SUNCALC_FIXED_TO_HOURS(time_)  \
+   ((time_) * (24.0f / SUNCALC_FIXED_CIRCLE))
+
+/**
+ *  Integer-only equivalent of calcSunRiseSetMulti().
+ *  
+ *  @param dayOfYear Day of year, 1 - 366.
+ *  @param latitude Latitude, in fixed-point angle units.
+ *  @param longitude Longitude, in fixed-point angle units.
+ *  @param zeniths Array of numZeniths zenith angles, in fixed-point angle units.
+ *  @param numZeniths Number of entries in zeniths, riseTimes and setTimes.
+ *  @param riseTimes Receives UTC rise time of day for each zenith, in
+ *             fixed-point time units, or SUNCALC_FIXED_NO_RISE_SET.
+ *  @param setTimes Receives UTC set time of day for each zenith, in
+ *             fixed-point time units, or SUNCALC_FIXED_NO_RISE_SET.
+ */
+void calcSunRiseSetMultiFixed(int dayOfYear, int32_t latitude, int32_t longitude,
+                              const int32_t *zeniths, int numZeniths,
+                              int32_t *riseTimes, int32_t *setTimes);
+
+/**
+ *  Test aid: run both engines over a full year at the given location and
+ *  log the worst-case difference, in minutes.  Only built when
+ *  TESTING_COMPARE_SUNCALC_FIXED is set in testing.h.
+ */
+void suncalc_fixed_compare(float latitude, float longitude);
@@ -0,0 +1,318 @@
+/**
+ *  @file
+ *
+ *  Integer-only version of the sun rise / set engine in suncalc.c.
+ *
+ *  The math is the same almanac algorithm, but all angles are carried in
+ *  PebbleOS' integer trig units (TRIG_MAX_ANGLE to a full circle) and all
+ *  trig goes through sin_lookup() / cos_lookup() / atan2_lookup().  Since a
+ *  full circle of hour angle is also a full day, times of day come out in
+ *  the same units with no further conversion.
+ *
+ *  Fixed-point conventions used below:
+ *    - "trig"  TRIG_MAX_ANGLE (0x10000) units per circle, or per day.
+ *    - "Q16"   value scaled by 0x10000, the same scale sin_lookup() returns.
+ *    - "Q15"   value scaled by 0x8000, so that +/-1.0 still fits in int16_t
+ *              for atan2_lookup().
+ */
+
+#include  "suncalc.h"
+
+#include  "pebble.h"
+
+#include  "config.h"
+#include  "testing.h"
+#include  "my_math.h"
+#include  "SolarEphemeris.h"
+
+
+//  Almanac constants, converted to fixed point.  See calcSun() in suncalc.c
+//  for the original float values.
+
+///  Mean anomaly rate: 0.9856 degrees/day, as trig units per Q16 day unit, scaled by 2^32.
+#define  FIX_M_RATE      11758666
+///  Mean anomaly offset: 3.289 degrees.
+#define  FIX_M_OFFSET    599
+///  True longitude first-harmonic amplitude: 1.916 degrees, in trig units * 64.
+#define  FIX_L_SIN1      22323
+///  True longitude second-harmonic amplitude: 0.020 degrees, in trig units * 64.
+#define  FIX_L_SIN2      233
+///  True longitude offset: 282.634 degrees.
+#define  FIX_L_OFFSET    51452
+///  Obliquity term for right ascension: 0.91764, Q15.
+#define  FIX_RA_TAN      30069
+///  Obliquity term for declination: 0.39782, Q16.
+#define  FIX_DEC_SIN     26072
+///  Local mean time rate: 0.06571 hours/day, as trig units per Q16 day unit, scaled by 2^32.
+#define  FIX_T_RATE      11759263
+///  Local mean time offset: 6.622 hours.
+#define  FIX_T_OFFSET    18082
+
+///  Approximate rise time (06:00) and set time (18:00), in trig units.
+#define  FIX_RISE_APPROX (TRIG_MAX_ANGLE / 4)
+#define  FIX_SET_APPROX  (TRIG_MAX_ANGLE * 3 / 4)
+
+///  Keep an angle (or time of day) within one circle (or day).
+#define  FIX_WRAP(angle_)  ((angle_) & (TRIG_MAX_ANGLE - 1))
+
+
+/**
+ *  Integer square root: largest r such that r * r <= x.
+ */
+static uint32_t isqrt(uint32_t x)
+{
+   uint32_t r = 0;
+   uint32_t bit = 1UL << 30;
+
+   while (bit > x)
+   {
+      bit >>= 2;
+   }
+
+   while (bit != 0)
+   {
+      if (x >= r + bit)
+      {
+         x -= r + bit;
+         r = (r >> 1) + bit;
+      }
+      else
+      {
+         r >>= 1;
+      }
+      bit >>= 2;
+   }
+
+   return r;
+}
+
+
+///  Clamp a Q15 value so it fits the int16_t arguments of atan2_lookup().
+static int16_t clampQ15(int32_t x)
+{
+   if (x > INT16_MAX)
+      return INT16_MAX;
+   if (x < -INT16_MAX)
+      return -INT16_MAX;
+   return (int16_t) x;
+}
+
+
+/**
+ *  Zenith-independent part of a single rise or set calculation.  Same role
+ *  as SunPosition in suncalc.c.
+ */
+typedef struct
+{
+   ///  Sun's right ascension less the local mean time correction
+   ///  (RA - 0.06571 * t - 6.622 hours), in trig units.
+   int32_t eqnTime;
+
+   ///  Sine of the sun's declination, Q16.
+   int32_t sinDec;
+
+   ///  Cosine of the sun's declination, Q15.
+   int32_t cosDec;
+
+} SunPositionFixed;
+
+
+/**
+ *  Steps 2 - 6 of the almanac algorithm, in fixed point.  As with the
+ *  float engine, the precomputed ephemeris table is used when available.
+ *
+ *  @param N Day of year.
+ *  @param lngDay Longitude in trig units, which is also the longitude's
+ *             time offset as a fraction of a day.
+ *  @param sunset True (non-zero) for set time, false (zero) for rise time.
+ *  @param pPos Receives the computed sun position.
+ */
+static void calcSunPositionFixed(int N, int32_t lngDay, int sunset,
+                                 SunPositionFixed *pPos)
+{
+
+   // 2. calculate an approximate time
+   int32_t t = (N << 16) + (sunset ? FIX_SET_APPROX : FIX_RISE_APPROX) - lngDay;
+
+   int32_t cosDec;
+   if (solar_ephemeris_lookup(t, &pPos->sinDec, &cosDec, &pPos->eqnTime))
+   {
+      pPos->cosDec = cosDec >> 1;
+      return;
+   }
+
+   // 3. calculate the Sun's mean anomaly
+   int32_t M = (int32_t) (((int64_t) t * FIX_M_RATE) >> 32) - FIX_M_OFFSET;
+   M = FIX_WRAP(M);
+
+   // 4. calculate the Sun's true longitude
+   int32_t L = M + ((sin_lookup(M) * FIX_L_SIN1) >> 22)
+                 + ((sin_lookup(2 * M) * FIX_L_SIN2) >> 22) + FIX_L_OFFSET;
+   L = FIX_WRAP(L);
+
+   int32_t sinL = sin_lookup(L);
+   int32_t cosL = cos_lookup(L);
+
+   // 5. calculate the Sun's right ascension.  atan2 lands it in L's
+   //    quadrant directly, so no quadrant fixup is needed.
+   int32_t RA = FIX_WRAP(atan2_lookup(clampQ15((sinL * FIX_RA_TAN) >> 16),
+                                      clampQ15(cosL >> 1)));
+
+   // 6. calculate the Sun's declination
+   pPos->sinDec = (sinL * FIX_DEC_SIN) >> 16;
+
+   int32_t sinDec15 = pPos->sinDec >> 1;
+   pPos->cosDec = isqrt((1UL << 30) - (uint32_t) (sinDec15 * sinDec15));
+
+   //  (step 8's date-dependent terms are folded in here too)
+   pPos->eqnTime = RA - (int32_t) (((int64_t) t * FIX_T_RATE) >> 32) - FIX_T_OFFSET;
+
+}  /* end of calcSunPositionFixed */
+
+
+/**
+ *  Steps 7 - 9 of the almanac algorithm, in fixed point.
+ *
+ *  @return UTC time of day in trig units, or SUNCALC_FIXED_NO_RISE_SET.
+ */
+static int32_t calcSunEventTimeFixed(const SunPositionFixed *pPos, int32_t lngDay,
+                                     int32_t sinLat, int32_t cosLat,
+                                     int sunset, int32_t zenith)
+{
+
+   //7a. calculate the Sun's local hour angle
+   //cosH = (cos(zenith) - (sinDec * sin(latitude))) / (cosDec * cos(latitude))
+   int32_t num = cos_lookup(zenith) - ((pPos->sinDec * sinLat) >> 16);
+   int32_t den = (pPos->cosDec * cosLat) >> 15;
+
+   if ((den <= 0) || (num >= den) || (num <= -den))
+   {
+      //  |cosH| >= 1: sun never reaches this zenith today.
+      return SUNCALC_FIXED_NO_RISE_SET;
+   }
+
+   //7b. finish calculating H: acos(cosH), as a fraction of a day.
+   //    acos(num / den) == atan2(sqrt(den^2 - num^2), num), which needs no
+   //    divide and keeps full precision when cosH is close to +/-1.
+   num >>= 1;                           // |num| < den <= 0x8000 now
+   den >>= 1;
+   int32_t sinH = isqrt((uint32_t) (den * den) - (uint32_t) (num * num));
+
+   int32_t H = FIX_WRAP(atan2_lookup(clampQ15(sinH), clampQ15(num)));
+   if (!sunset)
+   {
+      H = TRIG_MAX_ANGLE - H;
+   }
+
+   //8. calculate local mean time of rising/setting
+   int32_t T = H + pPos->eqnTime;
+
+   //9. adjust back to UTC
+   return FIX_WRAP(T - lngDay);
+
+}  /* end of calcSunEventTimeFixed */
+
+
+void calcSunRiseSetMultiFixed(int dayOfYear, int32_t latitude, int32_t longitude,
+                              const int32_t *zeniths, int numZeniths,
+                              int32_t *riseTimes, int32_t *setTimes)
+{
+
+   int32_t sinLat = sin_lookup(latitude);
+   int32_t cosLat = cos_lookup(latitude);
+
+   SunPositionFixed posRise;
+   SunPositionFixed posSet;
+   calcSunPositionFixed(dayOfYear, longitude, 0, &posRise);
+   calcSunPositionFixed(dayOfYear, longitude, 1, &posSet);
+
+   for (int i = 0; i < numZeniths; i++)
+   {
+      riseTimes[i] = calcSunEventTimeFixed(&posRise, longitude, sinLat, cosLat,
+                                           0, zeniths[i]);
+      setTimes[i]  = calcSunEventTimeFixed(&posSet, longitude, sinLat, cosLat,
+                                           1, zeniths[i]);
+   }
+
+}  /* end of calcSunRiseSetMultiFixed */
+
+
+#if TESTING_COMPARE_SUNCALC_FIXED
+
+///  Difference between two UTC times of day, in minutes, allowing for wrap at midnight.
+static float minutesApart(float hours1, float hours2)
+{
+   float diff = my_fabs(hours1 - hours2);
+   if (diff > 12)
+   {
+      diff = 24 - diff;
+   }
+   return diff * 60;
+}
+
+
+void suncalc_fixed_compare(float latitude, float longitude)
+{
+
+   static const float aZeniths[] = { ZENITH_ASTRONOMICAL, ZENITH_NAUTICAL,
+                                     ZENITH_CIVIL, ZENITH_OFFICIAL };
+   #define NUM_COMPARE_ZENITHS  (sizeof(aZeniths) / sizeof(aZeniths[0]))
+
+   float worst = 0;
+   int   worstDay = 0;
+   int   mismatches = 0;
+
+   //  Walk every day of a (leap) year.  Jan 1 + (day - 1) is a valid date
+   //  for the almanac's day-of-year formula even past the end of January.
+   for (int day = 1; day <= 366; day++)
+   {
+      float aRise[NUM_COMPARE_ZENITHS], aSet[NUM_COMPARE_ZENITHS];
+      calcSunRiseSetMultiFloat(2016, 1, day, latitude, longitude,
+                               aZeniths, NUM_COMPARE_ZENITHS, aRise, aSet);
+
+      int32_t aZenFix[NUM_COMPARE_ZENITHS];
+      int32_t aRiseFix[NUM_COMPARE_ZENITHS], aSetFix[NUM_COMPARE_ZENITHS];
+      for (unsigned i = 0; i < NUM_COMPARE_ZENITHS; i++)
+      {
+         aZenFix[i] = SUNCALC_DEGREES_TO_FIXED(aZeniths[i]);
+      }
+      calcSunRiseSetMultiFixed(day, SUNCALC_DEGREES_TO_FIXED(latitude),
+                               SUNCALC_DEGREES_TO_FIXED(longitude),
+                               aZenFix, NUM_COMPARE_ZENITHS, aRiseFix, aSetFix);
+
+      for (unsigned i = 0; i < NUM_COMPARE_ZENITHS; i++)
+      {
+         float aFloat[2] = { aRise[i], aSet[i] };
+         int32_t aFixed[2] = { aRiseFix[i], aSetFix[i] };
+
+         for (int j = 0; j < 2; j++)
+         {
+            if ((aFloat[j] == NO_RISE_SET_TIME) !=
+                (aFixed[j] == SUNCALC_FIXED_NO_RISE_SET))
+            {
+               //  only expected right at the edge of polar day / night.
+               mismatches++;
+               continue;
+            }
+            if (aFloat[j] == NO_RISE_SET_TIME)
+            {
+               continue;
+            }
+
+            float diff = minutesApart(aFloat[j], SUNCALC_FIXED_TO_HOURS(aFixed[j]));
+            if (diff > worst)
+            {
+               worst = diff;
+               worstDay = day;
+            }
+         }
+      }
+   }
+
+   APP_LOG(APP_LOG_LEVEL_INFO,
+           "suncalc fixed vs float: worst %d.%02d min on day %d, %d rise/set mismatches",
+           (int) worst, (int) (100 * (worst - (int) worst)), worstDay, mismatches);
+
+}  /* end of suncalc_fixed_compare */
+
+#endif  // TESTING_COMPARE_SUNCALC_FIXED
@@ -14,14 +14,21 @@
 
 #include "config.h"
 #include "ConfigData.h"
+#include "DayRecord.h"
+#include "DialCache.h"
+#include "DirtyRect.h"
 #include "helpers.h"
 #include "MessageWindow.h"
 #include "messaging.h"
-#include "my_math.h"
+#include "RefreshPolicy.h"
 #include "suncalc.h"
+#include "testing.h"
+#include "ScheduleStream.h"
+#include "SpriteAtlas.h"
+#include "TaskScheduler.h"
 #include "TransBitmap.h"
-#include "TransRotBmp.h"
 #include "TwilightPath.h"
+#include "TwilightSchedule.h"
 
 
 /// Test whether using a built-in font is smaller than using a (subsetted) resource.
@@ -62,8 +69,8 @@ GFont pFontMediumText = 0;
 GFont pFontSmallText = 0;
 
 
-///  Hour hand bitmap, a transparent png which can rotate to any angle.
-TransRotBmp* pTransRotBmpHourHand = 0;
+///  Hour hand, pre-rotated to every angle it can show.
+SpriteAtlas* pHourHand = 0;
 
 /**
  *  Watchface dial: a transparent png which supplies hour marks, a face
@@ -85,6 +92,77 @@ TwilightPath* pTwiPathNautical = 0;
 ///  Daylight edge of civil twilight (i.e., sun rise / set times).
 TwilightPath* pTwiPathCivil = 0;
 
+///  Retained copy of the composited dial (all of the above), redrawn once a day.
+DialCache* pDialCache = 0;
+
+///  Part of the screen changed since the last redraw.
+static DirtyRect dirtyRect;
+
+///  Set while the first day / night update waits for the first frame to draw.
+static bool fDayAndNightInfoDeferred = false;
+
+///  When sunclock_window_load() started, for timing the first frame.
+static time_t   loadStartSecs;
+static uint16_t loadStartMs;
+
+///  Has a frame been drawn since sunclock_window_load()?
+static bool fFirstFrameDrawn = false;
+
+///  Location fixes received, and those that changed the config enough to
+///  recompute the day, since launch.
+static uint16_t usCoordsRecvd = 0;
+static uint16_t usLocationRecomputes = 0;
+
+///  Day / night update queued by queue_day_and_night_info(), or TASK_HANDLE_NONE.
+static TaskHandle dayAndNightTask = TASK_HANDLE_NONE;
+
+///  Is the queued update to update everything?
+static bool fDayAndNightEverything = false;
+
+///  Twilight bands, and so TwilightPaths, on the dial.
+#define NUM_TWI_PATHS  4
+
+/**
+ *  Today's and tomorrow's results, each in one of two slots so that the
+ *  switch at midnight is just a swap.  A slot not tagged for its day
+ *  (day_record_is_for()) is empty.
+ */
+static DayRecord  aDayRecords[2];
+static DayRecord *pTodayRecord = &aDayRecords[0];
+static DayRecord *pTomorrowRecord = &aDayRecords[1];
+
+///  Is *pTodayRecord newer than the flash copy?
+static bool fTodayRecordUnsaved = false;
+
+///  Queued day_upkeep_step() task, or TASK_HANDLE_NONE.
+static TaskHandle dayUpkeepTask = TASK_HANDLE_NONE;
+
+///  Queued no_location_step() task, or TASK_HANDLE_NONE.
+static TaskHandle noLocationTask = TASK_HANDLE_NONE;
+
+
+static void graphics_night_layer_render_dial(GContext *ctx, GRect layerFrame);
+static void queue_day_and_night_info(bool update_everything);
+
+
+/**
+ *  Ask the phone for our first location.  Queued by the night layer's
+ *  update proc, which mustn't send messages or write flash itself, and
+ *  which runs on every redraw of the "Getting Location" screen.
+ */
+static bool  no_location_step(void *pContext)
+{
+
+   noLocationTask = TASK_HANDLE_NONE;
+
+   if (!config_data_location_avail())
+   {
+      refresh_policy_request(REFRESH_POLICY_NO_LOCATION);
+   }
+
+   return true;
+
+}  /* end of no_location_step */
 
 
 /**
@@ -93,6 +171,13 @@ TwilightPath* pTwiPathCivil = 0;
  *  Note that the heavy calculation has been done ahead of time by
  *  \href updateDayAndNightInfo(), so this callback should be a bit
  *  zippier than it otherwise might be.  (Not to say "fast"..)
+ *  
+ *  Better yet, the composited dial is kept in pDialCache, so after the
+ *  first redraw of each day (and until updateDayAndNightInfo() next
+ *  recomputes) all we do here is blit it back.  And since the framebuffer
+ *  keeps the last frame, usually only the part of it which dirtyRect says
+ *  has changed (the old and new hour hand, and any changed text) need be
+ *  restored: the layers above us redraw themselves over it.
  * 
  * @param me Night layer being updated.
  * @param ctx System-supplied context, presumably already set to defaults
@@ -113,50 +198,131 @@ void graphics_night_layer_update_callback(Layer *me, GContext *ctx)
       message_window_show_status ("Getting Location",
                                   "Obtaining initial location data.");
 
-      app_msg_RequestLatLong();
+      if (noLocationTask == TASK_HANDLE_NONE)
+      {
+         noLocationTask = task_scheduler_submit(no_location_step, NULL, NULL,
+                                                TASK_PRIORITY_NORMAL);
+      }
 
       return;
    }
 
    GRect layerFrame = layer_get_frame(me);
 
-   //BUGBUG: are these
-   //  GRect(0, 0, 144, 168)
-   //not equal to layerFrame?
-
-   // ------------------------------------------------
-
-   //  start out with white screen, draw full-night black to bottom part
-   twilight_path_render(pTwiPathNight, ctx, GColorBlack, layerFrame);
+   GRect dirty;
+   bool fPartial = dirty_rect_take(&dirtyRect, &dirty);
 
-   //  turn all of white remainder (upper part of screen) into dark grey & then
-   //  turn upper part of screen above astro twilight band back into white
-   twilight_path_render(pTwiPathAstro, ctx, GColorWhite, layerFrame);
-
-   //  turn all of white remainder (upper part of screen) into medium grey &
-   //  turn upper part of screen above nautical twilight band back into white
-   twilight_path_render(pTwiPathNautical, ctx, GColorWhite, layerFrame);
+#if TESTING_LOG_DIAL_RENDER_TIME
+   time_t startSecs;
+   uint16_t startMs;
+   time_ms(&startSecs, &startMs);
+   bool fFromCache = dial_cache_is_valid(pDialCache);
+#endif
 
-   //  turn all of white remainder (upper part of screen) into light grey &
-   //  turn upper part of screen above civil twilight band back into white
-   twilight_path_render(pTwiPathCivil, ctx, GColorWhite, layerFrame);
+   if (dial_cache_is_valid(pDialCache))
+   {
+      if (!fPartial || !dial_cache_draw_rect(pDialCache, ctx, dirty))
+      {
+         fPartial = false;
+         dial_cache_draw(pDialCache, ctx, layerFrame);
+      }
+   }
+   else
+   {
+      graphics_night_layer_render_dial(ctx, layerFrame);
 
-   // ------------------------------------------------
+      //  everything else draws after us, so framebuffer now holds just the dial.
+      dial_cache_capture(pDialCache, ctx);
+   }
 
-   //  place tidy watchface frame over accumulated render of twilight bands:
-   transbitmap_draw_in_rect(pTransBmpWatchface, ctx, layerFrame);
+#if TESTING_LOG_DIAL_RENDER_TIME
+   time_t endSecs;
+   uint16_t endMs;
+   time_ms(&endSecs, &endMs);
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "dial %s in %d ms",
+           !fFromCache ? "render" : (fPartial ? "patch" : "blit"),
+           (int) (((endSecs - startSecs) * 1000) + endMs - startMs));
+   if (fFromCache && fPartial)
+   {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "  patched %dx%d at (%d,%d)",
+              dirty.size.w, dirty.size.h, dirty.origin.x, dirty.origin.y);
+   }
+#endif
 
    //  not clear why this is done: perhaps the system needs it?
    graphics_context_set_compositing_mode(ctx, GCompOpAssign);
 
+   if (!fFirstFrameDrawn)
+   {
+      fFirstFrameDrawn = true;
+
+      time_t nowSecs;
+      uint16_t nowMs;
+      time_ms(&nowSecs, &nowMs);
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "first frame %d ms after load, dial %s",
+              (int) (((nowSecs - loadStartSecs) * 1000) + nowMs - loadStartMs),
+              fDayAndNightInfoDeferred ? "from flash" : "rendered");
+   }
+
+   if (fDayAndNightInfoDeferred)
+   {
+      //  Dial came from flash and is on screen: now catch up on the rest.
+      fDayAndNightInfoDeferred = false;
+      queue_day_and_night_info(false);
+   }
+
    return;
 
 }  /* end of graphics_night_layer_update_callback() */
 
-float get24HourAngle(int hours, int minutes)
+
+/**
+ *  Render the watch "dial" from scratch: all twilight bands, with the
+ *  watchface frame on top.
+ * 
+ * @param ctx Graphics context to render to.
+ * @param layerFrame Frame of the layer being rendered.
+ */
+static void graphics_night_layer_render_dial(GContext *ctx, GRect layerFrame)
 {
-   return (12.0f + hours + (minutes / 60.0f)) / 24.0f;
-}
+
+   //BUGBUG: are these
+   //  GRect(0, 0, 144, 168)
+   //not equal to layerFrame?
+
+   // ------------------------------------------------
+
+   //  All bands in one pass, straight to the framebuffer:
+   //    - start out with white screen, draw full-night black to bottom part
+   //    - turn all of white remainder (upper part of screen) into dark grey &
+   //      then turn upper part of screen above astro twilight band back into white
+   //    - likewise for medium grey & nautical band, then light grey & civil band
+   TwilightPath *apTwiPaths[] = { pTwiPathNight, pTwiPathAstro,
+                                  pTwiPathNautical, pTwiPathCivil };
+   const GColor aColors[] = { GColorBlack, GColorWhite, GColorWhite, GColorWhite };
+
+   if (! twilight_path_render_multi(apTwiPaths, aColors,
+                                    sizeof(apTwiPaths) / sizeof(apTwiPaths[0]),
+                                    ctx, layerFrame))
+   {
+      //  no framebuffer access, so do it the slow way, one band at a time.
+      //  That is when PebbleOS won't let us capture the framebuffer (it is
+      //  already captured, as by an animation), or its rows are wider than
+      //  the RASTER_MAX_ROW_WORDS the single pass buffers: neither happens
+      //  on aplite's 144 pixel wide screen in the normal course of things,
+      //  but the result is the same dial either way, only slower.
+      for (unsigned i = 0; i < sizeof(apTwiPaths) / sizeof(apTwiPaths[0]); i++)
+      {
+         twilight_path_render(apTwiPaths[i], ctx, aColors[i], layerFrame);
+      }
+   }
+
+   // ------------------------------------------------
+
+   //  place tidy watchface frame over accumulated render of twilight bands:
+   transbitmap_draw_in_rect(pTransBmpWatchface, ctx, layerFrame);
+
+}  /* end of graphics_night_layer_render_dial() */
 
 /** 
  *  Given a presumably UTC time, return the astronomical julian day.
@@ -195,41 +361,260 @@ int moon_phase(int jdn)
 
 
 /**
- *  Update lunar phase.  Intended to be called once per day.
+ *  Change a text layer's text, if it differs from what's shown, and note
+ *  the layer's area for redraw.
+ * 
+ *  @param pTextLayer Layer to update.
+ *  @param pszShown The layer's text buffer, bufSize bytes long.  This
+ *             must stay put while the layer shows it.
+ *  @param bufSize Size of pszShown.
+ *  @param pszNew New text.
+ */
+static void update_text_layer(TextLayer *pTextLayer, char *pszShown, size_t bufSize,
+                              const char *pszNew)
+{
+
+   if (strncmp(pszShown, pszNew, bufSize) == 0)
+   {
+      return;
+   }
+
+   strncpy(pszShown, pszNew, bufSize - 1);
+   pszShown[bufSize - 1] = '\0';
+
+   text_layer_set_text(pTextLayer, pszShown);
+   dirty_rect_add(&dirtyRect, layer_get_frame(text_layer_get_layer(pTextLayer)));
+
+}  /* end of update_text_layer */
+
+
+/**
+ *  Work out a day's lunar phase.
+ * 
+ *  @param timeWhen Time during the day wanted.
+ * 
+ *  @return Phase, 0 - 27, corrected for the hemisphere we're in.
  */
-void DisplayCurrentLunarPhase()
+static int current_lunar_phase(time_t timeWhen)
 {
 
-   static char moon[] = "m";
    int moonphase_number = 0;
 
-   // moon
-   time_t timeNow;
-   timeNow = time(NULL);
-   moonphase_number = moon_phase(tm2jd(gmtime(&timeNow)));
+   moonphase_number = moon_phase(tm2jd(gmtime(&timeWhen)));
    // correct for southern hemisphere
    if ((moonphase_number > 0) && (config_data_get_latitude() < 0))
       moonphase_number = 28 - moonphase_number;
 
+   return moonphase_number;
+
+}  /* end of current_lunar_phase */
+
+
+/**
+ *  Update lunar phase.  Intended to be called once per day.
+ * 
+ *  @param moonphase_number Phase, 0 - 27, from current_lunar_phase().
+ */
+void DisplayLunarPhase(int moonphase_number)
+{
+
+   static char moon[sizeof("m")] = "";
+   char newMoon[sizeof(moon)] = "m";
+
    // select correct font char
    if (moonphase_number == 14)
    {
-      moon[0] = (unsigned char)(48);
+      newMoon[0] = (unsigned char)(48);
    } else if (moonphase_number == 0)
    {
-      moon[0] = (unsigned char)(49);
+      newMoon[0] = (unsigned char)(49);
    } else if (moonphase_number < 14)
    {
-      moon[0] = (unsigned char)(moonphase_number + 96);
+      newMoon[0] = (unsigned char)(moonphase_number + 96);
    } else
    {
-      moon[0] = (unsigned char)(moonphase_number + 95);
+      newMoon[0] = (unsigned char)(moonphase_number + 95);
    }
 //    moon[0] = (unsigned char)(moonphase_number);
 
-   text_layer_set_text(pMoonLayer, moon);
+   update_text_layer(pMoonLayer, moon, sizeof(moon), newMoon);
+
+}  /* end of DisplayLunarPhase */
+
+
+/**
+ *  Hash everything the dial depends on: the date, and the location and
+ *  UTC offset its twilight times are computed for.
+ * 
+ *  @param pLocalTime Local date the dial is for.
+ */
+static uint32_t dial_fingerprint(const struct tm *pLocalTime)
+{
+
+   struct
+   {
+      int16_t  year;
+      int16_t  yday;
+      float    latitude;
+      float    longitude;
+      int32_t  utcOffset;
+   } inputs;
+
+   //  (no padding in the above, but be sure the hash only sees our values.)
+   memset(&inputs, 0, sizeof(inputs));
+   inputs.year = pLocalTime->tm_year;
+   inputs.yday = pLocalTime->tm_yday;
+   config_data_location_get(&inputs.latitude, &inputs.longitude,
+                            &inputs.utcOffset, NULL);
+
+   return fnv1a32(&inputs, sizeof(inputs));
+
+}  /* end of dial_fingerprint */
+
+
+/**
+ *  Format a time of day as strftime() would.
+ *
+ *  @param pTm Date to format the time with.  Its hour and minute are
+ *             overwritten.
+ *  @param minuteOfDay Minutes since midnight, or TWILIGHT_NO_MINUTE for
+ *             a time that doesn't occur today (sun never rises / sets).
+ */
+static void format_minute_of_day(char *pszBuf, size_t bufSize, const char *pszFormat,
+                                 struct tm *pTm, int16_t minuteOfDay)
+{
+   if (minuteOfDay == TWILIGHT_NO_MINUTE)
+   {
+      strncpy(pszBuf, "--:--", bufSize - 1);
+      pszBuf[bufSize - 1] = '\0';
+      return;
+   }
+
+   pTm->tm_hour = minuteOfDay / 60;
+   pTm->tm_min = minuteOfDay % 60;
+   strftime(pszBuf, bufSize, pszFormat, pTm);
+}
+
+
+/**
+ *  Find a day's twilight times, and fill in a day record with the results
+ *  and everything shown from them.
+ * 
+ *  @param pRecord Record to fill in, and tag for the day.
+ *  @param aZeniths Zenith angle of each band.  The last band's dawn / dusk
+ *             is shown as sunrise / sunset.
+ *  @param numBands Entries in aZeniths.  At most DAY_RECORD_MAX_BANDS
+ *             and TWILIGHT_SCHEDULE_MAX_BANDS.
+ *  @param pLocalTime Local date to compute for.
+ */
+static void compute_day_record(DayRecord *pRecord, const float aZeniths[],
+                               int numBands, const struct tm *pLocalTime)
+{
+
+   struct tm tmLocal = *pLocalTime;
+
+   //  Normally the day is already in the schedule, and there's no math
+   //  to do.  If not, work it out now.  (For today, the caller has the
+   //  schedule rebuilt too.)
+   int16_t aDawnMinutes[TWILIGHT_SCHEDULE_MAX_BANDS];
+   int16_t aDuskMinutes[TWILIGHT_SCHEDULE_MAX_BANDS];
+
+   if (!twilight_schedule_lookup(&tmLocal, aDawnMinutes, aDuskMinutes, numBands))
+   {
+      float aRise[TWILIGHT_SCHEDULE_MAX_BANDS];
+      float aSet[TWILIGHT_SCHEDULE_MAX_BANDS];
+
+      calcSunRiseSetMulti(tmLocal.tm_year, tmLocal.tm_mon + 1, tmLocal.tm_mday,
+                          config_data_get_latitude(), config_data_get_longitude(),
+                          aZeniths, numBands, aRise, aSet);
+
+      for (int i = 0; i < numBands; i++)
+      {
+         aDawnMinutes[i] = twilight_path_utc_to_minute(aRise[i]);
+         aDuskMinutes[i] = twilight_path_utc_to_minute(aSet[i]);
+      }
+   }
+
+   memset(pRecord, 0, sizeof(*pRecord));
+   for (int i = 0; i < numBands; i++)
+   {
+      pRecord->aDawnMinutes[i] = (uint16_t) aDawnMinutes[i];
+      pRecord->aDuskMinutes[i] = (uint16_t) aDuskMinutes[i];
+   }
+
+   //  Want the user's default time format, but not for the current time.
+   //  We can't use clock_copy_time_string(), so make an equivalent format:
+   char *time_format;
+
+   if (clock_is_24h_style())
+   {
+      time_format = "%R";
+   } else
+   {
+      time_format = "%l:%M";
+   }
+
+   //  (minutes are rounded to nearest, the same as the dial shows)
+   format_minute_of_day(pRecord->achSunrise, sizeof(pRecord->achSunrise), time_format,
+                        &tmLocal, aDawnMinutes[numBands - 1]);
+   format_minute_of_day(pRecord->achSunset, sizeof(pRecord->achSunset), time_format,
+                        &tmLocal, aDuskMinutes[numBands - 1]);
+
+   //  (the moon as at the start of the day, as an update just after
+   //  midnight would have it.)
+   tmLocal.tm_hour = 0;
+   tmLocal.tm_min = 0;
+   tmLocal.tm_sec = 0;
+   pRecord->moonPhase = current_lunar_phase(mktime(&tmLocal));
+
+   day_record_tag(pRecord, pLocalTime);
+
+}  /* end of compute_day_record */
+
+
+///  Zenith angle of each twilight path's band, in day record order.
+static int get_twilight_zeniths(float aZeniths[])
+{
+
+   aZeniths[0] = pTwiPathNight->fZenith;
+   aZeniths[1] = pTwiPathAstro->fZenith;
+   aZeniths[2] = pTwiPathNautical->fZenith;
+   aZeniths[3] = pTwiPathCivil->fZenith;
+
+   return NUM_TWI_PATHS;
+
+}  /* end of get_twilight_zeniths */
+
+
+///  TaskScheduler step: save today's record, then work out tomorrow's.
+static bool day_upkeep_step(void *pContext)
+{
+
+   (void) pContext;
+
+   if (fTodayRecordUnsaved)
+   {
+      fTodayRecordUnsaved = false;
+      day_record_save(pTodayRecord);
+
+      //  tomorrow in a later step: this one did a flash write.
+      return false;
+   }
+
+   time_t timeTomorrow = time(NULL) + (24 * 60 * 60);
+   struct tm tmTomorrow = *(localtime(&timeTomorrow));
+
+   if (!day_record_is_for(pTomorrowRecord, &tmTomorrow))
+   {
+      float aZeniths[NUM_TWI_PATHS];
+      int numBands = get_twilight_zeniths(aZeniths);
+      compute_day_record(pTomorrowRecord, aZeniths, numBands, &tmTomorrow);
+   }
+
+   dayUpkeepTask = TASK_HANDLE_NONE;
+   return true;
 
-}  /* end of DisplayCurrentLunarPhase */
+}  /* end of day_upkeep_step */
 
 
 /**
@@ -237,6 +622,8 @@ void DisplayCurrentLunarPhase()
  *  times for current day.
  *  
  *  This only needs to be called once a day (aside from startup time).
+ *  Tomorrow's results are worked out ahead, in idle time, so that at
+ *  midnight this only has to switch to them.
  * 
  * @param update_everything True to update everything. False to
  *                          only update when the day has
@@ -244,8 +631,8 @@ void DisplayCurrentLunarPhase()
  */
 void updateDayAndNightInfo(bool update_everything)
 {
-   static char sunrise_text[] = "00:00";
-   static char sunset_text[] = "00:00";
+   static char sunrise_text[DAY_RECORD_TEXT_BYTES] = "";
+   static char sunset_text[DAY_RECORD_TEXT_BYTES] = "";
 
    ///  Localtime mday of most recent completed day/night update.
    ///  This means we normally update just after midnight, which
@@ -262,48 +649,112 @@ void updateDayAndNightInfo(bool update_everything)
       return;
    }
 
-   twilight_path_compute_current(pTwiPathNight,    &tmNowLocal);
-   twilight_path_compute_current(pTwiPathAstro,    &tmNowLocal);
-   twilight_path_compute_current(pTwiPathNautical, &tmNowLocal);
-   twilight_path_compute_current(pTwiPathCivil,    &tmNowLocal);
+   uint32_t fingerprint = dial_fingerprint(&tmNowLocal);
 
-   //  Want the user's default time format, but not for the current time.
-   //  We can't use clock_copy_time_string(), so make an equivalent format:
-   char *time_format;
+   float aZeniths[NUM_TWI_PATHS];
+   int numBands = get_twilight_zeniths(aZeniths);
 
-   if (clock_is_24h_style())
+   if (day_record_is_for(pTomorrowRecord, &tmNowLocal))
    {
-      time_format = "%R";
-   } else
+      //  The usual midnight case: worked out in idle time yesterday.
+      DayRecord *pSwap = pTodayRecord;
+      pTodayRecord = pTomorrowRecord;
+      pTomorrowRecord = pSwap;
+
+      fTodayRecordUnsaved = true;
+   }
+   else if (!day_record_is_for(pTodayRecord, &tmNowLocal) &&
+            !day_record_load(pTodayRecord, &tmNowLocal))
    {
-      time_format = "%l:%M";
+      //  (If we already worked today out, say before a relaunch, the
+      //  load picks up the results from flash.)
+      compute_day_record(pTodayRecord, aZeniths, numBands, &tmNowLocal);
+
+      fTodayRecordUnsaved = true;
    }
 
-   float sunriseTime = pTwiPathCivil->fDawnTime;
-   float sunsetTime  = pTwiPathCivil->fDuskTime;
+   //  Have the schedule rebuilt in the background if it doesn't run far
+   //  enough on from today: by the phone if we can, else by the worker.
+   //  (Only from today, as it starts the schedule on the day given.)
+   schedule_stream_refresh(aZeniths, numBands, &tmNowLocal);
 
-   //BUGBUG - need to round this
-   tmNowLocal.tm_min = (int)(60 * (sunriseTime - ((int)(sunriseTime))));
-   tmNowLocal.tm_hour = (int)sunriseTime;
-   strftime(sunrise_text, sizeof(sunrise_text), time_format, &tmNowLocal);
-   text_layer_set_text(pTextSunriseLayer, sunrise_text);
+   //  All four bands share one date & location, so were computed together.
+   TwilightPath *apTwiPaths[NUM_TWI_PATHS] = { pTwiPathNight, pTwiPathAstro,
+                                               pTwiPathNautical, pTwiPathCivil };
+   for (unsigned i = 0; i < NUM_TWI_PATHS; i++)
+   {
+      twilight_path_set_minutes(apTwiPaths[i], (int16_t) pTodayRecord->aDawnMinutes[i],
+                                (int16_t) pTodayRecord->aDuskMinutes[i]);
+   }
 
-   tmNowLocal.tm_min = (int)(60 * (sunsetTime - ((int)(sunsetTime))));
-   tmNowLocal.tm_hour = (int)sunsetTime;
-   strftime(sunset_text, sizeof(sunset_text), time_format, &tmNowLocal);
-   text_layer_set_text(pTextSunsetLayer, sunset_text);
-   text_layer_set_text_alignment(pTextSunsetLayer, GTextAlignmentRight);
+   update_text_layer(pTextSunriseLayer, sunrise_text, sizeof(sunrise_text),
+                     pTodayRecord->achSunrise);
+   update_text_layer(pTextSunsetLayer, sunset_text, sizeof(sunset_text),
+                     pTodayRecord->achSunset);
 
-   DisplayCurrentLunarPhase();
+   DisplayLunarPhase(pTodayRecord->moonPhase);
 
    lastUpdateDay = tmNowLocal.tm_mday;
 
    //  other layers should take care of themselves, but make sure our base
-   //  "dial" bitmap is updated.
-   layer_mark_dirty(pGraphicsNightLayer);
+   //  "dial" bitmap is updated.  (The cache keeps its dial if that is
+   //  already for this day / location, as when it came from flash.)
+   dial_cache_set_fingerprint(pDialCache, fingerprint);
+   if (!dial_cache_is_valid(pDialCache))
+   {
+      dirty_rect_add_all(&dirtyRect);
+      layer_mark_dirty(pGraphicsNightLayer);
+   }
+
+   //  Flash write and tomorrow's math wait for idle time.
+   if (dayUpkeepTask == TASK_HANDLE_NONE)
+   {
+      dayUpkeepTask = task_scheduler_submit(day_upkeep_step, NULL, NULL,
+                                            TASK_PRIORITY_LOW);
+   }
 
 }  /* end of updateDayAndNightInfo() */
 
+
+///  TaskScheduler step: the day / night update queued by queue_day_and_night_info().
+static bool day_and_night_info_step(void *pContext)
+{
+   (void) pContext;
+
+   bool update_everything = fDayAndNightEverything;
+
+   dayAndNightTask = TASK_HANDLE_NONE;
+   fDayAndNightEverything = false;
+
+   updateDayAndNightInfo(update_everything);
+
+   return true;
+}
+
+/**
+ *  Run updateDayAndNightInfo() soon, from a TaskScheduler task, rather than
+ *  in the handler calling us.  Requests made before it runs are merged.
+ */
+static void queue_day_and_night_info(bool update_everything)
+{
+
+   fDayAndNightEverything |= update_everything;
+
+   if (dayAndNightTask != TASK_HANDLE_NONE)
+   {
+      return;
+   }
+
+   //  High priority: the face shows stale times until it runs.
+   dayAndNightTask = task_scheduler_submit(day_and_night_info_step, NULL, NULL,
+                                           TASK_PRIORITY_HIGH);
+   if (dayAndNightTask == TASK_HANDLE_NONE)
+   {
+      day_and_night_info_step(NULL);
+   }
+
+}  /* end of queue_day_and_night_info */
+
 /**
  *  Once a minute, update textual time displays, and analog hour hand.
  *  
@@ -323,32 +774,45 @@ static void handle_minute_tick(struct tm *tick_time, TimeUnits units_changed)
 
    (void) units_changed;
 
-   // Need to be static because they're used by the system later.
-   static char time_text[] = "00:00";
-   static char dow_text[] = "xxx";
-   static char mon_text[14];
-
-   strftime(dow_text, sizeof(dow_text), "%a", tick_time);
-   strftime(mon_text, sizeof(mon_text), "%b %e, %Y", tick_time);
+#if TESTING_LOG_TICK_LATENCY
+   static int worstTickMs = 0;
+   time_t startSecs;
+   uint16_t startMs;
+   time_ms(&startSecs, &startMs);
+#endif
 
-   clock_copy_time_string(time_text, sizeof(time_text));
-   if (!clock_is_24h_style() && (time_text[0] == '0'))
-   {
-      memmove(time_text, &time_text[1], sizeof(time_text) - 1);
-   }
+   // Need to be static because they're used by the system later.
+   static char time_text[sizeof("00:00")] = "";
+   static char dow_text[sizeof("xxx")] = "";
+   static char mon_text[14] = "";
 
-   text_layer_set_text(pDayOfWeekLayer, dow_text);
-   text_layer_set_text(pMonthLayer, mon_text);
+   //  Only text which has actually changed is set, so that as little of
+   //  the screen as possible is redrawn.  Most minutes that's just the time.
+   char newText[sizeof(mon_text)];
 
-   text_layer_set_text(pTextTimeLayer, time_text);
-   text_layer_set_text_alignment(pTextTimeLayer, GTextAlignmentCenter);
+   strftime(newText, sizeof(dow_text), "%a", tick_time);
+   update_text_layer(pDayOfWeekLayer, dow_text, sizeof(dow_text), newText);
 
-   //  update hour hand position
-   transrotbmp_set_angle(pTransRotBmpHourHand,
-                         TRIG_MAX_ANGLE * get24HourAngle(tick_time->tm_hour,
-                                                         tick_time->tm_min));
+   strftime(newText, sizeof(mon_text), "%b %e, %Y", tick_time);
+   update_text_layer(pMonthLayer, mon_text, sizeof(mon_text), newText);
 
-   transrotbmp_set_pos_centered(pTransRotBmpHourHand, 0, 9 + 2);
+   clock_copy_time_string(newText, sizeof(time_text));
+   if (!clock_is_24h_style() && (newText[0] == '0'))
+   {
+      memmove(newText, &newText[1], sizeof(time_text) - 1);
+   }
+   update_text_layer(pTextTimeLayer, time_text, sizeof(time_text), newText);
+
+   //  update hour hand position: it moves in steps of several minutes, and
+   //  its old and new areas both need redrawing when it does.
+   GRect handBefore = sprite_atlas_get_bounds(pHourHand);
+   if (sprite_atlas_set_angle(pHourHand,
+                              twilight_path_dial_angle((tick_time->tm_hour * 60) +
+                                                       tick_time->tm_min)))
+   {
+      dirty_rect_add(&dirtyRect, handBefore);
+      dirty_rect_add(&dirtyRect, sprite_atlas_get_bounds(pHourHand));
+   }
 
 // Vibrate Every Hour
 #if HOUR_VIBRATION
@@ -359,11 +823,59 @@ static void handle_minute_tick(struct tm *tick_time, TimeUnits units_changed)
    }
 #endif
 
-   updateDayAndNightInfo(false);
+   if (config_data_apply_utc_offset_changes())
+   {
+      //  A daylight saving change: the phone told us when, in advance.
+      queue_day_and_night_info(true /* update_everything */);
+   }
+   else if (!fDayAndNightInfoDeferred)
+   {
+      updateDayAndNightInfo(false);
+   }
+
+   refresh_policy_minute_tick(tick_time);
+
+#if TESTING_LOG_TICK_LATENCY
+   time_t endSecs;
+   uint16_t endMs;
+   time_ms(&endSecs, &endMs);
+   int tickMs = (int) (((endSecs - startSecs) * 1000) + endMs - startMs);
+   if (tickMs > worstTickMs)
+   {
+      worstTickMs = tickMs;
+   }
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "tick %02d:%02d in %d ms (worst %d ms)",
+           tick_time->tm_hour, tick_time->tm_min, tickMs, worstTickMs);
+#endif
 
 }  /* end of handle_minute_tick() */
 
 
+/**
+ *  Our window is (back) on screen, perhaps after another window covered it,
+ *  so the framebuffer holds nothing of ours: redraw all of it.
+ */
+static void  sunclock_window_appear(Window * pMyWindow)
+{
+   dirty_rect_add_all(&dirtyRect);
+   layer_mark_dirty(window_get_root_layer(pMyWindow));
+}
+
+
+/**
+ *  Likewise when we get focus back from a notification or other system
+ *  window drawn over ours.
+ */
+static void  sunclock_focus_handler(bool fInFocus)
+{
+   if (fInFocus)
+   {
+      dirty_rect_add_all(&dirtyRect);
+      layer_mark_dirty(window_get_root_layer(pWindow));
+   }
+}
+
+
 /**
  *  Do GUI layout for already-created window, and cache all needed resources.
  *  Also register a tick handler, initialize watch/phone messaging, and request
@@ -372,6 +884,9 @@ static void handle_minute_tick(struct tm *tick_time, TimeUnits units_changed)
 static void  sunclock_window_load(Window * pMyWindow) 
 {
 
+   time_ms(&loadStartSecs, &loadStartMs);
+   fFirstFrameDrawn = false;
+
    window_set_background_color(pWindow, GColorWhite);
 
    pFontMoon = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_FONT_MOON_PHASES_SUBSET_30));
@@ -407,19 +922,33 @@ static void  sunclock_window_load(Window * pMyWindow)
    //  Yes, the apparent mismatch between ZENITH_ names and TwilightPath instance
    //  names is intended (if a bit unfortunate).
    pTwiPathNight    = twilight_path_create(ZENITH_ASTRONOMICAL, ENCLOSE_SCREEN_BOTTOM,
-                                           INVALID_RESOURCE);
+                                           TWILIGHT_SHADE_NONE);
    pTwiPathAstro    = twilight_path_create(ZENITH_NAUTICAL,     ENCLOSE_SCREEN_TOP,
-                                           RESOURCE_ID_IMAGE_DARK_GREY);
+                                           TWILIGHT_SHADE_DARK_GREY);
    pTwiPathNautical = twilight_path_create(ZENITH_CIVIL,        ENCLOSE_SCREEN_TOP,
-                                           RESOURCE_ID_IMAGE_GREY);
+                                           TWILIGHT_SHADE_GREY);
    pTwiPathCivil    = twilight_path_create(ZENITH_OFFICIAL,     ENCLOSE_SCREEN_TOP,
-                                           RESOURCE_ID_IMAGE_LIGHT_GREY);
+                                           TWILIGHT_SHADE_LIGHT_GREY);
    if ((pTwiPathNight == NULL) || (pTwiPathAstro == NULL) ||
        (pTwiPathNautical == NULL) || (pTwiPathCivil == NULL))
    {
       return;
    }
 
+   //  Nice to have, but we can do without it if heap is short.
+   pDialCache = dial_cache_create(layer_get_frame(pGraphicsNightLayer).size);
+
+   time_t timeNow = time(NULL);
+   struct tm * pLocalTime = localtime(&timeNow);
+
+   //  If flash holds today's dial for here, the first frame can simply show
+   //  it, and the solar math can wait until that frame is up.
+   if (config_data_location_avail())
+   {
+      dial_cache_set_fingerprint(pDialCache, dial_fingerprint(pLocalTime));
+      fDayAndNightInfoDeferred = dial_cache_restore(pDialCache);
+   }
+
    // time of day text
    pTextTimeLayer = text_layer_create(GRect(0, 36, 144, 42));
    if (pTextTimeLayer == NULL)
@@ -429,6 +958,7 @@ static void  sunclock_window_load(Window * pMyWindow)
    text_layer_set_text_color(pTextTimeLayer, GColorBlack); 
    text_layer_set_background_color(pTextTimeLayer, GColorClear);
    text_layer_set_font(pTextTimeLayer, pFontCurTime);
+   text_layer_set_text_alignment(pTextTimeLayer, GTextAlignmentCenter);
    layer_add_child(window_get_root_layer(pWindow),
                    text_layer_get_layer(pTextTimeLayer));
 
@@ -446,13 +976,14 @@ static void  sunclock_window_load(Window * pMyWindow)
 
    //  Add hour hand after moon phase:  looks weird (wrong) to see phase
    //  on top of the hour hand.
-   pTransRotBmpHourHand = transrotbmp_create_with_resource_prefix(RESOURCE_ID_IMAGE_HOUR);
-   if (pTransRotBmpHourHand == NULL)
+   pHourHand = sprite_atlas_create(RESOURCE_ID_HOUR_HAND_ATLAS,
+                                   layer_get_bounds(window_get_root_layer(pWindow)));
+   if (pHourHand == NULL)
    {
       return;
    }
-   transrotbmp_set_src_ic(pTransRotBmpHourHand, GPoint(9, 56));
-   transrotbmp_add_to_layer(pTransRotBmpHourHand, window_get_root_layer(pWindow));
+   sprite_atlas_set_pivot(pHourHand, GPoint(144 / 2, (168 / 2) + 9 + 2));
+   sprite_atlas_add_to_layer(pHourHand, window_get_root_layer(pWindow));
 
    //  Same rectangle used for day of week and date text:
    //  text alignment avoids conflicts in the two layers.
@@ -489,8 +1020,8 @@ static void  sunclock_window_load(Window * pMyWindow)
 
    pFontSmallText = fonts_get_system_font(FONT_KEY_GOTHIC_18);
 
-   //  Same rectangle used for sunrise / sunset text layers: updateDayAndNightInfo()
-   //  changes sunset text to right-aligned.
+   //  Same rectangle used for sunrise / sunset text layers: text alignment
+   //  avoids conflicts in the two layers.
    GRect SunRiseSetTextRect;
    SunRiseSetTextRect = GRect(0, 147, 144, 30);
 
@@ -513,13 +1044,13 @@ static void  sunclock_window_load(Window * pMyWindow)
    text_layer_set_text_color(pTextSunsetLayer, GColorWhite); 
    text_layer_set_background_color(pTextSunsetLayer, GColorClear);
    text_layer_set_font(pTextSunsetLayer, pFontSmallText);
+   text_layer_set_text_alignment(pTextSunsetLayer, GTextAlignmentRight);
    layer_add_child(window_get_root_layer(pWindow),
                    text_layer_get_layer(pTextSunsetLayer));
 
    //  Run initial tick processing before our window displays, so that all
    //  text fields are populated initially.
-   time_t timeNow = time(NULL);
-   struct tm * pLocalTime = localtime(&timeNow);
+   pLocalTime = localtime(&timeNow);
 
    handle_minute_tick(pLocalTime, MINUTE_UNIT);
 
@@ -527,6 +1058,7 @@ static void  sunclock_window_load(Window * pMyWindow)
 //   app_msg_RequestLatLong();
 
    tick_timer_service_subscribe(MINUTE_UNIT, handle_minute_tick);
+   app_focus_service_subscribe(sunclock_focus_handler);
 
    initialized_ok = true;
 
@@ -541,6 +1073,25 @@ static void  sunclock_window_unload(Window * pMyWindow)
 {
 
    tick_timer_service_unsubscribe();
+   app_focus_service_unsubscribe();
+
+   //  any schedule rebuild in progress starts over next launch.
+   twilight_schedule_cancel();
+
+   task_scheduler_cancel(dayAndNightTask);
+   dayAndNightTask = TASK_HANDLE_NONE;
+
+   task_scheduler_cancel(dayUpkeepTask);
+   dayUpkeepTask = TASK_HANDLE_NONE;
+
+   task_scheduler_cancel(noLocationTask);
+   noLocationTask = TASK_HANDLE_NONE;
+
+   if (fTodayRecordUnsaved)
+   {
+      fTodayRecordUnsaved = false;
+      day_record_save(pTodayRecord);
+   }
 
    SAFE_DESTROY(text_layer, pTextSunsetLayer);
    SAFE_DESTROY(text_layer, pTextSunriseLayer);
@@ -553,29 +1104,61 @@ static void  sunclock_window_unload(Window * pMyWindow)
    transbitmap_destroy(pTransBmpWatchface);
    pTransBmpWatchface = 0;
 
-   transrotbmp_destroy(pTransRotBmpHourHand);
-   pTransRotBmpHourHand = 0;
+   SAFE_DESTROY(sprite_atlas, pHourHand);
 
    SAFE_DESTROY(twilight_path, pTwiPathNight);
    SAFE_DESTROY(twilight_path, pTwiPathAstro);
    SAFE_DESTROY(twilight_path, pTwiPathNautical);
    SAFE_DESTROY(twilight_path, pTwiPathCivil);
 
+   //  so that next launch can show the dial straight away.
+   if (config_data_location_avail())
+   {
+      dial_cache_save(pDialCache);
+   }
+   SAFE_DESTROY(dial_cache, pDialCache);
+
 }  /* end of sunclock_window_unload() */
 
 
-void sunclock_coords_recvd(float latitude, float longitude, int32_t utcOffset)
+void sunclock_coords_recvd(const AppMsgLocation *pLocation)
 {
 
-   APP_LOG(APP_LOG_LEVEL_DEBUG, "got coords, utcOff=%d", (int) utcOffset);
+   //  (time() is UTC on SDK3, as timeFix is.)
+   time_t nowUtc = time(NULL);
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "got coords, utcOff=%d, fix %d s old, +/- %d m",
+           (int) pLocation->utcOffset, (int) (nowUtc - pLocation->timeFix),
+           pLocation->usAccuracy);
+
+   usCoordsRecvd++;
+
+   bool fMoved = config_data_is_different(pLocation->latitude, pLocation->longitude,
+                                          pLocation->utcOffset);
+   refresh_policy_fix_received(fMoved);
 
-   if (config_data_is_different(latitude, longitude, utcOffset))
+   if (fMoved)
    {
-      config_data_location_set(latitude, longitude, utcOffset); 
+      config_data_location_set(pLocation->latitude, pLocation->longitude,
+                               pLocation->utcOffset);
 
-      updateDayAndNightInfo(true /* update_everything */);
+      usLocationRecomputes++;
+      queue_day_and_night_info(true /* update_everything */);
    }
 
+   ConfigDataUtcOffsetChange aChanges[CONFIG_DATA_MAX_UTC_OFFSET_CHANGES];
+   int numChanges = 0;
+   for (int i = 0; (i < pLocation->numUtcOffsetChanges) &&
+                   (numChanges < CONFIG_DATA_MAX_UTC_OFFSET_CHANGES); i++)
+   {
+      aChanges[numChanges].timeChange = pLocation->aUtcOffsetChanges[i].timeChange;
+      aChanges[numChanges].utcOffset  = pLocation->aUtcOffsetChanges[i].utcOffset;
+      numChanges++;
+   }
+   config_data_set_utc_offset_changes(aChanges, numChanges);
+
+   APP_LOG(APP_LOG_LEVEL_DEBUG, "coords received %d, recomputes %d",
+           usCoordsRecvd, usLocationRecomputes);
+
 }  /* end of sunclock_coords_recvd */
 
 
@@ -599,6 +1182,7 @@ void  sunclock_handle_init()
    window_set_window_handlers(pWindow,
                               (WindowHandlers) {
                                  .load = sunclock_window_load,
+                                 .appear = sunclock_window_appear,
                                  .unload = sunclock_window_unload,
                                });
 
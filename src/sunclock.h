@@ -9,11 +9,13 @@
 
 #include  <pebble.h>
 
+#include  "messaging.h"
+
 
 void  sunclock_handle_init(void);
 void  sunclock_handle_deinit(void);
 
-void sunclock_coords_recvd(float latitude, float longitude, int32_t utcOffset);
+void sunclock_coords_recvd(const AppMsgLocation *pLocation);
 
 
 //  Some resources loaded by sunclock_handle_init() which might be useful elsewhere:
@@ -2,6 +2,8 @@
  *  @file
  *  
  *  A few constants to simplify kicking the Sunclock into test modes for debug.
+ *  Each may also be set from the compiler command line (the host build,
+ *  host/CMakeLists.txt, turns on the test aids it runs).
  */
 
 #ifndef sunclock_testing_h__
@@ -9,10 +11,60 @@
 
 
 ///  Set true to always fail to read from watch's location cache, even when valid.
+#ifndef  TESTING_DISABLE_CACHE_READ
 #define  TESTING_DISABLE_CACHE_READ  0
+#endif
+
+///  Set true to always recompute the day's twilight times instead of using the flash copy.
+#ifndef  TESTING_DISABLE_DAY_RECORD_READ
+#define  TESTING_DISABLE_DAY_RECORD_READ  0
+#endif
 
 ///  Set true to disable normal load-time send of location update request to phone.
+#ifndef  TESTING_DISABLE_LOCATION_REQUEST
 #define  TESTING_DISABLE_LOCATION_REQUEST  0
+#endif
+
+///  Set true to never fetch the twilight schedule from the phone, leaving it to the worker.
+#ifndef  TESTING_DISABLE_SCHEDULE_STREAM
+#define  TESTING_DISABLE_SCHEDULE_STREAM  0
+#endif
+
+///  Set true to ignore the precomputed solar ephemeris table and always do the math.
+#ifndef  TESTING_DISABLE_EPHEMERIS_TABLE
+#define  TESTING_DISABLE_EPHEMERIS_TABLE  0
+#endif
+
+///  Set true to log worst-case float vs. fixed-point suncalc difference at startup.
+#ifndef  TESTING_COMPARE_SUNCALC_FIXED
+#define  TESTING_COMPARE_SUNCALC_FIXED  0
+#endif
+
+///  Set true to log how long each redraw of the watch dial takes.
+#ifndef  TESTING_LOG_DIAL_RENDER_TIME
+#define  TESTING_LOG_DIAL_RENDER_TIME  0
+#endif
+
+///  Set true to log how long each minute tick takes, with the worst so far.
+#ifndef  TESTING_LOG_TICK_LATENCY
+#define  TESTING_LOG_TICK_LATENCY  0
+#endif
+
+///  Set true to time a few days of local math at the end of each schedule
+///  stream, and log what the whole schedule would have cost the watch.
+#ifndef  TESTING_LOG_SCHEDULE_STREAM_COST
+#define  TESTING_LOG_SCHEDULE_STREAM_COST  0
+#endif
+
+///  Set true to time the daily solar update at startup, logged as JSON (Benchmark.c).
+#ifndef  TESTING_BENCHMARK_DAILY_UPDATE
+#define  TESTING_BENCHMARK_DAILY_UPDATE  0
+#endif
+
+///  Set true to log my_math accuracy and speed against double references at startup (MathSweep.c).
+#ifndef  TESTING_SWEEP_MY_MATH
+#define  TESTING_SWEEP_MY_MATH  0
+#endif
 
 
 #endif  // #ifndef sunclock_testing_h__
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Generate resources/data/solar_ephemeris.bin, the per-day solar ephemeris
+table read by src/SolarEphemeris.c, and worker_src/WorkerEphemerisTable.h,
+the same records as const data for the background worker, which can't read
+resources.
+
+The almanac algorithm in src/suncalc.c derives the sun's position purely
+from t, the day of year plus fraction, so one table covers every year.
+There is one record per whole value of t, from 0 through
+SOLAR_EPHEMERIS_NUM_DAYS - 1, enough to interpolate any t the watch can
+ask for (0.75 - 367.25).  Each record is three little-endian 16-bit values:
+
+   int16   sin(declination), scaled by 0x10000
+   uint16  cos(declination), scaled by 0x10000 (clamped to 0xFFFF)
+   uint16  RA - 0.06571 * t - 6.622 hours, as a fraction of a day
+           scaled by 0x10000 (i.e. PebbleOS trig units)
+
+Rerun this after changing any of the almanac constants in suncalc.c:
+
+   python3 tools/gen_ephemeris.py
+"""
+
+import math
+import os
+import struct
+
+#  Must match SOLAR_EPHEMERIS_NUM_DAYS in src/SolarEphemeris.h.
+NUM_DAYS = 369
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+OUT_FILE = os.path.join(ROOT, 'resources', 'data', 'solar_ephemeris.bin')
+OUT_HEADER = os.path.join(ROOT, 'worker_src', 'WorkerEphemerisTable.h')
+
+HEADER_TOP = """/**
+ *  @file
+ *
+ *  The solar ephemeris table, as resources/data/solar_ephemeris.bin has it.
+ *  Generated by tools/gen_ephemeris.py; don't edit.
+ */
+
+#pragma once
+
+#include  "../src/SolarEphemeris.h"
+
+
+static const SolarEphemerisRecord  aWorkerEphemeris[SOLAR_EPHEMERIS_NUM_DAYS] =
+{
+"""
+
+
+def record(t):
+    """Return (sinDec, cosDec, eqnTime hours) at day-of-year time t."""
+    rad = math.pi / 180
+
+    M = (0.9856 * t) - 3.289
+    L = M + (1.916 * math.sin(rad * M)) + (0.020 * math.sin(rad * 2 * M)) + 282.634
+    L %= 360
+
+    #  atan2 puts RA in the same quadrant as L, as steps 5a - 5b do.
+    RA = math.atan2(0.91764 * math.sin(rad * L), math.cos(rad * L)) / rad
+    RA = (RA % 360) / 15
+
+    sinDec = 0.39782 * math.sin(rad * L)
+    cosDec = math.cos(math.asin(sinDec))
+
+    eqnTime = RA - (0.06571 * t) - 6.622
+
+    return sinDec, cosDec, eqnTime
+
+
+def main():
+    data = bytearray()
+    lines = []
+    for t in range(NUM_DAYS):
+        sinDec, cosDec, eqnTime = record(t)
+        values = (int(round(sinDec * 0x10000)),
+                  min(int(round(cosDec * 0x10000)), 0xFFFF),
+                  int(round((eqnTime % 24) / 24 * 0x10000)) & 0xFFFF)
+        data += struct.pack('<hHH', *values)
+        lines.append('   {{ {:6d}, {:5d}, {:5d} }},'.format(*values))
+
+    with open(OUT_FILE, 'wb') as f:
+        f.write(data)
+
+    with open(OUT_HEADER, 'w') as f:
+        f.write(HEADER_TOP + '\n'.join(lines) + '\n};\n')
+
+    print('wrote {} records ({} bytes) to {} and {}'.format(
+        NUM_DAYS, len(data), os.path.normpath(OUT_FILE),
+        os.path.normpath(OUT_HEADER)))
+
+
+if __name__ == '__main__':
+    main()
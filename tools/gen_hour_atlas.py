@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""
+Generate resources/data/hour_atlas.bin, the pre-rotated hour hand sprites
+drawn by src/SpriteAtlas.c.
+
+resources/images/hour.png is rotated about its pivot to each of NUM_ANGLES
+evenly spaced angles.  Rotations by a multiple of 90 degrees are exact pixel
+moves which the watch does itself, so only the first quarter turn
+(NUM_ANGLES / 4 sprites) is stored.
+
+Each sprite is cropped to its bounding box and run-length coded, one row at a
+time.  Pixels are transparent, black or white, as in a "png-trans" resource.
+
+File layout, all little-endian:
+
+   uint8    NUM_ANGLES
+   uint8    number of sprites stored (NUM_ANGLES / 4)
+   uint16   offset of each sprite from start of file, and one past the last
+
+Each sprite:
+
+   int8     x of the sprite's left edge, relative to the pivot
+   int8     y of the sprite's top edge, relative to the pivot
+   uint8    rows
+   then for each row, starting at the left edge, run codes of
+   (kind << 6) | (length - 1), with kind 0 = transparent, 1 = black,
+   2 = white, and 3 ending the row (remaining pixels transparent).
+
+Rerun this after changing hour.png or its pivot:
+
+   python3 tools/gen_hour_atlas.py
+"""
+
+import math
+import os
+import struct
+import zlib
+
+#  Must be a multiple of 4.  The watch reads this from the file header.
+NUM_ANGLES = 144
+
+#  Pivot within hour.png: the hand rotates about this point, the center of
+#  the round boss.
+PIVOT_X = 9
+PIVOT_Y = 56
+
+TRANSPARENT, BLACK, WHITE, END_ROW = 0, 1, 2, 3
+
+#  Longest run one code can hold.
+MAX_RUN = 64
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+IN_FILE = os.path.join(HERE, '..', 'resources', 'images', 'hour.png')
+OUT_FILE = os.path.join(HERE, '..', 'resources', 'data', 'hour_atlas.bin')
+
+
+def read_png(path):
+    """Decode an 8-bit RGBA, non-interlaced PNG into rows of (r, g, b, a)."""
+    data = open(path, 'rb').read()
+    pos = 8
+    idat = b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b'IHDR':
+            width, height, depth, colour, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+            if (depth, colour, interlace) != (8, 6, 0):
+                raise ValueError('{}: expected 8-bit RGBA, not interlaced'.format(path))
+        elif kind == b'IDAT':
+            idat += chunk
+
+    raw = zlib.decompress(idat)
+    stride = width * 4
+    rows = []
+    prev = bytearray(stride)
+    pos = 0
+    for _ in range(height):
+        filt = raw[pos]
+        line = bytearray(raw[pos + 1:pos + 1 + stride])
+        pos += 1 + stride
+        for i in range(stride):
+            a = line[i - 4] if i >= 4 else 0
+            b = prev[i]
+            c = prev[i - 4] if i >= 4 else 0
+            if filt == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif filt == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif filt == 3:
+                line[i] = (line[i] + ((a + b) >> 1)) & 0xFF
+            elif filt == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                line[i] = (line[i] + (a if pa <= pb and pa <= pc else b if pb <= pc else c)) & 0xFF
+        rows.append([tuple(line[x * 4:x * 4 + 4]) for x in range(width)])
+        prev = line
+    return rows
+
+
+def pixel_kind(rgba):
+    r, g, b, a = rgba
+    if a < 128:
+        return TRANSPARENT
+    return WHITE if (r + g + b) >= 3 * 128 else BLACK
+
+
+def rotate(image, angle):
+    """Rotate clockwise (as the screen shows it) about the pivot.
+
+    Returns {(x, y): kind} of the opaque pixels, relative to the pivot."""
+    height = len(image)
+    width = len(image[0])
+    reach = int(math.ceil(math.hypot(max(PIVOT_X, width - PIVOT_X),
+                                     max(PIVOT_Y, height - PIVOT_Y)))) + 1
+    cos_a = math.cos(angle)
+    sin_a = math.sin(angle)
+    pixels = {}
+    for y in range(-reach, reach):
+        for x in range(-reach, reach):
+            #  sample the source at the pixel center, rotated back.
+            cx = x + 0.5
+            cy = y + 0.5
+            sx = int(math.floor(cx * cos_a + cy * sin_a + PIVOT_X))
+            sy = int(math.floor(-cx * sin_a + cy * cos_a + PIVOT_Y))
+            if 0 <= sx < width and 0 <= sy < height:
+                kind = pixel_kind(image[sy][sx])
+                if kind != TRANSPARENT:
+                    pixels[(x, y)] = kind
+    return pixels
+
+
+def encode(pixels):
+    left = min(x for x, _ in pixels)
+    right = max(x for x, _ in pixels)
+    top = min(y for _, y in pixels)
+    bottom = max(y for _, y in pixels)
+
+    out = bytearray(struct.pack('<bbB', left, top, bottom - top + 1))
+    for y in range(top, bottom + 1):
+        row = [pixels.get((x, y), TRANSPARENT) for x in range(left, right + 1)]
+        while row and row[-1] == TRANSPARENT:
+            row.pop()
+        x = 0
+        while x < len(row):
+            run = 1
+            while x + run < len(row) and row[x + run] == row[x] and run < MAX_RUN:
+                run += 1
+            out.append((row[x] << 6) | (run - 1))
+            x += run
+        out.append(END_ROW << 6)
+    return out
+
+
+def main():
+    image = read_png(IN_FILE)
+    num_stored = NUM_ANGLES // 4
+
+    sprites = [encode(rotate(image, 2 * math.pi * i / NUM_ANGLES))
+               for i in range(num_stored)]
+
+    header_len = 2 + 2 * (num_stored + 1)
+    offsets = [header_len]
+    for sprite in sprites:
+        offsets.append(offsets[-1] + len(sprite))
+
+    data = bytearray(struct.pack('<BB', NUM_ANGLES, num_stored))
+    data += struct.pack('<{}H'.format(num_stored + 1), *offsets)
+    for sprite in sprites:
+        data += sprite
+
+    with open(OUT_FILE, 'wb') as f:
+        f.write(data)
+
+    print('wrote {} sprites ({} bytes, largest {}) to {}'.format(
+        num_stored, len(data), max(len(s) for s in sprites), os.path.normpath(OUT_FILE)))
+
+
+if __name__ == '__main__':
+    main()
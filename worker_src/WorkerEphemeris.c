@@ -0,0 +1,19 @@
+/**
+ *  @file
+ *  
+ *  The worker's solar ephemeris records.  Workers can't read the app's
+ *  resources, so the worker has the table built in, and its suncalc reads
+ *  the same records the face's does.
+ */
+
+#include  "WorkerEphemerisTable.h"
+
+
+bool  solar_ephemeris_read(int32_t day, SolarEphemerisRecord aRecs[2])
+{
+
+   aRecs[0] = aWorkerEphemeris[day];
+   aRecs[1] = aWorkerEphemeris[day + 1];
+   return true;
+
+}  /* end of solar_ephemeris_read */
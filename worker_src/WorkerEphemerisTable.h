@@ -0,0 +1,384 @@
+/**
+ *  @file
+ *
+ *  The solar ephemeris table, as resources/data/solar_ephemeris.bin has it.
+ *  Generated by tools/gen_ephemeris.py; don't edit.
+ */
+
+#pragma once
+
+#include  "../src/SolarEphemeris.h"
+
+
+static const SolarEphemerisRecord  aWorkerEphemeris[SOLAR_EPHEMERIS_NUM_DAYS] =
+{
+   { -25734, 60272, 32898 },
+   { -25655, 60306, 32920 },
+   { -25569, 60342, 32941 },
+   { -25474, 60382, 32963 },
+   { -25371, 60426, 32983 },
+   { -25260, 60472, 33004 },
+   { -25142, 60522, 33024 },
+   { -25015, 60574, 33044 },
+   { -24880, 60629, 33064 },
+   { -24738, 60688, 33083 },
+   { -24588, 60749, 33102 },
+   { -24429, 60813, 33120 },
+   { -24264, 60879, 33138 },
+   { -24090, 60948, 33156 },
+   { -23909, 61019, 33173 },
+   { -23721, 61093, 33189 },
+   { -23525, 61168, 33206 },
+   { -23321, 61246, 33221 },
+   { -23110, 61326, 33236 },
+   { -22892, 61408, 33251 },
+   { -22667, 61491, 33264 },
+   { -22435, 61576, 33278 },
+   { -22195, 61663, 33291 },
+   { -21949, 61751, 33303 },
+   { -21696, 61841, 33314 },
+   { -21436, 61931, 33325 },
+   { -21169, 62023, 33336 },
+   { -20896, 62116, 33346 },
+   { -20616, 62209, 33355 },
+   { -20330, 62303, 33364 },
+   { -20037, 62398, 33372 },
+   { -19738, 62493, 33379 },
+   { -19433, 62588, 33386 },
+   { -19122, 62684, 33392 },
+   { -18806, 62780, 33397 },
+   { -18483, 62876, 33402 },
+   { -18155, 62971, 33406 },
+   { -17821, 63066, 33410 },
+   { -17482, 63161, 33413 },
+   { -17137, 63256, 33416 },
+   { -16787, 63350, 33417 },
+   { -16432, 63443, 33419 },
+   { -16072, 63535, 33419 },
+   { -15707, 63626, 33419 },
+   { -15337, 63716, 33419 },
+   { -14963, 63805, 33418 },
+   { -14584, 63893, 33416 },
+   { -14201, 63979, 33414 },
+   { -13814, 64064, 33411 },
+   { -13422, 64147, 33408 },
+   { -13027, 64228, 33404 },
+   { -12627, 64308, 33400 },
+   { -12224, 64386, 33395 },
+   { -11817, 64462, 33390 },
+   { -11407, 64536, 33384 },
+   { -10994, 64607, 33378 },
+   { -10577, 64677, 33371 },
+   { -10157, 64744, 33364 },
+   {  -9734, 64809, 33356 },
+   {  -9309, 64872, 33348 },
+   {  -8881, 64932, 33340 },
+   {  -8450, 64989, 33331 },
+   {  -8017, 65044, 33322 },
+   {  -7581, 65096, 33312 },
+   {  -7144, 65145, 33302 },
+   {  -6705, 65192, 33292 },
+   {  -6263, 65236, 33282 },
+   {  -5821, 65277, 33271 },
+   {  -5376, 65315, 33260 },
+   {  -4930, 65350, 33248 },
+   {  -4483, 65382, 33237 },
+   {  -4035, 65412, 33225 },
+   {  -3586, 65438, 33212 },
+   {  -3136, 65461, 33200 },
+   {  -2685, 65481, 33188 },
+   {  -2234, 65498, 33175 },
+   {  -1782, 65512, 33162 },
+   {  -1330, 65523, 33149 },
+   {   -878, 65530, 33135 },
+   {   -426, 65535, 33122 },
+   {     26, 65535, 33109 },
+   {    478, 65534, 33095 },
+   {    930, 65529, 33081 },
+   {   1380, 65521, 33068 },
+   {   1831, 65510, 33054 },
+   {   2280, 65496, 33040 },
+   {   2729, 65479, 33026 },
+   {   3176, 65459, 33013 },
+   {   3622, 65436, 32999 },
+   {   4067, 65410, 32985 },
+   {   4510, 65381, 32971 },
+   {   4952, 65349, 32958 },
+   {   5392, 65314, 32944 },
+   {   5830, 65276, 32931 },
+   {   6267, 65236, 32917 },
+   {   6701, 65193, 32904 },
+   {   7133, 65147, 32891 },
+   {   7562, 65098, 32878 },
+   {   7989, 65047, 32865 },
+   {   8414, 64994, 32853 },
+   {   8835, 64938, 32840 },
+   {   9254, 64879, 32828 },
+   {   9670, 64819, 32816 },
+   {  10083, 64756, 32804 },
+   {  10493, 64691, 32792 },
+   {  10899, 64623, 32781 },
+   {  11302, 64554, 32770 },
+   {  11702, 64483, 32759 },
+   {  12098, 64410, 32748 },
+   {  12490, 64335, 32738 },
+   {  12878, 64258, 32728 },
+   {  13262, 64180, 32719 },
+   {  13643, 64100, 32709 },
+   {  14019, 64019, 32700 },
+   {  14391, 63937, 32692 },
+   {  14758, 63853, 32683 },
+   {  15121, 63768, 32676 },
+   {  15480, 63682, 32668 },
+   {  15833, 63595, 32661 },
+   {  16182, 63507, 32654 },
+   {  16527, 63418, 32648 },
+   {  16866, 63329, 32642 },
+   {  17200, 63239, 32636 },
+   {  17530, 63148, 32631 },
+   {  17854, 63057, 32626 },
+   {  18172, 62966, 32622 },
+   {  18486, 62875, 32618 },
+   {  18794, 62783, 32614 },
+   {  19096, 62692, 32611 },
+   {  19393, 62601, 32609 },
+   {  19684, 62510, 32606 },
+   {  19970, 62419, 32605 },
+   {  20250, 62329, 32603 },
+   {  20523, 62239, 32602 },
+   {  20791, 62151, 32602 },
+   {  21053, 62062, 32602 },
+   {  21309, 61975, 32602 },
+   {  21559, 61889, 32603 },
+   {  21802, 61803, 32604 },
+   {  22039, 61719, 32606 },
+   {  22270, 61636, 32608 },
+   {  22495, 61554, 32611 },
+   {  22713, 61474, 32613 },
+   {  22924, 61396, 32617 },
+   {  23129, 61319, 32620 },
+   {  23328, 61244, 32624 },
+   {  23520, 61170, 32629 },
+   {  23705, 61099, 32634 },
+   {  23883, 61029, 32639 },
+   {  24055, 60962, 32644 },
+   {  24220, 60896, 32650 },
+   {  24378, 60833, 32657 },
+   {  24529, 60772, 32663 },
+   {  24674, 60714, 32670 },
+   {  24811, 60658, 32677 },
+   {  24941, 60604, 32684 },
+   {  25065, 60553, 32692 },
+   {  25181, 60505, 32700 },
+   {  25290, 60460, 32708 },
+   {  25393, 60417, 32717 },
+   {  25488, 60377, 32725 },
+   {  25576, 60339, 32734 },
+   {  25657, 60305, 32743 },
+   {  25730, 60274, 32752 },
+   {  25797, 60245, 32762 },
+   {  25856, 60220, 32771 },
+   {  25908, 60197, 32781 },
+   {  25953, 60178, 32790 },
+   {  25991, 60162, 32800 },
+   {  26022, 60149, 32810 },
+   {  26045, 60138, 32820 },
+   {  26061, 60132, 32829 },
+   {  26070, 60128, 32839 },
+   {  26071, 60127, 32849 },
+   {  26066, 60129, 32859 },
+   {  26053, 60135, 32869 },
+   {  26033, 60144, 32878 },
+   {  26005, 60156, 32888 },
+   {  25971, 60170, 32898 },
+   {  25929, 60188, 32907 },
+   {  25880, 60209, 32916 },
+   {  25824, 60234, 32925 },
+   {  25761, 60261, 32934 },
+   {  25691, 60291, 32943 },
+   {  25613, 60324, 32952 },
+   {  25529, 60359, 32960 },
+   {  25437, 60398, 32968 },
+   {  25338, 60439, 32976 },
+   {  25233, 60484, 32984 },
+   {  25120, 60531, 32991 },
+   {  25001, 60580, 32998 },
+   {  24874, 60632, 33005 },
+   {  24741, 60687, 33011 },
+   {  24600, 60744, 33017 },
+   {  24453, 60803, 33023 },
+   {  24299, 60865, 33028 },
+   {  24139, 60929, 33034 },
+   {  23971, 60995, 33038 },
+   {  23797, 61063, 33042 },
+   {  23617, 61133, 33046 },
+   {  23430, 61205, 33050 },
+   {  23236, 61279, 33053 },
+   {  23036, 61354, 33056 },
+   {  22829, 61431, 33058 },
+   {  22616, 61510, 33060 },
+   {  22397, 61590, 33061 },
+   {  22171, 61672, 33062 },
+   {  21940, 61755, 33062 },
+   {  21702, 61839, 33062 },
+   {  21458, 61924, 33062 },
+   {  21208, 62010, 33061 },
+   {  20952, 62097, 33060 },
+   {  20690, 62184, 33058 },
+   {  20422, 62273, 33056 },
+   {  20149, 62362, 33053 },
+   {  19870, 62451, 33050 },
+   {  19585, 62541, 33046 },
+   {  19295, 62631, 33042 },
+   {  18999, 62722, 33037 },
+   {  18698, 62812, 33032 },
+   {  18391, 62903, 33027 },
+   {  18080, 62993, 33021 },
+   {  17763, 63083, 33015 },
+   {  17441, 63173, 33008 },
+   {  17114, 63262, 33001 },
+   {  16782, 63351, 32993 },
+   {  16445, 63439, 32985 },
+   {  16104, 63527, 32977 },
+   {  15758, 63613, 32968 },
+   {  15407, 63699, 32958 },
+   {  15052, 63784, 32949 },
+   {  14693, 63868, 32939 },
+   {  14329, 63950, 32928 },
+   {  13961, 64032, 32918 },
+   {  13589, 64112, 32906 },
+   {  13213, 64190, 32895 },
+   {  12833, 64267, 32883 },
+   {  12449, 64343, 32871 },
+   {  12062, 64416, 32858 },
+   {  11671, 64488, 32846 },
+   {  11276, 64559, 32833 },
+   {  10878, 64627, 32819 },
+   {  10477, 64693, 32806 },
+   {  10073, 64757, 32792 },
+   {   9666, 64819, 32778 },
+   {   9255, 64879, 32763 },
+   {   8842, 64937, 32749 },
+   {   8426, 64992, 32734 },
+   {   8008, 65045, 32719 },
+   {   7587, 65095, 32704 },
+   {   7163, 65143, 32689 },
+   {   6738, 65189, 32673 },
+   {   6310, 65232, 32658 },
+   {   5880, 65272, 32642 },
+   {   5448, 65309, 32626 },
+   {   5015, 65344, 32610 },
+   {   4580, 65376, 32594 },
+   {   4143, 65405, 32578 },
+   {   3705, 65431, 32562 },
+   {   3265, 65455, 32546 },
+   {   2825, 65475, 32530 },
+   {   2383, 65493, 32513 },
+   {   1940, 65507, 32497 },
+   {   1497, 65519, 32481 },
+   {   1053, 65528, 32465 },
+   {    608, 65533, 32449 },
+   {    163, 65535, 32433 },
+   {   -283, 65535, 32417 },
+   {   -728, 65532, 32401 },
+   {  -1174, 65525, 32385 },
+   {  -1619, 65516, 32370 },
+   {  -2065, 65503, 32354 },
+   {  -2510, 65488, 32339 },
+   {  -2954, 65469, 32324 },
+   {  -3398, 65448, 32309 },
+   {  -3841, 65423, 32295 },
+   {  -4283, 65396, 32280 },
+   {  -4724, 65365, 32266 },
+   {  -5165, 65332, 32252 },
+   {  -5603, 65296, 32238 },
+   {  -6041, 65257, 32225 },
+   {  -6477, 65215, 32212 },
+   {  -6911, 65171, 32199 },
+   {  -7343, 65123, 32187 },
+   {  -7774, 65073, 32175 },
+   {  -8202, 65021, 32163 },
+   {  -8628, 64966, 32152 },
+   {  -9052, 64908, 32141 },
+   {  -9474, 64848, 32130 },
+   {  -9892, 64785, 32120 },
+   { -10308, 64720, 32110 },
+   { -10722, 64653, 32101 },
+   { -11132, 64584, 32092 },
+   { -11539, 64512, 32084 },
+   { -11943, 64439, 32076 },
+   { -12343, 64363, 32068 },
+   { -12740, 64286, 32062 },
+   { -13134, 64206, 32055 },
+   { -13523, 64126, 32049 },
+   { -13909, 64043, 32044 },
+   { -14291, 63959, 32039 },
+   { -14668, 63873, 32035 },
+   { -15042, 63786, 32032 },
+   { -15411, 63698, 32028 },
+   { -15775, 63609, 32026 },
+   { -16135, 63519, 32024 },
+   { -16490, 63427, 32023 },
+   { -16841, 63335, 32022 },
+   { -17186, 63242, 32022 },
+   { -17526, 63149, 32023 },
+   { -17861, 63055, 32024 },
+   { -18191, 62961, 32026 },
+   { -18515, 62866, 32028 },
+   { -18834, 62771, 32031 },
+   { -19147, 62677, 32035 },
+   { -19455, 62582, 32039 },
+   { -19756, 62487, 32044 },
+   { -20052, 62393, 32050 },
+   { -20342, 62299, 32056 },
+   { -20625, 62206, 32063 },
+   { -20902, 62113, 32071 },
+   { -21173, 62021, 32079 },
+   { -21438, 61931, 32088 },
+   { -21695, 61841, 32098 },
+   { -21947, 61752, 32108 },
+   { -22191, 61665, 32118 },
+   { -22429, 61578, 32130 },
+   { -22660, 61494, 32142 },
+   { -22884, 61411, 32154 },
+   { -23101, 61330, 32167 },
+   { -23311, 61250, 32181 },
+   { -23513, 61173, 32195 },
+   { -23708, 61097, 32210 },
+   { -23896, 61024, 32226 },
+   { -24077, 60953, 32242 },
+   { -24250, 60884, 32258 },
+   { -24416, 60818, 32275 },
+   { -24574, 60754, 32292 },
+   { -24724, 60693, 32310 },
+   { -24867, 60635, 32328 },
+   { -25001, 60580, 32347 },
+   { -25128, 60527, 32366 },
+   { -25248, 60477, 32386 },
+   { -25359, 60431, 32406 },
+   { -25462, 60387, 32426 },
+   { -25558, 60347, 32447 },
+   { -25645, 60310, 32467 },
+   { -25724, 60276, 32489 },
+   { -25796, 60246, 32510 },
+   { -25859, 60219, 32532 },
+   { -25914, 60195, 32554 },
+   { -25960, 60175, 32576 },
+   { -25999, 60158, 32598 },
+   { -26029, 60145, 32620 },
+   { -26052, 60136, 32643 },
+   { -26066, 60129, 32665 },
+   { -26071, 60127, 32688 },
+   { -26069, 60128, 32710 },
+   { -26058, 60133, 32733 },
+   { -26039, 60141, 32756 },
+   { -26012, 60153, 32778 },
+   { -25977, 60168, 32801 },
+   { -25933, 60187, 32823 },
+   { -25881, 60209, 32845 },
+   { -25821, 60235, 32867 },
+   { -25753, 60264, 32889 },
+   { -25676, 60297, 32911 },
+   { -25592, 60333, 32932 },
+   { -25499, 60372, 32954 },
+};
@@ -0,0 +1,160 @@
+/**
+ *  @file
+ *  
+ *  Background worker: keeps the twilight schedule topped up, so that the
+ *  face does no solar math of its own.  See src/SolarWorker.h.
+ *  
+ *  Built from the files listed in wscript's worker_shared_src as well as
+ *  those here.
+ */
+
+
+#include  "../src/ConfigData.h"
+#include  "../src/SolarWorker.h"
+#include  "../src/TaskScheduler.h"
+#include  "../src/TwilightSchedule.h"
+
+
+//  The shared code is written against pebble.h, which can't be included
+//  along with pebble_worker.h.  It has everything we use bar this:
+void  worker_event_loop(void);
+
+
+///  Lifts a SOLAR_WORKER_MSG_HOLD the face didn't, or NULL if not held.
+static AppTimer *pHoldTimer = NULL;
+
+
+///  Build the schedule if the face's request and the location call for it.
+static void  worker_refresh(void)
+{
+
+   SolarWorkerRequest request;
+
+   if (pHoldTimer != NULL)
+   {
+      //  the face is writing the schedule.
+      return;
+   }
+
+   int iRet = persist_read_data(SOLAR_WORKER_KEY_REQUEST, &request, sizeof(request));
+   if ((iRet != (int) sizeof(request)) ||
+       (request.usVersion != SOLAR_WORKER_REQUEST_VERSION) ||
+       (request.usBands > TWILIGHT_SCHEDULE_MAX_BANDS))
+   {
+      //  face hasn't asked for anything yet.
+      return;
+   }
+
+   //  The face may have changed the location or schedule since we last
+   //  looked.
+   config_data_init();
+   twilight_schedule_reload();
+
+   float aZeniths[TWILIGHT_SCHEDULE_MAX_BANDS];
+   memcpy(aZeniths, request.aZeniths, request.usBands * sizeof(aZeniths[0]));
+
+   time_t now = time(NULL);
+   twilight_schedule_refresh(aZeniths, request.usBands, localtime(&now));
+
+}  /* end of worker_refresh */
+
+
+///  TwilightSchedule callback: tell the face.
+static void  worker_schedule_built(const TwilightScheduleStats *pStats)
+{
+
+   AppWorkerMessage message;
+
+   message.data0 = pStats->usDays;
+   message.data1 = (pStats->ulBuildMs > 0xFFFF) ? 0xFFFF : (uint16_t) pStats->ulBuildMs;
+   message.data2 = pStats->usFlashBytes;
+
+   app_worker_send_message(SOLAR_WORKER_MSG_SCHEDULE_READY, &message);
+
+}  /* end of worker_schedule_built */
+
+
+///  The face never lifted its hold.
+static void  worker_hold_timer_callback(void *pData)
+{
+   (void) pData;
+
+   pHoldTimer = NULL;
+   worker_refresh();
+}
+
+
+///  Hold off the schedule, or carry on, as the face asks.
+static void  worker_hold(bool fHold)
+{
+
+   if (pHoldTimer != NULL)
+   {
+      app_timer_cancel(pHoldTimer);
+      pHoldTimer = NULL;
+   }
+
+   if (fHold)
+   {
+      twilight_schedule_cancel();
+      pHoldTimer = app_timer_register(SOLAR_WORKER_HOLD_MAX_SECS * 1000,
+                                      worker_hold_timer_callback, NULL);
+
+      //  The face waits for this before it touches the schedule keys.
+      AppWorkerMessage message;
+      memset(&message, 0, sizeof(message));
+      app_worker_send_message(SOLAR_WORKER_MSG_HELD, &message);
+   }
+   else
+   {
+      worker_refresh();
+   }
+
+}  /* end of worker_hold */
+
+
+static void  worker_message_handler(uint16_t type, AppWorkerMessage *pData)
+{
+
+   if (type == SOLAR_WORKER_MSG_REFRESH)
+   {
+      worker_refresh();
+   }
+   else if (type == SOLAR_WORKER_MSG_HOLD)
+   {
+      worker_hold(pData->data0 != 0);
+   }
+
+}  /* end of worker_message_handler */
+
+
+static void  worker_day_tick(struct tm *tick_time, TimeUnits units_changed)
+{
+   (void) tick_time;
+   (void) units_changed;
+
+   worker_refresh();
+}
+
+
+int  main(void)
+{
+
+   twilight_schedule_set_built_callback(worker_schedule_built);
+   app_worker_message_subscribe(worker_message_handler);
+   tick_timer_service_subscribe(DAY_UNIT, worker_day_tick);
+
+   worker_refresh();
+
+   worker_event_loop();
+
+   tick_timer_service_unsubscribe();
+   app_worker_message_unsubscribe();
+   if (pHoldTimer != NULL)
+   {
+      app_timer_cancel(pHoldTimer);
+   }
+   twilight_schedule_cancel();
+   task_scheduler_deinit();
+
+}  /* end of main() */